@@ -0,0 +1,152 @@
+#include "AllocationTracker.h"
+#include <cstdlib>
+#include <new>
+
+// Per thread counters, plain data so they are safe to touch from inside operator new.
+static thread_local size_t t_AllocationCount = 0;
+static thread_local size_t t_FreeCount = 0;
+static thread_local size_t t_AllocatedBytes = 0;
+
+static void* TrackedAlloc(size_t size)
+{
+	++t_AllocationCount;
+	t_AllocatedBytes += size;
+
+	// malloc(0) is allowed to return null, new must not.
+	void* memory = malloc(size > 0 ? size : 1);
+	return memory;
+}
+
+static void* TrackedAlignedAlloc(size_t size, size_t alignment)
+{
+	++t_AllocationCount;
+	t_AllocatedBytes += size;
+
+#ifdef _MSC_VER
+	return _aligned_malloc(size > 0 ? size : 1, alignment);
+#else
+	// aligned_alloc needs the size to be a multiple of the alignment.
+	size_t alignedSize = ((size > 0 ? size : 1) + alignment - 1) & ~(alignment - 1);
+	return aligned_alloc(alignment, alignedSize);
+#endif
+}
+
+static void TrackedFree(void* memory)
+{
+	if (memory == nullptr)
+		return;
+
+	++t_FreeCount;
+	free(memory);
+}
+
+static void TrackedAlignedFree(void* memory)
+{
+	if (memory == nullptr)
+		return;
+
+	++t_FreeCount;
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+//-------------------------------------------------------------------------------
+// Global operator new/delete replacements.
+//-------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+	void* memory = TrackedAlloc(size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = TrackedAlloc(size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* memory = TrackedAlignedAlloc(size, (size_t)alignment);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* memory = TrackedAlignedAlloc(size, (size_t)alignment);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void operator delete(void* memory) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, size_t) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory, size_t) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { TrackedFree(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { TrackedAlignedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { TrackedAlignedFree(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { TrackedAlignedFree(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { TrackedAlignedFree(memory); }
+
+//-------------------------------------------------------------------------------
+// AllocationTracker.
+//-------------------------------------------------------------------------------
+size_t AllocationTracker::GetThreadAllocationCount()
+{
+	return t_AllocationCount;
+}
+
+size_t AllocationTracker::GetThreadFreeCount()
+{
+	return t_FreeCount;
+}
+
+size_t AllocationTracker::GetThreadAllocatedBytes()
+{
+	return t_AllocatedBytes;
+}
+
+//-------------------------------------------------------------------------------
+// AllocationScope.
+//-------------------------------------------------------------------------------
+AllocationScope::AllocationScope(const char* name)
+{
+	m_Name = name;
+	m_StartAllocationCount = t_AllocationCount;
+	m_StartAllocatedBytes = t_AllocatedBytes;
+}
+
+size_t AllocationScope::GetAllocationCount() const
+{
+	return t_AllocationCount - m_StartAllocationCount;
+}
+
+size_t AllocationScope::GetAllocatedBytes() const
+{
+	return t_AllocatedBytes - m_StartAllocatedBytes;
+}
\ No newline at end of file
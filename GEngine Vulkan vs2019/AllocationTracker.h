@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+
+// Counts heap allocations made through the global operator new/delete.
+// Counters are kept per thread so worker threads don't pollute the main thread's numbers.
+class AllocationTracker
+{
+public:
+	// Get the number of allocations made on the calling thread.
+	// Returns: total allocations since the thread started.
+	static size_t GetThreadAllocationCount();
+
+	// Get the number of frees made on the calling thread.
+	// Returns: total frees since the thread started.
+	static size_t GetThreadFreeCount();
+
+	// Get the amount of bytes allocated on the calling thread.
+	// Returns: total bytes requested since the thread started.
+	static size_t GetThreadAllocatedBytes();
+};
+
+// Scope marker that measures the heap allocations made on the current thread while it is alive.
+class AllocationScope
+{
+public:
+	// Constructor.
+	// Params: name of the scope, used when reporting.
+	AllocationScope(const char* name);
+
+	// Get the allocations made since the scope began.
+	// Returns: number of allocations.
+	size_t GetAllocationCount() const;
+
+	// Get the bytes allocated since the scope began.
+	// Returns: number of bytes.
+	size_t GetAllocatedBytes() const;
+
+	// Get the name of the scope.
+	// Returns: the name given on construction.
+	const char* GetName() const { return m_Name; }
+
+private:
+	// Name of the scope.
+	const char* m_Name;
+
+	// Thread allocation count when the scope began.
+	size_t m_StartAllocationCount;
+
+	// Thread allocated bytes when the scope began.
+	size_t m_StartAllocatedBytes;
+};
\ No newline at end of file
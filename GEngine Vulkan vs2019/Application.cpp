@@ -1,4 +1,15 @@
 #include "Application.h"
+#include "DescriptorAllocator.h"
+#include "RenderGraph.h"
+#include "DynamicResolution.h"
+#include "TemporalUpsampler.h"
+#include "FrameTimeline.h"
+#include "GpuMesh.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <string>
 
 	Application::Application()
 	{
@@ -6,16 +17,24 @@
 
 		m_VulkanRenderer = new VulkanRenderer(1280, 720);
 
-		m_GameScene = new Scene();
-		m_GameScene->CreateSemaphores(m_VulkanRenderer);
+		m_JobSystem = new JobSystem();
+
+		m_GameScene = new Scene(m_JobSystem);
+
+		// The demo triangle.
+		m_GameScene->CreateGameObject();
 	}
 
 	Application::~Application()
 	{
-		m_GameScene->DeleteSamophores(m_VulkanRenderer);
+		// The scene's GPU resources might still be used by frames in flight.
+		m_VulkanRenderer->WaitIdle();
 		delete m_GameScene;
 		m_GameScene = nullptr;
 
+		delete m_JobSystem;
+		m_JobSystem = nullptr;
+
 		delete m_VulkanRenderer;
 		m_VulkanRenderer = nullptr;
 	}
@@ -29,15 +48,267 @@
 	{
 		while (!m_ShuttingDown)
 		{
+			// Everything in here runs every frame, so it shouldn't touch the heap once warmed up.
+			AllocationScope frameScope("Application::Run frame");
+
 			m_CurrentFrame = glfwGetTime();
 			m_DeltaTime = m_CurrentFrame - m_LastFrame;
 			m_LastFrame = m_CurrentFrame;
 
 			m_GameScene->Update((float)m_DeltaTime);
 
+			// Only waits for the GPU when it's MAX_FRAMES_IN_FLIGHT frames behind.
 			m_GameScene->Draw(m_VulkanRenderer);
-			vkDeviceWaitIdle(m_VulkanRenderer->GetLogicalDevice());
+
+			if (m_AllocationTestMode)
+				CheckFrameAllocations(frameScope);
+
+			if (m_GpuCullingTestMode)
+				CheckGpuCulling();
+
+			// The graph's built on the first frame drawn, or again when culling changes.
+			if (m_RenderGraphDump)
+			{
+				std::cout << m_VulkanRenderer->GetRenderGraph()->Dump();
+				m_RenderGraphDump = false;
+			}
+
+			if (m_DrawStatsInterval > 0 && m_FrameCount % m_DrawStatsInterval == 0)
+			{
+				RenderQueueStats stats = m_GameScene->GetRenderQueueStats();
+				std::cout << "Render queue: " << stats.m_ObjectCount << " objects in " << stats.m_DrawCount << " draws." << std::endl;
+
+				const DescriptorAllocatorStats& descriptorStats = m_VulkanRenderer->GetDescriptorAllocator()->GetStats();
+				std::cout << "Descriptors: " << descriptorStats.m_PoolCount << " pools, " << descriptorStats.m_SetsAllocated << " sets allocated, "
+					<< descriptorStats.m_CacheHits << " cache hits, " << descriptorStats.m_CacheMisses << " misses." << std::endl;
+
+				if (m_GameScene->GetLightCount() > 0)
+				{
+					LightCullStats lightStats = m_GameScene->GetLightCullStats();
+					std::cout << "Lights: " << lightStats.m_VisibleLightCount << " of " << lightStats.m_LightCount << " visible, " << lightStats.m_IndexCount
+						<< " cluster entries, up to " << lightStats.m_MaxClusterLights << " in a cluster" << (lightStats.m_Overflowed ? ", index list full." : ".") << std::endl;
+				}
+
+				DynamicResolution* dynamicResolution = m_VulkanRenderer->GetDynamicResolution();
+				if (dynamicResolution != nullptr)
+				{
+					const DynamicResolutionStats& resolutionStats = dynamicResolution->GetStats();
+					VkExtent2D renderExtent = m_VulkanRenderer->GetRenderExtent();
+					std::cout << "Resolution: " << renderExtent.width << "x" << renderExtent.height << " at " << (int)(resolutionStats.m_Scale * 100.0f + 0.5f)
+						<< "% scale, GPU " << resolutionStats.m_GpuTime << " ms, smoothed " << resolutionStats.m_SmoothedGpuTime << " ms, "
+						<< resolutionStats.m_ScaleChanges << " scale changes." << std::endl;
+				}
+
+				TemporalUpsampler* temporalUpsampler = m_VulkanRenderer->GetTemporalUpsampler();
+				if (temporalUpsampler != nullptr)
+				{
+					const TemporalUpsamplerStats& temporalStats = temporalUpsampler->GetStats();
+					std::cout << "Temporal upsampling: " << temporalStats.m_RenderExtent.width << "x" << temporalStats.m_RenderExtent.height << " to "
+						<< temporalStats.m_OutputExtent.width << "x" << temporalStats.m_OutputExtent.height << ", jitter (" << temporalStats.m_Jitter.x << ", "
+						<< temporalStats.m_Jitter.y << ") of " << temporalStats.m_JitterPhaseCount << " phases, " << temporalStats.m_HistoryResets
+						<< " history resets." << std::endl;
+				}
+
+				if (m_VulkanRenderer->IsAsyncComputeEnabled())
+				{
+					const RenderGraphStats& graphStats = m_VulkanRenderer->GetRenderGraph()->GetStats();
+					std::cout << "Async compute: " << graphStats.m_AsyncPassCount << " passes on the compute queue, " << graphStats.m_SegmentCount
+						<< " submissions with " << graphStats.m_QueueWaitCount << " waiting for the other queue." << std::endl;
+				}
+
+				if (m_GameScene->IsCullingClusters())
+				{
+					const GpuCullStats& cullStats = m_GameScene->GetGpuCullStats();
+					std::cout << "Clusters: " << cullStats.m_DrawCounts[0] + cullStats.m_DrawCounts[1] << " of " << cullStats.m_TestedObjects << " drawn, "
+						<< cullStats.m_FrustumCulled << " outside the frustum, " << cullStats.m_BackfaceCulled << " facing away, " << cullStats.m_OcclusionCulled
+						<< " occluded." << std::endl;
+				}
+
+				const LodStats& lodStats = m_GameScene->GetLodStats();
+				if (lodStats.m_FullDetailTriangleCount > 0)
+				{
+					std::cout << "LODs:";
+					for (uint i = 0; i < m_VulkanRenderer->GetDemoMesh()->GetLodCount(); ++i)
+						std::cout << (i == 0 ? " " : ", ") << lodStats.m_ObjectCounts[i] << " at " << i;
+					std::cout << ", " << lodStats.m_FadingCount << " fading, " << lodStats.m_TriangleCount << " of " << lodStats.m_FullDetailTriangleCount
+						<< " triangles at full detail." << std::endl;
+				}
+
+				ShadowStats shadowStats = m_GameScene->GetShadowStats();
+				if (shadowStats.m_TileCount > 0)
+				{
+					std::cout << "Shadows: " << shadowStats.m_TileCount << " tiles for " << shadowStats.m_PointLightCount << " point lights, "
+						<< shadowStats.m_StaticTilesDrawn << " drawn into the cache with " << shadowStats.m_StaticCasterCount << " static casters, "
+						<< shadowStats.m_DynamicCasterCount << " dynamic casters." << std::endl;
+				}
+			}
+
+			++m_FrameCount;
 		}
 
 		return;
+	}
+
+	void Application::EnableAllocationTest(uint warmupFrames, uint testFrames)
+	{
+		m_AllocationTestMode = true;
+		m_AllocationTestWarmupFrames = warmupFrames;
+		m_AllocationTestFrames = testFrames;
+	}
+
+	void Application::CheckFrameAllocations(const AllocationScope& frameScope)
+	{
+		// Let caches and pools fill up before enforcing anything.
+		if (m_FrameCount < m_AllocationTestWarmupFrames)
+			return;
+
+		if (frameScope.GetAllocationCount() > 0)
+		{
+			throw std::runtime_error(std::string("Allocation test failed! ") + frameScope.GetName() + " made " +
+				std::to_string(frameScope.GetAllocationCount()) + " allocations (" + std::to_string(frameScope.GetAllocatedBytes()) +
+				" bytes) on frame " + std::to_string(m_FrameCount) + ".");
+		}
+
+		if (m_FrameCount + 1 >= m_AllocationTestWarmupFrames + m_AllocationTestFrames)
+		{
+			std::cout << "Allocation test passed, " << m_AllocationTestFrames << " frames ran without allocating." << std::endl;
+			m_ShuttingDown = true;
+		}
+	}
+
+	void Application::EnableGpuCulling(bool checkResults, uint testFrames)
+	{
+		m_GameScene->EnableGpuCulling(m_VulkanRenderer, checkResults);
+		m_GpuCullingTestMode = checkResults;
+		m_GpuCullingTestFrames = testFrames;
+	}
+
+	void Application::EnableDrawStats(uint interval)
+	{
+		m_DrawStatsInterval = interval;
+	}
+
+	void Application::EnableRenderGraphDump()
+	{
+		m_RenderGraphDump = true;
+	}
+
+	void Application::EnableDepthPrepass()
+	{
+		m_VulkanRenderer->SetDepthPrepassEnabled(true);
+	}
+
+	void Application::EnableLights(uint count)
+	{
+		m_GameScene->SetCamera(glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+
+		// The same lights every run, so runs can be compared.
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> colour(0.2f, 1.0f);
+		for (uint i = 0; i < count; ++i)
+		{
+			PointLight light;
+			light.m_Position = glm::vec3(position(random), position(random), position(random) * 0.5f);
+			light.m_Radius = 0.3f;
+			light.m_Colour = glm::vec3(colour(random), colour(random), colour(random));
+			light.m_Intensity = 4.0f / count;
+			m_GameScene->AddLight(light);
+		}
+	}
+
+	void Application::EnableShadows()
+	{
+		m_GameScene->SetCamera(glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+
+		DirectionalLight sun;
+		sun.m_Direction = glm::normalize(glm::vec3(0.3f, -0.4f, -1.0f));
+		sun.m_Intensity = 0.9f;
+		m_GameScene->SetDirectionalLight(sun);
+
+		// The wall never moves, so its shadow map tiles are only drawn once and copied from the cache after that.
+		GameObject* wall = m_GameScene->CreateGameObject();
+		wall->SetStatic(true);
+		wall->SetLocalMatrix(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.5f)), glm::vec3(6.0f, 6.0f, 1.0f)));
+
+		m_GameScene->EnableShadows(m_VulkanRenderer);
+	}
+
+	void Application::EnableDynamicResolution()
+	{
+		m_VulkanRenderer->EnableDynamicResolution(1000.0f / 60.0f, 0.5f, 1.0f);
+	}
+
+	void Application::EnableTemporalUpsampling()
+	{
+		m_VulkanRenderer->EnableTemporalUpsampling(0.5f);
+	}
+
+	void Application::EnableAsyncCompute()
+	{
+		if (!m_VulkanRenderer->IsAsyncComputeSupported())
+			std::cout << "Async compute isn't supported, culling stays on the graphics queue." << std::endl;
+
+		m_VulkanRenderer->SetAsyncComputeEnabled(true);
+	}
+
+	void Application::EnableVertexFormat(VertexFormat format)
+	{
+		m_VulkanRenderer->SetVertexFormat(format);
+	}
+
+	void Application::EnableMesh(const std::string& path)
+	{
+		Mesh mesh;
+		mesh.Load(path);
+		m_VulkanRenderer->SetDemoMesh(mesh);
+
+		// The mesh's longest side is as long as the triangle's, centred where the triangle was.
+		glm::vec3 extents = mesh.m_Bounds.GetExtents();
+		float size = std::max(std::max(extents.x, extents.y), extents.z) * 2.0f;
+		glm::mat4 fit = glm::scale(glm::mat4(1.0f), glm::vec3(size > 0.0f ? 1.0f / size : 1.0f));
+		fit = glm::translate(fit, -mesh.m_Bounds.GetCentre());
+
+		GameObject* gameObject = m_GameScene->GetGameObject(0);
+		gameObject->SetLocalBounds(mesh.m_Bounds);
+		gameObject->SetLocalMatrix(fit);
+		m_GameScene->MarkStaticObjectsChanged();
+
+		m_GameScene->SetCamera(glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+	}
+
+	void Application::EnableClusterCulling()
+	{
+		m_GameScene->SetClusterCullingEnabled(true);
+	}
+
+	void Application::EnableLodQualityBias(float bias)
+	{
+		m_GameScene->SetLodQualityBias(bias);
+	}
+
+	void Application::EnableLodCrossFade()
+	{
+		m_GameScene->SetLodCrossFadeTime(0.25f);
+	}
+
+	void Application::CheckGpuCulling()
+	{
+		// The read back draws have to be from the frame just drawn, so it's waited for.
+		FrameTimeline* timeline = m_VulkanRenderer->GetFrameTimeline();
+		timeline->WaitForFrame(timeline->GetSubmittedFrame());
+		if (!m_GameScene->CheckGpuCulling())
+		{
+			throw std::runtime_error("GPU culling test failed! The GPU drew different objects to the CPU cull on frame " +
+				std::to_string(m_FrameCount) + ".");
+		}
+
+		if (m_FrameCount + 1 >= m_GpuCullingTestFrames)
+		{
+			std::cout << "GPU culling test passed, " << m_GpuCullingTestFrames << " frames matched the CPU." << std::endl;
+			m_ShuttingDown = true;
+		}
 	}
\ No newline at end of file
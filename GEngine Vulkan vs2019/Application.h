@@ -1,6 +1,8 @@
 #pragma once
 #include "Scene.h"
 #include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include "JobSystem.h"
 
  class Application
  {
@@ -20,7 +22,67 @@
 		// Get the renderer from the application.
 		VulkanRenderer* GetRenderer() { return m_VulkanRenderer; }
 
+		// Run in allocation test mode, failing if the frame body allocates after warm-up.
+		// Params: frames to run before checking, frames to check before shutting down.
+		void EnableAllocationTest(uint warmupFrames, uint testFrames);
+
+		// Cull on the GPU, optionally checking every frame against the CPU.
+		// Params: if the results should be checked, frames to check before shutting down.
+		void EnableGpuCulling(bool checkResults, uint testFrames);
+
+		// Print the render queue's draw counts before and after merging every so often.
+		// Params: frames between prints.
+		void EnableDrawStats(uint interval);
+
+		// Print the compiled render graph after the first frame: passes, barriers and transient memory.
+		void EnableRenderGraphDump();
+
+		// Draw depth in a pre-pass and shade only what's at that depth, to compare against drawing without one.
+		void EnableDepthPrepass();
+
+		// Put the camera in front of the demo triangle and scatter point lights around it, shaded with clustered lighting.
+		// Params: the amount of lights.
+		void EnableLights(uint count);
+
+		// Put the camera in front of the demo triangle, light it with a directional light and draw its shadow on a static wall behind it.
+		void EnableShadows();
+
+		// Draw the scene at a resolution that keeps the GPU inside a 60 fps frame, upscaled to the window.
+		void EnableDynamicResolution();
+
+		// Draw the scene at half the window's width and height with a jittered projection, and rebuild the full resolution from several frames.
+		void EnableTemporalUpsampling();
+
+		// Cull on the compute queue alongside the graphics work that doesn't need it, if the device has a queue for it.
+		void EnableAsyncCompute();
+
+		// Store vertices in another format, to compare memory and bandwidth against the default octahedral 16 bit one.
+		// Params: the format.
+		void EnableVertexFormat(VertexFormat format);
+
+		// Draw a cooked mesh instead of the demo triangle, scaled to the triangle's size in front of the camera.
+		// Params: the path of the .gmesh file.
+		void EnableMesh(const std::string& path);
+
+		// Cull each of the mesh's meshlets on its own when culling on the GPU, printing how many were culled with the draw stats.
+		void EnableClusterCulling();
+
+		// Pick levels of detail with a quality bias, the way a performance tier would. Each step down lets twice as much
+		// error on screen, each step up half.
+		// Params: the bias.
+		void EnableLodQualityBias(float bias);
+
+		// Cross-fade objects between levels of detail with a dither rather than switching straight away.
+		void EnableLodCrossFade();
+
 	private:
+		// Check the allocations made during a frame when in allocation test mode.
+		// Params: the scope that covered the frame body.
+		void CheckFrameAllocations(const AllocationScope& frameScope);
+
+		// Check the GPU cull of the last frame against the CPU when in GPU cull test mode.
+		void CheckGpuCulling();
+
 		// The vulkan renderer.
 		VulkanRenderer* m_VulkanRenderer;
 
@@ -30,8 +92,35 @@
 		// The game scene.
 		Scene* m_GameScene;
 
+		// Worker threads for per frame work.
+		JobSystem* m_JobSystem;
+
 		// For calculating delta time.
 		double m_CurrentFrame = 0.0;
 		double m_LastFrame = 0.0;
 		double m_DeltaTime = 0.0;
+
+		// Amount of frames run so far.
+		uint m_FrameCount = 0;
+
+		// If the frame body should be checked for heap allocations.
+		bool m_AllocationTestMode = false;
+
+		// Frames to run before allocations are checked.
+		uint m_AllocationTestWarmupFrames = 0;
+
+		// Frames to check before the test passes.
+		uint m_AllocationTestFrames = 0;
+
+		// If the GPU cull results are checked against the CPU every frame.
+		bool m_GpuCullingTestMode = false;
+
+		// Frames to check GPU culling for before the test passes.
+		uint m_GpuCullingTestFrames = 0;
+
+		// Frames between printing draw counts, 0 to not print them.
+		uint m_DrawStatsInterval = 0;
+
+		// If the render graph should be printed after the next frame.
+		bool m_RenderGraphDump = false;
  };
\ No newline at end of file
@@ -0,0 +1,510 @@
+#include "BVH.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Amount of bins the SAH split search sorts centroids into.
+static const int BIN_COUNT = 16;
+// Leaves always split above this many items, if they can.
+static const uint MAX_LEAF_ITEMS = 8;
+// Cost of visiting a node relative to testing an item.
+static const float TRAVERSAL_COST = 1.0f;
+// Deepest a query can go. SAH builds of a million items stay well under this.
+static const int MAX_QUERY_DEPTH = 256;
+// Marks a node on a frustum query stack as already known to be inside.
+static const uint INSIDE_FLAG = 0x80000000u;
+
+BVH::BVH()
+{
+	m_AnyDirty = false;
+}
+
+BVH::~BVH()
+{
+
+}
+
+void BVH::Clear()
+{
+	m_Nodes.clear();
+	m_ItemBounds.clear();
+	m_ItemIds.clear();
+	m_ItemLeaves.clear();
+	m_ItemPositions.clear();
+	m_DirtyNodes.clear();
+	m_AnyDirty = false;
+}
+
+void BVH::Build(const AABB* bounds, const uint* ids, size_t count)
+{
+	Clear();
+
+	if (count == 0)
+		return;
+
+	std::vector<glm::vec3> centroids(count);
+	std::vector<uint> order(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		centroids[i] = bounds[i].GetCentre();
+		order[i] = (uint)i;
+	}
+
+	m_ItemLeaves.resize(count);
+	m_Nodes.reserve(count * 2);
+
+	struct BuildTask
+	{
+		uint m_Node;
+		uint m_First;
+		uint m_Count;
+	};
+
+	std::vector<BuildTask> tasks;
+	m_Nodes.push_back(BVHNode{ AABB::Empty(), INVALID_BVH_NODE, INVALID_BVH_NODE, INVALID_BVH_NODE, 0, 0 });
+	tasks.push_back({ 0, 0, (uint)count });
+
+	while (!tasks.empty())
+	{
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		AABB nodeBounds = AABB::Empty();
+		AABB centroidBounds = AABB::Empty();
+		for (uint i = task.m_First; i < task.m_First + task.m_Count; ++i)
+		{
+			nodeBounds.Grow(bounds[order[i]]);
+			centroidBounds.Grow(centroids[order[i]]);
+		}
+
+		m_Nodes[task.m_Node].m_Bounds = nodeBounds;
+
+		// Find the cheapest binned split on any axis.
+		int bestAxis = -1;
+		int bestSplit = 0;
+		float bestCost = FLT_MAX;
+
+		if (task.m_Count > 2)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float extent = centroidBounds.m_Max[axis] - centroidBounds.m_Min[axis];
+				if (extent <= 0.0f)
+					continue;
+
+				uint binCounts[BIN_COUNT] = {};
+				AABB binBounds[BIN_COUNT];
+				for (int b = 0; b < BIN_COUNT; ++b)
+					binBounds[b] = AABB::Empty();
+
+				float scale = BIN_COUNT / extent;
+				for (uint i = task.m_First; i < task.m_First + task.m_Count; ++i)
+				{
+					int bin = std::min((int)((centroids[order[i]][axis] - centroidBounds.m_Min[axis]) * scale), BIN_COUNT - 1);
+					++binCounts[bin];
+					binBounds[bin].Grow(bounds[order[i]]);
+				}
+
+				// Sweep from the right to get the cost of everything right of each split.
+				float rightCosts[BIN_COUNT];
+				AABB rightBounds = AABB::Empty();
+				uint rightCount = 0;
+				for (int b = BIN_COUNT - 1; b > 0; --b)
+				{
+					rightBounds.Grow(binBounds[b]);
+					rightCount += binCounts[b];
+					rightCosts[b] = rightCount > 0 ? rightBounds.GetSurfaceArea() * rightCount : 0.0f;
+				}
+
+				AABB leftBounds = AABB::Empty();
+				uint leftCount = 0;
+				for (int b = 0; b < BIN_COUNT - 1; ++b)
+				{
+					leftBounds.Grow(binBounds[b]);
+					leftCount += binCounts[b];
+					if (leftCount == 0 || leftCount == task.m_Count)
+						continue;
+
+					float cost = leftBounds.GetSurfaceArea() * leftCount + rightCosts[b + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = b;
+					}
+				}
+			}
+		}
+
+		float nodeArea = nodeBounds.GetSurfaceArea();
+		float leafCost = nodeArea * task.m_Count;
+		float splitCost = TRAVERSAL_COST * nodeArea + bestCost;
+
+		uint middle;
+		if (task.m_Count <= 2 || (bestAxis < 0 && task.m_Count <= MAX_LEAF_ITEMS) || (bestAxis >= 0 && splitCost >= leafCost && task.m_Count <= MAX_LEAF_ITEMS))
+		{
+			BVHNode& leaf = m_Nodes[task.m_Node];
+			leaf.m_FirstItem = task.m_First;
+			leaf.m_ItemCount = task.m_Count;
+
+			for (uint i = task.m_First; i < task.m_First + task.m_Count; ++i)
+				m_ItemLeaves[i] = task.m_Node;
+
+			continue;
+		}
+		else if (bestAxis >= 0)
+		{
+			float scale = BIN_COUNT / (centroidBounds.m_Max[bestAxis] - centroidBounds.m_Min[bestAxis]);
+			float minimum = centroidBounds.m_Min[bestAxis];
+			uint* splitPoint = std::partition(order.data() + task.m_First, order.data() + task.m_First + task.m_Count, [&](uint item)
+			{
+				return std::min((int)((centroids[item][bestAxis] - minimum) * scale), BIN_COUNT - 1) <= bestSplit;
+			});
+			middle = (uint)(splitPoint - order.data());
+
+			if (middle == task.m_First || middle == task.m_First + task.m_Count)
+				middle = task.m_First + task.m_Count / 2;
+		}
+		else
+		{
+			// Every centroid is in the same place, so just halve the items.
+			middle = task.m_First + task.m_Count / 2;
+		}
+
+		uint left = (uint)m_Nodes.size();
+		uint right = left + 1;
+		m_Nodes.push_back(BVHNode{ AABB::Empty(), task.m_Node, INVALID_BVH_NODE, INVALID_BVH_NODE, 0, 0 });
+		m_Nodes.push_back(BVHNode{ AABB::Empty(), task.m_Node, INVALID_BVH_NODE, INVALID_BVH_NODE, 0, 0 });
+		m_Nodes[task.m_Node].m_Left = left;
+		m_Nodes[task.m_Node].m_Right = right;
+
+		tasks.push_back({ right, middle, task.m_First + task.m_Count - middle });
+		tasks.push_back({ left, task.m_First, middle - task.m_First });
+	}
+
+	m_ItemBounds.resize(count);
+	m_ItemIds.resize(count);
+	m_ItemPositions.resize(count);
+	for (size_t position = 0; position < count; ++position)
+	{
+		uint item = order[position];
+		m_ItemBounds[position] = bounds[item];
+		m_ItemIds[position] = ids[item];
+		m_ItemPositions[item] = (uint)position;
+	}
+
+	m_DirtyNodes.assign(m_Nodes.size(), 0);
+}
+
+void BVH::UpdateItem(uint item, const AABB& bounds)
+{
+	uint position = m_ItemPositions[item];
+	m_ItemBounds[position] = bounds;
+
+	// Mark the path to the root, stopping early if it's already been marked.
+	for (uint node = m_ItemLeaves[position]; node != INVALID_BVH_NODE && !m_DirtyNodes[node]; node = m_Nodes[node].m_Parent)
+		m_DirtyNodes[node] = 1;
+
+	m_AnyDirty = true;
+}
+
+void BVH::Refit(bool rotate)
+{
+	if (!m_AnyDirty || m_Nodes.empty())
+		return;
+
+	RefitNode(0, rotate);
+	m_AnyDirty = false;
+}
+
+void BVH::RefitNode(uint node, bool rotate)
+{
+	if (!m_DirtyNodes[node])
+		return;
+
+	m_DirtyNodes[node] = 0;
+	BVHNode& current = m_Nodes[node];
+
+	if (current.IsLeaf())
+	{
+		AABB bounds = AABB::Empty();
+		for (uint i = current.m_FirstItem; i < current.m_FirstItem + current.m_ItemCount; ++i)
+			bounds.Grow(m_ItemBounds[i]);
+
+		current.m_Bounds = bounds;
+		return;
+	}
+
+	RefitNode(current.m_Left, rotate);
+	RefitNode(current.m_Right, rotate);
+
+	AABB bounds = m_Nodes[current.m_Left].m_Bounds;
+	bounds.Grow(m_Nodes[current.m_Right].m_Bounds);
+	current.m_Bounds = bounds;
+
+	if (rotate)
+		RotateNode(node);
+}
+
+void BVH::RotateNode(uint node)
+{
+	uint left = m_Nodes[node].m_Left;
+	uint right = m_Nodes[node].m_Right;
+
+	// Each rotation swaps one child with a grandchild on the other side.
+	// The node's own bounds don't change, only the bounds of the child that gets the swapped in node.
+	float bestGain = 0.0f;
+	uint swapChild = INVALID_BVH_NODE;
+	uint swapGrandchild = INVALID_BVH_NODE;
+	uint keptGrandchild = INVALID_BVH_NODE;
+
+	auto consider = [&](uint child, uint otherChild)
+	{
+		const BVHNode& other = m_Nodes[otherChild];
+		if (other.IsLeaf())
+			return;
+
+		float otherArea = other.m_Bounds.GetSurfaceArea();
+		uint grandchildren[2] = { other.m_Left, other.m_Right };
+		for (int i = 0; i < 2; ++i)
+		{
+			AABB rotated = m_Nodes[child].m_Bounds;
+			rotated.Grow(m_Nodes[grandchildren[1 - i]].m_Bounds);
+
+			float gain = otherArea - rotated.GetSurfaceArea();
+			if (gain > bestGain)
+			{
+				bestGain = gain;
+				swapChild = child;
+				swapGrandchild = grandchildren[i];
+				keptGrandchild = grandchildren[1 - i];
+			}
+		}
+	};
+
+	consider(left, right);
+	consider(right, left);
+
+	if (swapChild == INVALID_BVH_NODE)
+		return;
+
+	uint otherChild = swapChild == left ? right : left;
+
+	// The grandchild takes the child's place under the node...
+	BVHNode& parent = m_Nodes[node];
+	if (parent.m_Left == swapChild)
+		parent.m_Left = swapGrandchild;
+	else
+		parent.m_Right = swapGrandchild;
+	m_Nodes[swapGrandchild].m_Parent = node;
+
+	// ...and the child moves down under the other child.
+	BVHNode& other = m_Nodes[otherChild];
+	if (other.m_Left == swapGrandchild)
+		other.m_Left = swapChild;
+	else
+		other.m_Right = swapChild;
+	m_Nodes[swapChild].m_Parent = otherChild;
+
+	AABB bounds = m_Nodes[swapChild].m_Bounds;
+	bounds.Grow(m_Nodes[keptGrandchild].m_Bounds);
+	other.m_Bounds = bounds;
+}
+
+void BVH::QueryFrustum(const Frustum& frustum, std::vector<uint>& results) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	uint stack[MAX_QUERY_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		uint entry = stack[--stackSize];
+		uint nodeIndex = entry & ~INSIDE_FLAG;
+		bool inside = (entry & INSIDE_FLAG) != 0;
+		const BVHNode& node = m_Nodes[nodeIndex];
+
+		// Once a node is fully inside, nothing under it needs testing.
+		if (!inside)
+		{
+			FrustumTest test = frustum.TestAABB(node.m_Bounds);
+			if (test == FrustumTest::Outside)
+				continue;
+
+			inside = test == FrustumTest::Inside;
+		}
+
+		if (node.IsLeaf())
+		{
+			for (uint i = node.m_FirstItem; i < node.m_FirstItem + node.m_ItemCount; ++i)
+			{
+				if (inside || frustum.TestAABB(m_ItemBounds[i]) != FrustumTest::Outside)
+					results.push_back(m_ItemIds[i]);
+			}
+			continue;
+		}
+
+		if (stackSize + 2 > MAX_QUERY_DEPTH)
+			throw std::runtime_error("BVH is too deep to query!");
+
+		stack[stackSize++] = node.m_Right | (inside ? INSIDE_FLAG : 0);
+		stack[stackSize++] = node.m_Left | (inside ? INSIDE_FLAG : 0);
+	}
+}
+
+void BVH::QueryAABB(const AABB& box, std::vector<uint>& results) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	uint stack[MAX_QUERY_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = m_Nodes[stack[--stackSize]];
+		if (!box.Overlaps(node.m_Bounds))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint i = node.m_FirstItem; i < node.m_FirstItem + node.m_ItemCount; ++i)
+			{
+				if (box.Overlaps(m_ItemBounds[i]))
+					results.push_back(m_ItemIds[i]);
+			}
+			continue;
+		}
+
+		if (stackSize + 2 > MAX_QUERY_DEPTH)
+			throw std::runtime_error("BVH is too deep to query!");
+
+		stack[stackSize++] = node.m_Right;
+		stack[stackSize++] = node.m_Left;
+	}
+}
+
+void BVH::QuerySphere(const Sphere& sphere, std::vector<uint>& results) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	uint stack[MAX_QUERY_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = m_Nodes[stack[--stackSize]];
+		if (!sphere.Overlaps(node.m_Bounds))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint i = node.m_FirstItem; i < node.m_FirstItem + node.m_ItemCount; ++i)
+			{
+				if (sphere.Overlaps(m_ItemBounds[i]))
+					results.push_back(m_ItemIds[i]);
+			}
+			continue;
+		}
+
+		if (stackSize + 2 > MAX_QUERY_DEPTH)
+			throw std::runtime_error("BVH is too deep to query!");
+
+		stack[stackSize++] = node.m_Right;
+		stack[stackSize++] = node.m_Left;
+	}
+}
+
+// Slab test of a ray against a box.
+// Params: the box, ray origin, 1 / ray direction, the furthest distance to accept.
+// Returns: distance to where the ray enters the box, or FLT_MAX if it misses.
+static float IntersectRayAABB(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+{
+	glm::vec3 t0 = (box.m_Min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.m_Max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+
+	float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+bool BVH::Raycast(const Ray& ray, float maxDistance, uint& hitId, float& hitDistance) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	glm::vec3 inverseDirection = 1.0f / ray.m_Direction;
+	float closest = maxDistance;
+	bool hit = false;
+
+	uint stack[MAX_QUERY_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = m_Nodes[stack[--stackSize]];
+		if (IntersectRayAABB(node.m_Bounds, ray.m_Origin, inverseDirection, closest) == FLT_MAX)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			for (uint i = node.m_FirstItem; i < node.m_FirstItem + node.m_ItemCount; ++i)
+			{
+				float distance = IntersectRayAABB(m_ItemBounds[i], ray.m_Origin, inverseDirection, closest);
+				if (distance < closest)
+				{
+					closest = distance;
+					hitId = m_ItemIds[i];
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		if (stackSize + 2 > MAX_QUERY_DEPTH)
+			throw std::runtime_error("BVH is too deep to query!");
+
+		// Visit the nearer child first so the far one is more likely to be culled by the closest hit.
+		float leftDistance = IntersectRayAABB(m_Nodes[node.m_Left].m_Bounds, ray.m_Origin, inverseDirection, closest);
+		float rightDistance = IntersectRayAABB(m_Nodes[node.m_Right].m_Bounds, ray.m_Origin, inverseDirection, closest);
+		if (leftDistance < rightDistance)
+		{
+			stack[stackSize++] = node.m_Right;
+			stack[stackSize++] = node.m_Left;
+		}
+		else
+		{
+			stack[stackSize++] = node.m_Left;
+			stack[stackSize++] = node.m_Right;
+		}
+	}
+
+	if (hit)
+		hitDistance = closest;
+
+	return hit;
+}
+
+float BVH::GetCost() const
+{
+	if (m_Nodes.empty())
+		return 0.0f;
+
+	float cost = 0.0f;
+	for (const BVHNode& node : m_Nodes)
+	{
+		float area = node.m_Bounds.GetSurfaceArea();
+		cost += node.IsLeaf() ? area * node.m_ItemCount : area * TRAVERSAL_COST;
+	}
+
+	return cost / m_Nodes[0].m_Bounds.GetSurfaceArea();
+}
\ No newline at end of file
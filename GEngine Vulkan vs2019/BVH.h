@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Bounds.h"
+#include <vector>
+
+// Node index used for "no node".
+#define INVALID_BVH_NODE UINT32_MAX
+
+// Node of the bounding volume hierarchy.
+// Leaves have m_ItemCount > 0 and point at a range of items, inner nodes have two children.
+struct BVHNode
+{
+	bool IsLeaf() const { return m_ItemCount > 0; }
+
+	AABB m_Bounds;
+	uint m_Parent;
+	uint m_Left;
+	uint m_Right;
+	uint m_FirstItem;
+	uint m_ItemCount;
+};
+
+// Bounding volume hierarchy over item AABBs.
+// Built top down with a binned surface area heuristic, then kept up to date for moving items
+// by refitting the changed paths and rotating nodes when that shrinks them.
+class BVH
+{
+public:
+	// Constructor.
+	BVH();
+	// Destructor.
+	~BVH();
+
+	// Build the tree from scratch.
+	// Params: bounds of each item, id to report for each item, how many items.
+	void Build(const AABB* bounds, const uint* ids, size_t count);
+
+	// Clear the tree.
+	void Clear();
+
+	// Change the bounds of an item. The tree isn't updated until Refit is called.
+	// Params: the item's index in the array given to Build, its new bounds.
+	void UpdateItem(uint item, const AABB& bounds);
+
+	// Refit the nodes above items changed with UpdateItem.
+	// Params: if nodes should be rotated where that lowers the surface area of the tree.
+	void Refit(bool rotate = true);
+
+	// Find the items that are at least partly inside a frustum.
+	// Params: the frustum, vector to append the ids of items found to.
+	void QueryFrustum(const Frustum& frustum, std::vector<uint>& results) const;
+
+	// Find the items that overlap a box.
+	// Params: the box, vector to append the ids of items found to.
+	void QueryAABB(const AABB& box, std::vector<uint>& results) const;
+
+	// Find the items that overlap a sphere.
+	// Params: the sphere, vector to append the ids of items found to.
+	void QuerySphere(const Sphere& sphere, std::vector<uint>& results) const;
+
+	// Find the closest item whose bounds are hit by a ray.
+	// Params: the ray, the furthest distance to check, the id of the item hit, the distance along the ray it was hit.
+	// Returns: if anything was hit.
+	bool Raycast(const Ray& ray, float maxDistance, uint& hitId, float& hitDistance) const;
+
+	// Get the amount of items in the tree.
+	// Returns: the item count.
+	size_t GetItemCount() const { return m_ItemIds.size(); }
+
+	// Get the amount of nodes in the tree.
+	// Returns: the node count.
+	size_t GetNodeCount() const { return m_Nodes.size(); }
+
+	// Get the SAH cost of the tree, for comparing build and refit quality.
+	// Returns: the cost relative to the root's surface area.
+	float GetCost() const;
+
+private:
+	// Recompute the bounds of a dirty node and its dirty children, rotating if asked.
+	// Params: the node, if rotations are allowed.
+	void RefitNode(uint node, bool rotate);
+
+	// Try the four child/grandchild swaps of a node and apply the best one.
+	// Params: the node.
+	void RotateNode(uint node);
+
+	// The nodes, root first.
+	std::vector<BVHNode> m_Nodes;
+
+	// Item bounds, in leaf order.
+	std::vector<AABB> m_ItemBounds;
+
+	// Item ids, in leaf order.
+	std::vector<uint> m_ItemIds;
+
+	// Leaf node of each item, in leaf order.
+	std::vector<uint> m_ItemLeaves;
+
+	// Where each item given to Build ended up in leaf order.
+	std::vector<uint> m_ItemPositions;
+
+	// If a node's bounds need recomputing on the next Refit.
+	std::vector<uint8_t> m_DirtyNodes;
+
+	// If any item has changed since the last Refit.
+	bool m_AnyDirty;
+};
\ No newline at end of file
@@ -0,0 +1,617 @@
+#include "Benchmark.h"
+#include "TransformSystem.h"
+#include "BVH.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cfloat>
+#include <cmath>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Amount of nodes in the transform hierarchy, and how many of them are roots.
+static const size_t TRANSFORM_COUNT = 100000;
+static const size_t TRANSFORM_ROOT_COUNT = 100;
+
+// Amount of local matrices changed for the partly dirty updates.
+static const size_t TRANSFORM_DIRTY_COUNT = TRANSFORM_COUNT / 100;
+
+// Amount of transforms whose world matrices are checked against ones worked out the slow way.
+static const size_t TRANSFORM_CHECK_COUNT = 1000;
+
+// Amount of objects in the BVH, spread over a flat world of this size with boxes up to a few units across.
+static const size_t BVH_OBJECT_COUNT = 1000000;
+static const glm::vec3 WORLD_SIZE(2000.0f, 100.0f, 2000.0f);
+static const float MAX_OBJECT_SIZE = 4.0f;
+
+// Times the BVH is built, which takes a lot longer than anything else timed.
+static const int BVH_BUILD_RUNS = 3;
+
+// Amount of each kind of query in a run.
+static const size_t BVH_FRUSTUM_QUERY_COUNT = 100;
+static const size_t BVH_VOLUME_QUERY_COUNT = 1000;
+static const size_t BVH_RAY_QUERY_COUNT = 10000;
+
+// Queries of each kind checked against testing every object.
+static const size_t BVH_CHECK_COUNT = 10;
+
+// Amount of objects moved before each refit.
+static const size_t BVH_MOVED_COUNT = BVH_OBJECT_COUNT / 100;
+
+// Amount of objects culled, over the same world as the BVH's, and how long culling them on one thread should take.
+static const size_t CULL_OBJECT_COUNT = 1000000;
+static const double CULL_TARGET_MILLISECONDS = 1.0;
+
+// How far past a frustum plane the checks against the SIMD culling allow for rounding.
+static const float CULL_CHECK_MARGIN = 0.001f;
+
+// Times each part of a benchmark is run.
+static const int BENCHMARK_RUNS = 20;
+
+// Best and average of a benchmark's runs, in milliseconds.
+struct Timings
+{
+	double m_Best = DBL_MAX;
+	double m_Total = 0.0;
+	int m_Runs = 0;
+};
+
+// Get the time since a point.
+// Params: the point.
+// Returns: the time in milliseconds.
+static double GetMilliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Add a run to some timings.
+// Params: the timings, how long the run took in milliseconds.
+static void AddRun(Timings& timings, double milliseconds)
+{
+	timings.m_Best = std::min(timings.m_Best, milliseconds);
+	timings.m_Total += milliseconds;
+	++timings.m_Runs;
+}
+
+// Print a line for some timings.
+// Params: what was timed, the timings.
+static void PrintTimings(const char* name, const Timings& timings)
+{
+	if (timings.m_Runs == 1)
+	{
+		std::cout << "  " << name << ": " << timings.m_Total << " ms" << std::endl;
+		return;
+	}
+
+	std::cout << "  " << name << ": best " << timings.m_Best << " ms, average " << timings.m_Total / std::max(timings.m_Runs, 1)
+		<< " ms over " << timings.m_Runs << " runs" << std::endl;
+}
+
+// Make a local matrix somewhere near its parent.
+// Params: the random generator.
+// Returns: the matrix.
+static glm::mat4 RandomLocalMatrix(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random)));
+	return glm::rotate(matrix, angle(random), glm::normalize(glm::vec3(offset(random), offset(random), offset(random)) + glm::vec3(0.0f, 2.0f, 0.0f)));
+}
+
+// Check if two matrices are the same apart from rounding.
+// Params: the matrix to check, the matrix it should be.
+// Returns: if every element is close enough.
+static bool IsNearlyEqual(const glm::mat4& matrix, const glm::mat4& expected)
+{
+	for (int column = 0; column < 4; ++column)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			if (std::abs(matrix[column][row] - expected[column][row]) > 0.001f * std::max(1.0f, std::abs(expected[column][row])))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Scatter boxes over the world.
+// Params: the random generator, how many boxes, vector to fill with them.
+static void MakeBoxes(std::mt19937& random, size_t count, std::vector<AABB>& boxes)
+{
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	boxes.resize(count);
+	for (AABB& box : boxes)
+	{
+		glm::vec3 centre = glm::vec3(unit(random), unit(random), unit(random)) * WORLD_SIZE;
+		glm::vec3 extents = glm::vec3(0.1f) + glm::vec3(unit(random), unit(random), unit(random)) * (MAX_OBJECT_SIZE * 0.5f - 0.1f);
+		box.m_Min = centre - extents;
+		box.m_Max = centre + extents;
+	}
+}
+
+// Make the frustum of a camera somewhere in the world looking out over it.
+// Params: the random generator.
+// Returns: the frustum.
+static Frustum RandomFrustum(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	glm::vec3 position = glm::vec3(unit(random), unit(random), unit(random)) * WORLD_SIZE;
+	float angle = unit(random) * 6.2831853f;
+	glm::vec3 forward(std::cos(angle), -0.2f, std::sin(angle));
+
+	glm::mat4 view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+	return Frustum::FromMatrix(projection * view);
+}
+
+// Slab test of a ray against a box, the slow way, to check the BVH's against.
+// Params: the box, the ray, the furthest distance to accept.
+// Returns: distance to where the ray enters the box, or FLT_MAX if it misses.
+static float IntersectRayAABB(const AABB& box, const Ray& ray, float maxDistance)
+{
+	float enter = 0.0f;
+	float exit = maxDistance;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float t0 = (box.m_Min[axis] - ray.m_Origin[axis]) / ray.m_Direction[axis];
+		float t1 = (box.m_Max[axis] - ray.m_Origin[axis]) / ray.m_Direction[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+
+	return enter <= exit ? enter : FLT_MAX;
+}
+
+// Test a box and the sphere around it against a frustum the slow way, the same tests as the culling kernels.
+// Params: the frustum, the box, how far outside the planes still counts as inside.
+// Returns: if the box is visible.
+static bool IsInFrustum(const Frustum& frustum, const AABB& box, float margin)
+{
+	glm::vec3 centre = box.GetCentre();
+	glm::vec3 extents = box.GetExtents();
+	float radius = glm::length(extents);
+	for (int i = 0; i < 6; ++i)
+	{
+		const Plane& plane = frustum.m_Planes[i];
+		float distance = glm::dot(plane.m_Normal, centre) + plane.m_Distance;
+		if (distance < -radius - margin || distance + glm::dot(glm::abs(plane.m_Normal), extents) < -margin)
+			return false;
+	}
+
+	return true;
+}
+
+// Sort query results and ids found by testing every object, and compare them.
+// Params: the query results, the ids that should have been found.
+// Returns: if they're the same ids.
+static bool IsSameItems(std::vector<uint>& results, std::vector<uint>& expected)
+{
+	std::sort(results.begin(), results.end());
+	std::sort(expected.begin(), expected.end());
+	return results == expected;
+}
+
+Benchmark::Benchmark(JobSystem* jobSystem)
+{
+	m_JobSystem = jobSystem;
+}
+
+bool Benchmark::Run(const std::vector<std::string>& names)
+{
+	// Every benchmark, by the name it's given on the command line.
+	struct Entry
+	{
+		const char* m_Name;
+		bool (Benchmark::*m_Run)();
+	};
+	static const Entry benchmarks[] =
+	{
+		{ "transforms", &Benchmark::RunTransforms },
+		{ "bvh", &Benchmark::RunBVH },
+		{ "culling", &Benchmark::RunCulling },
+	};
+
+	for (const std::string& name : names)
+	{
+		bool known = false;
+		for (const Entry& benchmark : benchmarks)
+			known = known || name == benchmark.m_Name;
+
+		if (!known)
+		{
+			std::cerr << "Unknown benchmark " << name << "!" << std::endl;
+			return false;
+		}
+	}
+
+	bool succeeded = true;
+	for (const Entry& benchmark : benchmarks)
+	{
+		if (!names.empty() && std::find(names.begin(), names.end(), benchmark.m_Name) == names.end())
+			continue;
+
+		std::cout << benchmark.m_Name << std::endl;
+		succeeded = (this->*benchmark.m_Run)() && succeeded;
+	}
+
+	return succeeded;
+}
+
+bool Benchmark::RunTransforms()
+{
+	std::mt19937 random(1);
+
+	// Each node after the roots hangs off any node made before it, which makes a tree around a dozen levels deep.
+	TransformSystem transforms;
+	std::vector<uint> handles(TRANSFORM_COUNT);
+	std::vector<uint> parents(TRANSFORM_COUNT, INVALID_TRANSFORM);
+	for (size_t i = 0; i < TRANSFORM_COUNT; ++i)
+	{
+		if (i >= TRANSFORM_ROOT_COUNT)
+			parents[i] = std::uniform_int_distribution<uint>(0, (uint)i - 1)(random);
+
+		handles[i] = transforms.CreateTransform(parents[i] == INVALID_TRANSFORM ? INVALID_TRANSFORM : handles[parents[i]]);
+		transforms.SetLocalMatrix(handles[i], RandomLocalMatrix(random));
+	}
+
+	// The first update sorts the arrays by depth too.
+	Timings first;
+	Clock::time_point start = Clock::now();
+	transforms.Update();
+	AddRun(first, GetMilliseconds(start));
+	PrintTimings("first update, sorting and computing every transform", first);
+
+	// Moving every root recomputes everything below them.
+	Timings everything;
+	size_t everythingCount = 0;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		for (size_t i = 0; i < TRANSFORM_ROOT_COUNT; ++i)
+			transforms.SetLocalMatrix(handles[i], RandomLocalMatrix(random));
+
+		start = Clock::now();
+		transforms.Update();
+		AddRun(everything, GetMilliseconds(start));
+		everythingCount = transforms.GetLastUpdateCount();
+	}
+	PrintTimings("every root moved", everything);
+	std::cout << "    " << everythingCount << " of " << TRANSFORM_COUNT << " transforms recomputed" << std::endl;
+
+	// Moving a few scattered nodes recomputes just their subtrees.
+	Timings some;
+	size_t someCount = 0;
+	std::uniform_int_distribution<size_t> anyTransform(0, TRANSFORM_COUNT - 1);
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		for (size_t i = 0; i < TRANSFORM_DIRTY_COUNT; ++i)
+			transforms.SetLocalMatrix(handles[anyTransform(random)], RandomLocalMatrix(random));
+
+		start = Clock::now();
+		transforms.Update();
+		AddRun(some, GetMilliseconds(start));
+		someCount += transforms.GetLastUpdateCount();
+	}
+	PrintTimings("1% of transforms moved", some);
+	std::cout << "    " << someCount / BENCHMARK_RUNS << " of " << TRANSFORM_COUNT << " transforms recomputed on average" << std::endl;
+
+	// Nothing moved, which should cost next to nothing.
+	Timings none;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		start = Clock::now();
+		transforms.Update();
+		AddRun(none, GetMilliseconds(start));
+	}
+	PrintTimings("nothing moved", none);
+
+	// Check a sample of world matrices against multiplying up the parent chain one matrix at a time.
+	size_t wrongCount = 0;
+	for (size_t i = 0; i < TRANSFORM_CHECK_COUNT; ++i)
+	{
+		size_t transform = anyTransform(random);
+		glm::mat4 expected = transforms.GetLocalMatrix(handles[transform]);
+		for (uint parent = parents[transform]; parent != INVALID_TRANSFORM; parent = parents[parent])
+			expected = transforms.GetLocalMatrix(handles[parent]) * expected;
+
+		if (!IsNearlyEqual(transforms.GetWorldMatrix(handles[transform]), expected))
+			++wrongCount;
+	}
+
+	if (wrongCount != 0)
+	{
+		std::cerr << "  " << wrongCount << " of " << TRANSFORM_CHECK_COUNT << " checked world matrices were wrong!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool Benchmark::RunBVH()
+{
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<AABB> boxes;
+	MakeBoxes(random, BVH_OBJECT_COUNT, boxes);
+	std::vector<uint> ids(BVH_OBJECT_COUNT);
+	for (size_t i = 0; i < BVH_OBJECT_COUNT; ++i)
+		ids[i] = (uint)i;
+
+	BVH bvh;
+	Timings build;
+	for (int run = 0; run < BVH_BUILD_RUNS; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		bvh.Build(boxes.data(), ids.data(), boxes.size());
+		AddRun(build, GetMilliseconds(start));
+	}
+	PrintTimings("build", build);
+	std::cout << "    " << bvh.GetNodeCount() << " nodes, SAH cost " << bvh.GetCost() << std::endl;
+
+	// The same queries every run, made up front.
+	std::vector<Frustum> frustums(BVH_FRUSTUM_QUERY_COUNT);
+	for (Frustum& frustum : frustums)
+		frustum = RandomFrustum(random);
+
+	std::vector<AABB> queryBoxes(BVH_VOLUME_QUERY_COUNT);
+	std::vector<Sphere> spheres(BVH_VOLUME_QUERY_COUNT);
+	for (size_t i = 0; i < BVH_VOLUME_QUERY_COUNT; ++i)
+	{
+		glm::vec3 centre = glm::vec3(unit(random), unit(random), unit(random)) * WORLD_SIZE;
+		queryBoxes[i].m_Min = centre - glm::vec3(10.0f);
+		queryBoxes[i].m_Max = centre + glm::vec3(10.0f);
+		spheres[i].m_Centre = centre;
+		spheres[i].m_Radius = 10.0f;
+	}
+
+	std::vector<Ray> rays(BVH_RAY_QUERY_COUNT);
+	for (Ray& ray : rays)
+	{
+		ray.m_Origin = glm::vec3(unit(random), unit(random), unit(random)) * WORLD_SIZE;
+		ray.m_Direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f);
+	}
+
+	// Each query appends to the results, which are cleared in between so the time is just the search.
+	std::vector<uint> results;
+	results.reserve(BVH_OBJECT_COUNT);
+	size_t found = 0;
+
+	Timings frustumQueries;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		found = 0;
+		Clock::time_point start = Clock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			results.clear();
+			bvh.QueryFrustum(frustum, results);
+			found += results.size();
+		}
+		AddRun(frustumQueries, GetMilliseconds(start));
+	}
+	PrintTimings("100 frustum queries", frustumQueries);
+	std::cout << "    " << found / BVH_FRUSTUM_QUERY_COUNT << " objects found on average" << std::endl;
+
+	// What the frustum queries would cost without the tree.
+	Timings frustumScans;
+	for (int run = 0; run < BVH_BUILD_RUNS; ++run)
+	{
+		found = 0;
+		Clock::time_point start = Clock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			for (const AABB& box : boxes)
+				found += frustum.TestAABB(box) != FrustumTest::Outside;
+		}
+		AddRun(frustumScans, GetMilliseconds(start));
+	}
+	PrintTimings("100 frustum tests of every object, for comparison", frustumScans);
+	std::cout << "    " << found / BVH_FRUSTUM_QUERY_COUNT << " objects found on average" << std::endl;
+
+	Timings boxQueries;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		for (const AABB& box : queryBoxes)
+		{
+			results.clear();
+			bvh.QueryAABB(box, results);
+		}
+		AddRun(boxQueries, GetMilliseconds(start));
+	}
+	PrintTimings("1000 box queries", boxQueries);
+
+	Timings sphereQueries;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		for (const Sphere& sphere : spheres)
+		{
+			results.clear();
+			bvh.QuerySphere(sphere, results);
+		}
+		AddRun(sphereQueries, GetMilliseconds(start));
+	}
+	PrintTimings("1000 sphere queries", sphereQueries);
+
+	Timings rayQueries;
+	size_t hitCount = 0;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		hitCount = 0;
+		Clock::time_point start = Clock::now();
+		for (const Ray& ray : rays)
+		{
+			uint hitId;
+			float hitDistance;
+			hitCount += bvh.Raycast(ray, FLT_MAX, hitId, hitDistance);
+		}
+		AddRun(rayQueries, GetMilliseconds(start));
+	}
+	PrintTimings("10000 raycasts", rayQueries);
+	std::cout << "    " << hitCount << " hit something" << std::endl;
+
+	// Check a few of each kind of query against testing every object.
+	size_t wrongCount = 0;
+	std::vector<uint> expected;
+	for (size_t i = 0; i < BVH_CHECK_COUNT; ++i)
+	{
+		results.clear();
+		expected.clear();
+		bvh.QueryFrustum(frustums[i], results);
+		for (size_t object = 0; object < boxes.size(); ++object)
+		{
+			if (frustums[i].TestAABB(boxes[object]) != FrustumTest::Outside)
+				expected.push_back((uint)object);
+		}
+		wrongCount += !IsSameItems(results, expected);
+
+		results.clear();
+		expected.clear();
+		bvh.QueryAABB(queryBoxes[i], results);
+		for (size_t object = 0; object < boxes.size(); ++object)
+		{
+			if (queryBoxes[i].Overlaps(boxes[object]))
+				expected.push_back((uint)object);
+		}
+		wrongCount += !IsSameItems(results, expected);
+
+		results.clear();
+		expected.clear();
+		bvh.QuerySphere(spheres[i], results);
+		for (size_t object = 0; object < boxes.size(); ++object)
+		{
+			if (spheres[i].Overlaps(boxes[object]))
+				expected.push_back((uint)object);
+		}
+		wrongCount += !IsSameItems(results, expected);
+
+		// Boxes can overlap, so only the distance has to match.
+		float closest = FLT_MAX;
+		for (const AABB& box : boxes)
+			closest = std::min(closest, IntersectRayAABB(box, rays[i], closest));
+
+		uint hitId;
+		float hitDistance = FLT_MAX;
+		bvh.Raycast(rays[i], FLT_MAX, hitId, hitDistance);
+		wrongCount += std::abs(hitDistance - closest) > 0.001f * std::max(1.0f, closest) && !(hitDistance == FLT_MAX && closest == FLT_MAX);
+	}
+
+	// Move some objects a little each run, like a frame of things walking around, and refit with and without rotations.
+	for (int rotate = 1; rotate >= 0; --rotate)
+	{
+		Timings refits;
+		std::uniform_int_distribution<uint> anyObject(0, (uint)BVH_OBJECT_COUNT - 1);
+		for (int run = 0; run < BENCHMARK_RUNS; ++run)
+		{
+			for (size_t i = 0; i < BVH_MOVED_COUNT; ++i)
+			{
+				uint object = anyObject(random);
+				glm::vec3 offset = (glm::vec3(unit(random), 0.0f, unit(random)) * 2.0f - 1.0f) * 2.0f;
+				boxes[object].m_Min += offset;
+				boxes[object].m_Max += offset;
+				bvh.UpdateItem(object, boxes[object]);
+			}
+
+			Clock::time_point start = Clock::now();
+			bvh.Refit(rotate != 0);
+			AddRun(refits, GetMilliseconds(start));
+		}
+		PrintTimings(rotate != 0 ? "refit with rotations after 1% of objects moved" : "refit without rotations after 1% of objects moved", refits);
+		std::cout << "    SAH cost " << bvh.GetCost() << std::endl;
+	}
+
+	// The refitted tree has to find the moved objects too.
+	for (size_t i = 0; i < BVH_CHECK_COUNT; ++i)
+	{
+		results.clear();
+		expected.clear();
+		bvh.QueryAABB(queryBoxes[i], results);
+		for (size_t object = 0; object < boxes.size(); ++object)
+		{
+			if (queryBoxes[i].Overlaps(boxes[object]))
+				expected.push_back((uint)object);
+		}
+		wrongCount += !IsSameItems(results, expected);
+	}
+
+	if (wrongCount != 0)
+	{
+		std::cerr << "  " << wrongCount << " checked queries didn't match testing every object!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool Benchmark::RunCulling()
+{
+	std::mt19937 random(3);
+
+	std::vector<AABB> boxes;
+	MakeBoxes(random, CULL_OBJECT_COUNT, boxes);
+
+	FrustumCuller culler;
+	culler.Resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+		culler.SetBounds((uint)i, boxes[i]);
+
+	Frustum frustum = RandomFrustum(random);
+	std::vector<uint> visibleObjects(boxes.size());
+	size_t visibleCount = 0;
+
+	Timings single;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		visibleCount = culler.Cull(frustum, visibleObjects.data());
+		AddRun(single, GetMilliseconds(start));
+	}
+	PrintTimings("cull on one thread", single);
+	std::cout << "    " << visibleCount << " of " << boxes.size() << " objects visible" << std::endl;
+
+	std::vector<uint> parallelObjects(boxes.size());
+	size_t parallelCount = 0;
+	Timings parallel;
+	for (int run = 0; run < BENCHMARK_RUNS; ++run)
+	{
+		Clock::time_point start = Clock::now();
+		parallelCount = culler.CullParallel(frustum, m_JobSystem, parallelObjects.data());
+		AddRun(parallel, GetMilliseconds(start));
+	}
+	PrintTimings("cull across threads", parallel);
+	std::cout << "    " << m_JobSystem->GetThreadCount() << " threads" << std::endl;
+
+	// Both should find the same objects in the same order, and they should pass the slow test, give or take rounding.
+	bool succeeded = true;
+	if (parallelCount != visibleCount || !std::equal(visibleObjects.begin(), visibleObjects.begin() + visibleCount, parallelObjects.begin()))
+	{
+		std::cerr << "  Culling across threads found different objects to culling on one!" << std::endl;
+		succeeded = false;
+	}
+
+	size_t wrongCount = 0;
+	size_t next = 0;
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		bool visible = next < visibleCount && visibleObjects[next] == i;
+		next += visible;
+		wrongCount += visible ? !IsInFrustum(frustum, boxes[i], CULL_CHECK_MARGIN) : IsInFrustum(frustum, boxes[i], -CULL_CHECK_MARGIN);
+	}
+
+	if (wrongCount != 0 || next != visibleCount)
+	{
+		std::cerr << "  " << wrongCount << " objects were culled wrongly!" << std::endl;
+		succeeded = false;
+	}
+
+	double average = single.m_Total / single.m_Runs;
+	std::cout << "  target of " << CULL_TARGET_MILLISECONDS << " ms on one thread " << (average < CULL_TARGET_MILLISECONDS ? "met" : "missed") << std::endl;
+
+	return succeeded && average < CULL_TARGET_MILLISECONDS;
+}
\ No newline at end of file
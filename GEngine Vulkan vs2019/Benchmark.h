@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Offline benchmarks for the engine's CPU side systems, run at the sizes they're meant to handle without starting the
+// renderer. Each one builds its own scene from a fixed seed, times the work over several runs and prints the best and
+// average times, along with whether it met its target where it has one.
+class Benchmark
+{
+public:
+	// Constructor.
+	// Params: the job system, for the parts that are timed across threads.
+	Benchmark(JobSystem* jobSystem);
+
+	// Run benchmarks.
+	// Params: names of the benchmarks to run, or empty to run them all.
+	// Returns: if every benchmark ran and met its target.
+	bool Run(const std::vector<std::string>& names);
+
+private:
+	// Time updates of a 100k transform hierarchy with everything, some of it and none of it dirty.
+	// Returns: if the world matrices it worked out were right.
+	bool RunTransforms();
+
+	// Time building a BVH over 1M objects, querying it with frustums, boxes, spheres and rays, and refitting it after
+	// some of the objects move.
+	// Returns: if the queries found the same objects as testing every one.
+	bool RunBVH();
+
+	// Time frustum culling 1M objects on one thread, which should take under 1 ms in release builds, and across the job
+	// system's threads.
+	// Returns: if the visible objects were right and it met its target.
+	bool RunCulling();
+
+	// The job system parallel parts run on.
+	JobSystem* m_JobSystem;
+};
\ No newline at end of file
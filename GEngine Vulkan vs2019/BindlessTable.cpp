@@ -0,0 +1,283 @@
+#include "BindlessTable.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Array sizes asked for, cut down to what the device allows.
+static const uint MAX_BINDLESS_IMAGES = 16 * 1024;
+static const uint MAX_BINDLESS_SAMPLERS = 64;
+static const uint MAX_BINDLESS_STORAGE_BUFFERS = 8 * 1024;
+static const uint MAX_MATERIALS = 4 * 1024;
+
+// Binding of each array in the set.
+enum BindlessBinding
+{
+	BINDLESS_BINDING_IMAGES,
+	BINDLESS_BINDING_SAMPLERS,
+	BINDLESS_BINDING_STORAGE_BUFFERS,
+	BINDLESS_BINDING_MATERIALS,
+	BINDLESS_BINDING_COUNT
+};
+
+uint BindlessTable::IndexAllocator::Allocate()
+{
+	if (!m_Free.empty())
+	{
+		uint index = m_Free.back();
+		m_Free.pop_back();
+		return index;
+	}
+
+	if (m_Count == m_Capacity)
+		return BINDLESS_INVALID_INDEX;
+
+	return m_Count++;
+}
+
+BindlessTable::BindlessTable(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	// Update after bind descriptors have their own, sometimes lower, limits.
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(renderer->GetPhysicalDevice(), &properties);
+
+	m_Images.m_Capacity = std::min({ MAX_BINDLESS_IMAGES, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	m_Samplers.m_Capacity = std::min({ MAX_BINDLESS_SAMPLERS, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+	// One storage buffer binding goes to the materials.
+	m_StorageBuffers.m_Capacity = std::min({ MAX_BINDLESS_STORAGE_BUFFERS, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers - 1,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers - 1 });
+	m_Materials.m_Capacity = MAX_MATERIALS;
+
+	m_Renderer->CreateBuffer(MAX_MATERIALS * sizeof(MaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_VkMaterialBuffer, m_VkMaterialMemory);
+	vkMapMemory(m_VkDevice, m_VkMaterialMemory, 0, MAX_MATERIALS * sizeof(MaterialData), 0, (void**)&m_MappedMaterials);
+
+	CreateDescriptorSet();
+
+	// Objects that never set a material use the first one.
+	AddMaterial(MaterialData());
+}
+
+BindlessTable::~BindlessTable()
+{
+	vkDestroyDescriptorPool(m_VkDevice, m_VkDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_VkDevice, m_VkDescriptorSetLayout, nullptr);
+	vkUnmapMemory(m_VkDevice, m_VkMaterialMemory);
+	vkDestroyBuffer(m_VkDevice, m_VkMaterialBuffer, nullptr);
+	vkFreeMemory(m_VkDevice, m_VkMaterialMemory, nullptr);
+}
+
+void BindlessTable::CreateDescriptorSet()
+{
+	VkDescriptorSetLayoutBinding bindings[BINDLESS_BINDING_COUNT]{};
+	bindings[BINDLESS_BINDING_IMAGES].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	bindings[BINDLESS_BINDING_IMAGES].descriptorCount = m_Images.m_Capacity;
+	bindings[BINDLESS_BINDING_SAMPLERS].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	bindings[BINDLESS_BINDING_SAMPLERS].descriptorCount = m_Samplers.m_Capacity;
+	bindings[BINDLESS_BINDING_STORAGE_BUFFERS].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[BINDLESS_BINDING_STORAGE_BUFFERS].descriptorCount = m_StorageBuffers.m_Capacity;
+	bindings[BINDLESS_BINDING_MATERIALS].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[BINDLESS_BINDING_MATERIALS].descriptorCount = 1;
+
+	// Most of each array is empty, and entries can change while a frame using the set is in flight.
+	VkDescriptorBindingFlags bindingFlags[BINDLESS_BINDING_COUNT];
+	for (uint i = 0; i < BINDLESS_BINDING_COUNT; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = BINDLESS_BINDING_COUNT;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = BINDLESS_BINDING_COUNT;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &m_VkDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create bindless descriptor set layout!");
+
+	VkDescriptorPoolSize poolSizes[3]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	poolSizes[0].descriptorCount = m_Images.m_Capacity;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+	poolSizes[1].descriptorCount = m_Samplers.m_Capacity;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = m_StorageBuffers.m_Capacity + 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 3;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_VkDevice, &poolInfo, nullptr, &m_VkDescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create bindless descriptor pool!");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_VkDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_VkDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(m_VkDevice, &allocInfo, &m_VkDescriptorSet) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate bindless descriptor set!");
+
+	VkDescriptorBufferInfo materialInfo{};
+	materialInfo.buffer = m_VkMaterialBuffer;
+	materialInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSet;
+	descriptorWrite.dstBinding = BINDLESS_BINDING_MATERIALS;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.pBufferInfo = &materialInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+void BindlessTable::BeginFrame(uint frameIndex)
+{
+	m_FrameIndex = frameIndex;
+
+	// This frame's last run has finished by now, so what it removed can't be in use.
+	IndexAllocator* allocators[] = { &m_Images, &m_Samplers, &m_StorageBuffers, &m_Materials };
+	for (IndexAllocator* allocator : allocators)
+	{
+		std::vector<uint>& pending = allocator->m_Pending[frameIndex];
+		allocator->m_Free.insert(allocator->m_Free.end(), pending.begin(), pending.end());
+		pending.clear();
+	}
+}
+
+void BindlessTable::Free(IndexAllocator& allocator, uint index)
+{
+	allocator.m_Pending[m_FrameIndex].push_back(index);
+}
+
+uint BindlessTable::AddImage(VkImageView imageView, VkImageLayout imageLayout)
+{
+	uint index = m_Images.Allocate();
+	if (index == BINDLESS_INVALID_INDEX)
+		throw std::runtime_error("Bindless image table is full!");
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = imageLayout;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSet;
+	descriptorWrite.dstBinding = BINDLESS_BINDING_IMAGES;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, 1, &descriptorWrite, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::RemoveImage(uint index)
+{
+	Free(m_Images, index);
+}
+
+uint BindlessTable::AddSampler(VkSampler sampler)
+{
+	uint index = m_Samplers.Allocate();
+	if (index == BINDLESS_INVALID_INDEX)
+		throw std::runtime_error("Bindless sampler table is full!");
+
+	VkDescriptorImageInfo samplerInfo{};
+	samplerInfo.sampler = sampler;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSet;
+	descriptorWrite.dstBinding = BINDLESS_BINDING_SAMPLERS;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	descriptorWrite.pImageInfo = &samplerInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, 1, &descriptorWrite, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::RemoveSampler(uint index)
+{
+	Free(m_Samplers, index);
+}
+
+uint BindlessTable::AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint index = m_StorageBuffers.Allocate();
+	if (index == BINDLESS_INVALID_INDEX)
+		throw std::runtime_error("Bindless storage buffer table is full!");
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSet;
+	descriptorWrite.dstBinding = BINDLESS_BINDING_STORAGE_BUFFERS;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, 1, &descriptorWrite, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::RemoveStorageBuffer(uint index)
+{
+	Free(m_StorageBuffers, index);
+}
+
+uint BindlessTable::AddMaterial(const MaterialData& material)
+{
+	uint index = m_Materials.Allocate();
+	if (index == BINDLESS_INVALID_INDEX)
+		throw std::runtime_error("Material table is full!");
+
+	m_MappedMaterials[index] = material;
+	return index;
+}
+
+void BindlessTable::SetMaterial(uint index, const MaterialData& material)
+{
+	m_MappedMaterials[index] = material;
+}
+
+void BindlessTable::RemoveMaterial(uint index)
+{
+	Free(m_Materials, index);
+}
+
+void BindlessTable::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint set) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &m_VkDescriptorSet, 0, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include <vector>
+
+// Index returned when a table is full, and used by materials for "no texture".
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFF
+
+// Material as laid out in the material buffer, indexed by material ID in shaders.
+struct MaterialData
+{
+	glm::vec4 m_Colour = glm::vec4(1.0f);
+	// Bindless image and sampler indices, or BINDLESS_INVALID_INDEX for no texture.
+	uint m_AlbedoImage = BINDLESS_INVALID_INDEX;
+	uint m_AlbedoSampler = BINDLESS_INVALID_INDEX;
+	// How much temporal upsampling should go by this frame instead of the history, from 0 to 1, for surfaces
+	// whose motion vectors don't say how they change, like animated or see through ones.
+	float m_Reactive = 0.0f;
+	uint m_Padding = 0;
+};
+
+// One global descriptor set holding big arrays of sampled images, samplers and storage buffers, plus the materials.
+// Resources get an index that stays the same for as long as they're in the table, and shaders pick them
+// by index, so drawing something with a different material never binds or allocates a descriptor set.
+// Descriptors are written with update after bind, so adding resources doesn't wait for frames using the set.
+// Removed indices are only reused once the frame they were removed in has come around again.
+class BindlessTable
+{
+public:
+	// Constructor.
+	// Params: the renderer, which has to have descriptor indexing enabled.
+	BindlessTable(VulkanRenderer* renderer);
+	// Destructor.
+	~BindlessTable();
+
+	// Move on to the next frame in flight, making indices removed the last time it ran free again.
+	// Params: the frame in flight index.
+	void BeginFrame(uint frameIndex);
+
+	// Add a sampled image.
+	// Params: the image view, the layout it's in when sampled.
+	// Returns: the image's index.
+	uint AddImage(VkImageView imageView, VkImageLayout imageLayout);
+
+	// Remove a sampled image.
+	// Params: the image's index.
+	void RemoveImage(uint index);
+
+	// Add a sampler.
+	// Params: the sampler.
+	// Returns: the sampler's index.
+	uint AddSampler(VkSampler sampler);
+
+	// Remove a sampler.
+	// Params: the sampler's index.
+	void RemoveSampler(uint index);
+
+	// Add a storage buffer.
+	// Params: the buffer, offset to the start of the range, size of the range.
+	// Returns: the buffer's index.
+	uint AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+	// Remove a storage buffer.
+	// Params: the buffer's index.
+	void RemoveStorageBuffer(uint index);
+
+	// Add a material. Material 0 is always there, plain white.
+	// Params: the material.
+	// Returns: the material ID.
+	uint AddMaterial(const MaterialData& material);
+
+	// Change a material.
+	// Params: the material ID, the new material.
+	void SetMaterial(uint index, const MaterialData& material);
+
+	// Remove a material.
+	// Params: the material ID.
+	void RemoveMaterial(uint index);
+
+	// Get the layout of the set, for pipeline layouts.
+	// Returns: the descriptor set layout.
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_VkDescriptorSetLayout; }
+
+	// Bind the set.
+	// Params: the command buffer, where to bind it, the pipeline layout, the set number.
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint set) const;
+
+private:
+	// Hands out indices into one of the arrays.
+	struct IndexAllocator
+	{
+		// Get a free index.
+		// Returns: the index, or BINDLESS_INVALID_INDEX if the array is full.
+		uint Allocate();
+
+		// Indices never handed out start at m_Count, indices given back go in m_Free.
+		uint m_Count = 0;
+		uint m_Capacity = 0;
+		std::vector<uint> m_Free;
+
+		// Indices removed during each frame in flight, waiting for the frame to finish.
+		std::vector<uint> m_Pending[MAX_FRAMES_IN_FLIGHT];
+	};
+
+	// Create the layout, pool and set.
+	void CreateDescriptorSet();
+
+	// Give an index back once the current frame is done with it.
+	// Params: the allocator it came from, the index.
+	void Free(IndexAllocator& allocator, uint index);
+
+	// The renderer the table was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// The set and what it's allocated from.
+	VkDescriptorSetLayout m_VkDescriptorSetLayout;
+	VkDescriptorPool m_VkDescriptorPool;
+	VkDescriptorSet m_VkDescriptorSet;
+
+	// Indices for each array.
+	IndexAllocator m_Images;
+	IndexAllocator m_Samplers;
+	IndexAllocator m_StorageBuffers;
+	IndexAllocator m_Materials;
+
+	// Every material, written by the CPU.
+	VkBuffer m_VkMaterialBuffer;
+	VkDeviceMemory m_VkMaterialMemory;
+	MaterialData* m_MappedMaterials;
+
+	// The frame in flight removed indices are held back for.
+	uint m_FrameIndex = 0;
+};
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cfloat>
+
+// Axis aligned bounding box.
+struct AABB
+{
+	// Get a box that contains nothing, ready to be grown.
+	// Returns: an inverted box.
+	static AABB Empty()
+	{
+		AABB box;
+		box.m_Min = glm::vec3(FLT_MAX);
+		box.m_Max = glm::vec3(-FLT_MAX);
+		return box;
+	}
+
+	// Grow the box to contain a point.
+	// Params: the point.
+	void Grow(const glm::vec3& point)
+	{
+		m_Min = glm::min(m_Min, point);
+		m_Max = glm::max(m_Max, point);
+	}
+
+	// Grow the box to contain another box.
+	// Params: the other box.
+	void Grow(const AABB& other)
+	{
+		m_Min = glm::min(m_Min, other.m_Min);
+		m_Max = glm::max(m_Max, other.m_Max);
+	}
+
+	// Get the centre of the box.
+	// Returns: the centre point.
+	glm::vec3 GetCentre() const { return (m_Min + m_Max) * 0.5f; }
+
+	// Get the half size of the box.
+	// Returns: distance from the centre to the max corner.
+	glm::vec3 GetExtents() const { return (m_Max - m_Min) * 0.5f; }
+
+	// Get the surface area of the box, for SAH costs.
+	// Returns: the surface area, 0 for empty boxes.
+	float GetSurfaceArea() const
+	{
+		glm::vec3 size = glm::max(m_Max - m_Min, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// Check if the box overlaps another box.
+	// Params: the other box.
+	// Returns: if the boxes overlap.
+	bool Overlaps(const AABB& other) const
+	{
+		return m_Min.x <= other.m_Max.x && m_Max.x >= other.m_Min.x &&
+			m_Min.y <= other.m_Max.y && m_Max.y >= other.m_Min.y &&
+			m_Min.z <= other.m_Max.z && m_Max.z >= other.m_Min.z;
+	}
+
+	// Check if the box fully contains another box.
+	// Params: the other box.
+	// Returns: if the other box is inside this one.
+	bool Contains(const AABB& other) const
+	{
+		return m_Min.x <= other.m_Min.x && m_Max.x >= other.m_Max.x &&
+			m_Min.y <= other.m_Min.y && m_Max.y >= other.m_Max.y &&
+			m_Min.z <= other.m_Min.z && m_Max.z >= other.m_Max.z;
+	}
+
+	glm::vec3 m_Min;
+	glm::vec3 m_Max;
+};
+
+// Bounding sphere.
+struct Sphere
+{
+	// Check if the sphere overlaps a box.
+	// Params: the box.
+	// Returns: if they overlap.
+	bool Overlaps(const AABB& box) const
+	{
+		glm::vec3 closest = glm::clamp(m_Centre, box.m_Min, box.m_Max);
+		glm::vec3 offset = closest - m_Centre;
+		return glm::dot(offset, offset) <= m_Radius * m_Radius;
+	}
+
+	glm::vec3 m_Centre;
+	float m_Radius;
+};
+
+// Plane where points with dot(m_Normal, point) + m_Distance >= 0 are in front.
+struct Plane
+{
+	glm::vec3 m_Normal;
+	float m_Distance;
+};
+
+// Result of testing a volume against a frustum.
+enum class FrustumTest
+{
+	Outside,
+	Intersecting,
+	Inside
+};
+
+// View frustum as six inward facing planes.
+struct Frustum
+{
+	// Extract the frustum planes from a view projection matrix, using vulkan's 0 to 1 clip depth.
+	// Params: the view projection matrix.
+	// Returns: the frustum with normalised planes.
+	static Frustum FromMatrix(const glm::mat4& viewProjection)
+	{
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		glm::vec4 planes[6] =
+		{
+			row3 + row0,	// Left.
+			row3 - row0,	// Right.
+			row3 + row1,	// Bottom.
+			row3 - row1,	// Top.
+			row2,			// Near.
+			row3 - row2		// Far.
+		};
+
+		Frustum frustum;
+		for (int i = 0; i < 6; ++i)
+		{
+			float length = glm::length(glm::vec3(planes[i]));
+			frustum.m_Planes[i].m_Normal = glm::vec3(planes[i]) / length;
+			frustum.m_Planes[i].m_Distance = planes[i].w / length;
+		}
+
+		return frustum;
+	}
+
+	// Test a box against the frustum.
+	// Params: the box.
+	// Returns: if the box is outside, intersecting or fully inside.
+	FrustumTest TestAABB(const AABB& box) const
+	{
+		glm::vec3 centre = box.GetCentre();
+		glm::vec3 extents = box.GetExtents();
+
+		FrustumTest result = FrustumTest::Inside;
+		for (int i = 0; i < 6; ++i)
+		{
+			const Plane& plane = m_Planes[i];
+			float distance = glm::dot(plane.m_Normal, centre) + plane.m_Distance;
+			float radius = glm::dot(glm::abs(plane.m_Normal), extents);
+
+			if (distance < -radius)
+				return FrustumTest::Outside;
+
+			if (distance < radius)
+				result = FrustumTest::Intersecting;
+		}
+
+		return result;
+	}
+
+	// Test a sphere against the frustum.
+	// Params: the sphere.
+	// Returns: if the sphere is at least partly inside.
+	bool TestSphere(const Sphere& sphere) const
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			if (glm::dot(m_Planes[i].m_Normal, sphere.m_Centre) + m_Planes[i].m_Distance < -sphere.m_Radius)
+				return false;
+		}
+
+		return true;
+	}
+
+	Plane m_Planes[6];
+};
+
+// Ray with a normalised direction.
+struct Ray
+{
+	glm::vec3 m_Origin;
+	glm::vec3 m_Direction;
+};
+
+// Transform a box and get the box that contains the result.
+// Params: the box, the matrix to transform it by.
+// Returns: the transformed box.
+inline AABB TransformAABB(const AABB& box, const glm::mat4& matrix)
+{
+	glm::vec3 centre = glm::vec3(matrix * glm::vec4(box.GetCentre(), 1.0f));
+	glm::vec3 extents = box.GetExtents();
+
+	// Each world axis extent is the sum of the absolute contributions of the local extents.
+	glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+	glm::vec3 worldExtents = absolute * extents;
+
+	AABB result;
+	result.m_Min = centre - worldExtents;
+	result.m_Max = centre + worldExtents;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "CpuFeatures.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void Cpuid(int leaf, int subleaf, int registers[4])
+{
+#ifdef _MSC_VER
+	__cpuidex(registers, leaf, subleaf);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	registers[0] = (int)a;
+	registers[1] = (int)b;
+	registers[2] = (int)c;
+	registers[3] = (int)d;
+#endif
+}
+
+static unsigned long long ReadXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static CpuFeatures DetectCpuFeatures()
+{
+	CpuFeatures features;
+
+	int registers[4];
+	Cpuid(0, 0, registers);
+	int maxLeaf = registers[0];
+
+	if (maxLeaf < 1)
+		return features;
+
+	Cpuid(1, 0, registers);
+	features.m_SSE41 = (registers[2] & (1 << 19)) != 0;
+	features.m_FMA = (registers[2] & (1 << 12)) != 0;
+
+	// AVX needs the OS to save the ymm registers on context switch as well as the cpu supporting it.
+	bool osxsave = (registers[2] & (1 << 27)) != 0;
+	bool cpuAVX = (registers[2] & (1 << 28)) != 0;
+	bool osAVX = osxsave && (ReadXCR0() & 0x6) == 0x6;
+	features.m_AVX = cpuAVX && osAVX;
+	features.m_FMA = features.m_FMA && features.m_AVX;
+	features.m_F16C = features.m_AVX && (registers[2] & (1 << 29)) != 0;
+
+	if (maxLeaf >= 7)
+	{
+		Cpuid(7, 0, registers);
+		features.m_AVX2 = features.m_AVX && (registers[1] & (1 << 5)) != 0;
+	}
+
+	return features;
+}
+
+const CpuFeatures& CpuFeatures::Get()
+{
+	static const CpuFeatures features = DetectCpuFeatures();
+	return features;
+}
\ No newline at end of file
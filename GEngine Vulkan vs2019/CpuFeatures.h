@@ -0,0 +1,25 @@
+#pragma once
+
+// Lets a function use AVX2/FMA/F16C/POPCNT intrinsics while the rest of the file is built for the baseline instruction set.
+// MSVC allows intrinsics anywhere, gcc and clang need the target attribute.
+#ifdef _MSC_VER
+#define GENGINE_TARGET_AVX2
+#else
+#define GENGINE_TARGET_AVX2 __attribute__((target("avx2,fma,f16c,popcnt")))
+#endif
+
+// SIMD features of the cpu the program is running on.
+// Used to pick between SSE and AVX code paths at runtime.
+struct CpuFeatures
+{
+	// Get the features of the current cpu.
+	// Only detected the first time it's called.
+	// Returns: the detected features.
+	static const CpuFeatures& Get();
+
+	bool m_SSE41 = false;
+	bool m_AVX = false;
+	bool m_AVX2 = false;
+	bool m_FMA = false;
+	bool m_F16C = false;
+};
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "DeletionQueue.h"
+#include "FrameTimeline.h"
+
+// Destroyed entries at the front of the queue before they're erased.
+static const size_t MAX_DESTROYED_ENTRIES = 64;
+
+static void FreeDescriptorSetObject(VkDevice device, uint64_t handle, uint64_t parent)
+{
+	VkDescriptorSet set = (VkDescriptorSet)handle;
+	vkFreeDescriptorSets(device, (VkDescriptorPool)parent, 1, &set);
+}
+
+DeletionQueue::DeletionQueue(VkDevice device, FrameTimeline* timeline)
+{
+	m_VkDevice = device;
+	m_Timeline = timeline;
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	Flush();
+}
+
+void DeletionQueue::FreeDescriptorSet(VkDescriptorPool pool, VkDescriptorSet set)
+{
+	if (set != VK_NULL_HANDLE)
+		Push((uint64_t)set, (uint64_t)pool, FreeDescriptorSetObject);
+}
+
+void DeletionQueue::Push(uint64_t handle, uint64_t parent, DestroyFunction destroy)
+{
+	Deletion deletion;
+	deletion.m_Frame = m_Timeline->GetFrameNumber();
+	deletion.m_Handle = handle;
+	deletion.m_Parent = parent;
+	deletion.m_Destroy = destroy;
+	m_Deletions.push_back(deletion);
+}
+
+void DeletionQueue::Collect()
+{
+	if (m_Head == m_Deletions.size())
+		return;
+
+	uint64_t completedFrame = m_Timeline->GetCompletedFrame();
+	size_t end = m_Head;
+	while (end < m_Deletions.size() && m_Deletions[end].m_Frame <= completedFrame)
+		++end;
+
+	DestroyUpTo(end);
+}
+
+void DeletionQueue::Flush()
+{
+	DestroyUpTo(m_Deletions.size());
+}
+
+void DeletionQueue::DestroyUpTo(size_t end)
+{
+	for (; m_Head < end; ++m_Head)
+	{
+		const Deletion& deletion = m_Deletions[m_Head];
+		deletion.m_Destroy(m_VkDevice, deletion.m_Handle, deletion.m_Parent);
+	}
+
+	if (m_Head == m_Deletions.size())
+	{
+		m_Deletions.clear();
+		m_Head = 0;
+	}
+	else if (m_Head >= MAX_DESTROYED_ENTRIES)
+	{
+		m_Deletions.erase(m_Deletions.begin(), m_Deletions.begin() + m_Head);
+		m_Head = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "VulkanHandle.h"
+
+class FrameTimeline;
+
+// Destroys Vulkan objects once the GPU has finished every frame that could have used them, so they can be replaced
+// while frames are in flight without waiting for the device. Each object is marked with the frame being recorded when
+// it's given up, as anything submitted before or recorded since could still use it, and destroyed by the first Collect
+// after the frame timeline has passed that frame. Objects are queued in frame order, so Collect only looks at the front.
+class DeletionQueue
+{
+public:
+	// Constructor.
+	// Params: the logical device, the timeline frames are checked against.
+	DeletionQueue(VkDevice device, FrameTimeline* timeline);
+	// Destructor. Destroys everything still queued, so the device has to be idle.
+	~DeletionQueue();
+
+	// Destroy an object once the GPU's done with the frame being recorded. Empty handles are ignored.
+	// Params: the handle, moved from.
+	template<typename T, void (VKAPI_PTR* DestroyHandle)(VkDevice, T, const VkAllocationCallbacks*)>
+	void Destroy(VulkanHandle<T, DestroyHandle>&& handle)
+	{
+		if (handle)
+			Push((uint64_t)handle.Release(), 0, DestroyObject<T, DestroyHandle>);
+	}
+
+	// Free a descriptor set back to its pool once the GPU's done with the frame being recorded.
+	// Params: the pool the set was allocated from, the set.
+	void FreeDescriptorSet(VkDescriptorPool pool, VkDescriptorSet set);
+
+	// Destroy the objects whose frames the GPU has finished. Cheap when nothing's queued.
+	void Collect();
+
+	// Destroy everything queued straight away. The GPU has to be done with all of it.
+	void Flush();
+
+	// Get the amount of objects waiting to be destroyed.
+	// Returns: the object count.
+	size_t GetPendingCount() const { return m_Deletions.size() - m_Head; }
+
+private:
+	// Destroys an object given as an integer, with the parent object for things like descriptor sets.
+	typedef void (*DestroyFunction)(VkDevice device, uint64_t handle, uint64_t parent);
+
+	// An object to destroy and the frame that has to finish first.
+	struct Deletion
+	{
+		uint64_t m_Frame;
+		uint64_t m_Handle;
+		uint64_t m_Parent;
+		DestroyFunction m_Destroy;
+	};
+
+	// Queue an object for destruction after the frame being recorded.
+	// Params: the object, its parent, the function to destroy it with.
+	void Push(uint64_t handle, uint64_t parent, DestroyFunction destroy);
+
+	// Destroy the objects from the front of the queue up to an index.
+	// Params: the index to stop at.
+	void DestroyUpTo(size_t end);
+
+	// Destroy an object of a handle type.
+	template<typename T, void (VKAPI_PTR* DestroyHandle)(VkDevice, T, const VkAllocationCallbacks*)>
+	static void DestroyObject(VkDevice device, uint64_t handle, uint64_t /*parent*/)
+	{
+		DestroyHandle(device, (T)handle, nullptr);
+	}
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// The timeline frames are checked against.
+	FrameTimeline* m_Timeline;
+
+	// Objects waiting to be destroyed, oldest frame first, from m_Head on. The front is only erased once it's
+	// grown, so collecting a few objects at a time doesn't move the rest every frame.
+	std::vector<Deletion> m_Deletions;
+	size_t m_Head = 0;
+};
\ No newline at end of file
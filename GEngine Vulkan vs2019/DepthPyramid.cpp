@@ -0,0 +1,186 @@
+#include "DepthPyramid.h"
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Mip 0 texels reduced by one workgroup along each side.
+static const uint PYRAMID_TILE_SIZE = 32;
+
+// Largest power of two that isn't bigger than a value.
+static uint PreviousPowerOfTwo(uint value)
+{
+	uint result = 1;
+	while (result * 2 <= value)
+		result *= 2;
+
+	return result;
+}
+
+DepthPyramid::DepthPyramid(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+	m_DepthExtent = renderer->GetSwapChainExtent();
+
+	if (!renderer->GetEnabledFeatures().shaderStorageImageExtendedFormats)
+		throw std::runtime_error("The depth pyramid needs the shaderStorageImageExtendedFormats feature!");
+
+	// A power of two keeps every reduction after mip 0 to exactly 2x2 texels.
+	uint maxSize = 1u << (DEPTH_PYRAMID_MAX_MIPS - 1);
+	m_Extent.width = std::min(PreviousPowerOfTwo(m_DepthExtent.width), maxSize);
+	m_Extent.height = std::min(PreviousPowerOfTwo(m_DepthExtent.height), maxSize);
+
+	m_MipCount = 1;
+	while ((std::max(m_Extent.width, m_Extent.height) >> m_MipCount) > 0)
+		++m_MipCount;
+
+	CreateImage();
+	CreateDescriptorSet();
+	CreatePipeline();
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	vkDestroyPipeline(m_VkDevice, m_VkPipeline, nullptr);
+	vkDestroyPipelineLayout(m_VkDevice, m_VkPipelineLayout, nullptr);
+	m_Renderer->GetDescriptorAllocator()->FreeCachedSet(m_VkDescriptorSet);
+	vkDestroyDescriptorSetLayout(m_VkDevice, m_VkDescriptorSetLayout, nullptr);
+	vkDestroyBuffer(m_VkDevice, m_VkCounterBuffer, nullptr);
+	vkFreeMemory(m_VkDevice, m_VkCounterMemory, nullptr);
+	vkDestroySampler(m_VkDevice, m_VkSampler, nullptr);
+
+	for (uint i = 0; i < m_MipCount; ++i)
+		vkDestroyImageView(m_VkDevice, m_VkMipViews[i], nullptr);
+
+	vkDestroyImageView(m_VkDevice, m_VkImageView, nullptr);
+	vkDestroyImage(m_VkDevice, m_VkImage, nullptr);
+	vkFreeMemory(m_VkDevice, m_VkImageMemory, nullptr);
+}
+
+void DepthPyramid::CreateImage()
+{
+	m_Renderer->CreateImage(m_Extent.width, m_Extent.height, m_MipCount, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		m_VkImage, m_VkImageMemory);
+
+	m_VkImageView = m_Renderer->CreateImageView(m_VkImage, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipCount);
+	for (uint i = 0; i < m_MipCount; ++i)
+		m_VkMipViews[i] = m_Renderer->CreateImageView(m_VkImage, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, i, 1);
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(m_VkDevice, &samplerInfo, nullptr, &m_VkSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid sampler!");
+
+	// The last workgroup puts the count back to 0, so it only needs clearing once.
+	m_Renderer->CreateBuffer(sizeof(uint), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_VkCounterBuffer, m_VkCounterMemory);
+
+	void* data;
+	vkMapMemory(m_VkDevice, m_VkCounterMemory, 0, sizeof(uint), 0, &data);
+	memset(data, 0, sizeof(uint));
+	vkUnmapMemory(m_VkDevice, m_VkCounterMemory);
+}
+
+void DepthPyramid::CreateDescriptorSet()
+{
+	// Depth buffer, pyramid mips and the workgroup counter.
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = DEPTH_PYRAMID_MAX_MIPS;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[2].binding = 2;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2].descriptorCount = 1;
+	bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &m_VkDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid descriptor set layout!");
+
+	// Every slot needs a valid view, so slots past the last mip repeat it. The shader never touches them.
+	DescriptorWrite descriptorWrites[DEPTH_PYRAMID_MAX_MIPS + 2];
+	descriptorWrites[0] = DescriptorWrite::Image(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_VkSampler, m_Renderer->GetDepthImageView(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	for (uint i = 0; i < DEPTH_PYRAMID_MAX_MIPS; ++i)
+	{
+		descriptorWrites[i + 1] = DescriptorWrite::Image(1, i, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE, m_VkMipViews[std::min(i, m_MipCount - 1)],
+			VK_IMAGE_LAYOUT_GENERAL);
+	}
+	descriptorWrites[DEPTH_PYRAMID_MAX_MIPS + 1] = DescriptorWrite::Buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_VkCounterBuffer);
+
+	m_VkDescriptorSet = m_Renderer->GetDescriptorAllocator()->GetCachedSet(m_VkDescriptorSetLayout, descriptorWrites, DEPTH_PYRAMID_MAX_MIPS + 2);
+}
+
+void DepthPyramid::CreatePipeline()
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PyramidConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_VkDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_VkDevice, &pipelineLayoutInfo, nullptr, &m_VkPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid pipeline layout!");
+
+	VkShaderModule shaderModule = m_Renderer->CreateShaderModule(m_Renderer->ReadFile("../Shaders/DepthPyramid/depthPyramid.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_VkPipelineLayout;
+
+	if (vkCreateComputePipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pyramid pipeline!");
+
+	vkDestroyShaderModule(m_VkDevice, shaderModule, nullptr);
+}
+
+void DepthPyramid::Record(VkCommandBuffer commandBuffer)
+{
+	uint groupsX = (m_Extent.width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+	uint groupsY = (m_Extent.height + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+
+	// Only the render extent of the depth buffer was drawn to, so mip 0 is spread over that.
+	VkExtent2D renderExtent = m_Renderer->GetRenderExtent();
+
+	PyramidConstants constants;
+	constants.m_DepthSize[0] = (int32_t)renderExtent.width;
+	constants.m_DepthSize[1] = (int32_t)renderExtent.height;
+	constants.m_PyramidSize[0] = (int32_t)m_Extent.width;
+	constants.m_PyramidSize[1] = (int32_t)m_Extent.height;
+	constants.m_MipCount = (int32_t)m_MipCount;
+	constants.m_GroupCount = groupsX * groupsY;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipelineLayout, 0, 1, &m_VkDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_VkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants), &constants);
+	vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+
+// Most mip levels the pyramid can have, enough for a 4096 texel wide pyramid.
+#define DEPTH_PYRAMID_MAX_MIPS 13
+
+// Min and max depth pyramid built from the depth buffer each frame, for occlusion culling on the GPU.
+// Mip 0 is the largest power of two that fits in the depth buffer, each texel holding the min and max
+// depth of every depth pixel it covers, and each mip after that reduces 2x2 texels of the one before.
+// Every mip is built in one dispatch: each workgroup reduces a 32x32 tile down to a single texel,
+// and the last workgroup to finish builds the rest of the mips from those.
+class DepthPyramid
+{
+public:
+	// Constructor.
+	// Params: the renderer, whose depth buffer the pyramid is built from.
+	DepthPyramid(VulkanRenderer* renderer);
+	// Destructor.
+	~DepthPyramid();
+
+	// Record the pyramid build. Has to be outside a render pass, with depth readable by shaders and the pyramid in the general layout.
+	// Params: the command buffer.
+	void Record(VkCommandBuffer commandBuffer);
+
+	// Get the pyramid image.
+	// Returns: the image.
+	VkImage GetImage() const { return m_VkImage; }
+
+	// Get a view of every mip level, for sampling in the general layout.
+	// Returns: the image view.
+	VkImageView GetImageView() const { return m_VkImageView; }
+
+	// Get the sampler to read the pyramid with.
+	// Returns: the sampler.
+	VkSampler GetSampler() const { return m_VkSampler; }
+
+	// Get the size of mip 0.
+	// Returns: the width and height in texels.
+	VkExtent2D GetExtent() const { return m_Extent; }
+
+	// Get the amount of mip levels.
+	// Returns: the mip count.
+	uint GetMipCount() const { return m_MipCount; }
+
+private:
+	// Create the pyramid image and its views, the sampler and the workgroup counter.
+	void CreateImage();
+
+	// Create the set layout, and get a descriptor set that points at the depth buffer and the pyramid mips.
+	void CreateDescriptorSet();
+
+	// Create the compute pipeline.
+	void CreatePipeline();
+
+	// Push constants for the pyramid shader.
+	struct PyramidConstants
+	{
+		int32_t m_DepthSize[2];
+		int32_t m_PyramidSize[2];
+		int32_t m_MipCount;
+		uint m_GroupCount;
+	};
+
+	// The renderer the pyramid was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// Size of the depth buffer.
+	VkExtent2D m_DepthExtent;
+
+	// Size of mip 0 and the amount of mips.
+	VkExtent2D m_Extent;
+	uint m_MipCount;
+
+	// The pyramid image, a view of all of it and a view per mip for writing.
+	VkImage m_VkImage;
+	VkDeviceMemory m_VkImageMemory;
+	VkImageView m_VkImageView;
+	VkImageView m_VkMipViews[DEPTH_PYRAMID_MAX_MIPS];
+
+	// Nearest, clamped sampler for the depth buffer and pyramid.
+	VkSampler m_VkSampler;
+
+	// Count of finished workgroups, so the last one knows to carry on.
+	VkBuffer m_VkCounterBuffer;
+	VkDeviceMemory m_VkCounterMemory;
+
+	// The compute pipeline and its layouts.
+	VkDescriptorSetLayout m_VkDescriptorSetLayout;
+	VkPipelineLayout m_VkPipelineLayout;
+	VkPipeline m_VkPipeline;
+
+	// Set pointing at the depth buffer and mips, from the renderer's descriptor set cache.
+	VkDescriptorSet m_VkDescriptorSet;
+};
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "DescriptorAllocator.h"
+#include "DeletionQueue.h"
+#include <cstring>
+#include <stdexcept>
+
+// Sets each pool holds.
+static const uint SETS_PER_POOL = 64;
+
+// Descriptors of each type per set a pool holds, roughly what the engine's sets use.
+static const VkDescriptorPoolSize POOL_RATIOS[] =
+{
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+};
+
+// FNV-1a.
+static const uint64_t HASH_OFFSET = 14695981039346656037ull;
+static const uint64_t HASH_PRIME = 1099511628211ull;
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
+
+// Hash a value on its own, so padding bytes in the structs it sits in are never read.
+template<typename T>
+static uint64_t HashValue(uint64_t hash, const T& value)
+{
+	return HashBytes(hash, &value, sizeof(T));
+}
+
+DescriptorWrite DescriptorWrite::Buffer(uint binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorWrite write{};
+	write.m_Binding = binding;
+	write.m_ArrayElement = 0;
+	write.m_Type = type;
+	write.m_BufferInfo.buffer = buffer;
+	write.m_BufferInfo.offset = offset;
+	write.m_BufferInfo.range = range;
+	return write;
+}
+
+DescriptorWrite DescriptorWrite::Image(uint binding, uint arrayElement, VkDescriptorType type, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout)
+{
+	DescriptorWrite write{};
+	write.m_Binding = binding;
+	write.m_ArrayElement = arrayElement;
+	write.m_Type = type;
+	write.m_ImageInfo.sampler = sampler;
+	write.m_ImageInfo.imageView = imageView;
+	write.m_ImageInfo.imageLayout = imageLayout;
+	return write;
+}
+
+DescriptorAllocator::DescriptorAllocator(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+	m_CachePools.m_FreeSets = true;
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+	for (PoolList& pools : m_FramePools)
+	{
+		for (VkDescriptorPool pool : pools.m_Pools)
+			vkDestroyDescriptorPool(m_VkDevice, pool, nullptr);
+	}
+
+	for (VkDescriptorPool pool : m_CachePools.m_Pools)
+		vkDestroyDescriptorPool(m_VkDevice, pool, nullptr);
+}
+
+void DescriptorAllocator::BeginFrame(uint frameIndex)
+{
+	m_FrameIndex = frameIndex;
+
+	// Resetting gives back every set at once, and keeps the pools around for this frame's sets.
+	PoolList& pools = m_FramePools[frameIndex];
+	for (VkDescriptorPool pool : pools.m_Pools)
+		vkResetDescriptorPool(m_VkDevice, pool, 0);
+	pools.m_Current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateFrameSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount)
+{
+	VkDescriptorSet set = Allocate(m_FramePools[m_FrameIndex], layout, nullptr);
+	WriteSet(set, writes, writeCount);
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::GetCachedSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount)
+{
+	uint64_t hash = HashSet(layout, writes, writeCount);
+
+	auto found = m_Cache.find(hash);
+	if (found != m_Cache.end())
+	{
+		for (const CachedSet& cachedSet : found->second)
+		{
+			if (Matches(cachedSet, layout, writes, writeCount))
+			{
+				++m_Stats.m_CacheHits;
+				return cachedSet.m_Set;
+			}
+		}
+	}
+
+	++m_Stats.m_CacheMisses;
+
+	CachedSet cachedSet;
+	cachedSet.m_Layout = layout;
+	cachedSet.m_Writes.assign(writes, writes + writeCount);
+	cachedSet.m_Set = Allocate(m_CachePools, layout, &cachedSet.m_Pool);
+	WriteSet(cachedSet.m_Set, writes, writeCount);
+
+	m_Cache[hash].push_back(cachedSet);
+	m_CachedSetHashes[cachedSet.m_Set] = hash;
+	return cachedSet.m_Set;
+}
+
+void DescriptorAllocator::FreeCachedSet(VkDescriptorSet set)
+{
+	auto found = m_CachedSetHashes.find(set);
+	if (found == m_CachedSetHashes.end())
+		return;
+
+	std::vector<CachedSet>& bucket = m_Cache[found->second];
+	for (size_t i = 0; i < bucket.size(); ++i)
+	{
+		if (bucket[i].m_Set == set)
+		{
+			// Frames in flight might still use it, only finding it in the cache has to stop now.
+			m_Renderer->GetDeletionQueue()->FreeDescriptorSet(bucket[i].m_Pool, set);
+			bucket.erase(bucket.begin() + i);
+			break;
+		}
+	}
+
+	if (bucket.empty())
+		m_Cache.erase(found->second);
+	m_CachedSetHashes.erase(found);
+
+	// Freed sets leave gaps in earlier pools, so look for space from the start again.
+	m_CachePools.m_Current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(PoolList& pools, VkDescriptorSetLayout layout, VkDescriptorPool* pool)
+{
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	while (true)
+	{
+		bool newPool = pools.m_Current == pools.m_Pools.size();
+		if (newPool)
+			pools.m_Pools.push_back(CreatePool(pools.m_FreeSets));
+
+		allocInfo.descriptorPool = pools.m_Pools[pools.m_Current];
+		VkResult result = vkAllocateDescriptorSets(m_VkDevice, &allocInfo, &set);
+		if (result == VK_SUCCESS)
+			break;
+
+		// The pool's full, so move on to the next one. A set that doesn't fit in a new pool never will.
+		if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || newPool)
+			throw std::runtime_error("Failed to allocate descriptor set!");
+
+		++pools.m_Current;
+	}
+
+	if (pool != nullptr)
+		*pool = allocInfo.descriptorPool;
+
+	++m_Stats.m_SetsAllocated;
+	return set;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(bool freeSets)
+{
+	VkDescriptorPoolSize poolSizes[sizeof(POOL_RATIOS) / sizeof(POOL_RATIOS[0])];
+	for (size_t i = 0; i < sizeof(POOL_RATIOS) / sizeof(POOL_RATIOS[0]); ++i)
+	{
+		poolSizes[i].type = POOL_RATIOS[i].type;
+		poolSizes[i].descriptorCount = POOL_RATIOS[i].descriptorCount * SETS_PER_POOL;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = freeSets ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+	poolInfo.maxSets = SETS_PER_POOL;
+	poolInfo.poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]);
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_VkDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create descriptor pool!");
+
+	++m_Stats.m_PoolCount;
+	return pool;
+}
+
+void DescriptorAllocator::WriteSet(VkDescriptorSet set, const DescriptorWrite* writes, uint writeCount)
+{
+	if (writeCount == 0)
+		return;
+
+	// Frame sets are written every frame, so the writes go in scratch space that only grows until it fits the biggest set.
+	if (m_ScratchWrites.size() < writeCount)
+		m_ScratchWrites.resize(writeCount);
+
+	for (uint i = 0; i < writeCount; ++i)
+	{
+		VkWriteDescriptorSet& descriptorWrite = m_ScratchWrites[i];
+		descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = writes[i].m_Binding;
+		descriptorWrite.dstArrayElement = writes[i].m_ArrayElement;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = writes[i].m_Type;
+		descriptorWrite.pImageInfo = &writes[i].m_ImageInfo;
+		descriptorWrite.pBufferInfo = &writes[i].m_BufferInfo;
+	}
+
+	vkUpdateDescriptorSets(m_VkDevice, writeCount, m_ScratchWrites.data(), 0, nullptr);
+}
+
+uint64_t DescriptorAllocator::HashSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount)
+{
+	uint64_t hash = HashValue(HASH_OFFSET, layout);
+	for (uint i = 0; i < writeCount; ++i)
+	{
+		const DescriptorWrite& write = writes[i];
+		hash = HashValue(hash, write.m_Binding);
+		hash = HashValue(hash, write.m_ArrayElement);
+		hash = HashValue(hash, write.m_Type);
+		hash = HashValue(hash, write.m_ImageInfo.sampler);
+		hash = HashValue(hash, write.m_ImageInfo.imageView);
+		hash = HashValue(hash, write.m_ImageInfo.imageLayout);
+		hash = HashValue(hash, write.m_BufferInfo.buffer);
+		hash = HashValue(hash, write.m_BufferInfo.offset);
+		hash = HashValue(hash, write.m_BufferInfo.range);
+	}
+
+	return hash;
+}
+
+bool DescriptorAllocator::Matches(const CachedSet& cachedSet, VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount)
+{
+	if (cachedSet.m_Layout != layout || cachedSet.m_Writes.size() != writeCount)
+		return false;
+
+	for (uint i = 0; i < writeCount; ++i)
+	{
+		const DescriptorWrite& a = cachedSet.m_Writes[i];
+		const DescriptorWrite& b = writes[i];
+		if (a.m_Binding != b.m_Binding || a.m_ArrayElement != b.m_ArrayElement || a.m_Type != b.m_Type
+			|| a.m_ImageInfo.sampler != b.m_ImageInfo.sampler || a.m_ImageInfo.imageView != b.m_ImageInfo.imageView
+			|| a.m_ImageInfo.imageLayout != b.m_ImageInfo.imageLayout || a.m_BufferInfo.buffer != b.m_BufferInfo.buffer
+			|| a.m_BufferInfo.offset != b.m_BufferInfo.offset || a.m_BufferInfo.range != b.m_BufferInfo.range)
+			return false;
+	}
+
+	return true;
+}
\ No newline at end of file
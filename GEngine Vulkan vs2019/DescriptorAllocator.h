@@ -0,0 +1,145 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include <unordered_map>
+#include <vector>
+
+// One descriptor to write into a set.
+struct DescriptorWrite
+{
+	uint m_Binding;
+	uint m_ArrayElement;
+	VkDescriptorType m_Type;
+	VkDescriptorImageInfo m_ImageInfo;
+	VkDescriptorBufferInfo m_BufferInfo;
+
+	// Make a buffer descriptor.
+	// Params: the binding, the descriptor type, the buffer, offset to the start of the range, size of the range.
+	// Returns: the descriptor write.
+	static DescriptorWrite Buffer(uint binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	// Make an image or sampler descriptor.
+	// Params: the binding, the array element, the descriptor type, the sampler, the image view, the image's layout.
+	// Returns: the descriptor write.
+	static DescriptorWrite Image(uint binding, uint arrayElement, VkDescriptorType type, VkSampler sampler, VkImageView imageView, VkImageLayout imageLayout);
+};
+
+// Counts of what the allocator has done.
+struct DescriptorAllocatorStats
+{
+	// Pools created, for frames and the cache.
+	size_t m_PoolCount = 0;
+	// Sets allocated from the pools.
+	size_t m_SetsAllocated = 0;
+	// Cached set lookups that found a set, and ones that had to make a new one.
+	size_t m_CacheHits = 0;
+	size_t m_CacheMisses = 0;
+};
+
+// Hands out descriptor sets from growable lists of pools.
+// Sets that only live for a frame come from that frame in flight's pools, which are reset all at once
+// when the frame comes around again instead of freeing sets one by one. Sets that don't change are
+// cached by a hash of their layout and the resources written to them, so asking for the same set
+// again returns the one already made without allocating or updating anything.
+class DescriptorAllocator
+{
+public:
+	// Constructor.
+	// Params: the renderer whose device the pools are made on.
+	DescriptorAllocator(VulkanRenderer* renderer);
+	// Destructor.
+	~DescriptorAllocator();
+
+	// Move on to the next frame in flight, resetting its pools. The frame's last run has to have finished.
+	// Params: the frame in flight index.
+	void BeginFrame(uint frameIndex);
+
+	// Allocate and write a set that's only used this frame.
+	// Params: the set layout, the descriptors to write, how many descriptors.
+	// Returns: the set, valid until the frame comes around again.
+	VkDescriptorSet AllocateFrameSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount);
+
+	// Get a set with a layout and resources, making it the first time it's asked for.
+	// Params: the set layout, the descriptors to write, how many descriptors.
+	// Returns: the set, valid until it's freed.
+	VkDescriptorSet GetCachedSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount);
+
+	// Free a cached set once the frames in flight are done with it, taking it out of the cache straight away. Has to be
+	// called before destroying resources in it, as new resources can get the same handles.
+	// Params: the set.
+	void FreeCachedSet(VkDescriptorSet set);
+
+	// Get the counts of what the allocator has done.
+	// Returns: the stats.
+	const DescriptorAllocatorStats& GetStats() const { return m_Stats; }
+
+private:
+	// A list of pools, filled in order.
+	struct PoolList
+	{
+		std::vector<VkDescriptorPool> m_Pools;
+		// The pool being allocated from.
+		size_t m_Current = 0;
+		// If sets can be freed one at a time.
+		bool m_FreeSets = false;
+	};
+
+	// A set in the cache, with what it was made from to tell hash collisions apart.
+	struct CachedSet
+	{
+		VkDescriptorSetLayout m_Layout;
+		std::vector<DescriptorWrite> m_Writes;
+		VkDescriptorSet m_Set;
+		// The pool the set came from, to free it back to.
+		VkDescriptorPool m_Pool;
+	};
+
+	// Allocate a set from a list of pools, moving on to the next pool when one is full.
+	// Params: the pool list, the set layout, where to put the pool it came from, or nullptr.
+	// Returns: the set.
+	VkDescriptorSet Allocate(PoolList& pools, VkDescriptorSetLayout layout, VkDescriptorPool* pool);
+
+	// Create a pool.
+	// Params: if sets can be freed one at a time.
+	// Returns: the pool.
+	VkDescriptorPool CreatePool(bool freeSets);
+
+	// Write descriptors into a set.
+	// Params: the set, the descriptors, how many descriptors.
+	void WriteSet(VkDescriptorSet set, const DescriptorWrite* writes, uint writeCount);
+
+	// Hash a layout and the descriptors in it.
+	// Params: the set layout, the descriptors, how many descriptors.
+	// Returns: the hash.
+	static uint64_t HashSet(VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount);
+
+	// Check if a cached set was made from a layout and descriptors.
+	// Params: the cached set, the set layout, the descriptors, how many descriptors.
+	// Returns: if they match.
+	static bool Matches(const CachedSet& cachedSet, VkDescriptorSetLayout layout, const DescriptorWrite* writes, uint writeCount);
+
+	// The renderer the allocator was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// Pools for each frame in flight, reset when the frame begins.
+	PoolList m_FramePools[MAX_FRAMES_IN_FLIGHT];
+
+	// Pools for cached sets, never reset.
+	PoolList m_CachePools;
+
+	// Cached sets by hash, and the hash of each cached set.
+	std::unordered_map<uint64_t, std::vector<CachedSet>> m_Cache;
+	std::unordered_map<VkDescriptorSet, uint64_t> m_CachedSetHashes;
+
+	// The frame in flight being recorded.
+	uint m_FrameIndex = 0;
+
+	// Vulkan writes filled in by WriteSet, kept so writing a set doesn't allocate.
+	std::vector<VkWriteDescriptorSet> m_ScratchWrites;
+
+	// Counts of what the allocator has done.
+	DescriptorAllocatorStats m_Stats;
+};
\ No newline at end of file
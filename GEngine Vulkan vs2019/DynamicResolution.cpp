@@ -0,0 +1,165 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// Weight of each new GPU time in the smoothed time.
+static const float SMOOTHING = 0.1f;
+
+// The band around the target the smoothed time can be in without the scale moving, as fractions of the target.
+// It's wider below so a scale that only just fits doesn't climb back up straight away.
+static const float OVER_BUDGET = 1.05f;
+static const float UNDER_BUDGET = 0.85f;
+
+// Frames in a row outside the band before the scale drops or climbs.
+static const uint OVER_FRAMES = 4;
+static const uint UNDER_FRAMES = 30;
+
+// Frames to wait after the scale moves, for the smoothed time to catch up with it.
+static const uint COOLDOWN_FRAMES = 15;
+
+// Time to aim for when climbing, as a fraction of the target, so the new scale lands inside the band.
+static const float CLIMB_AIM = 0.95f;
+
+// Most the scale can climb by at once.
+static const float MAX_CLIMB = 1.1f;
+
+// Smallest change of scale worth making.
+static const float MIN_SCALE_CHANGE = 0.02f;
+
+// Render extents are rounded to this many pixels, so small changes of scale don't change them.
+static const uint EXTENT_ALIGNMENT = 8;
+
+DynamicResolution::DynamicResolution(VulkanRenderer* renderer)
+{
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	// Without timestamps on the graphics queue there's nothing to go by, so the scale stays where it is.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(renderer->GetPhysicalDevice(), &properties);
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+
+	uint familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer->GetPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer->GetPhysicalDevice(), &familyCount, families.data());
+
+	uint validBits = 0;
+	for (const VkQueueFamilyProperties& family : families)
+	{
+		if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			validBits = family.timestampValidBits;
+			break;
+		}
+	}
+
+	if (validBits == 0)
+		return;
+
+	m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+
+	if (vkCreateQueryPool(m_VkDevice, &poolInfo, nullptr, &m_VkQueryPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create timestamp query pool!");
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	vkDestroyQueryPool(m_VkDevice, m_VkQueryPool, nullptr);
+}
+
+void DynamicResolution::SetTarget(float targetFrameTime, float minScale, float maxScale)
+{
+	m_TargetFrameTime = targetFrameTime;
+	m_MinScale = minScale;
+	m_MaxScale = std::max(minScale, maxScale);
+	m_Stats.m_Scale = std::min(std::max(m_Stats.m_Scale, m_MinScale), m_MaxScale);
+}
+
+void DynamicResolution::Update(uint frameIndex)
+{
+	if (!m_QueriesWritten[frameIndex])
+		return;
+
+	m_QueriesWritten[frameIndex] = false;
+
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(m_VkDevice, m_VkQueryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	AddFrameTime((float)((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0f);
+}
+
+void DynamicResolution::AddFrameTime(float gpuTime)
+{
+	m_Stats.m_GpuTime = gpuTime;
+	m_Stats.m_SmoothedGpuTime = m_HasTime ? m_Stats.m_SmoothedGpuTime + (gpuTime - m_Stats.m_SmoothedGpuTime) * SMOOTHING : gpuTime;
+	m_HasTime = true;
+
+	if (m_Cooldown > 0)
+	{
+		--m_Cooldown;
+		return;
+	}
+
+	float smoothed = m_Stats.m_SmoothedGpuTime;
+	m_OverFrames = smoothed > m_TargetFrameTime * OVER_BUDGET ? m_OverFrames + 1 : 0;
+	m_UnderFrames = smoothed < m_TargetFrameTime * UNDER_BUDGET ? m_UnderFrames + 1 : 0;
+
+	float scale = m_Stats.m_Scale;
+	if (m_OverFrames >= OVER_FRAMES)
+		scale *= std::sqrt(m_TargetFrameTime / smoothed);
+	else if (m_UnderFrames >= UNDER_FRAMES)
+		scale *= std::min(std::sqrt(m_TargetFrameTime * CLIMB_AIM / smoothed), MAX_CLIMB);
+	else
+		return;
+
+	scale = std::min(std::max(scale, m_MinScale), m_MaxScale);
+	m_OverFrames = 0;
+	m_UnderFrames = 0;
+	if (std::fabs(scale - m_Stats.m_Scale) < MIN_SCALE_CHANGE)
+		return;
+
+	// Guess the time at the new scale so the smoothing doesn't spend the next frames pulling the old one back.
+	float ratio = scale / m_Stats.m_Scale;
+	m_Stats.m_SmoothedGpuTime *= ratio * ratio;
+	m_Stats.m_Scale = scale;
+	++m_Stats.m_ScaleChanges;
+	m_Cooldown = COOLDOWN_FRAMES;
+}
+
+void DynamicResolution::RecordBegin(VkCommandBuffer commandBuffer, uint frameIndex)
+{
+	if (m_VkQueryPool == VK_NULL_HANDLE)
+		return;
+
+	vkCmdResetQueryPool(commandBuffer, m_VkQueryPool, frameIndex * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_VkQueryPool, frameIndex * 2);
+}
+
+void DynamicResolution::RecordEnd(VkCommandBuffer commandBuffer, uint frameIndex)
+{
+	if (m_VkQueryPool == VK_NULL_HANDLE)
+		return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_VkQueryPool, frameIndex * 2 + 1);
+	m_QueriesWritten[frameIndex] = true;
+}
+
+VkExtent2D DynamicResolution::GetRenderExtent(VkExtent2D fullExtent) const
+{
+	VkExtent2D extent;
+	extent.width = (uint)(fullExtent.width * m_Stats.m_Scale / EXTENT_ALIGNMENT + 0.5f) * EXTENT_ALIGNMENT;
+	extent.height = (uint)(fullExtent.height * m_Stats.m_Scale / EXTENT_ALIGNMENT + 0.5f) * EXTENT_ALIGNMENT;
+	extent.width = std::min(std::max(extent.width, EXTENT_ALIGNMENT), fullExtent.width);
+	extent.height = std::min(std::max(extent.height, EXTENT_ALIGNMENT), fullExtent.height);
+
+	return extent;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+
+// Numbers from the controller.
+struct DynamicResolutionStats
+{
+	// GPU time of the last frame measured and the smoothed time the controller goes by, in milliseconds.
+	float m_GpuTime = 0.0f;
+	float m_SmoothedGpuTime = 0.0f;
+	// Scale of each side of the render extent.
+	float m_Scale = 1.0f;
+	// Times the scale has changed.
+	size_t m_ScaleChanges = 0;
+};
+
+// Picks the resolution the scene is drawn at from how long the GPU takes on a frame.
+// Each frame's commands are wrapped in timestamps, read back when its frame in flight comes around again. The times
+// are smoothed, and the scale only moves once they've been outside a band around the target for a number of frames,
+// then waits before moving again, so it settles instead of going back and forth. Dropping is quick and climbing is
+// slow, since a missed frame is worse than a few frames at a lower resolution. The cost of drawing follows the pixel
+// count, so the scale is moved by the square root of how far the time is from the target.
+class DynamicResolution
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the timestamp queries with.
+	DynamicResolution(VulkanRenderer* renderer);
+	// Destructor.
+	~DynamicResolution();
+
+	// Set the GPU time to aim for and how far each side of the render extent can be scaled.
+	// Params: the target frame time in milliseconds, the smallest and largest scale.
+	void SetTarget(float targetFrameTime, float minScale, float maxScale);
+
+	// Read back the timestamps of the last frame drawn with a frame in flight and move the scale if it needs to.
+	// The GPU has to be done with that frame.
+	// Params: the frame in flight index.
+	void Update(uint frameIndex);
+
+	// Record resetting a frame's timestamps and writing the first, before any of its other commands.
+	// Params: the command buffer, the frame in flight index.
+	void RecordBegin(VkCommandBuffer commandBuffer, uint frameIndex);
+
+	// Record writing a frame's last timestamp, after all of its other commands.
+	// Params: the command buffer, the frame in flight index.
+	void RecordEnd(VkCommandBuffer commandBuffer, uint frameIndex);
+
+	// Work out the extent to draw at, the full extent scaled and rounded to a multiple of 8 pixels.
+	// Params: the full extent.
+	// Returns: the render extent.
+	VkExtent2D GetRenderExtent(VkExtent2D fullExtent) const;
+
+	// Get the numbers from the last update.
+	// Returns: the stats.
+	const DynamicResolutionStats& GetStats() const { return m_Stats; }
+
+private:
+	// Move the scale towards the target from a new GPU time.
+	// Params: the frame's GPU time in milliseconds.
+	void AddFrameTime(float gpuTime);
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// A begin and end timestamp per frame in flight, or VK_NULL_HANDLE if the graphics queue can't write timestamps.
+	VkQueryPool m_VkQueryPool = VK_NULL_HANDLE;
+
+	// If a frame in flight's timestamps were written and not read back yet.
+	bool m_QueriesWritten[MAX_FRAMES_IN_FLIGHT] = {};
+
+	// Nanoseconds per timestamp tick, and the bits of a timestamp that count, so a difference can wrap around.
+	float m_TimestampPeriod = 1.0f;
+	uint64_t m_TimestampMask = ~0ull;
+
+	// What to aim for and the scale's bounds.
+	float m_TargetFrameTime = 1000.0f / 60.0f;
+	float m_MinScale = 0.5f;
+	float m_MaxScale = 1.0f;
+
+	// Frames in a row the smoothed time has been over or under the band around the target.
+	uint m_OverFrames = 0;
+	uint m_UnderFrames = 0;
+
+	// Frames left to wait after the scale moves before it can move again.
+	uint m_Cooldown = 0;
+
+	// If a GPU time has been measured yet, to start the smoothing from.
+	bool m_HasTime = false;
+
+	// Numbers from the last update, with the current scale.
+	DynamicResolutionStats m_Stats;
+};
\ No newline at end of file
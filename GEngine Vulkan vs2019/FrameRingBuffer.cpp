@@ -0,0 +1,143 @@
+#include "FrameRingBuffer.h"
+#include "DeletionQueue.h"
+#include <algorithm>
+#include <stdexcept>
+
+FrameRingBuffer::FrameRingBuffer(VulkanRenderer* renderer, VkDeviceSize frameSize)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(renderer->GetPhysicalDevice(), &properties);
+	m_OffsetAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create frame ring buffer descriptor set layout!");
+	m_DescriptorSetLayout = UniqueDescriptorSetLayout(m_VkDevice, layout);
+
+	CreateBuffer(frameSize);
+}
+
+FrameRingBuffer::~FrameRingBuffer()
+{
+	// The handles destroy themselves and freeing the memory unmaps it. The renderer has waited for the GPU by now.
+}
+
+void FrameRingBuffer::CreateBuffer(VkDeviceSize frameSize)
+{
+	// Every frame's part has to start on a valid dynamic offset.
+	m_FrameSize = (frameSize + m_OffsetAlignment - 1) / m_OffsetAlignment * m_OffsetAlignment;
+
+	VkDeviceSize size = m_FrameSize * MAX_FRAMES_IN_FLIGHT;
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	m_Renderer->CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer, memory);
+	m_Buffer = UniqueBuffer(m_VkDevice, buffer);
+	m_Memory = UniqueDeviceMemory(m_VkDevice, memory);
+	vkMapMemory(m_VkDevice, memory, 0, size, 0, (void**)&m_MappedData);
+
+	// Each buffer gets a pool and set of its own. Frames in flight still use the old set, so it can't be written to.
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_VkDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create frame ring buffer descriptor pool!");
+	m_DescriptorPool = UniqueDescriptorPool(m_VkDevice, pool);
+
+	VkDescriptorSetLayout layout = m_DescriptorSetLayout.Get();
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	if (vkAllocateDescriptorSets(m_VkDevice, &allocInfo, &m_VkDescriptorSet) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate frame ring buffer descriptor set!");
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = m_FrameSize;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_VkDescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_VkDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+void FrameRingBuffer::ReleaseBuffer()
+{
+	// Freeing the memory unmaps it.
+	DeletionQueue* deletionQueue = m_Renderer->GetDeletionQueue();
+	deletionQueue->Destroy(std::move(m_Buffer));
+	deletionQueue->Destroy(std::move(m_Memory));
+	deletionQueue->Destroy(std::move(m_DescriptorPool));
+
+	m_VkDescriptorSet = VK_NULL_HANDLE;
+	m_MappedData = nullptr;
+}
+
+void FrameRingBuffer::BeginFrame(uint frameIndex)
+{
+	m_FrameIndex = frameIndex;
+	m_Head = 0;
+}
+
+void FrameRingBuffer::Reserve(VkDeviceSize frameSize)
+{
+	if (frameSize <= m_FrameSize)
+		return;
+
+	// Frames in flight keep reading the old buffer until they finish, so it goes to the deletion queue. This frame's
+	// part of it is thrown away, which is why nothing can be allocated before this.
+	ReleaseBuffer();
+	CreateBuffer(std::max(frameSize, m_FrameSize * 2));
+	m_Head = 0;
+}
+
+FrameAllocation FrameRingBuffer::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize offset = (m_Head + alignment - 1) / alignment * alignment;
+	if (offset + size > m_FrameSize)
+		throw std::runtime_error("Frame ring buffer is full!");
+
+	m_Head = offset + size;
+
+	FrameAllocation allocation;
+	allocation.m_Data = m_MappedData + m_FrameIndex * m_FrameSize + offset;
+	allocation.m_Offset = (uint)offset;
+	return allocation;
+}
+
+void FrameRingBuffer::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint set) const
+{
+	uint dynamicOffset = (uint)(m_FrameIndex * m_FrameSize);
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &m_VkDescriptorSet, 1, &dynamicOffset);
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include "VulkanHandle.h"
+
+// An allocation from a FrameRingBuffer.
+struct FrameAllocation
+{
+	// Where to write the data.
+	void* m_Data;
+	// Offset from the start of the frame's part of the buffer, in bytes.
+	uint m_Offset;
+};
+
+// Persistently mapped storage buffer split into one part per frame in flight, for data written every frame.
+// Allocating is just moving a head forward, and the part is reused once its frame comes around again.
+// Shaders see the current frame's part through one dynamic storage buffer descriptor, so moving between
+// frames only changes the dynamic offset, and draws find their data with an index in push constants.
+class FrameRingBuffer
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the buffer with, the size of each frame's part in bytes.
+	FrameRingBuffer(VulkanRenderer* renderer, VkDeviceSize frameSize);
+	// Destructor.
+	~FrameRingBuffer();
+
+	// Move on to the next frame's part of the buffer and free everything in it.
+	// Params: the frame in flight index.
+	void BeginFrame(uint frameIndex);
+
+	// Make sure each frame's part fits an amount of data, growing the buffer if needed.
+	// Has to be called before anything is allocated in the frame, as growing throws the frame's data away.
+	// Params: the size in bytes.
+	void Reserve(VkDeviceSize frameSize);
+
+	// Allocate space in this frame's part of the buffer.
+	// Params: size in bytes, alignment of the offset in bytes, which doesn't have to be a power of two.
+	// Returns: the allocation.
+	FrameAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+	// Get the layout of the descriptor set, for pipeline layouts.
+	// Returns: the descriptor set layout.
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout.Get(); }
+
+	// Bind the descriptor set at this frame's part of the buffer.
+	// Params: the command buffer, where to bind it, the pipeline layout, the set number.
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint set) const;
+
+	// Get the bytes allocated so far this frame.
+	// Returns: the bytes used.
+	VkDeviceSize GetUsedSize() const { return m_Head; }
+
+private:
+	// Create the buffer and a descriptor set pointing at it.
+	// Params: the size of each frame's part in bytes.
+	void CreateBuffer(VkDeviceSize frameSize);
+
+	// Give the buffer and its descriptor set to the deletion queue.
+	void ReleaseBuffer();
+
+	// The renderer the buffer was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// The buffer and its mapping.
+	UniqueBuffer m_Buffer;
+	UniqueDeviceMemory m_Memory;
+	char* m_MappedData = nullptr;
+
+	// Size of each frame's part, a multiple of the device's dynamic offset alignment.
+	VkDeviceSize m_FrameSize = 0;
+
+	// Alignment dynamic storage buffer offsets need.
+	VkDeviceSize m_OffsetAlignment;
+
+	// The current frame's part, and how much of it is used.
+	uint m_FrameIndex = 0;
+	VkDeviceSize m_Head = 0;
+
+	// One dynamic storage buffer descriptor covering a frame's part, from a pool made with the buffer.
+	UniqueDescriptorSetLayout m_DescriptorSetLayout;
+	UniqueDescriptorPool m_DescriptorPool;
+	VkDescriptorSet m_VkDescriptorSet = VK_NULL_HANDLE;
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "FrameTimeline.h"
+#include <stdexcept>
+
+FrameTimeline::FrameTimeline(VulkanRenderer* renderer)
+{
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	// Core in 1.2, the device was picked for having the extension before that.
+	bool core = renderer->GetApiVersion() >= VK_API_VERSION_1_2;
+	m_VkWaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(m_VkDevice, core ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR");
+	m_VkGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(m_VkDevice,
+		core ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR");
+	if (m_VkWaitSemaphores == nullptr || m_VkGetSemaphoreCounterValue == nullptr)
+		throw std::runtime_error("Failed to load timeline semaphore functions!");
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	for (VkSemaphore& semaphore : m_VkSemaphores)
+	{
+		if (vkCreateSemaphore(m_VkDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create timeline semaphore!");
+	}
+}
+
+FrameTimeline::~FrameTimeline()
+{
+	for (VkSemaphore semaphore : m_VkSemaphores)
+		vkDestroySemaphore(m_VkDevice, semaphore, nullptr);
+}
+
+void FrameTimeline::EndFrame()
+{
+	// The oldest frame's values are about to go, so it has to be done first. The renderer has already waited for it
+	// before reusing its frame in flight, so this doesn't block.
+	if (m_FrameNumber > MAX_FRAMES_IN_FLIGHT)
+		WaitForFrame(m_FrameNumber - MAX_FRAMES_IN_FLIGHT);
+
+	uint64_t* values = m_FrameValues[m_FrameNumber % MAX_FRAMES_IN_FLIGHT];
+	for (uint queue = 0; queue < FRAME_QUEUE_COUNT; ++queue)
+		values[queue] = m_SubmittedValues[queue];
+
+	++m_FrameNumber;
+}
+
+bool FrameTimeline::IsFrameComplete(uint64_t frame)
+{
+	if (frame <= m_CompletedFrame)
+		return true;
+
+	if (frame >= m_FrameNumber)
+		return false;
+
+	Poll();
+	return frame <= m_CompletedFrame;
+}
+
+uint64_t FrameTimeline::GetCompletedFrame()
+{
+	Poll();
+	return m_CompletedFrame;
+}
+
+void FrameTimeline::WaitForFrame(uint64_t frame)
+{
+	if (frame <= m_CompletedFrame)
+		return;
+
+	if (frame >= m_FrameNumber)
+		throw std::runtime_error("Failed to wait for a frame that hasn't been submitted!");
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = FRAME_QUEUE_COUNT;
+	waitInfo.pSemaphores = m_VkSemaphores;
+	waitInfo.pValues = m_FrameValues[frame % MAX_FRAMES_IN_FLIGHT];
+
+	if (m_VkWaitSemaphores(m_VkDevice, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		throw std::runtime_error("Failed to wait for frame!");
+
+	m_CompletedFrame = frame;
+}
+
+void FrameTimeline::Poll()
+{
+	uint64_t counters[FRAME_QUEUE_COUNT];
+	for (uint queue = 0; queue < FRAME_QUEUE_COUNT; ++queue)
+	{
+		if (m_VkGetSemaphoreCounterValue(m_VkDevice, m_VkSemaphores[queue], &counters[queue]) != VK_SUCCESS)
+			throw std::runtime_error("Failed to read timeline semaphore!");
+	}
+
+	// Frames finish in order on each queue, so the first one not done stops the search.
+	while (m_CompletedFrame + 1 < m_FrameNumber)
+	{
+		const uint64_t* values = m_FrameValues[(m_CompletedFrame + 1) % MAX_FRAMES_IN_FLIGHT];
+		bool complete = true;
+		for (uint queue = 0; queue < FRAME_QUEUE_COUNT; ++queue)
+			complete = complete && counters[queue] >= values[queue];
+
+		if (!complete)
+			break;
+
+		++m_CompletedFrame;
+	}
+}
\ No newline at end of file
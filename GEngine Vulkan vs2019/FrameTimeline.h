@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+
+// A timeline semaphore per queue, with the values each frame's submissions signal on them.
+// Every submit to a queue signals the next value on its timeline, so a value being reached means everything
+// submitted to that queue up to it has finished. Frames are numbered from 1 as they're submitted, and a frame is
+// done once every queue has reached the values it signalled in that frame. Checking is one counter read per queue,
+// and the furthest frame known to be done is kept, so asking about older frames again costs nothing.
+// Only the last MAX_FRAMES_IN_FLIGHT frames' values are kept, a frame is waited for before its values are replaced.
+class FrameTimeline
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the semaphores with.
+	FrameTimeline(VulkanRenderer* renderer);
+	// Destructor.
+	~FrameTimeline();
+
+	// Get a queue's timeline semaphore.
+	// Params: the queue.
+	// Returns: the semaphore.
+	VkSemaphore GetSemaphore(FrameQueue queue) const { return m_VkSemaphores[queue]; }
+
+	// Take the next value on a queue's timeline, for a submit to signal.
+	// Params: the queue.
+	// Returns: the value.
+	uint64_t Signal(FrameQueue queue) { return ++m_SubmittedValues[queue]; }
+
+	// Get the last value taken on a queue's timeline.
+	// Params: the queue.
+	// Returns: the value, 0 if nothing was submitted.
+	uint64_t GetSubmittedValue(FrameQueue queue) const { return m_SubmittedValues[queue]; }
+
+	// Finish the frame being submitted, keeping the values its submits signalled, and move on to the next one.
+	void EndFrame();
+
+	// Get the number of the frame being recorded, what anything it uses should be marked with.
+	// Returns: the frame number.
+	uint64_t GetFrameNumber() const { return m_FrameNumber; }
+
+	// Get the number of the last frame submitted.
+	// Returns: the frame number, 0 before the first frame is submitted.
+	uint64_t GetSubmittedFrame() const { return m_FrameNumber - 1; }
+
+	// Check if the GPU has finished a frame, without waiting.
+	// Params: the frame number.
+	// Returns: if the frame's done, always for frame 0 and never for one that isn't submitted yet.
+	bool IsFrameComplete(uint64_t frame);
+
+	// Get the last frame the GPU has finished, without waiting.
+	// Returns: the frame number, 0 if none are done.
+	uint64_t GetCompletedFrame();
+
+	// Wait for the GPU to finish a frame. The frame has to have been submitted.
+	// Params: the frame number.
+	void WaitForFrame(uint64_t frame);
+
+	// Wait for the GPU to finish every frame submitted so far.
+	void WaitIdle() { WaitForFrame(GetSubmittedFrame()); }
+
+private:
+	// Read the queues' counters and move the last completed frame on to the last frame they've all passed.
+	void Poll();
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// vkWaitSemaphores and vkGetSemaphoreCounterValue, or their KHR versions before 1.2.
+	PFN_vkWaitSemaphoresKHR m_VkWaitSemaphores;
+	PFN_vkGetSemaphoreCounterValueKHR m_VkGetSemaphoreCounterValue;
+
+	// The timeline semaphore of each queue, and the last value taken on it.
+	VkSemaphore m_VkSemaphores[FRAME_QUEUE_COUNT] = {};
+	uint64_t m_SubmittedValues[FRAME_QUEUE_COUNT] = {};
+
+	// The values each queue had reached at the end of the last frames submitted, indexed by frame number.
+	uint64_t m_FrameValues[MAX_FRAMES_IN_FLIGHT][FRAME_QUEUE_COUNT] = {};
+
+	// The frame being recorded, and the last one known to be done.
+	uint64_t m_FrameNumber = 1;
+	uint64_t m_CompletedFrame = 0;
+};
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "FrustumCuller.h"
+#include "CpuFeatures.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <glm/gtc/packing.hpp>
+
+// Objects per chunk when culling in parallel, a multiple of 8 so every chunk starts on a full block.
+static const size_t CULL_CHUNK_SIZE = 64 * 1024;
+
+// Order the frustum's planes are tested in. The far plane goes first, as most of a world bigger than the view distance
+// is past it, then the sides. Few blocks have anything left after those.
+static const int CULL_PLANE_ORDER[6] = { 5, 0, 1, 4, 2, 3 };
+
+// Planes the first pass tests every object against, the far plane and the sides.
+static const int CULL_FIRST_PASS_PLANES = 3;
+// Objects culled in a batch, the first pass listing the blocks the later passes test, while they're still in cache.
+static const size_t CULL_BATCH_SIZE = 2048;
+// Blocks ahead of the first pass to fetch. The hardware prefetcher loses track of the stream between batches.
+static const size_t CULL_PREFETCH_BLOCKS = 16;
+
+// Largest finite half float. Centres are clamped to it so their rounding error stays finite.
+static const float HALF_FLOAT_MAX = 65504.0f;
+// Half float bits of infinity, for spheres too big for a half float.
+static const uint16_t HALF_FLOAT_INFINITY = 0x7C00;
+
+//-------------------------------------------------------------------------------
+// Cull kernels.
+//-------------------------------------------------------------------------------
+// Write the indices of the set bits of a visibility mask without branching on each bit.
+// Every lane is written, so the lane count is clamped to the end of the range to stay inside the output.
+static inline size_t CompactMask(unsigned int mask, int laneCount, uint base, uint* visibleObjects)
+{
+	size_t count = 0;
+	for (int lane = 0; lane < laneCount; ++lane)
+	{
+		visibleObjects[count] = base + lane;
+		count += (mask >> lane) & 1;
+	}
+
+	return count;
+}
+
+// Lane indices of the set bits of every 8 bit visibility mask, one per byte, for compacting a block with one store.
+struct CompactTable
+{
+	CompactTable()
+	{
+		for (uint mask = 0; mask < 256; ++mask)
+		{
+			uint64_t lanes = 0;
+			uint count = 0;
+			for (uint lane = 0; lane < 8; ++lane)
+			{
+				if (mask & (1 << lane))
+					lanes |= (uint64_t)lane << (8 * count++);
+			}
+
+			m_Lanes[mask] = lanes;
+		}
+	}
+
+	uint64_t m_Lanes[256];
+};
+
+static const CompactTable s_CompactTable;
+
+// Start fetching a block's exact bounds.
+static inline void PrefetchBoundsBlock(const FrustumCuller::BoundsBlock* bounds)
+{
+	for (size_t offset = 0; offset < sizeof(FrustumCuller::BoundsBlock); offset += 64)
+		_mm_prefetch((const char*)bounds + offset, _MM_HINT_T0);
+}
+
+static size_t CullSSE(const float* planes, const FrustumCuller::BlockArrays& blocks, size_t begin, size_t end, uint* visibleObjects)
+{
+	__m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	uint candidates[CULL_BATCH_SIZE / 4];
+	size_t count = 0;
+
+	for (size_t batch = begin; batch < end; batch += CULL_BATCH_SIZE)
+	{
+		size_t batchEnd = std::min(end, batch + CULL_BATCH_SIZE);
+
+		// The far plane and the sides first, with each object's sphere and without branching, listing the halves of
+		// blocks that might have something left in.
+		size_t candidateCount = 0;
+		for (size_t i = batch; i < batchEnd; i += 4)
+		{
+			const FrustumCuller::BoundsBlock& bounds = blocks.m_Bounds[i >> 3];
+			__m128 centreX = _mm_loadu_ps(bounds.m_X + (i & 7));
+			__m128 centreY = _mm_loadu_ps(bounds.m_Y + (i & 7));
+			__m128 centreZ = _mm_loadu_ps(bounds.m_Z + (i & 7));
+			__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(bounds.m_Radius + (i & 7)), _mm_set1_ps(-0.0f));
+
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < CULL_FIRST_PASS_PLANES; ++p)
+			{
+				const float* plane = planes + p * 4;
+				__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), centreX), _mm_set1_ps(plane[3]));
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[1]), centreY), distance);
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), centreZ), distance);
+				visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			candidates[candidateCount] = (uint)i;
+			candidateCount += _mm_movemask_ps(visible) != 0;
+		}
+
+		// Then every plane for what's left, with each object's sphere and then its box.
+		for (size_t candidate = 0; candidate < candidateCount; ++candidate)
+		{
+			size_t i = candidates[candidate];
+			const FrustumCuller::BoundsBlock& bounds = blocks.m_Bounds[i >> 3];
+			__m128 centreX = _mm_loadu_ps(bounds.m_X + (i & 7));
+			__m128 centreY = _mm_loadu_ps(bounds.m_Y + (i & 7));
+			__m128 centreZ = _mm_loadu_ps(bounds.m_Z + (i & 7));
+			__m128 radius = _mm_loadu_ps(bounds.m_Radius + (i & 7));
+			__m128 negativeRadius = _mm_xor_ps(radius, _mm_set1_ps(-0.0f));
+
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			__m128 inside = visible;
+			__m128 distances[6];
+			for (int p = 0; p < 6; ++p)
+			{
+				const float* plane = planes + p * 4;
+				__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), centreX), _mm_set1_ps(plane[3]));
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[1]), centreY), distance);
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), centreZ), distance);
+				distances[p] = distance;
+				visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, radius));
+			}
+
+			unsigned int mask = (unsigned int)_mm_movemask_ps(visible);
+			if (mask == 0)
+				continue;
+
+			// The box, using its projected radius on each plane normal, unless the spheres still visible are all inside
+			// every plane, which puts their boxes inside too.
+			if ((unsigned int)_mm_movemask_ps(inside) != mask)
+			{
+				__m128 extentX = _mm_loadu_ps(bounds.m_ExtentX + (i & 7));
+				__m128 extentY = _mm_loadu_ps(bounds.m_ExtentY + (i & 7));
+				__m128 extentZ = _mm_loadu_ps(bounds.m_ExtentZ + (i & 7));
+				for (int p = 0; p < 6; ++p)
+				{
+					const float* plane = planes + p * 4;
+					__m128 boxRadius = _mm_mul_ps(_mm_and_ps(_mm_set1_ps(plane[0]), signMask), extentX);
+					boxRadius = _mm_add_ps(_mm_mul_ps(_mm_and_ps(_mm_set1_ps(plane[1]), signMask), extentY), boxRadius);
+					boxRadius = _mm_add_ps(_mm_mul_ps(_mm_and_ps(_mm_set1_ps(plane[2]), signMask), extentZ), boxRadius);
+					visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distances[p], boxRadius), _mm_setzero_ps()));
+				}
+
+				mask = (unsigned int)_mm_movemask_ps(visible);
+			}
+
+			count += CompactMask(mask, (int)std::min<size_t>(4, end - i), (uint)i, visibleObjects + count);
+		}
+	}
+
+	return count;
+}
+
+// Test a block's exact boxes against every plane.
+// Params: the frustum planes, the block's bounds.
+// Returns: the mask of visible objects.
+GENGINE_TARGET_AVX2 static inline unsigned int CullBoxesAVX2(const float* planes, const FrustumCuller::BoundsBlock& bounds)
+{
+	__m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 centreX = _mm256_load_ps(bounds.m_X);
+	__m256 centreY = _mm256_load_ps(bounds.m_Y);
+	__m256 centreZ = _mm256_load_ps(bounds.m_Z);
+	__m256 extentX = _mm256_load_ps(bounds.m_ExtentX);
+	__m256 extentY = _mm256_load_ps(bounds.m_ExtentY);
+	__m256 extentZ = _mm256_load_ps(bounds.m_ExtentZ);
+
+	// The box's distance past each plane is its centre's plus its projected radius on the plane normal.
+	__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (int p = 0; p < 6; ++p)
+	{
+		const float* plane = planes + p * 4;
+		__m256 distance = _mm256_fmadd_ps(_mm256_broadcast_ss(plane + 0), centreX, _mm256_broadcast_ss(plane + 3));
+		distance = _mm256_fmadd_ps(_mm256_broadcast_ss(plane + 1), centreY, distance);
+		distance = _mm256_fmadd_ps(_mm256_broadcast_ss(plane + 2), centreZ, distance);
+		distance = _mm256_fmadd_ps(_mm256_and_ps(_mm256_broadcast_ss(plane + 0), signMask), extentX, distance);
+		distance = _mm256_fmadd_ps(_mm256_and_ps(_mm256_broadcast_ss(plane + 1), signMask), extentY, distance);
+		distance = _mm256_fmadd_ps(_mm256_and_ps(_mm256_broadcast_ss(plane + 2), signMask), extentZ, distance);
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+	}
+
+	return (unsigned int)_mm256_movemask_ps(visible);
+}
+
+GENGINE_TARGET_AVX2 static size_t CullAVX2(const float* planes, const FrustumCuller::BlockArrays& blocks, size_t begin, size_t end, uint* visibleObjects)
+{
+	size_t count = 0;
+
+	// Blocks with something left in after the spheres, with the lanes whose spheres are inside every plane and the lanes
+	// whose spheres cross one, for this batch and the one before.
+	uint candidates[2][CULL_BATCH_SIZE / 8];
+	uint8_t insideMasks[2][CULL_BATCH_SIZE / 8];
+	uint8_t crossingMasks[2][CULL_BATCH_SIZE / 8];
+	size_t candidateCounts[2] = { 0, 0 };
+
+	// The first pass's planes stay in registers.
+	__m256 firstPlanes[CULL_FIRST_PASS_PLANES * 4];
+	for (int p = 0; p < CULL_FIRST_PASS_PLANES * 4; ++p)
+		firstPlanes[p] = _mm256_broadcast_ss(planes + p);
+
+	// Each batch's boxes are tested during the next batch, so fetching the ones that are needed overlaps with its spheres.
+	// One more batch than there is tests just the boxes of the last one.
+	for (size_t batch = begin, list = 0; batch < end + CULL_BATCH_SIZE; batch += CULL_BATCH_SIZE, list ^= 1)
+	{
+		size_t batchEnd = std::min(end, batch + CULL_BATCH_SIZE);
+		uint* listed = candidates[list];
+
+		// The far plane and the sides first, with each object's sphere and without branching, listing the blocks that
+		// might have something left in.
+		size_t candidateCount = 0;
+		for (size_t i = batch; i < batchEnd; i += 8)
+		{
+			const FrustumCuller::HalfSphereBlock& sphere = blocks.m_HalfSpheres[i >> 3];
+			_mm_prefetch((const char*)(&sphere + CULL_PREFETCH_BLOCKS), _MM_HINT_T0);
+			__m256 centreX = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_X));
+			__m256 centreY = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Y));
+			__m256 centreZ = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Z));
+			__m256 radius = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Radius));
+			__m256 negativeRadius = _mm256_xor_ps(radius, _mm256_set1_ps(-0.0f));
+
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < CULL_FIRST_PASS_PLANES; ++p)
+			{
+				__m256 distance = _mm256_fmadd_ps(firstPlanes[p * 4 + 0], centreX, firstPlanes[p * 4 + 3]);
+				distance = _mm256_fmadd_ps(firstPlanes[p * 4 + 1], centreY, distance);
+				distance = _mm256_fmadd_ps(firstPlanes[p * 4 + 2], centreZ, distance);
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+
+			listed[candidateCount] = (uint)i;
+			candidateCount += !_mm256_testz_ps(visible, visible);
+		}
+
+		// Then every plane for what's left, while its spheres are still in cache. Spheres inside every plane have their
+		// boxes inside too, only the blocks with spheres crossing a plane need their boxes, so start fetching those.
+		size_t keptCount = 0;
+		for (size_t candidate = 0; candidate < candidateCount; ++candidate)
+		{
+			size_t i = listed[candidate];
+			const FrustumCuller::HalfSphereBlock& sphere = blocks.m_HalfSpheres[i >> 3];
+			__m256 centreX = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_X));
+			__m256 centreY = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Y));
+			__m256 centreZ = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Z));
+			__m256 radius = _mm256_cvtph_ps(_mm_load_si128((const __m128i*)sphere.m_Radius));
+			__m256 negativeRadius = _mm256_xor_ps(radius, _mm256_set1_ps(-0.0f));
+
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			__m256 inside = visible;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 distance = _mm256_fmadd_ps(_mm256_broadcast_ss(planes + p * 4 + 0), centreX, _mm256_broadcast_ss(planes + p * 4 + 3));
+				distance = _mm256_fmadd_ps(_mm256_broadcast_ss(planes + p * 4 + 1), centreY, distance);
+				distance = _mm256_fmadd_ps(_mm256_broadcast_ss(planes + p * 4 + 2), centreZ, distance);
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, radius, _CMP_GE_OQ));
+			}
+
+			unsigned int visibleMask = (unsigned int)_mm256_movemask_ps(visible);
+			unsigned int insideMask = (unsigned int)_mm256_movemask_ps(inside);
+			if (visibleMask != insideMask)
+				PrefetchBoundsBlock(blocks.m_Bounds + (i >> 3));
+
+			listed[keptCount] = (uint)i;
+			insideMasks[list][keptCount] = (uint8_t)insideMask;
+			crossingMasks[list][keptCount] = (uint8_t)(visibleMask & ~insideMask);
+			keptCount += visibleMask != 0;
+		}
+
+		candidateCounts[list] = keptCount;
+
+		// Then the previous batch's boxes, where a sphere crosses a plane.
+		const uint* tested = candidates[list ^ 1];
+		for (size_t candidate = 0; candidate < candidateCounts[list ^ 1]; ++candidate)
+		{
+			size_t i = tested[candidate];
+			unsigned int mask = insideMasks[list ^ 1][candidate];
+			if (crossingMasks[list ^ 1][candidate] != 0)
+				mask |= CullBoxesAVX2(planes, blocks.m_Bounds[i >> 3]) & crossingMasks[list ^ 1][candidate];
+
+			// Every lane is stored, so a block running past the end of the range goes one at a time to stay inside the output.
+			if (i + 8 <= end)
+			{
+				__m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s_CompactTable.m_Lanes + mask)));
+				_mm256_storeu_si256((__m256i*)(visibleObjects + count), _mm256_add_epi32(_mm256_set1_epi32((int)i), lanes));
+				count += _mm_popcnt_u32(mask);
+			}
+			else
+			{
+				count += CompactMask(mask, (int)(end - i), (uint)i, visibleObjects + count);
+			}
+		}
+	}
+
+	return count;
+}
+
+// Get a frustum's planes as x, y, z and distance, in the order they're tested.
+// Params: the frustum, array of 24 floats to write them to.
+static void GetPlanes(const Frustum& frustum, float* planes)
+{
+	for (int p = 0; p < 6; ++p)
+	{
+		const Plane& plane = frustum.m_Planes[CULL_PLANE_ORDER[p]];
+		planes[p * 4 + 0] = plane.m_Normal.x;
+		planes[p * 4 + 1] = plane.m_Normal.y;
+		planes[p * 4 + 2] = plane.m_Normal.z;
+		planes[p * 4 + 3] = plane.m_Distance;
+	}
+}
+
+//-------------------------------------------------------------------------------
+// FrustumCuller.
+//-------------------------------------------------------------------------------
+FrustumCuller::FrustumCuller()
+{
+	m_ObjectCount = 0;
+
+	const CpuFeatures& cpu = CpuFeatures::Get();
+	m_Cull = cpu.m_AVX2 && cpu.m_FMA && cpu.m_F16C ? CullAVX2 : CullSSE;
+}
+
+FrustumCuller::~FrustumCuller()
+{
+
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+	size_t oldCount = m_ObjectCount;
+	size_t paddedCount = (count + 7) & ~(size_t)7;
+
+	// NaN centres fail every comparison, so padding and unset objects are never visible.
+	float unset = std::numeric_limits<float>::quiet_NaN();
+	glm::uint16 unsetHalf = glm::packHalf1x16(unset);
+	HalfSphereBlock unsetSpheres = {};
+	std::fill(unsetSpheres.m_X, unsetSpheres.m_Z + 8, unsetHalf);
+	BoundsBlock unsetBounds = {};
+	std::fill(unsetBounds.m_X, unsetBounds.m_Z + 8, unset);
+	m_HalfSpheres.resize(paddedCount / 8, unsetSpheres);
+	m_Bounds.resize(paddedCount / 8, unsetBounds);
+
+	for (size_t i = count; i < std::min(oldCount, paddedCount); ++i)
+	{
+		m_HalfSpheres[i >> 3].m_X[i & 7] = unsetHalf;
+		m_HalfSpheres[i >> 3].m_Y[i & 7] = unsetHalf;
+		m_HalfSpheres[i >> 3].m_Z[i & 7] = unsetHalf;
+		m_Bounds[i >> 3].m_X[i & 7] = unset;
+		m_Bounds[i >> 3].m_Y[i & 7] = unset;
+		m_Bounds[i >> 3].m_Z[i & 7] = unset;
+	}
+
+	m_ObjectCount = count;
+	m_ChunkCounts.resize((count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE);
+}
+
+void FrustumCuller::SetBounds(uint index, const AABB& box, float radius)
+{
+	glm::vec3 centre = box.GetCentre();
+	glm::vec3 extents = box.GetExtents();
+	BoundsBlock& bounds = m_Bounds[index >> 3];
+	HalfSphereBlock& sphere = m_HalfSpheres[index >> 3];
+	uint lane = index & 7;
+
+	bounds.m_X[lane] = centre.x;
+	bounds.m_Y[lane] = centre.y;
+	bounds.m_Z[lane] = centre.z;
+	bounds.m_ExtentX[lane] = extents.x;
+	bounds.m_ExtentY[lane] = extents.y;
+	bounds.m_ExtentZ[lane] = extents.z;
+	bounds.m_Radius[lane] = radius;
+
+	glm::vec3 halfCentre = glm::clamp(centre, glm::vec3(-HALF_FLOAT_MAX), glm::vec3(HALF_FLOAT_MAX));
+	sphere.m_X[lane] = glm::packHalf1x16(halfCentre.x);
+	sphere.m_Y[lane] = glm::packHalf1x16(halfCentre.y);
+	sphere.m_Z[lane] = glm::packHalf1x16(halfCentre.z);
+
+	// Grow the sphere by how far the rounded centre is from the real one and round its radius up, so it still holds
+	// the real sphere.
+	glm::vec3 roundedCentre(glm::unpackHalf1x16(sphere.m_X[lane]), glm::unpackHalf1x16(sphere.m_Y[lane]), glm::unpackHalf1x16(sphere.m_Z[lane]));
+	float halfRadius = radius + glm::length(centre - roundedCentre);
+	if (halfRadius <= HALF_FLOAT_MAX)
+	{
+		sphere.m_Radius[lane] = glm::packHalf1x16(halfRadius);
+		if (glm::unpackHalf1x16(sphere.m_Radius[lane]) < halfRadius)
+			++sphere.m_Radius[lane];
+	}
+	else
+	{
+		sphere.m_Radius[lane] = HALF_FLOAT_INFINITY;
+	}
+}
+
+void FrustumCuller::SetBounds(uint index, const AABB& box)
+{
+	SetBounds(index, box, glm::length(box.GetExtents()));
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, uint* visibleObjects)
+{
+	float planes[24];
+	GetPlanes(frustum, planes);
+	return m_Cull(planes, GetBlockArrays(), 0, m_ObjectCount, visibleObjects);
+}
+
+// Everything a cull chunk needs, passed through the job system's user data.
+struct CullJob
+{
+	FrustumCuller::CullFunction m_Cull;
+	float m_Planes[24];
+	FrustumCuller::BlockArrays m_Blocks;
+	uint* m_VisibleObjects;
+	size_t* m_ChunkCounts;
+};
+
+static void RunCullJob(void* data, size_t begin, size_t end)
+{
+	CullJob* job = (CullJob*)data;
+
+	// Each chunk writes to its own part of the output, they get packed together afterwards.
+	job->m_ChunkCounts[begin / CULL_CHUNK_SIZE] = job->m_Cull(job->m_Planes, job->m_Blocks, begin, end, job->m_VisibleObjects + begin);
+}
+
+size_t FrustumCuller::CullParallel(const Frustum& frustum, JobSystem* jobSystem, uint* visibleObjects)
+{
+	if (m_ObjectCount <= CULL_CHUNK_SIZE || jobSystem == nullptr || jobSystem->GetThreadCount() == 1)
+		return Cull(frustum, visibleObjects);
+
+	CullJob job;
+	job.m_Cull = m_Cull;
+	GetPlanes(frustum, job.m_Planes);
+	job.m_Blocks = GetBlockArrays();
+	job.m_VisibleObjects = visibleObjects;
+	job.m_ChunkCounts = m_ChunkCounts.data();
+
+	jobSystem->ParallelFor(m_ObjectCount, CULL_CHUNK_SIZE, RunCullJob, &job);
+
+	// Pack the chunks down. Each chunk's output starts at or after where the packed data ends, so moving forward is safe.
+	size_t count = m_ChunkCounts[0];
+	for (size_t chunk = 1; chunk < m_ChunkCounts.size(); ++chunk)
+	{
+		memmove(visibleObjects + count, visibleObjects + chunk * CULL_CHUNK_SIZE, m_ChunkCounts[chunk] * sizeof(uint));
+		count += m_ChunkCounts[chunk];
+	}
+
+	return count;
+}
+
+FrustumCuller::BlockArrays FrustumCuller::GetBlockArrays() const
+{
+	BlockArrays blocks;
+	blocks.m_HalfSpheres = m_HalfSpheres.data();
+	blocks.m_Bounds = m_Bounds.data();
+	return blocks;
+}
\ No newline at end of file
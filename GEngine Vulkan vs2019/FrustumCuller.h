@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Bounds.h"
+#include "JobSystem.h"
+#include <vector>
+
+// Culls object bounds against a view frustum, 8 objects at a time.
+// Bounds are kept in blocks of 8 objects: their boxes, and spheres around the box centres. A first pass streams through
+// the spheres, testing each block against the far plane and the sides without branching, and lists the blocks that
+// might have something visible, which is few of them when the world is much bigger than the view distance. A second pass
+// tests those blocks' spheres against every plane, then the boxes of objects whose spheres cross a plane.
+// The AVX2 kernel keeps a copy of the spheres in half floats, so the first pass reads a cache line per block.
+// Uses AVX2 when the cpu has it, SSE otherwise.
+class FrustumCuller
+{
+public:
+	// Constructor.
+	FrustumCuller();
+	// Destructor.
+	~FrustumCuller();
+
+	// Set the amount of objects to cull. New objects start with empty bounds that are never visible.
+	// Params: the object count.
+	void Resize(size_t count);
+
+	// Set the bounds of an object.
+	// Params: the object index, its world space box, radius of its bounding sphere around the box centre.
+	void SetBounds(uint index, const AABB& box, float radius);
+
+	// Set the bounds of an object, using the sphere that encloses the box.
+	// Params: the object index, its world space box.
+	void SetBounds(uint index, const AABB& box);
+
+	// Cull every object against a frustum on the calling thread.
+	// Params: the frustum, array of at least GetObjectCount() entries to write the visible object indices to.
+	// Returns: how many objects are visible.
+	size_t Cull(const Frustum& frustum, uint* visibleObjects);
+
+	// Cull every object against a frustum, split into chunks over the job system's threads.
+	// Params: the frustum, the job system, array of at least GetObjectCount() entries to write the visible object indices to.
+	// Returns: how many objects are visible.
+	size_t CullParallel(const Frustum& frustum, JobSystem* jobSystem, uint* visibleObjects);
+
+	// Get the amount of objects.
+	// Returns: the object count.
+	size_t GetObjectCount() const { return m_ObjectCount; }
+
+	// Spheres of a block of 8 objects in half floats, one cache line. The radii are grown to cover the rounding of the
+	// centres, so each sphere holds the object's real one.
+	struct alignas(64) HalfSphereBlock
+	{
+		uint16_t m_X[8];
+		uint16_t m_Y[8];
+		uint16_t m_Z[8];
+		uint16_t m_Radius[8];
+	};
+
+	// Exact bounds of a block of 8 objects: box centres and half sizes, and the radii of spheres around the same centres.
+	struct alignas(32) BoundsBlock
+	{
+		float m_X[8];
+		float m_Y[8];
+		float m_Z[8];
+		float m_ExtentX[8];
+		float m_ExtentY[8];
+		float m_ExtentZ[8];
+		float m_Radius[8];
+	};
+
+	// The bounds a cull kernel reads, one entry per block of 8 objects.
+	struct BlockArrays
+	{
+		const HalfSphereBlock* m_HalfSpheres;
+		const BoundsBlock* m_Bounds;
+	};
+
+	// Culls a range of objects and writes the visible indices, compacted, to the output.
+	// Params: the frustum planes as 6 * (x, y, z, distance), the bounds, first object (a multiple of 8), one past the last
+	// object, output array.
+	// Returns: how many objects were written.
+	typedef size_t (*CullFunction)(const float* planes, const BlockArrays& blocks, size_t begin, size_t end, uint* visibleObjects);
+
+private:
+	// Amount of objects.
+	size_t m_ObjectCount;
+
+	// Get the bounds arrays for a cull kernel.
+	// Returns: pointers to the start of each array.
+	BlockArrays GetBlockArrays() const;
+
+	// Bounds in blocks of 8 objects, padded up to a multiple of 8. The AVX2 kernel tests the half float spheres and only
+	// reads the exact bounds of blocks with a sphere crossing a plane, the SSE kernel only reads the exact bounds.
+	std::vector<HalfSphereBlock> m_HalfSpheres;
+	std::vector<BoundsBlock> m_Bounds;
+
+	// Visible count per chunk when culling in parallel.
+	std::vector<size_t> m_ChunkCounts;
+
+	// The AVX2 or SSE kernel chosen for this cpu.
+	CullFunction m_Cull;
+};
\ No newline at end of file
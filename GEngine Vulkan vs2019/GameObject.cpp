@@ -1,13 +1,28 @@
 #include "GameObject.h"
 
-GameObject::GameObject()
+GameObject::GameObject(TransformSystem* transformSystem, GameObject* parent)
 {
 	m_ChildObjects = std::vector<GameObject*>();
+
+	m_TransformSystem = transformSystem;
+	m_Transform = m_TransformSystem->CreateTransform(parent != nullptr ? parent->m_Transform : INVALID_TRANSFORM);
+
+	m_LocalBounds.m_Min = glm::vec3(-0.5f);
+	m_LocalBounds.m_Max = glm::vec3(0.5f);
+	m_Static = false;
+
+	if (parent != nullptr)
+		parent->m_ChildObjects.push_back(this);
 }
 
 GameObject::~GameObject()
 {
+	for (auto child : m_ChildObjects)
+	{
+		delete child;
+	}
 
+	m_TransformSystem->DestroyTransform(m_Transform);
 }
 
 void GameObject::Update(float deltaTime)
@@ -1,16 +1,92 @@
 #pragma once
 #include <vector>
+#include "TransformSystem.h"
+#include "Bounds.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
 
 class GameObject
 {
 public:
-	GameObject();
+	// Constructor.
+	// Params: the transform system to keep the object's transform in, the parent object or nullptr for a root object.
+	GameObject(TransformSystem* transformSystem, GameObject* parent);
 	~GameObject();
 
 	void Update(float deltaTime);
 
 	void Draw();
 
+	// Set the object's matrix relative to its parent.
+	// Params: the local matrix.
+	void SetLocalMatrix(const glm::mat4& localMatrix) { m_TransformSystem->SetLocalMatrix(m_Transform, localMatrix); }
+
+	// Get the object's matrix relative to the world, as of the last transform update.
+	// Returns: the world matrix.
+	const glm::mat4& GetWorldMatrix() const { return m_TransformSystem->GetWorldMatrix(m_Transform); }
+
+	// Get the object's matrix relative to the world from before the last transform update, for motion vectors.
+	// Returns: the previous world matrix.
+	const glm::mat4& GetPreviousWorldMatrix() const { return m_TransformSystem->GetPreviousWorldMatrix(m_Transform); }
+
+	// Set the bounds of the object in its own space.
+	// Params: the local bounds.
+	void SetLocalBounds(const AABB& localBounds) { m_LocalBounds = localBounds; }
+
+	// Get the bounds of the object in its own space.
+	// Returns: the local bounds.
+	const AABB& GetLocalBounds() const { return m_LocalBounds; }
+
+	// Get the bounds of the object in the world, as of the last transform update.
+	// Returns: the world bounds.
+	AABB GetWorldBounds() const { return TransformAABB(m_LocalBounds, GetWorldMatrix()); }
+
+	// Set if the object never moves. Static objects go in a tree that's built once instead of refit every frame.
+	// Params: if the object is static.
+	void SetStatic(bool isStatic) { m_Static = isStatic; }
+
+	// Get if the object never moves.
+	// Returns: if the object is static.
+	bool IsStatic() const { return m_Static; }
+
+	// Get the handle of the object's transform.
+	// Returns: the transform handle.
+	uint GetTransform() const { return m_Transform; }
+
+	// Set a simple mesh that stands in for the object when culling what's behind it.
+	// Params: the occluder mesh, or nullptr if the object doesn't hide anything. Not owned by the object.
+	void SetOccluderMesh(const OccluderMesh* occluderMesh) { m_OccluderMesh = occluderMesh; }
+
+	// Get the object's occluder mesh.
+	// Returns: the occluder mesh, or nullptr.
+	const OccluderMesh* GetOccluderMesh() const { return m_OccluderMesh; }
+
+	// Set what the object is drawn with.
+	// Params: the render state.
+	void SetRenderState(const RenderState& renderState) { m_RenderState = renderState; }
+
+	// Get what the object is drawn with.
+	// Returns: the render state.
+	const RenderState& GetRenderState() const { return m_RenderState; }
+
 private:
 	std::vector<GameObject*> m_ChildObjects;
+
+	// The transform system the object's transform lives in.
+	TransformSystem* m_TransformSystem;
+
+	// Handle of the object's transform.
+	uint m_Transform;
+
+	// Bounds of the object in its own space.
+	AABB m_LocalBounds;
+
+	// If the object never moves.
+	bool m_Static;
+
+	// Mesh drawn into the occlusion buffer, or nullptr.
+	const OccluderMesh* m_OccluderMesh = nullptr;
+
+	// Layer, pipeline, material and mesh the object is drawn with.
+	RenderState m_RenderState;
 };
\ No newline at end of file
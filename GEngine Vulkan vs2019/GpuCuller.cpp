@@ -0,0 +1,414 @@
+#include "GpuCuller.h"
+#include "DepthPyramid.h"
+#include "DescriptorAllocator.h"
+#include "DeletionQueue.h"
+#include "FrameRingBuffer.h"
+#include "GpuMesh.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Threads per workgroup in the cull shader.
+static const uint CULL_GROUP_SIZE = 64;
+// Objects the buffers fit before the first resize.
+static const size_t INITIAL_CAPACITY = 1024;
+
+GpuCuller::GpuCuller(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(renderer->GetPhysicalDevice(), &properties);
+	m_OffsetAlignment = properties.limits.minStorageBufferOffsetAlignment;
+
+	if (!renderer->GetEnabledFeatures().drawIndirectFirstInstance)
+		throw std::runtime_error("GPU culling needs the drawIndirectFirstInstance feature!");
+
+	m_Constants = {};
+	m_Constants.m_LodCount = renderer->GetDemoMesh()->GetLodCount();
+	m_LodBuffer = renderer->GetDemoMesh()->GetLodBuffer();
+	m_Constants.m_ClusterCount = 1;
+	m_Constants.m_Compact = renderer->GetDrawIndexedIndirectCount() != nullptr ? 1 : 0;
+
+	CreateDescriptorSetLayout();
+	CreatePipelines();
+	CreateBuffers(INITIAL_CAPACITY);
+}
+
+GpuCuller::~GpuCuller()
+{
+	ReleaseBuffers();
+	vkDestroyPipeline(m_VkDevice, m_VkPipeline, nullptr);
+	vkDestroyPipelineLayout(m_VkDevice, m_VkPipelineLayout, nullptr);
+	vkDestroyPipeline(m_VkDevice, m_VkClusterPipeline, nullptr);
+	vkDestroyDescriptorSetLayout(m_VkDevice, m_VkDescriptorSetLayout, nullptr);
+}
+
+void GpuCuller::CreateDescriptorSetLayout()
+{
+	// Bounds, draws, draw counts, visibility, the depth pyramid, the meshlets, which are only written when culling
+	// clusters, and the levels of detail.
+	VkDescriptorSetLayoutBinding bindings[7]{};
+	for (uint i = 0; i < 7; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i != 4 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	// Each frame in flight reads its own copy of the bounds, picked with the dynamic offset.
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 7;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &m_VkDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cull descriptor set layout!");
+}
+
+void GpuCuller::CreatePipelines()
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(GpuCullConstants);
+
+	VkDescriptorSetLayout setLayouts[] = { m_VkDescriptorSetLayout, m_Renderer->GetObjectRingBuffer()->GetDescriptorSetLayout() };
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_VkDevice, &pipelineLayoutInfo, nullptr, &m_VkPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cull pipeline layout!");
+
+	VkShaderModule shaderModule = m_Renderer->CreateShaderModule(m_Renderer->ReadFile("../Shaders/Cull/cull.spv"));
+	VkShaderModule clusterShaderModule = m_Renderer->CreateShaderModule(m_Renderer->ReadFile("../Shaders/ClusterCull/clusterCull.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_VkPipelineLayout;
+
+	if (vkCreateComputePipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cull pipeline!");
+
+	pipelineInfo.stage.module = clusterShaderModule;
+
+	if (vkCreateComputePipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkClusterPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create cluster cull pipeline!");
+
+	vkDestroyShaderModule(m_VkDevice, shaderModule, nullptr);
+	vkDestroyShaderModule(m_VkDevice, clusterShaderModule, nullptr);
+}
+
+void GpuCuller::CreateBuffers(size_t capacity)
+{
+	m_Capacity = capacity;
+
+	// Every frame's part of the bounds has to start on a valid dynamic offset.
+	m_BoundsFrameSize = (capacity * sizeof(GpuObjectBounds) + m_OffsetAlignment - 1) / m_OffsetAlignment * m_OffsetAlignment;
+	VkDeviceSize boundsSize = m_BoundsFrameSize * MAX_FRAMES_IN_FLIGHT;
+	VkDeviceSize drawSize = GetDrawCapacity() * sizeof(VkDrawIndexedIndirectCommand) * 2;
+	VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	// Bounds and the count stay mapped for as long as they live.
+	m_Renderer->CreateBuffer(boundsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory, m_VkBoundsBuffer, m_VkBoundsMemory);
+	vkMapMemory(m_VkDevice, m_VkBoundsMemory, 0, boundsSize, 0, (void**)&m_MappedBounds);
+
+	m_Renderer->CreateBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VkDrawBuffer, m_VkDrawMemory);
+
+	m_Renderer->CreateBuffer(sizeof(GpuCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		hostMemory, m_VkCountBuffer, m_VkCountMemory);
+	vkMapMemory(m_VkDevice, m_VkCountMemory, 0, sizeof(GpuCullStats), 0, (void**)&m_MappedStats);
+	memset(m_MappedStats, 0, sizeof(GpuCullStats));
+
+	m_Renderer->CreateBuffer(GetDrawCapacity() * sizeof(uint), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VkVisibilityBuffer, m_VkVisibilityMemory);
+	m_VisibilityDirty = true;
+
+	if (m_ReadbackEnabled)
+	{
+		m_Renderer->CreateBuffer(drawSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostMemory, m_VkReadbackBuffer, m_VkReadbackMemory);
+		vkMapMemory(m_VkDevice, m_VkReadbackMemory, 0, drawSize, 0, (void**)&m_MappedReadback);
+	}
+
+	// No frame has culled with the new buffer yet, so every part gets all the bounds straight away. Unset entries have a w of
+	// 0 in their extents, which the shader never draws.
+	memset(m_MappedBounds, 0, (size_t)boundsSize);
+	for (uint frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame)
+	{
+		memcpy(m_MappedBounds + frame * m_BoundsFrameSize, m_Bounds.data(), m_Bounds.size() * sizeof(GpuObjectBounds));
+		m_DirtyBounds[frame].clear();
+	}
+	std::fill(m_BoundsDirtyFrames.begin(), m_BoundsDirtyFrames.end(), (uint8_t)0);
+
+	CreateDescriptorSet();
+}
+
+void GpuCuller::CreateDescriptorSet()
+{
+	// The pyramid lives as long as the renderer once it's made, so only the buffers change between sets.
+	DepthPyramid* depthPyramid = m_Renderer->GetDepthPyramid();
+
+	DescriptorWrite descriptorWrites[7];
+	uint writeCount = 0;
+	descriptorWrites[writeCount++] = DescriptorWrite::Buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, m_VkBoundsBuffer, 0,
+		m_Capacity * sizeof(GpuObjectBounds));
+	descriptorWrites[writeCount++] = DescriptorWrite::Buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_VkDrawBuffer);
+	descriptorWrites[writeCount++] = DescriptorWrite::Buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_VkCountBuffer);
+	descriptorWrites[writeCount++] = DescriptorWrite::Buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_VkVisibilityBuffer);
+	descriptorWrites[writeCount++] = DescriptorWrite::Buffer(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_LodBuffer);
+
+	// Only the occlusion phases read the pyramid, and the object cull shader doesn't use the meshlets, so they're left out when
+	// there aren't any.
+	if (depthPyramid != nullptr)
+	{
+		descriptorWrites[writeCount++] = DescriptorWrite::Image(4, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, depthPyramid->GetSampler(),
+			depthPyramid->GetImageView(), VK_IMAGE_LAYOUT_GENERAL);
+	}
+	if (m_MeshletBuffer != VK_NULL_HANDLE)
+		descriptorWrites[writeCount++] = DescriptorWrite::Buffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_MeshletBuffer);
+
+	m_VkDescriptorSet = m_Renderer->GetDescriptorAllocator()->GetCachedSet(m_VkDescriptorSetLayout, descriptorWrites, writeCount);
+}
+
+void GpuCuller::ReleaseBuffers()
+{
+	// The buffers' handles can be given to new buffers, which mustn't find this set in the cache.
+	m_Renderer->GetDescriptorAllocator()->FreeCachedSet(m_VkDescriptorSet);
+	m_VkDescriptorSet = VK_NULL_HANDLE;
+
+	// Frames in flight still cull with them, so they're destroyed once those are done. The memory stays mapped until then.
+	DeletionQueue* deletionQueue = m_Renderer->GetDeletionQueue();
+	deletionQueue->Destroy(UniqueBuffer(m_VkDevice, m_VkBoundsBuffer));
+	deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, m_VkBoundsMemory));
+	deletionQueue->Destroy(UniqueBuffer(m_VkDevice, m_VkDrawBuffer));
+	deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, m_VkDrawMemory));
+	deletionQueue->Destroy(UniqueBuffer(m_VkDevice, m_VkCountBuffer));
+	deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, m_VkCountMemory));
+	deletionQueue->Destroy(UniqueBuffer(m_VkDevice, m_VkVisibilityBuffer));
+	deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, m_VkVisibilityMemory));
+	deletionQueue->Destroy(UniqueBuffer(m_VkDevice, m_VkReadbackBuffer));
+	deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, m_VkReadbackMemory));
+
+	m_VkReadbackBuffer = VK_NULL_HANDLE;
+	m_VkReadbackMemory = VK_NULL_HANDLE;
+	m_MappedBounds = nullptr;
+	m_MappedStats = nullptr;
+	m_MappedReadback = nullptr;
+}
+
+void GpuCuller::Resize(size_t count)
+{
+	// New entries start unset, and have to reach every frame's part so growing again doesn't bring old objects back.
+	m_Bounds.resize(count, GpuObjectBounds{});
+	m_BoundsDirtyFrames.resize(count, 0);
+	for (size_t i = m_ObjectCount; i < count; ++i)
+		MarkBoundsDirty((uint)i);
+
+	if (count > m_Capacity)
+	{
+		ReleaseBuffers();
+		CreateBuffers(std::max(count, m_Capacity * 2));
+	}
+
+	// New objects take over the visibility of whatever last used their index.
+	if (count != m_ObjectCount)
+		m_VisibilityDirty = true;
+
+	m_ObjectCount = count;
+	m_Constants.m_ObjectCount = (uint)count;
+}
+
+void GpuCuller::SetBounds(uint index, const AABB& box)
+{
+	glm::vec3 extents = box.GetExtents();
+	m_Bounds[index].m_CentreRadius = glm::vec4(box.GetCentre(), glm::length(extents));
+	m_Bounds[index].m_Extents = glm::vec4(extents, 1.0f);
+	MarkBoundsDirty(index);
+}
+
+void GpuCuller::MarkBoundsDirty(uint index)
+{
+	for (uint frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame)
+	{
+		uint8_t bit = (uint8_t)(1 << frame);
+		if ((m_BoundsDirtyFrames[index] & bit) == 0)
+		{
+			m_BoundsDirtyFrames[index] |= bit;
+			m_DirtyBounds[frame].push_back(index);
+		}
+	}
+}
+
+void GpuCuller::UploadBounds(uint frameIndex)
+{
+	m_FrameIndex = frameIndex;
+
+	// Objects removed since they were set don't need copying.
+	GpuObjectBounds* frameBounds = (GpuObjectBounds*)(m_MappedBounds + frameIndex * m_BoundsFrameSize);
+	uint8_t bit = (uint8_t)(1 << frameIndex);
+	for (uint index : m_DirtyBounds[frameIndex])
+	{
+		if (index < m_ObjectCount)
+		{
+			frameBounds[index] = m_Bounds[index];
+			m_BoundsDirtyFrames[index] &= (uint8_t)~bit;
+		}
+	}
+	m_DirtyBounds[frameIndex].clear();
+}
+
+void GpuCuller::SetReadbackEnabled(bool enabled)
+{
+	if (enabled == m_ReadbackEnabled)
+		return;
+
+	m_ReadbackEnabled = enabled;
+	ReleaseBuffers();
+	CreateBuffers(m_Capacity);
+}
+
+void GpuCuller::SetOcclusionCullingEnabled(bool enabled)
+{
+	m_OcclusionCullingEnabled = enabled;
+	if (!enabled || m_Renderer->GetDepthPyramid() != nullptr)
+		return;
+
+	// The pyramid is only made once something culls against it, and the set written before then doesn't point at it.
+	m_Renderer->EnableDepthPyramid();
+	m_Renderer->GetDescriptorAllocator()->FreeCachedSet(m_VkDescriptorSet);
+	CreateDescriptorSet();
+}
+
+void GpuCuller::SetMesh(const GpuMesh* mesh)
+{
+	m_Constants.m_LodCount = mesh->GetLodCount();
+
+	// Each object gets room for the clusters of the level of detail with the most.
+	VkBuffer meshletBuffer = m_ClusterCullingEnabled ? mesh->GetMeshletBuffer() : VK_NULL_HANDLE;
+	uint clusterCount = meshletBuffer != VK_NULL_HANDLE ? mesh->GetMaxLodMeshletCount() : 1;
+	if (meshletBuffer == m_MeshletBuffer && clusterCount == m_ClusterCount && mesh->GetLodBuffer() == m_LodBuffer)
+		return;
+
+	// The draws and visibility are per cluster, so they're made again at the new size. Every cluster starts never visible.
+	ReleaseBuffers();
+	m_MeshletBuffer = meshletBuffer;
+	m_LodBuffer = mesh->GetLodBuffer();
+	m_ClusterCount = clusterCount;
+	m_Constants.m_ClusterCount = clusterCount;
+	CreateBuffers(m_Capacity);
+}
+
+void GpuCuller::RecordCull(VkCommandBuffer commandBuffer, GpuCullPhase phase)
+{
+	// Counts start again each frame, the second phase adds to the first's.
+	if (phase != GPU_CULL_PHASE_SECOND)
+		vkCmdFillBuffer(commandBuffer, m_VkCountBuffer, 0, sizeof(GpuCullStats), 0);
+
+	// New objects weren't visible last frame.
+	if (m_VisibilityDirty)
+	{
+		vkCmdFillBuffer(commandBuffer, m_VkVisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+		m_VisibilityDirty = false;
+	}
+
+	// The clears have to finish before the shader writes. Earlier passes' use of the buffers is the render graph's job.
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	if (m_ObjectCount > 0)
+	{
+		m_Constants.m_Phase = phase;
+		m_Constants.m_DrawOffset = phase == GPU_CULL_PHASE_SECOND ? (uint)GetDrawCapacity() : 0;
+
+		// Clusters get a thread each, running through every object's meshlets in turn.
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, IsCullingClusters() ? m_VkClusterPipeline : m_VkPipeline);
+		uint boundsOffset = (uint)(m_FrameIndex * m_BoundsFrameSize);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipelineLayout, 0, 1, &m_VkDescriptorSet, 1, &boundsOffset);
+		m_Renderer->GetObjectRingBuffer()->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipelineLayout, 1);
+		vkCmdPushConstants(commandBuffer, m_VkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullConstants), &m_Constants);
+
+		size_t threadCount = m_ObjectCount * m_ClusterCount;
+		vkCmdDispatch(commandBuffer, (uint)((threadCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+	}
+
+	if (m_ReadbackEnabled && phase == GPU_CULL_PHASE_ALL && m_ObjectCount > 0)
+	{
+		// The copy is in the same pass as the cull, so it waits for it here rather than in the render graph.
+		VkMemoryBarrier cullBarrier{};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.size = m_ObjectCount * m_ClusterCount * sizeof(VkDrawIndexedIndirectCommand);
+		vkCmdCopyBuffer(commandBuffer, m_VkDrawBuffer, m_VkReadbackBuffer, 1, &copyRegion);
+
+		VkMemoryBarrier readbackBarrier{};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readbackBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void GpuCuller::RecordDraws(VkCommandBuffer commandBuffer, GpuCullPhase phase)
+{
+	if (m_ObjectCount == 0)
+		return;
+
+	uint maxDrawCount = (uint)(m_ObjectCount * m_ClusterCount);
+	uint stride = sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize drawOffset = phase == GPU_CULL_PHASE_SECOND ? GetDrawCapacity() * stride : 0;
+	VkDeviceSize countOffset = phase == GPU_CULL_PHASE_SECOND ? sizeof(uint) : 0;
+
+	PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = m_Renderer->GetDrawIndexedIndirectCount();
+	if (drawIndexedIndirectCount != nullptr)
+		drawIndexedIndirectCount(commandBuffer, m_VkDrawBuffer, drawOffset, m_VkCountBuffer, countOffset, maxDrawCount, stride);
+	else if (m_Renderer->GetEnabledFeatures().multiDrawIndirect)
+		vkCmdDrawIndexedIndirect(commandBuffer, m_VkDrawBuffer, drawOffset, maxDrawCount, stride);
+	else
+	{
+		// Without multi draw each draw needs its own call, which is what GPU culling is meant to avoid.
+		for (uint i = 0; i < maxDrawCount; ++i)
+			vkCmdDrawIndexedIndirect(commandBuffer, m_VkDrawBuffer, drawOffset + (VkDeviceSize)i * stride, 1, stride);
+	}
+}
+
+void GpuCuller::ReadVisibleObjects(std::vector<uint>& visibleObjects) const
+{
+	visibleObjects.clear();
+
+	if (m_MappedReadback == nullptr)
+		throw std::runtime_error("GPU cull readback isn't enabled!");
+
+	// Compacted draws are in whatever order the shader's atomics handed out slots.
+	size_t maxDrawCount = m_ObjectCount * m_ClusterCount;
+	size_t drawCount = m_Constants.m_Compact ? std::min<size_t>(m_MappedStats->m_DrawCounts[0], maxDrawCount) : maxDrawCount;
+	for (size_t i = 0; i < drawCount; ++i)
+	{
+		if (m_MappedReadback[i].instanceCount > 0)
+			visibleObjects.push_back(m_MappedReadback[i].firstInstance);
+	}
+
+	// Objects drawn a cluster at a time have a draw for each visible cluster.
+	std::sort(visibleObjects.begin(), visibleObjects.end());
+	visibleObjects.erase(std::unique(visibleObjects.begin(), visibleObjects.end()), visibleObjects.end());
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include "Bounds.h"
+#include <vector>
+
+class GpuMesh;
+
+// Bounds of an object as laid out in the storage buffer read by the cull shader.
+struct GpuObjectBounds
+{
+	// Box centre in xyz, radius of the sphere around it in w.
+	glm::vec4 m_CentreRadius;
+	// Box half size in xyz, 1 in w if the entry has been set.
+	glm::vec4 m_Extents;
+};
+
+// Push constants for the cull shader.
+struct GpuCullConstants
+{
+	// The camera's view projection matrix, the frustum planes are taken from it in the shader.
+	glm::mat4 m_ViewProjection;
+	// The camera's position in xyz, and 1 in w if it's known, 0 to not cull clusters that face away from it.
+	glm::vec4 m_CameraPosition;
+	uint m_ObjectCount;
+	// Levels of detail in the mesh. Each object's is read from its data in the object ring buffer.
+	uint m_LodCount;
+	// 1 to pack visible draws at the front of the draw buffer, 0 to write every draw with 0 or 1 instances.
+	uint m_Compact;
+	// Which GpuCullPhase is being culled.
+	uint m_Phase;
+	// First draw written by this phase.
+	uint m_DrawOffset;
+	// Index of the first object's data in this frame's part of the object ring buffer, where objects find their level of
+	// detail and clusters their world matrices.
+	uint m_FirstObject;
+	// Meshlets in the mesh's largest level of detail, culled for each object, or 1 when culling whole objects.
+	uint m_ClusterCount;
+};
+
+// Which objects a cull dispatch looks at.
+enum GpuCullPhase
+{
+	// Every object against the frustum, drawn in one go.
+	GPU_CULL_PHASE_ALL,
+	// Objects that were visible last frame against the frustum, drawn to fill the depth buffer.
+	GPU_CULL_PHASE_FIRST,
+	// Every object against the frustum and the depth pyramid, drawing the ones the first phase missed.
+	GPU_CULL_PHASE_SECOND,
+	GPU_CULL_PHASE_COUNT
+};
+
+// Counters written by the cull shaders, in the layout of the count buffer. When culling clusters, everything counts
+// clusters rather than objects.
+struct GpuCullStats
+{
+	// Draws written by the first (or only) and second phase.
+	uint m_DrawCounts[2];
+	// Objects tested by the phase that looks at every object.
+	uint m_TestedObjects;
+	// Objects outside the frustum.
+	uint m_FrustumCulled;
+	// Objects inside the frustum hidden behind the depth pyramid.
+	uint m_OcclusionCulled;
+	// Clusters inside the frustum facing away from the camera.
+	uint m_BackfaceCulled;
+};
+
+// Culls objects against the view frustum in a compute shader and draws the survivors with indirect draws.
+// Object bounds are kept on the CPU and copied into this frame's part of a persistently mapped storage buffer, which has
+// one part per frame in flight so frames still culling on the GPU never see them change. The shader writes one indexed indirect draw
+// per visible object with the scene index as the first instance, and counts them in a second buffer, so a
+// single vkCmdDrawIndexedIndirectCount draws everything and the CPU cost doesn't grow with the scene.
+// Without VK_KHR_draw_indirect_count every object gets a draw, with no instances if it was culled.
+// With occlusion culling on, culling is done in two phases around the renderer's depth pyramid build:
+// objects visible last frame are drawn first, then everything else is tested against the pyramid.
+// With cluster culling on and a mesh split into meshlets, each object's meshlets are culled on their own instead, by
+// the frustum, their normal cones and the pyramid, and each one left gets a draw of just its range of indices. Large
+// meshes partly on screen or partly facing away then only draw the clusters that can be seen.
+// Both shaders draw each object at the level of detail in its data in the object ring buffer, picked on the CPU.
+class GpuCuller
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the buffers and pipeline with.
+	GpuCuller(VulkanRenderer* renderer);
+	// Destructor.
+	~GpuCuller();
+
+	// Set the amount of objects to cull, growing the buffers if needed. New objects start never visible.
+	// Params: the object count.
+	void Resize(size_t count);
+
+	// Set the bounds of an object, using the sphere that encloses the box. The GPU sees them from the next UploadBounds.
+	// Params: the object index, its world space box.
+	void SetBounds(uint index, const AABB& box);
+
+	// Copy the bounds set since this frame's part of the bounds buffer was last written into it, and cull with that part.
+	// Has to be called each frame after the renderer's BeginFrame, once the frame's last run is done with the part.
+	// Params: the frame in flight index.
+	void UploadBounds(uint frameIndex);
+
+	// Set the camera to cull against in the next recorded command buffer.
+	// Params: the camera's view projection matrix.
+	void SetViewProjection(const glm::mat4& viewProjection) { m_Constants.m_ViewProjection = viewProjection; }
+
+	// Set the camera's position, which clusters facing away from are culled. Without it only the frustum and depth cull them.
+	// Params: the camera's world position.
+	void SetCameraPosition(const glm::vec3& position) { m_Constants.m_CameraPosition = glm::vec4(position, 1.0f); }
+
+	// Set where this frame's object data starts in the object ring buffer, for the shaders to read levels of detail and
+	// world matrices from.
+	// Params: the index of the first object's data.
+	void SetFirstObject(uint firstObject) { m_Constants.m_FirstObject = firstObject; }
+
+	// Set the mesh every object is drawn with, remaking the buffers if its levels of detail or amount of clusters change.
+	// Params: the mesh.
+	void SetMesh(const GpuMesh* mesh);
+
+	// Turn culling each object's meshlets on their own on or off. Takes effect from the next SetMesh, and only for meshes
+	// with meshlets.
+	// Params: if cluster culling is on.
+	void SetClusterCullingEnabled(bool enabled) { m_ClusterCullingEnabled = enabled; }
+
+	// Get if clusters are being culled, which needs cluster culling on and a mesh with meshlets.
+	// Returns: if clusters are culled.
+	bool IsCullingClusters() const { return m_MeshletBuffer != VK_NULL_HANDLE; }
+
+	// Turn two phase occlusion culling against the depth pyramid on or off, making the renderer's pyramid the first time.
+	// Params: if occlusion culling is on.
+	void SetOcclusionCullingEnabled(bool enabled);
+
+	// Get if two phase occlusion culling is on.
+	// Returns: if occlusion culling is on.
+	bool IsOcclusionCullingEnabled() const { return m_OcclusionCullingEnabled; }
+
+	// Copy the draws back to the CPU every frame so the results can be checked.
+	// Params: if the draws should be read back.
+	void SetReadbackEnabled(bool enabled);
+
+	// Record a cull dispatch. Has to be outside a render pass, in a render graph pass that writes the buffers with
+	// transfers and compute storage, and reads the depth pyramid for the second phase.
+	// Params: the command buffer, which phase to cull.
+	void RecordCull(VkCommandBuffer commandBuffer, GpuCullPhase phase);
+
+	// Record the indirect draws from a cull dispatch. Has to be inside a render pass with the pipeline and index buffer bound.
+	// Params: the command buffer, which phase's draws to draw.
+	void RecordDraws(VkCommandBuffer commandBuffer, GpuCullPhase phase);
+
+	// Get the amount of objects drawn on the last finished frame, or clusters when culling clusters.
+	// Returns: the visible object count.
+	uint GetVisibleObjectCount() const { return m_MappedStats->m_DrawCounts[0] + m_MappedStats->m_DrawCounts[1]; }
+
+	// Get the counters from the last finished frame.
+	// Returns: the stats.
+	const GpuCullStats& GetStats() const { return *m_MappedStats; }
+
+	// Get the scene indices of the objects drawn on the last finished frame, in ascending order.
+	// Readback has to be enabled, and occlusion culling off.
+	// Params: vector to fill with the scene indices.
+	void ReadVisibleObjects(std::vector<uint>& visibleObjects) const;
+
+	// Get the amount of objects.
+	// Returns: the object count.
+	size_t GetObjectCount() const { return m_ObjectCount; }
+
+private:
+	// Create the layout of the buffers the shader reads and writes.
+	void CreateDescriptorSetLayout();
+
+	// Create the compute pipelines.
+	void CreatePipelines();
+
+	// Create the buffers for a number of objects and get a descriptor set pointing at them.
+	// Params: the amount of objects the buffers can fit.
+	void CreateBuffers(size_t capacity);
+
+	// Get a descriptor set pointing at the buffers, and the depth pyramid if there is one.
+	void CreateDescriptorSet();
+
+	// Give the buffers to the deletion queue, for when frames in flight are done with them.
+	void ReleaseBuffers();
+
+	// Mark an object's bounds as needing copying into every frame's part of the bounds buffer.
+	// Params: the object index.
+	void MarkBoundsDirty(uint index);
+
+	// Get the amount of draws each phase has room for.
+	// Returns: the object capacity times the clusters per object.
+	size_t GetDrawCapacity() const { return m_Capacity * m_ClusterCount; }
+
+	// The renderer the culler was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// The compute pipelines and their layouts. Both read the object ring buffer in set 1.
+	VkDescriptorSetLayout m_VkDescriptorSetLayout;
+	VkPipelineLayout m_VkPipelineLayout;
+	VkPipeline m_VkPipeline;
+	VkPipeline m_VkClusterPipeline;
+
+	// Set pointing at the buffers, from the renderer's descriptor set cache.
+	VkDescriptorSet m_VkDescriptorSet = VK_NULL_HANDLE;
+
+	// Object bounds, written by SetBounds and copied to the GPU by UploadBounds.
+	std::vector<GpuObjectBounds> m_Bounds;
+
+	// Bit per frame in flight for each object, set while its bounds are waiting in that frame's list of objects to copy.
+	std::vector<uint8_t> m_BoundsDirtyFrames;
+	std::vector<uint> m_DirtyBounds[MAX_FRAMES_IN_FLIGHT];
+
+	// Copies of the bounds, one part per frame in flight, read by the shader through a dynamic storage buffer descriptor.
+	VkBuffer m_VkBoundsBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_VkBoundsMemory = VK_NULL_HANDLE;
+	char* m_MappedBounds = nullptr;
+
+	// Size of each frame's part of the bounds, a multiple of the device's dynamic offset alignment.
+	VkDeviceSize m_BoundsFrameSize = 0;
+
+	// Alignment dynamic storage buffer offsets need.
+	VkDeviceSize m_OffsetAlignment;
+
+	// The frame whose part of the bounds the next dispatch reads.
+	uint m_FrameIndex = 0;
+
+	// Indirect draws, written by the shader. The second phase's draws start at GetDrawCapacity().
+	VkBuffer m_VkDrawBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_VkDrawMemory = VK_NULL_HANDLE;
+
+	// Draw counts and stats, written by the shader and read by the draws and the CPU.
+	VkBuffer m_VkCountBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_VkCountMemory = VK_NULL_HANDLE;
+	GpuCullStats* m_MappedStats = nullptr;
+
+	// 1 per object (or cluster) that was visible last frame, only touched by the shader.
+	VkBuffer m_VkVisibilityBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_VkVisibilityMemory = VK_NULL_HANDLE;
+
+	// If the visibility buffer needs clearing before the next cull.
+	bool m_VisibilityDirty = true;
+
+	// Copy of the draws for checking on the CPU, only made when readback is enabled.
+	VkBuffer m_VkReadbackBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory m_VkReadbackMemory = VK_NULL_HANDLE;
+	VkDrawIndexedIndirectCommand* m_MappedReadback = nullptr;
+
+	// Amount of objects, and how many the buffers fit.
+	size_t m_ObjectCount = 0;
+	size_t m_Capacity = 0;
+
+	// If the draws get copied back each frame.
+	bool m_ReadbackEnabled = false;
+
+	// If culling is done in two phases around the depth pyramid.
+	bool m_OcclusionCullingEnabled = false;
+
+	// If meshes with meshlets have them culled one by one.
+	bool m_ClusterCullingEnabled = false;
+
+	// The mesh's meshlets when culling clusters, or VK_NULL_HANDLE, and how many there are (1 when culling objects).
+	VkBuffer m_MeshletBuffer = VK_NULL_HANDLE;
+	uint m_ClusterCount = 1;
+
+	// The mesh's levels of detail.
+	VkBuffer m_LodBuffer = VK_NULL_HANDLE;
+
+	// Push constants for the next dispatch.
+	GpuCullConstants m_Constants;
+};
\ No newline at end of file
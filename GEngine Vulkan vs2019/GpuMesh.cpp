@@ -0,0 +1,77 @@
+#include "GpuMesh.h"
+#include "VulkanRenderer.h"
+#include "DeletionQueue.h"
+#include <algorithm>
+#include <cstring>
+
+GpuMesh::GpuMesh(VulkanRenderer* renderer, const Mesh& mesh, VertexFormat format)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+	m_Format = format;
+	m_Lods = mesh.m_Lods;
+
+	if (m_Lods.empty())
+	{
+		MeshLod lod = {};
+		lod.m_SubMeshCount = (uint)mesh.m_SubMeshes.size();
+		lod.m_IndexCount = (uint)mesh.m_Indices.size();
+		lod.m_MeshletCount = (uint)mesh.m_Meshlets.size();
+		m_Lods.push_back(lod);
+	}
+
+	m_MaxLodMeshletCount = 0;
+	for (const MeshLod& lod : m_Lods)
+		m_MaxLodMeshletCount = std::max(m_MaxLodMeshletCount, lod.m_MeshletCount);
+
+	const VertexLayout& layout = VertexLayout::Get(format);
+	layout.GetPositionTransform(mesh.m_Bounds, m_Constants.m_PositionOffset, m_Constants.m_PositionScale);
+
+	std::vector<uint8_t> vertices(mesh.m_Vertices.size() * layout.m_Stride);
+	layout.Pack(mesh.m_Vertices.data(), mesh.m_Vertices.size(), mesh.m_Bounds, vertices.data());
+	m_VertexBufferSize = vertices.size();
+
+	CreateBuffer(vertices.data(), vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VertexBuffer, m_VertexMemory);
+	CreateBuffer(mesh.m_Indices.data(), mesh.m_Indices.size() * sizeof(uint), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer, m_IndexMemory);
+
+	CreateBuffer(m_Lods.data(), m_Lods.size() * sizeof(MeshLod), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_LodBuffer, m_LodMemory);
+
+	if (!mesh.m_Meshlets.empty())
+		CreateBuffer(mesh.m_Meshlets.data(), mesh.m_Meshlets.size() * sizeof(Meshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_MeshletBuffer, m_MeshletMemory);
+}
+
+GpuMesh::~GpuMesh()
+{
+	DeletionQueue* deletionQueue = m_Renderer->GetDeletionQueue();
+	deletionQueue->Destroy(std::move(m_VertexBuffer));
+	deletionQueue->Destroy(std::move(m_VertexMemory));
+	deletionQueue->Destroy(std::move(m_IndexBuffer));
+	deletionQueue->Destroy(std::move(m_IndexMemory));
+	deletionQueue->Destroy(std::move(m_MeshletBuffer));
+	deletionQueue->Destroy(std::move(m_MeshletMemory));
+	deletionQueue->Destroy(std::move(m_LodBuffer));
+	deletionQueue->Destroy(std::move(m_LodMemory));
+}
+
+void GpuMesh::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const
+{
+	VkBuffer vertexBuffer = m_VertexBuffer.Get();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.Get(), 0, VK_INDEX_TYPE_UINT32);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawConstants), sizeof(MeshConstants), &m_Constants);
+}
+
+void GpuMesh::CreateBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, UniqueBuffer& buffer, UniqueDeviceMemory& memory)
+{
+	VkBuffer newBuffer;
+	VkDeviceMemory newMemory;
+	m_Renderer->CreateBuffer(size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, newBuffer, newMemory);
+	buffer = UniqueBuffer(m_VkDevice, newBuffer);
+	memory = UniqueDeviceMemory(m_VkDevice, newMemory);
+
+	void* mapped;
+	vkMapMemory(m_VkDevice, newMemory, 0, size, 0, &mapped);
+	memcpy(mapped, data, (size_t)size);
+	vkUnmapMemory(m_VkDevice, newMemory);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include "VertexLayout.h"
+#include "VulkanHandle.h"
+
+class VulkanRenderer;
+
+// Push constants for the mesh being drawn, straight after the DrawConstants and only seen by the vertex shaders.
+// Laid out like the end of the vertex shaders' push constant block.
+struct MeshConstants
+{
+	// What quantised positions are scaled by and then offset by to get back to the mesh's space.
+	glm::vec4 m_PositionOffset;
+	glm::vec4 m_PositionScale;
+};
+
+// A mesh's vertices, packed in a vertex format, and its indices, in buffers ready to draw. Meshes split into meshlets
+// also get a storage buffer of the meshlets, for culling them on the GPU. The levels of detail go in a storage buffer
+// too, for the cull shaders to find each object's range of indices or meshlets. Meshes without levels of detail get
+// one covering the whole mesh.
+class GpuMesh
+{
+public:
+	// Constructor.
+	// Params: the renderer, the mesh, the format to pack its vertices in.
+	GpuMesh(VulkanRenderer* renderer, const Mesh& mesh, VertexFormat format);
+	// Destructor. The buffers go to the renderer's deletion queue, so frames in flight can finish drawing the mesh.
+	~GpuMesh();
+
+	// Bind the vertex and index buffers and push the mesh constants.
+	// Params: the command buffer, the layout of the pipeline bound.
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+
+	// Get the format the vertices are packed in.
+	// Returns: the format.
+	VertexFormat GetVertexFormat() const { return m_Format; }
+
+	// Get the amount of levels of detail.
+	// Returns: the level count, at least 1.
+	uint GetLodCount() const { return (uint)m_Lods.size(); }
+
+	// Get a level of detail.
+	// Params: the level, 0 for full detail.
+	// Returns: the level.
+	const MeshLod& GetLod(uint lod) const { return m_Lods[lod]; }
+
+	// Get every level of detail, the full detail one first.
+	// Returns: the levels.
+	const MeshLod* GetLods() const { return m_Lods.data(); }
+
+	// Get the buffer of levels of detail, laid out like MeshLod.
+	// Returns: the buffer.
+	VkBuffer GetLodBuffer() const { return m_LodBuffer.Get(); }
+
+	// Get the size of the vertex buffer.
+	// Returns: the size in bytes.
+	VkDeviceSize GetVertexBufferSize() const { return m_VertexBufferSize; }
+
+	// Get the buffer of meshlets, laid out like Meshlet.
+	// Returns: the buffer, or VK_NULL_HANDLE if the mesh has no meshlets.
+	VkBuffer GetMeshletBuffer() const { return m_MeshletBuffer.Get(); }
+
+	// Get the amount of meshlets in the level of detail with the most.
+	// Returns: the meshlet count, 0 if the mesh has none.
+	uint GetMaxLodMeshletCount() const { return m_MaxLodMeshletCount; }
+
+private:
+	// Create a host visible buffer holding some data.
+	// Params: the data, its size, what the buffer's used for, the buffer and memory to create.
+	void CreateBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, UniqueBuffer& buffer, UniqueDeviceMemory& memory);
+
+	// The renderer.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	UniqueBuffer m_VertexBuffer;
+	UniqueDeviceMemory m_VertexMemory;
+	UniqueBuffer m_IndexBuffer;
+	UniqueDeviceMemory m_IndexMemory;
+	UniqueBuffer m_MeshletBuffer;
+	UniqueDeviceMemory m_MeshletMemory;
+	UniqueBuffer m_LodBuffer;
+	UniqueDeviceMemory m_LodMemory;
+
+	VertexFormat m_Format;
+	std::vector<MeshLod> m_Lods;
+	uint m_MaxLodMeshletCount;
+	VkDeviceSize m_VertexBufferSize;
+	MeshConstants m_Constants;
+};
\ No newline at end of file
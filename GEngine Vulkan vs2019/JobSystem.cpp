@@ -0,0 +1,117 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	m_NextChunk = 0;
+	m_FinishedChunks = 0;
+
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (unsigned int i = 0; i < workerCount; ++i)
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_ShuttingDown = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t chunkSize, JobFunction function, void* data)
+{
+	if (count == 0)
+		return;
+
+	if (chunkSize == 0)
+		chunkSize = 1;
+
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	// Not worth waking anyone up for a single chunk.
+	if (chunkCount == 1 || m_Workers.empty())
+	{
+		function(data, 0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> dispatchLock(m_DispatchMutex);
+
+	{
+		// Late workers from the last batch have to be out before its details are replaced.
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_DoneCondition.wait(lock, [this] { return m_ActiveWorkers == 0; });
+
+		m_Function = function;
+		m_Data = data;
+		m_Count = count;
+		m_ChunkSize = chunkSize;
+		m_ChunkCount = chunkCount;
+		m_NextChunk = 0;
+		m_FinishedChunks = 0;
+		++m_Generation;
+	}
+	m_WakeCondition.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_DoneCondition.wait(lock, [this] { return m_FinishedChunks == m_ChunkCount && m_ActiveWorkers == 0; });
+}
+
+void JobSystem::RunChunks()
+{
+	while (true)
+	{
+		size_t chunk = m_NextChunk.fetch_add(1);
+		if (chunk >= m_ChunkCount)
+			return;
+
+		size_t begin = chunk * m_ChunkSize;
+		size_t end = begin + m_ChunkSize < m_Count ? begin + m_ChunkSize : m_Count;
+		m_Function(m_Data, begin, end);
+
+		if (m_FinishedChunks.fetch_add(1) + 1 == m_ChunkCount)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_DoneCondition.notify_all();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop()
+{
+	size_t seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WakeCondition.wait(lock, [&] { return m_ShuttingDown || m_Generation != seenGeneration; });
+
+			if (m_ShuttingDown)
+				return;
+
+			seenGeneration = m_Generation;
+			++m_ActiveWorkers;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			--m_ActiveWorkers;
+			if (m_ActiveWorkers == 0)
+				m_DoneCondition.notify_all();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Function run over a range of a parallel for.
+// Params: user data given to ParallelFor, first index, one past the last index.
+typedef void (*JobFunction)(void* data, size_t begin, size_t end);
+
+// Pool of worker threads that split ranges of work between them.
+// Plain function pointers are used instead of std::function so dispatching work never allocates.
+class JobSystem
+{
+public:
+	// Constructor.
+	// Params: amount of worker threads, 0 to use one less than the hardware thread count.
+	JobSystem(unsigned int workerCount = 0);
+	// Destructor.
+	~JobSystem();
+
+	// Run a function over a range in chunks, on the workers and the calling thread. Returns once every chunk is done.
+	// Params: amount of indices, indices per chunk, the function, user data passed to the function.
+	void ParallelFor(size_t count, size_t chunkSize, JobFunction function, void* data);
+
+	// Get the amount of threads work is split between, including the calling thread.
+	// Returns: the thread count.
+	unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+private:
+	// Loop run by each worker thread.
+	void WorkerLoop();
+
+	// Run chunks of the current batch until there are none left.
+	void RunChunks();
+
+	// The worker threads.
+	std::vector<std::thread> m_Workers;
+
+	// Guards the batch details and wakes the workers.
+	std::mutex m_Mutex;
+	std::condition_variable m_WakeCondition;
+	std::condition_variable m_DoneCondition;
+
+	// Only one ParallelFor can run at a time.
+	std::mutex m_DispatchMutex;
+
+	// The batch being worked on.
+	JobFunction m_Function = nullptr;
+	void* m_Data = nullptr;
+	size_t m_Count = 0;
+	size_t m_ChunkSize = 0;
+	size_t m_ChunkCount = 0;
+
+	// Next chunk to hand out.
+	std::atomic<size_t> m_NextChunk;
+
+	// Amount of chunks finished.
+	std::atomic<size_t> m_FinishedChunks;
+
+	// Goes up each time a batch starts, so workers know there's new work.
+	size_t m_Generation = 0;
+
+	// Workers currently running chunks. A new batch isn't set up until this is back to 0.
+	size_t m_ActiveWorkers = 0;
+
+	// If the workers should exit.
+	bool m_ShuttingDown = false;
+};
\ No newline at end of file
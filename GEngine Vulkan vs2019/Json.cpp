@@ -0,0 +1,283 @@
+#include "Json.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+// Deepest nesting of arrays and objects parsed, so a bad file can't run the stack out.
+static const int MAX_JSON_DEPTH = 256;
+
+// Recursive descent parser over a JSON document.
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length) : m_Text(text), m_End(text + length) {}
+
+	// Parse the whole document, which has to be one value.
+	// Returns: the value.
+	JsonValue ParseDocument()
+	{
+		JsonValue value;
+		ParseValue(value, 0);
+		SkipWhitespace();
+		if (m_Text != m_End)
+			throw std::runtime_error("Failed to parse JSON, unexpected text after the document!");
+		return value;
+	}
+
+private:
+	void SkipWhitespace()
+	{
+		while (m_Text != m_End && (*m_Text == ' ' || *m_Text == '\t' || *m_Text == '\n' || *m_Text == '\r'))
+			++m_Text;
+	}
+
+	// Skip whitespace, then consume a character if it's next.
+	// Params: the character.
+	// Returns: if it was consumed.
+	bool Accept(char c)
+	{
+		SkipWhitespace();
+		if (m_Text != m_End && *m_Text == c)
+		{
+			++m_Text;
+			return true;
+		}
+		return false;
+	}
+
+	void Expect(char c)
+	{
+		if (!Accept(c))
+			throw std::runtime_error("Failed to parse JSON, unexpected character!");
+	}
+
+	// Consume a keyword if it's next.
+	// Params: the keyword.
+	// Returns: if it was consumed.
+	bool AcceptWord(const char* word)
+	{
+		size_t length = strlen(word);
+		if ((size_t)(m_End - m_Text) >= length && strncmp(m_Text, word, length) == 0)
+		{
+			m_Text += length;
+			return true;
+		}
+		return false;
+	}
+
+	void ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > MAX_JSON_DEPTH)
+			throw std::runtime_error("Failed to parse JSON, nested too deeply!");
+
+		SkipWhitespace();
+		if (m_Text == m_End)
+			throw std::runtime_error("Failed to parse JSON, unexpected end of file!");
+
+		if (Accept('{'))
+		{
+			value.m_Type = JsonValue::JSON_OBJECT;
+			if (Accept('}'))
+				return;
+
+			do
+			{
+				SkipWhitespace();
+				value.m_Keys.emplace_back();
+				ParseString(value.m_Keys.back());
+				Expect(':');
+				value.m_Values.emplace_back();
+				ParseValue(value.m_Values.back(), depth + 1);
+			} while (Accept(','));
+
+			Expect('}');
+		}
+		else if (Accept('['))
+		{
+			value.m_Type = JsonValue::JSON_ARRAY;
+			if (Accept(']'))
+				return;
+
+			do
+			{
+				value.m_Values.emplace_back();
+				ParseValue(value.m_Values.back(), depth + 1);
+			} while (Accept(','));
+
+			Expect(']');
+		}
+		else if (*m_Text == '"')
+		{
+			value.m_Type = JsonValue::JSON_STRING;
+			ParseString(value.m_String);
+		}
+		else if (AcceptWord("true"))
+		{
+			value.m_Type = JsonValue::JSON_BOOL;
+			value.m_Bool = true;
+		}
+		else if (AcceptWord("false"))
+		{
+			value.m_Type = JsonValue::JSON_BOOL;
+			value.m_Bool = false;
+		}
+		else if (AcceptWord("null"))
+		{
+			value.m_Type = JsonValue::JSON_NULL;
+		}
+		else
+		{
+			value.m_Type = JsonValue::JSON_NUMBER;
+			ParseNumber(value.m_Number);
+		}
+	}
+
+	void ParseNumber(double& number)
+	{
+		// strtod would read past the end of an unterminated buffer, so the number is copied out first.
+		char digits[64];
+		size_t length = 0;
+		while (m_Text + length != m_End && length < sizeof(digits) - 1 && strchr("+-0123456789.eE", m_Text[length]) != nullptr)
+		{
+			digits[length] = m_Text[length];
+			++length;
+		}
+		digits[length] = '\0';
+
+		char* end = nullptr;
+		number = strtod(digits, &end);
+		if (length == 0 || end != digits + length)
+			throw std::runtime_error("Failed to parse JSON, invalid number!");
+
+		m_Text += length;
+	}
+
+	void ParseString(std::string& string)
+	{
+		if (m_Text == m_End || *m_Text != '"')
+			throw std::runtime_error("Failed to parse JSON, expected a string!");
+		++m_Text;
+
+		while (true)
+		{
+			if (m_Text == m_End)
+				throw std::runtime_error("Failed to parse JSON, unterminated string!");
+
+			char c = *m_Text++;
+			if (c == '"')
+				return;
+
+			if (c != '\\')
+			{
+				string += c;
+				continue;
+			}
+
+			if (m_Text == m_End)
+				throw std::runtime_error("Failed to parse JSON, unterminated string!");
+
+			c = *m_Text++;
+			switch (c)
+			{
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u': AppendCodePoint(string, ParseCodePoint()); break;
+			default: string += c; break;
+			}
+		}
+	}
+
+	// Parse the rest of a \u escape, and the low half after it if it's a surrogate pair.
+	// Returns: the code point.
+	unsigned int ParseCodePoint()
+	{
+		unsigned int codePoint = ParseHex();
+		if (codePoint >= 0xD800 && codePoint < 0xDC00 && m_End - m_Text >= 6 && m_Text[0] == '\\' && m_Text[1] == 'u')
+		{
+			m_Text += 2;
+			unsigned int low = ParseHex();
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+		}
+		return codePoint;
+	}
+
+	unsigned int ParseHex()
+	{
+		if (m_End - m_Text < 4)
+			throw std::runtime_error("Failed to parse JSON, invalid escape!");
+
+		unsigned int value = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			char c = *m_Text++;
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+				value |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				value |= c - 'A' + 10;
+			else
+				throw std::runtime_error("Failed to parse JSON, invalid escape!");
+		}
+		return value;
+	}
+
+	// Append a code point to a string as UTF-8.
+	static void AppendCodePoint(std::string& string, unsigned int codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			string += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			string += (char)(0xC0 | (codePoint >> 6));
+			string += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			string += (char)(0xE0 | (codePoint >> 12));
+			string += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			string += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			string += (char)(0xF0 | (codePoint >> 18));
+			string += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			string += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			string += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	const char* m_Text;
+	const char* m_End;
+};
+
+JsonValue JsonValue::Parse(const char* text, size_t length)
+{
+	JsonParser parser(text, length);
+	return parser.ParseDocument();
+}
+
+const JsonValue* JsonValue::Find(const char* key) const
+{
+	if (m_Type != JSON_OBJECT)
+		return nullptr;
+
+	for (size_t i = 0; i < m_Keys.size(); ++i)
+	{
+		if (m_Keys[i] == key)
+			return &m_Values[i];
+	}
+	return nullptr;
+}
+
+double JsonValue::GetNumber(const char* key, double fallback) const
+{
+	const JsonValue* value = Find(key);
+	return value != nullptr ? value->GetNumber(fallback) : fallback;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A parsed JSON value, enough to read asset files like glTF.
+// Objects keep their members in file order and are searched linearly, which is fine for the handful of keys assets have.
+class JsonValue
+{
+public:
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// Parse a JSON document. Throws if it isn't valid JSON.
+	// Params: the text, its length in bytes.
+	// Returns: the root value.
+	static JsonValue Parse(const char* text, size_t length);
+
+	// Get the type of the value.
+	// Returns: the type.
+	Type GetType() const { return m_Type; }
+
+	// Get the value as a number.
+	// Params: what to return if it isn't a number.
+	// Returns: the number.
+	double GetNumber(double fallback = 0.0) const { return m_Type == JSON_NUMBER ? m_Number : fallback; }
+
+	// Get the value as a bool.
+	// Params: what to return if it isn't a bool.
+	// Returns: the bool.
+	bool GetBool(bool fallback = false) const { return m_Type == JSON_BOOL ? m_Bool : fallback; }
+
+	// Get the value as a string.
+	// Returns: the string, empty if it isn't one.
+	const std::string& GetString() const { return m_String; }
+
+	// Get the amount of elements in an array or members in an object.
+	// Returns: the count, 0 for anything else.
+	size_t GetSize() const { return m_Values.size(); }
+
+	// Get an element of an array or the value of a member of an object.
+	// Params: the index.
+	// Returns: the value.
+	const JsonValue& operator[](size_t index) const { return m_Values[index]; }
+
+	// Find a member of an object.
+	// Params: the member's name.
+	// Returns: the member's value, or nullptr if this isn't an object or doesn't have it.
+	const JsonValue* Find(const char* key) const;
+
+	// Get a number member of an object.
+	// Params: the member's name, what to return if it's missing or not a number.
+	// Returns: the number.
+	double GetNumber(const char* key, double fallback) const;
+
+private:
+	friend class JsonParser;
+
+	Type m_Type = JSON_NULL;
+	bool m_Bool = false;
+	double m_Number = 0.0;
+	std::string m_String;
+
+	// Elements of an array, or values of an object with their names in m_Keys.
+	std::vector<JsonValue> m_Values;
+	std::vector<std::string> m_Keys;
+};
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "LightCuller.h"
+#include "BindlessTable.h"
+#include "CpuFeatures.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Clusters across, down and into the screen. Rows are a multiple of 8 so kernels only see whole blocks.
+static const uint GRID_X = 16;
+static const uint GRID_Y = 9;
+static const uint GRID_Z = 24;
+static const uint SLICE_CLUSTERS = GRID_X * GRID_Y;
+static const uint CLUSTER_COUNT = SLICE_CLUSTERS * GRID_Z;
+
+// Lights binned each frame, and entries in the light index list shared by every cluster.
+static const uint MAX_LIGHTS = 1024;
+static const uint MAX_LIGHT_INDICES = 64 * 1024;
+
+// Where each part of the buffer starts, in bytes.
+static const VkDeviceSize LIGHTS_OFFSET = sizeof(LightGridHeader);
+static const VkDeviceSize CLUSTERS_OFFSET = LIGHTS_OFFSET + MAX_LIGHTS * sizeof(PointLight);
+static const VkDeviceSize INDICES_OFFSET = CLUSTERS_OFFSET + CLUSTER_COUNT * 2 * sizeof(uint);
+static const VkDeviceSize LIGHT_GRID_SIZE = INDICES_OFFSET + MAX_LIGHT_INDICES * sizeof(uint);
+
+// Order of the arrays passed to the bin kernels.
+enum ClusterBoundsArray
+{
+	CLUSTER_MIN_X,
+	CLUSTER_MIN_Y,
+	CLUSTER_MIN_Z,
+	CLUSTER_MAX_X,
+	CLUSTER_MAX_Y,
+	CLUSTER_MAX_Z,
+	CLUSTER_BOUNDS_ARRAY_COUNT
+};
+
+//-------------------------------------------------------------------------------
+// Bin kernels.
+//-------------------------------------------------------------------------------
+// Write the indices of the set bits of a mask without branching on each bit. Every lane is written.
+static inline size_t CompactMask(unsigned int mask, int laneCount, uint base, uint* clusters)
+{
+	size_t count = 0;
+	for (int lane = 0; lane < laneCount; ++lane)
+	{
+		clusters[count] = base + lane;
+		count += (mask >> lane) & 1;
+	}
+
+	return count;
+}
+
+static size_t BinSSE(const float* const* bounds, const float* sphere, size_t begin, size_t end, uint* clusters)
+{
+	__m128 centreX = _mm_set1_ps(sphere[0]);
+	__m128 centreY = _mm_set1_ps(sphere[1]);
+	__m128 centreZ = _mm_set1_ps(sphere[2]);
+	__m128 radiusSquared = _mm_set1_ps(sphere[3]);
+	__m128 zero = _mm_setzero_ps();
+	size_t count = 0;
+
+	for (size_t i = begin; i < end; i += 4)
+	{
+		// Distance from the centre to the box on each axis, zero when it's between the sides.
+		__m128 distanceX = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds[CLUSTER_MIN_X] + i), centreX),
+			_mm_sub_ps(centreX, _mm_loadu_ps(bounds[CLUSTER_MAX_X] + i))), zero);
+		__m128 distanceY = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds[CLUSTER_MIN_Y] + i), centreY),
+			_mm_sub_ps(centreY, _mm_loadu_ps(bounds[CLUSTER_MAX_Y] + i))), zero);
+		__m128 distanceZ = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(bounds[CLUSTER_MIN_Z] + i), centreZ),
+			_mm_sub_ps(centreZ, _mm_loadu_ps(bounds[CLUSTER_MAX_Z] + i))), zero);
+
+		__m128 distanceSquared = _mm_mul_ps(distanceX, distanceX);
+		distanceSquared = _mm_add_ps(_mm_mul_ps(distanceY, distanceY), distanceSquared);
+		distanceSquared = _mm_add_ps(_mm_mul_ps(distanceZ, distanceZ), distanceSquared);
+
+		unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared));
+		if (mask != 0)
+			count += CompactMask(mask, 4, (uint)i, clusters + count);
+	}
+
+	return count;
+}
+
+GENGINE_TARGET_AVX2 static size_t BinAVX2(const float* const* bounds, const float* sphere, size_t begin, size_t end, uint* clusters)
+{
+	__m256 centreX = _mm256_broadcast_ss(sphere + 0);
+	__m256 centreY = _mm256_broadcast_ss(sphere + 1);
+	__m256 centreZ = _mm256_broadcast_ss(sphere + 2);
+	__m256 radiusSquared = _mm256_broadcast_ss(sphere + 3);
+	__m256 zero = _mm256_setzero_ps();
+	size_t count = 0;
+
+	for (size_t i = begin; i < end; i += 8)
+	{
+		// Distance from the centre to the box on each axis, zero when it's between the sides.
+		__m256 distanceX = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds[CLUSTER_MIN_X] + i), centreX),
+			_mm256_sub_ps(centreX, _mm256_loadu_ps(bounds[CLUSTER_MAX_X] + i))), zero);
+		__m256 distanceY = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds[CLUSTER_MIN_Y] + i), centreY),
+			_mm256_sub_ps(centreY, _mm256_loadu_ps(bounds[CLUSTER_MAX_Y] + i))), zero);
+		__m256 distanceZ = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(bounds[CLUSTER_MIN_Z] + i), centreZ),
+			_mm256_sub_ps(centreZ, _mm256_loadu_ps(bounds[CLUSTER_MAX_Z] + i))), zero);
+
+		__m256 distanceSquared = _mm256_mul_ps(distanceX, distanceX);
+		distanceSquared = _mm256_fmadd_ps(distanceY, distanceY, distanceSquared);
+		distanceSquared = _mm256_fmadd_ps(distanceZ, distanceZ, distanceSquared);
+
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, radiusSquared, _CMP_LE_OQ));
+		if (mask != 0)
+			count += CompactMask(mask, 8, (uint)i, clusters + count);
+	}
+
+	return count;
+}
+
+//-------------------------------------------------------------------------------
+// LightCuller.
+//-------------------------------------------------------------------------------
+LightCuller::LightCuller(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	const CpuFeatures& cpu = CpuFeatures::Get();
+	m_Bin = cpu.m_AVX2 && cpu.m_FMA ? BinAVX2 : BinSSE;
+
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Renderer->CreateBuffer(LIGHT_GRID_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_VkBuffers[i], m_VkMemory[i]);
+		vkMapMemory(m_VkDevice, m_VkMemory[i], 0, LIGHT_GRID_SIZE, 0, (void**)&m_MappedData[i]);
+
+		m_BindlessIndices[i] = m_Renderer->GetBindlessTable()->AddStorageBuffer(m_VkBuffers[i], 0, LIGHT_GRID_SIZE);
+		if (m_BindlessIndices[i] == BINDLESS_INVALID_INDEX)
+			throw std::runtime_error("Failed to add light grid to the bindless table!");
+	}
+
+	m_MinX.resize(CLUSTER_COUNT);
+	m_MinY.resize(CLUSTER_COUNT);
+	m_MinZ.resize(CLUSTER_COUNT);
+	m_MaxX.resize(CLUSTER_COUNT);
+	m_MaxY.resize(CLUSTER_COUNT);
+	m_MaxZ.resize(CLUSTER_COUNT);
+
+	// A light can't touch more clusters than there are.
+	m_LightClusters.resize(CLUSTER_COUNT);
+	m_HitClusters.reserve(MAX_LIGHT_INDICES);
+	m_HitLights.reserve(MAX_LIGHT_INDICES);
+	m_ClusterCounts.resize(CLUSTER_COUNT);
+	m_ClusterOffsets.resize(CLUSTER_COUNT);
+	m_Indices.resize(MAX_LIGHT_INDICES);
+}
+
+LightCuller::~LightCuller()
+{
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Renderer->GetBindlessTable()->RemoveStorageBuffer(m_BindlessIndices[i]);
+		vkUnmapMemory(m_VkDevice, m_VkMemory[i]);
+		vkDestroyBuffer(m_VkDevice, m_VkBuffers[i], nullptr);
+		vkFreeMemory(m_VkDevice, m_VkMemory[i], nullptr);
+	}
+}
+
+void LightCuller::SetProjection(float fovY, float aspect, float nearPlane, float farPlane)
+{
+	if (fovY == m_FovY && aspect == m_Aspect && nearPlane == m_NearPlane && farPlane == m_FarPlane)
+		return;
+
+	m_FovY = fovY;
+	m_Aspect = aspect;
+	m_NearPlane = nearPlane;
+	m_FarPlane = farPlane;
+
+	// Half the size of the view at a depth of 1.
+	float halfHeight = tanf(fovY * 0.5f);
+	float halfWidth = halfHeight * aspect;
+
+	for (uint z = 0; z < GRID_Z; ++z)
+	{
+		// Exponential slices keep clusters roughly cube shaped as they get further away.
+		float sliceNear = nearPlane * powf(farPlane / nearPlane, (float)z / GRID_Z);
+		float sliceFar = nearPlane * powf(farPlane / nearPlane, (float)(z + 1) / GRID_Z);
+
+		for (uint y = 0; y < GRID_Y; ++y)
+		{
+			// Row 0 is at the top of the screen, where view space y is highest.
+			float top = (1.0f - 2.0f * y / GRID_Y) * halfHeight;
+			float bottom = (1.0f - 2.0f * (y + 1) / GRID_Y) * halfHeight;
+
+			for (uint x = 0; x < GRID_X; ++x)
+			{
+				float left = (-1.0f + 2.0f * x / GRID_X) * halfWidth;
+				float right = (-1.0f + 2.0f * (x + 1) / GRID_X) * halfWidth;
+
+				// The tile's edges spread out with depth, so the box covers its corners at both ends of the slice.
+				uint cluster = x + y * GRID_X + z * SLICE_CLUSTERS;
+				m_MinX[cluster] = std::min(left * sliceNear, left * sliceFar);
+				m_MaxX[cluster] = std::max(right * sliceNear, right * sliceFar);
+				m_MinY[cluster] = std::min(bottom * sliceNear, bottom * sliceFar);
+				m_MaxY[cluster] = std::max(top * sliceNear, top * sliceFar);
+				m_MinZ[cluster] = sliceNear;
+				m_MaxZ[cluster] = sliceFar;
+			}
+		}
+	}
+}
+
+uint LightCuller::GetSlice(float depth) const
+{
+	float slice = logf(depth / m_NearPlane) * GRID_Z / logf(m_FarPlane / m_NearPlane);
+	return (uint)std::min(std::max(slice, 0.0f), (float)(GRID_Z - 1));
+}
+
+uint LightCuller::Build(const PointLight* lights, size_t lightCount, const glm::mat4& view, uint frameIndex)
+{
+	if (m_NearPlane <= 0.0f)
+		throw std::runtime_error("Light culler projection isn't set!");
+
+	lightCount = std::min<size_t>(lightCount, MAX_LIGHTS);
+
+	m_Stats = LightCullStats();
+	m_Stats.m_LightCount = lightCount;
+
+	m_HitClusters.clear();
+	m_HitLights.clear();
+	std::fill(m_ClusterCounts.begin(), m_ClusterCounts.end(), 0);
+
+	const float* bounds[CLUSTER_BOUNDS_ARRAY_COUNT] = { m_MinX.data(), m_MinY.data(), m_MinZ.data(), m_MaxX.data(), m_MaxY.data(), m_MaxZ.data() };
+	for (size_t i = 0; i < lightCount; ++i)
+	{
+		const PointLight& light = lights[i];
+		glm::vec4 centre = view * glm::vec4(light.m_Position, 1.0f);
+		float depth = -centre.z;
+		if (depth + light.m_Radius < m_NearPlane || depth - light.m_Radius > m_FarPlane)
+			continue;
+
+		// Only the slices the sphere's depth range covers are tested.
+		uint firstSlice = GetSlice(std::max(depth - light.m_Radius, m_NearPlane));
+		uint lastSlice = GetSlice(std::min(depth + light.m_Radius, m_FarPlane));
+
+		float sphere[4] = { centre.x, centre.y, depth, light.m_Radius * light.m_Radius };
+		size_t count = m_Bin(bounds, sphere, firstSlice * SLICE_CLUSTERS, (lastSlice + 1) * SLICE_CLUSTERS, m_LightClusters.data());
+		if (count > 0)
+			++m_Stats.m_VisibleLightCount;
+
+		for (size_t c = 0; c < count; ++c)
+		{
+			if (m_HitClusters.size() == MAX_LIGHT_INDICES)
+			{
+				m_Stats.m_Overflowed = true;
+				break;
+			}
+
+			m_HitClusters.push_back(m_LightClusters[c]);
+			m_HitLights.push_back((uint)i);
+			++m_ClusterCounts[m_LightClusters[c]];
+		}
+	}
+
+	// The buffer's write combined, so it's only written front to back or in big copies.
+	char* data = m_MappedData[frameIndex];
+	uint* clusters = (uint*)(data + CLUSTERS_OFFSET);
+
+	// Give each cluster its part of the index list, then fill the lists in light order.
+	uint offset = 0;
+	for (uint c = 0; c < CLUSTER_COUNT; ++c)
+	{
+		m_ClusterOffsets[c] = offset;
+		clusters[c * 2 + 0] = offset;
+		clusters[c * 2 + 1] = m_ClusterCounts[c];
+		offset += m_ClusterCounts[c];
+		m_Stats.m_MaxClusterLights = std::max<size_t>(m_Stats.m_MaxClusterLights, m_ClusterCounts[c]);
+	}
+
+	for (size_t i = 0; i < m_HitClusters.size(); ++i)
+		m_Indices[m_ClusterOffsets[m_HitClusters[i]]++] = m_HitLights[i];
+
+	m_Stats.m_IndexCount = m_HitClusters.size();
+
+	// Pixels are counted in the render extent, which is smaller than the swap chain with dynamic resolution.
+	VkExtent2D extent = m_Renderer->GetRenderExtent();
+
+	LightGridHeader header;
+	header.m_GridX = GRID_X;
+	header.m_GridY = GRID_Y;
+	header.m_GridZ = GRID_Z;
+	header.m_LightCount = (uint)lightCount;
+	header.m_TileWidth = (float)extent.width / GRID_X;
+	header.m_TileHeight = (float)extent.height / GRID_Y;
+	header.m_SliceScale = GRID_Z / logf(m_FarPlane / m_NearPlane);
+	header.m_SliceBias = -logf(m_NearPlane) * header.m_SliceScale;
+	header.m_NearPlane = m_NearPlane;
+	header.m_FarPlane = m_FarPlane;
+	header.m_ClusterOffset = (uint)(CLUSTERS_OFFSET / sizeof(uint));
+	header.m_IndexOffset = (uint)(INDICES_OFFSET / sizeof(uint));
+
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + LIGHTS_OFFSET, lights, lightCount * sizeof(PointLight));
+	memcpy(data + INDICES_OFFSET, m_Indices.data(), m_HitClusters.size() * sizeof(uint));
+
+	return m_BindlessIndices[frameIndex];
+}
\ No newline at end of file
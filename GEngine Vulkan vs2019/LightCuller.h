@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include <vector>
+
+// A point light as laid out in the light grid buffer.
+struct PointLight
+{
+	// World space position, and the distance the light reaches.
+	glm::vec3 m_Position = glm::vec3(0.0f);
+	float m_Radius = 1.0f;
+	glm::vec3 m_Colour = glm::vec3(1.0f);
+	float m_Intensity = 1.0f;
+};
+
+// Start of the light grid buffer, read by the fragment shader to find a pixel's cluster.
+struct LightGridHeader
+{
+	uint m_GridX;
+	uint m_GridY;
+	uint m_GridZ;
+	uint m_LightCount;
+	// Size of a cluster on screen in pixels.
+	float m_TileWidth;
+	float m_TileHeight;
+	// The depth slice is log(view depth) * scale + bias.
+	float m_SliceScale;
+	float m_SliceBias;
+	float m_NearPlane;
+	float m_FarPlane;
+	// Offsets in 4 byte words to the (first index, count) pair of each cluster and to the light index list.
+	uint m_ClusterOffset;
+	uint m_IndexOffset;
+};
+
+// Counts from the last build.
+struct LightCullStats
+{
+	size_t m_LightCount = 0;
+	// Lights that touched at least one cluster.
+	size_t m_VisibleLightCount = 0;
+	// Entries in the light index list, and the most any one cluster has.
+	size_t m_IndexCount = 0;
+	size_t m_MaxClusterLights = 0;
+	// If the index list filled up and some cluster entries were dropped.
+	bool m_Overflowed = false;
+};
+
+// Bins lights into clusters for clustered forward shading.
+// The view frustum is split into a grid of tiles on screen and exponential slices in depth. Each light's
+// bounding sphere is tested against the view space boxes of the clusters in the slices it covers, 8 clusters
+// at a time, and every cluster gets a compact list of the lights touching it. The fragment shader finds its
+// cluster from its pixel and depth and only loops over those lights, so the cost per pixel follows how many
+// lights are nearby rather than how many there are. Uses AVX2 when the cpu has it, SSE otherwise.
+// The grid, lights and lists are written each frame to that frame in flight's buffer in the bindless table.
+class LightCuller
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the buffers with, which has the bindless table.
+	LightCuller(VulkanRenderer* renderer);
+	// Destructor.
+	~LightCuller();
+
+	// Set the camera's perspective projection, working out the clusters' view space boxes again if it changed.
+	// The projection is expected to put view space +y at the top of the screen and depth in 0 to 1.
+	// Params: vertical field of view in radians, aspect ratio, near and far plane distances.
+	void SetProjection(float fovY, float aspect, float nearPlane, float farPlane);
+
+	// Bin the lights into clusters and write them to this frame's buffer.
+	// Params: the lights, how many, the camera's view matrix, the frame in flight index.
+	// Returns: the bindless storage buffer index of the frame's light grid.
+	uint Build(const PointLight* lights, size_t lightCount, const glm::mat4& view, uint frameIndex);
+
+	// Get the counts from the last build.
+	// Returns: the stats.
+	const LightCullStats& GetStats() const { return m_Stats; }
+
+	// Tests a sphere against a range of cluster boxes and writes the indices of the ones it touches.
+	// Params: the box arrays as min x, y, z then max x, y, z, the sphere as view space x, y, depth and radius squared,
+	// first cluster (a multiple of 8), one past the last cluster, output array.
+	// Returns: how many clusters were written.
+	typedef size_t (*BinFunction)(const float* const* bounds, const float* sphere, size_t begin, size_t end, uint* clusters);
+
+private:
+	// Work out the depth slice a view depth is in.
+	// Params: the view depth.
+	// Returns: the slice, clamped to the grid.
+	uint GetSlice(float depth) const;
+
+	// The renderer the buffers were created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// One host visible buffer per frame in flight, mapped, and its index in the bindless table.
+	VkBuffer m_VkBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory m_VkMemory[MAX_FRAMES_IN_FLIGHT];
+	char* m_MappedData[MAX_FRAMES_IN_FLIGHT];
+	uint m_BindlessIndices[MAX_FRAMES_IN_FLIGHT];
+
+	// The projection the cluster boxes were worked out for.
+	float m_FovY = 0.0f;
+	float m_Aspect = 0.0f;
+	float m_NearPlane = 0.0f;
+	float m_FarPlane = 0.0f;
+
+	// View space box of every cluster, x fastest then y then depth slice. Depth is positive into the screen.
+	std::vector<float> m_MinX;
+	std::vector<float> m_MinY;
+	std::vector<float> m_MinZ;
+	std::vector<float> m_MaxX;
+	std::vector<float> m_MaxY;
+	std::vector<float> m_MaxZ;
+
+	// Clusters a light touches, from the bin kernel.
+	std::vector<uint> m_LightClusters;
+
+	// Every (cluster, light) pair found this build, in light order.
+	std::vector<uint> m_HitClusters;
+	std::vector<uint> m_HitLights;
+
+	// Lights in each cluster, then where each cluster's list starts.
+	std::vector<uint> m_ClusterCounts;
+	std::vector<uint> m_ClusterOffsets;
+
+	// The light index list, built here then copied to the buffer in one go.
+	std::vector<uint> m_Indices;
+
+	// The AVX2 or SSE kernel chosen for this cpu.
+	BinFunction m_Bin;
+
+	// Counts from the last build.
+	LightCullStats m_Stats;
+};
\ No newline at end of file
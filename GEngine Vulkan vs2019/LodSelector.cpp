@@ -0,0 +1,178 @@
+#include "LodSelector.h"
+#include "GameObject.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Objects per chunk when picking levels in parallel.
+static const size_t LOD_CHUNK_SIZE = 8 * 1024;
+
+// How far under the pixel error a coarser level has to be before objects move to it, and how far over a level has to
+// go before they move back to a finer one, as a fraction of the pixel error.
+static const float LOD_HYSTERESIS = 0.2f;
+
+// Closest an object's bounds are taken to be to the camera, so objects the camera is inside are drawn at full detail.
+static const float LOD_MIN_DISTANCE = 1e-4f;
+
+// Fades start a step in, so the level fading in is never drawn as if it weren't fading.
+static const float LOD_MIN_FADE = 1.0f / 64.0f;
+
+void LodSelector::Resize(size_t count)
+{
+	LodState state = {};
+	state.m_FadeLod = LOD_NONE;
+	m_States.resize(count, state);
+
+	m_FadingObjects.resize(count);
+	m_ChunkStats.resize((count + LOD_CHUNK_SIZE - 1) / LOD_CHUNK_SIZE);
+}
+
+void LodSelector::SetLods(const MeshLod* lods, uint count)
+{
+	m_LodCount = std::min(std::max(count, 1u), (uint)MESH_MAX_LODS);
+	memcpy(m_Lods, lods, m_LodCount * sizeof(MeshLod));
+}
+
+// Everything a selection chunk needs, passed through the job system's user data.
+struct LodJob
+{
+	GameObject* const* m_GameObjects;
+	const AABB* m_WorldBounds;
+	const uint* m_Objects;
+	LodState* m_States;
+	const MeshLod* m_Lods;
+	uint m_LodCount;
+	glm::vec3 m_CameraPosition;
+	float m_PixelScale;
+	float m_Threshold;
+	float m_FadeStep;
+	uint m_Selection;
+	uint* m_FadingObjects;
+	LodStats* m_ChunkStats;
+};
+
+static void RunLodJob(void* data, size_t begin, size_t end)
+{
+	LodJob* job = (LodJob*)data;
+	const MeshLod* lods = job->m_Lods;
+	uint lodCount = job->m_LodCount;
+	float finerThreshold = job->m_Threshold * (1.0f + LOD_HYSTERESIS);
+	float coarserThreshold = job->m_Threshold * (1.0f - LOD_HYSTERESIS);
+
+	// Each chunk writes its fading objects to its own part of the list, they get packed together afterwards.
+	LodStats& stats = job->m_ChunkStats[begin / LOD_CHUNK_SIZE];
+	stats = {};
+	uint* fadingObjects = job->m_FadingObjects + begin;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		uint object = job->m_Objects != nullptr ? job->m_Objects[i] : (uint)i;
+		LodState& state = job->m_States[object];
+
+		// The error is in the mesh's space, scale it by the object's largest axis.
+		const glm::mat4& world = job->m_GameObjects[object]->GetWorldMatrix();
+		float scale = std::max(std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))), glm::length(glm::vec3(world[2])));
+
+		// Distance to the nearest point of the sphere around the bounds.
+		const AABB& bounds = job->m_WorldBounds[object];
+		float distance = glm::length(bounds.GetCentre() - job->m_CameraPosition) - glm::length(bounds.GetExtents());
+		float pixelsPerUnit = job->m_PixelScale * scale / std::max(distance, LOD_MIN_DISTANCE);
+
+		uint current = std::min((uint)state.m_Lod, lodCount - 1);
+		bool continuing = state.m_LastSelection + 1 == job->m_Selection;
+		uint lod;
+		if (!continuing)
+		{
+			// Just come into view, go straight to the coarsest level under the pixel error.
+			lod = 0;
+			while (lod + 1 < lodCount && lods[lod + 1].m_Error * pixelsPerUnit <= job->m_Threshold)
+				++lod;
+		}
+		else
+		{
+			lod = current;
+			while (lod > 0 && lods[lod].m_Error * pixelsPerUnit > finerThreshold)
+				--lod;
+			if (lod == current)
+			{
+				while (lod + 1 < lodCount && lods[lod + 1].m_Error * pixelsPerUnit <= coarserThreshold)
+					++lod;
+			}
+		}
+
+		// A change of level restarts the fade from the level that was last drawn fully.
+		if (!continuing || job->m_FadeStep == 0.0f || state.m_FadeLod >= lodCount)
+			state.m_FadeLod = LOD_NONE;
+		if (continuing && job->m_FadeStep != 0.0f && lod != current)
+		{
+			state.m_FadeLod = (uint8_t)current;
+			state.m_Fade = 0.0f;
+		}
+
+		if (state.m_FadeLod != LOD_NONE)
+		{
+			state.m_Fade = std::max(state.m_Fade + job->m_FadeStep, LOD_MIN_FADE);
+			if (state.m_Fade >= 1.0f)
+				state.m_FadeLod = LOD_NONE;
+		}
+
+		state.m_Lod = (uint8_t)lod;
+		state.m_LastSelection = job->m_Selection;
+
+		++stats.m_ObjectCounts[lod];
+		stats.m_TriangleCount += lods[lod].m_IndexCount / 3;
+		stats.m_FullDetailTriangleCount += lods[0].m_IndexCount / 3;
+		if (state.m_FadeLod != LOD_NONE)
+		{
+			fadingObjects[stats.m_FadingCount++] = object;
+			stats.m_TriangleCount += lods[state.m_FadeLod].m_IndexCount / 3;
+		}
+	}
+}
+
+void LodSelector::Select(GameObject* const* gameObjects, const AABB* worldBounds, const uint* objects, size_t count, float deltaTime, JobSystem* jobSystem)
+{
+	++m_Selection;
+
+	LodJob job;
+	job.m_GameObjects = gameObjects;
+	job.m_WorldBounds = worldBounds;
+	job.m_Objects = objects;
+	job.m_States = m_States.data();
+	job.m_Lods = m_Lods;
+	job.m_LodCount = m_LodCount;
+	job.m_CameraPosition = m_CameraPosition;
+	job.m_PixelScale = m_PixelScale;
+	job.m_Threshold = m_PixelError * std::exp2(-m_QualityBias);
+	job.m_FadeStep = m_FadeTime > 0.0f ? deltaTime / m_FadeTime : 0.0f;
+	job.m_Selection = m_Selection;
+	job.m_FadingObjects = m_FadingObjects.data();
+	job.m_ChunkStats = m_ChunkStats.data();
+
+	m_Stats = {};
+	if (count == 0)
+		return;
+
+	if (count <= LOD_CHUNK_SIZE || jobSystem == nullptr || jobSystem->GetThreadCount() == 1)
+		RunLodJob(&job, 0, count);
+	else
+		jobSystem->ParallelFor(count, LOD_CHUNK_SIZE, RunLodJob, &job);
+
+	// Add up the chunks and pack their fading objects down. Each chunk's list starts at or after where the packed list
+	// ends, so moving forward is safe.
+	size_t chunkCount = (count + LOD_CHUNK_SIZE - 1) / LOD_CHUNK_SIZE;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const LodStats& stats = m_ChunkStats[chunk];
+		for (uint lod = 0; lod < MESH_MAX_LODS; ++lod)
+			m_Stats.m_ObjectCounts[lod] += stats.m_ObjectCounts[lod];
+
+		if (chunk != 0)
+			memmove(m_FadingObjects.data() + m_Stats.m_FadingCount, m_FadingObjects.data() + chunk * LOD_CHUNK_SIZE, stats.m_FadingCount * sizeof(uint));
+
+		m_Stats.m_FadingCount += stats.m_FadingCount;
+		m_Stats.m_TriangleCount += stats.m_TriangleCount;
+		m_Stats.m_FullDetailTriangleCount += stats.m_FullDetailTriangleCount;
+	}
+}
\ No newline at end of file
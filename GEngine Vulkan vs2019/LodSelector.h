@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+class GameObject;
+class JobSystem;
+
+// Level of detail used for "not fading".
+#define LOD_NONE 0xFF
+
+// The level of detail an object is drawn at, and the one it's fading out from.
+struct LodState
+{
+	uint8_t m_Lod;
+	// Level being faded out while m_Lod fades in, or LOD_NONE.
+	uint8_t m_FadeLod;
+	// How far through the fade, from 0 to 1.
+	float m_Fade;
+	// Selection the object was last picked on, to tell objects that have just come into view.
+	uint m_LastSelection;
+};
+
+// Counts from the last selection.
+struct LodStats
+{
+	// Objects at each level of detail.
+	uint m_ObjectCounts[MESH_MAX_LODS];
+	// Objects fading between two levels, which are drawn at both.
+	uint m_FadingCount;
+	// Triangles in the levels picked, and how many there would be at full detail.
+	size_t m_TriangleCount;
+	size_t m_FullDetailTriangleCount;
+};
+
+// Picks the level of detail each object is drawn at from how far out its error would be on screen.
+// A level's error is scaled by the object's size and divided by the distance to the nearest point of its bounds, giving
+// the pixels its surface could be out by, and the coarsest level under the pixel error is picked. Objects only move to
+// a coarser level once it's a margin under the pixel error, and back to a finer one once they're a margin over, so
+// objects sitting on the line don't flicker between levels as the camera moves. Objects that have just come into view
+// go straight to their level.
+// With a fade time, changes of level cross-fade: both levels are drawn, each discarding the pixels the other keeps in a
+// screen space dither, so the switch doesn't pop. The quality bias scales the pixel error in powers of two for the
+// performance tiers, -1 allowing twice the error and +1 half.
+class LodSelector
+{
+public:
+	// Set the amount of objects. New objects start at full detail.
+	// Params: the object count.
+	void Resize(size_t count);
+
+	// Set the levels of detail of the mesh the objects are drawn with.
+	// Params: the levels, the full detail one first, amount of levels.
+	void SetLods(const MeshLod* lods, uint count);
+
+	// Set the camera levels are picked for.
+	// Params: the camera's world position, the pixels one unit covers one unit in front of it: the screen's height over
+	//         twice the tangent of half the vertical field of view.
+	void SetCamera(const glm::vec3& position, float pixelScale) { m_CameraPosition = position; m_PixelScale = pixelScale; }
+
+	// Set how many pixels a level's error can cover on screen.
+	// Params: the pixel error.
+	void SetPixelError(float pixels) { m_PixelError = pixels; }
+
+	// Set the quality bias, which halves the pixel error for each step up.
+	// Params: the bias, 0 for none.
+	void SetQualityBias(float bias) { m_QualityBias = bias; }
+
+	// Get the quality bias.
+	// Returns: the bias.
+	float GetQualityBias() const { return m_QualityBias; }
+
+	// Set how long changes of level cross-fade for.
+	// Params: the fade time in seconds, 0 to switch straight away.
+	void SetFadeTime(float seconds) { m_FadeTime = seconds; }
+
+	// Pick the level of detail of some objects and move their fades on.
+	// Params: every game object by scene index, world bounds of every object, scene indices of the objects to pick for
+	//         or nullptr for every object, how many objects, seconds since the last selection, the job system to spread
+	//         the work over.
+	void Select(GameObject* const* gameObjects, const AABB* worldBounds, const uint* objects, size_t count, float deltaTime, JobSystem* jobSystem);
+
+	// Get an object's level of detail from the last selection it was in.
+	// Params: the scene index.
+	// Returns: the state.
+	const LodState& GetState(uint index) const { return m_States[index]; }
+
+	// Get every object's state, by scene index.
+	// Returns: the states.
+	const LodState* GetStates() const { return m_States.data(); }
+
+	// Get the scene indices of the objects fading between levels after the last selection.
+	// Returns: the objects, GetFadingCount() of them.
+	const uint* GetFadingObjects() const { return m_FadingObjects.data(); }
+
+	// Get the amount of objects fading between levels after the last selection.
+	// Returns: the fading count.
+	size_t GetFadingCount() const { return m_Stats.m_FadingCount; }
+
+	// Get the counts from the last selection.
+	// Returns: the stats.
+	const LodStats& GetStats() const { return m_Stats; }
+
+private:
+	// Every object's level, by scene index.
+	std::vector<LodState> m_States;
+
+	// The mesh's levels of detail.
+	MeshLod m_Lods[MESH_MAX_LODS];
+	uint m_LodCount = 1;
+
+	glm::vec3 m_CameraPosition = glm::vec3(0.0f);
+	float m_PixelScale = 0.0f;
+	float m_PixelError = 1.0f;
+	float m_QualityBias = 0.0f;
+	float m_FadeTime = 0.0f;
+
+	// Counts up each selection.
+	uint m_Selection = 1;
+
+	// Objects fading, each chunk's starting at its first object's position in the list, packed down after.
+	std::vector<uint> m_FadingObjects;
+
+	// Stats of each chunk, added up after.
+	std::vector<LodStats> m_ChunkStats;
+
+	// Counts from the last selection.
+	LodStats m_Stats = {};
+};
\ No newline at end of file
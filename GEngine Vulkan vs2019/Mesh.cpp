@@ -0,0 +1,88 @@
+#include "Mesh.h"
+#include <fstream>
+#include <stdexcept>
+
+// "GMSH", the first four bytes of a .gmesh file.
+static const uint MESH_FILE_MAGIC = 0x48534D47;
+// Bumped whenever the layout of the file changes, so old files are recooked instead of misread.
+static const uint MESH_FILE_VERSION = 3;
+
+// Start of a .gmesh file. The sub meshes, meshlets, levels of detail, vertices and indices follow, in that order.
+struct MeshFileHeader
+{
+	uint m_Magic;
+	uint m_Version;
+	uint m_VertexCount;
+	uint m_IndexCount;
+	uint m_SubMeshCount;
+	uint m_MeshletCount;
+	uint m_LodCount;
+	glm::vec3 m_BoundsMin;
+	glm::vec3 m_BoundsMax;
+};
+
+void Mesh::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open mesh file for writing!");
+
+	MeshFileHeader header;
+	header.m_Magic = MESH_FILE_MAGIC;
+	header.m_Version = MESH_FILE_VERSION;
+	header.m_VertexCount = (uint)m_Vertices.size();
+	header.m_IndexCount = (uint)m_Indices.size();
+	header.m_SubMeshCount = (uint)m_SubMeshes.size();
+	header.m_MeshletCount = (uint)m_Meshlets.size();
+	header.m_LodCount = (uint)m_Lods.size();
+	header.m_BoundsMin = m_Bounds.m_Min;
+	header.m_BoundsMax = m_Bounds.m_Max;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)m_SubMeshes.data(), m_SubMeshes.size() * sizeof(SubMesh));
+	file.write((const char*)m_Meshlets.data(), m_Meshlets.size() * sizeof(Meshlet));
+	file.write((const char*)m_Lods.data(), m_Lods.size() * sizeof(MeshLod));
+	file.write((const char*)m_Vertices.data(), m_Vertices.size() * sizeof(MeshVertex));
+	file.write((const char*)m_Indices.data(), m_Indices.size() * sizeof(uint));
+
+	if (!file.good())
+		throw std::runtime_error("Failed to write mesh file!");
+}
+
+void Mesh::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open mesh file!");
+
+	MeshFileHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() || header.m_Magic != MESH_FILE_MAGIC)
+		throw std::runtime_error("Failed to load mesh, not a mesh file!");
+	if (header.m_Version != MESH_FILE_VERSION)
+		throw std::runtime_error("Failed to load mesh, it needs to be cooked again!");
+
+	m_SubMeshes.resize(header.m_SubMeshCount);
+	m_Meshlets.resize(header.m_MeshletCount);
+	m_Lods.resize(header.m_LodCount);
+	m_Vertices.resize(header.m_VertexCount);
+	m_Indices.resize(header.m_IndexCount);
+	m_Bounds.m_Min = header.m_BoundsMin;
+	m_Bounds.m_Max = header.m_BoundsMax;
+
+	file.read((char*)m_SubMeshes.data(), m_SubMeshes.size() * sizeof(SubMesh));
+	file.read((char*)m_Meshlets.data(), m_Meshlets.size() * sizeof(Meshlet));
+	file.read((char*)m_Lods.data(), m_Lods.size() * sizeof(MeshLod));
+	file.read((char*)m_Vertices.data(), m_Vertices.size() * sizeof(MeshVertex));
+	file.read((char*)m_Indices.data(), m_Indices.size() * sizeof(uint));
+
+	if (!file.good())
+		throw std::runtime_error("Failed to load mesh, the file is cut short!");
+}
+
+void Mesh::ComputeBounds()
+{
+	m_Bounds = AABB::Empty();
+	for (const MeshVertex& vertex : m_Vertices)
+		m_Bounds.Grow(vertex.m_Position);
+}
\ No newline at end of file
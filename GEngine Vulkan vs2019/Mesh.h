@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Bounds.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Most levels of detail a mesh can have, including the full detail one.
+#define MESH_MAX_LODS 8
+
+// A vertex as it's imported and cooked, before it's packed for the GPU.
+struct MeshVertex
+{
+	glm::vec3 m_Position;
+	glm::vec3 m_Normal;
+	// Tangent, with the sign of the bitangent in w.
+	glm::vec4 m_Tangent;
+	glm::vec2 m_UV;
+};
+
+// A range of a mesh's triangles drawn with one material.
+struct SubMesh
+{
+	uint m_FirstIndex;
+	uint m_IndexCount;
+	uint m_MaterialIndex;
+};
+
+// A cluster of up to MESHLET_MAX_TRIANGLES triangles from one sub mesh, touching up to MESHLET_MAX_VERTICES vertices,
+// small enough to be culled on its own. Its triangles are a range of the mesh's indices. Laid out like the meshlet
+// buffer the cluster cull shader reads.
+struct Meshlet
+{
+	// Sphere around the triangles, centre in xyz and radius in w.
+	glm::vec4 m_CentreRadius;
+	// Average direction the triangles face in xyz. In w, the sine of the widest angle between it and a triangle's normal,
+	// which the direction to the camera has to be within for every triangle to face away. 1 if the cone is too wide to cull.
+	glm::vec4 m_ConeAxisCutoff;
+	// Where the cone starts, behind every triangle's plane.
+	glm::vec3 m_ConeApex;
+	uint m_FirstIndex;
+	uint m_TriangleCount;
+	uint m_VertexCount;
+	uint m_SubMesh;
+	uint m_Padding;
+};
+
+// A level of detail of a mesh, with sub meshes of its own. Its indices and meshlets are ranges of the mesh's, after the
+// finer levels'. Laid out like the LOD buffer the cull shaders read.
+struct MeshLod
+{
+	uint m_FirstSubMesh;
+	uint m_SubMeshCount;
+	uint m_FirstIndex;
+	uint m_IndexCount;
+	uint m_FirstMeshlet;
+	uint m_MeshletCount;
+	// How far the level's surface is from the full detail mesh's, as the MeshSimplifier measures it, in the mesh's space.
+	// 0 for the full detail level.
+	float m_Error;
+	uint m_Padding;
+};
+
+// A mesh in the engine's runtime format: an indexed triangle list split into sub meshes that share one vertex array.
+// Meshes are imported and optimised offline by the MeshCooker and saved as .gmesh files, which load straight into
+// this without any parsing or processing.
+struct Mesh
+{
+	// Save the mesh to a .gmesh file.
+	// Params: the file path.
+	void Save(const std::string& path) const;
+
+	// Load a mesh from a .gmesh file, replacing this one.
+	// Params: the file path.
+	void Load(const std::string& path);
+
+	// Recompute the bounds from the vertices.
+	void ComputeBounds();
+
+	std::vector<MeshVertex> m_Vertices;
+	std::vector<uint> m_Indices;
+	// The sub meshes of every level of detail, the full detail ones first.
+	std::vector<SubMesh> m_SubMeshes;
+	// Empty unless the MeshletBuilder has split the sub meshes up.
+	std::vector<Meshlet> m_Meshlets;
+	// Empty unless the mesh went through the MeshSimplifier, in which case the first is the full detail mesh.
+	std::vector<MeshLod> m_Lods;
+	AABB m_Bounds = AABB::Empty();
+};
\ No newline at end of file
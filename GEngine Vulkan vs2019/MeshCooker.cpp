@@ -0,0 +1,113 @@
+#include "MeshCooker.h"
+#include "MeshImporter.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "JobSystem.h"
+#include "VertexLayout.h"
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include <algorithm>
+
+MeshCooker::MeshCooker(JobSystem* jobSystem)
+{
+	m_JobSystem = jobSystem;
+}
+
+bool MeshCooker::Cook(const std::vector<std::string>& paths)
+{
+	std::vector<CookResult> results(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
+		results[i].m_Path = paths[i];
+
+	// Each file is a lot of work, so they're handed out one at a time.
+	m_JobSystem->ParallelFor(results.size(), 1, CookFiles, results.data());
+
+	bool succeeded = true;
+	for (const CookResult& result : results)
+	{
+		PrintResult(result);
+		succeeded = succeeded && result.m_Error.empty();
+	}
+
+	return succeeded;
+}
+
+std::string MeshCooker::GetCookedPath(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos)
+		return path + ".gmesh";
+	return path.substr(0, dot) + ".gmesh";
+}
+
+void MeshCooker::CookFiles(void* data, size_t begin, size_t end)
+{
+	CookResult* results = (CookResult*)data;
+
+	MeshImporter importer;
+	Mesh mesh;
+	for (size_t i = begin; i < end; ++i)
+	{
+		CookResult& result = results[i];
+		try
+		{
+			importer.Import(result.m_Path, mesh);
+			result.m_Before = MeshOptimizer::AnalyseVertexCache(mesh.m_Indices.data(), mesh.m_Indices.size(), mesh.m_Vertices.size());
+
+			// The levels of detail are sub meshes of their own, so they're optimised along with the full detail ones.
+			MeshSimplifier::BuildLods(mesh);
+			MeshOptimizer::Optimise(mesh);
+			result.m_Optimised = MeshOptimizer::AnalyseVertexCache(mesh.m_Indices.data(), mesh.m_Lods[0].m_IndexCount, mesh.m_Vertices.size());
+
+			// Meshlets regroup the triangles of their sub mesh, which loses most of the cache order, so each meshlet's triangles
+			// are ordered again. The meshlets' own order replaces the overdraw order, as they're culled and drawn on their own.
+			// Then vertices are put back in the order they're first used.
+			MeshletBuilder::Build(mesh);
+			MeshOptimizer::OptimiseMeshlets(mesh);
+			MeshOptimizer::OptimiseVertexFetch(mesh);
+			result.m_After = MeshOptimizer::AnalyseVertexCache(mesh.m_Indices.data(), mesh.m_Lods[0].m_IndexCount, mesh.m_Vertices.size());
+
+			mesh.Save(GetCookedPath(result.m_Path));
+
+			result.m_ImportedVertexCount = importer.GetImportedVertexCount();
+			result.m_VertexCount = mesh.m_Vertices.size();
+			result.m_TriangleCount = mesh.m_Lods[0].m_IndexCount / 3;
+			result.m_Lods = mesh.m_Lods;
+			result.m_SubMeshCount = mesh.m_Lods[0].m_SubMeshCount;
+			result.m_MeshletCount = mesh.m_Lods[0].m_MeshletCount;
+		}
+		catch (const std::exception& e)
+		{
+			result.m_Error = e.what();
+		}
+	}
+}
+
+void MeshCooker::PrintResult(const CookResult& result)
+{
+	if (!result.m_Error.empty())
+	{
+		std::cerr << result.m_Path << ": " << result.m_Error << std::endl;
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(3) << result.m_Path << ": " << result.m_ImportedVertexCount << " vertices deduplicated to "
+		<< result.m_VertexCount << ", " << result.m_TriangleCount << " triangles in " << result.m_SubMeshCount << " sub meshes, " << result.m_MeshletCount << " meshlets, ACMR "
+		<< result.m_Before.m_ACMR << " to " << result.m_Optimised.m_ACMR << " optimised and " << result.m_After.m_ACMR << " in meshlets, ATVR "
+		<< result.m_Before.m_ATVR << " to " << result.m_Optimised.m_ATVR << " optimised and " << result.m_After.m_ATVR << " in meshlets"
+		<< std::defaultfloat << std::endl;
+
+	// What the vertices take up in each format, against plain floats.
+	size_t floatSize = result.m_VertexCount * VertexLayout::Get(VERTEX_FORMAT_FLOAT).m_Stride;
+	size_t octahedral16Size = result.m_VertexCount * VertexLayout::Get(VERTEX_FORMAT_OCTAHEDRAL_16).m_Stride;
+	size_t octahedral8Size = result.m_VertexCount * VertexLayout::Get(VERTEX_FORMAT_OCTAHEDRAL_8).m_Stride;
+	std::cout << "  levels of detail";
+	for (const MeshLod& lod : result.m_Lods)
+		std::cout << (&lod == &result.m_Lods[0] ? " " : ", ") << lod.m_IndexCount / 3 << " triangles at error " << lod.m_Error;
+	std::cout << std::endl;
+
+	std::cout << "  vertex memory " << floatSize << " bytes as floats, " << octahedral16Size << " octahedral 16 ("
+		<< 100 - octahedral16Size * 100 / std::max<size_t>(floatSize, 1) << "% less), " << octahedral8Size << " octahedral 8 ("
+		<< 100 - octahedral8Size * 100 / std::max<size_t>(floatSize, 1) << "% less)" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include "MeshOptimizer.h"
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// Offline tool that imports mesh files, simplifies them into levels of detail, optimises them, splits them into meshlets
+// and saves them in the runtime format as .gmesh files next to their sources. Files are cooked in parallel over the job
+// system, one per job, and a line of stats is printed for each once they're all done, in the order they were given.
+class MeshCooker
+{
+public:
+	// Constructor.
+	// Params: the job system to spread the files over.
+	MeshCooker(JobSystem* jobSystem);
+
+	// Cook mesh files.
+	// Params: the source file paths.
+	// Returns: if every file cooked.
+	bool Cook(const std::vector<std::string>& paths);
+
+	// Get the path a source file is cooked to.
+	// Params: the source file path.
+	// Returns: the path with its extension replaced by .gmesh.
+	static std::string GetCookedPath(const std::string& path);
+
+private:
+	// What happened to one file.
+	struct CookResult
+	{
+		std::string m_Path;
+		// Empty if the file cooked.
+		std::string m_Error;
+		size_t m_ImportedVertexCount;
+		size_t m_VertexCount;
+		size_t m_TriangleCount;
+		size_t m_SubMeshCount;
+		size_t m_MeshletCount;
+		std::vector<MeshLod> m_Lods;
+		// Cache stats as imported, once optimised, and once split into meshlets with each meshlet optimised again.
+		VertexCacheStats m_Before;
+		VertexCacheStats m_Optimised;
+		VertexCacheStats m_After;
+	};
+
+	// Cook a range of files.
+	static void CookFiles(void* data, size_t begin, size_t end);
+
+	// Print a file's stats, or why it failed.
+	// Params: the result.
+	static void PrintResult(const CookResult& result);
+
+	// The job system files are spread over.
+	JobSystem* m_JobSystem;
+};
\ No newline at end of file
@@ -0,0 +1,797 @@
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "Json.h"
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+// glTF accessor component types.
+static const int GLTF_BYTE = 5120;
+static const int GLTF_UNSIGNED_BYTE = 5121;
+static const int GLTF_SHORT = 5122;
+static const int GLTF_UNSIGNED_SHORT = 5123;
+static const int GLTF_UNSIGNED_INT = 5125;
+static const int GLTF_FLOAT = 5126;
+// glTF primitive mode for triangle lists, the only one imported.
+static const int GLTF_TRIANGLES = 4;
+// "glTF", "JSON" and "BIN", the magic numbers of a .glb file and its chunks.
+static const uint GLB_MAGIC = 0x46546C67;
+static const uint GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint GLB_CHUNK_BIN = 0x004E4942;
+
+// A glTF file's JSON and the buffers it points into.
+struct GltfFile
+{
+	JsonValue m_Json;
+	std::vector<std::vector<uint8_t>> m_Buffers;
+};
+
+// Where an accessor's elements are in its buffer.
+struct GltfAccessor
+{
+	// The first element, or nullptr if the accessor has no buffer view and is all zeros.
+	const uint8_t* m_Data;
+	size_t m_Count;
+	size_t m_Stride;
+	size_t m_ComponentCount;
+	size_t m_ComponentSize;
+	int m_ComponentType;
+	bool m_Normalized;
+};
+
+static std::vector<char> ReadWholeFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open mesh file!");
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> data(fileSize);
+	file.seekg(0);
+	file.read(data.data(), fileSize);
+	return data;
+}
+
+static std::string GetExtension(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos)
+		return "";
+
+	std::string extension = path.substr(dot + 1);
+	for (char& c : extension)
+		c = (char)tolower((unsigned char)c);
+	return extension;
+}
+
+static std::string GetDirectory(const std::string& path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+static void DecodeBase64(const char* text, size_t length, std::vector<uint8_t>& data)
+{
+	uint bits = 0;
+	int bitCount = 0;
+	for (size_t i = 0; i < length && text[i] != '='; ++i)
+	{
+		char c = text[i];
+		uint value;
+		if (c >= 'A' && c <= 'Z')
+			value = c - 'A';
+		else if (c >= 'a' && c <= 'z')
+			value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9')
+			value = c - '0' + 52;
+		else if (c == '+')
+			value = 62;
+		else if (c == '/')
+			value = 63;
+		else
+			throw std::runtime_error("Failed to import glTF, a data URI isn't valid base64!");
+
+		bits = (bits << 6) | value;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			data.push_back((uint8_t)(bits >> bitCount));
+		}
+	}
+}
+
+// Get a JSON value as an index into one of the file's arrays.
+static size_t ToIndex(const JsonValue& value)
+{
+	if (value.GetType() != JsonValue::JSON_NUMBER || value.GetNumber() < 0.0)
+		throw std::runtime_error("Failed to import glTF, an index isn't valid!");
+	return (size_t)value.GetNumber();
+}
+
+// Get an element of one of the file's top level arrays, checking it's there.
+static const JsonValue& GetElement(const JsonValue& root, const char* array, size_t index)
+{
+	const JsonValue* values = root.Find(array);
+	if (values == nullptr || values->GetType() != JsonValue::JSON_ARRAY || index >= values->GetSize())
+		throw std::runtime_error("Failed to import glTF, an index is out of range!");
+	return (*values)[index];
+}
+
+static GltfAccessor GetAccessor(const GltfFile& file, size_t accessorIndex)
+{
+	const JsonValue& accessor = GetElement(file.m_Json, "accessors", accessorIndex);
+	if (accessor.Find("sparse") != nullptr)
+		throw std::runtime_error("Failed to import glTF, sparse accessors aren't supported!");
+
+	GltfAccessor result{};
+	result.m_Count = (size_t)accessor.GetNumber("count", 0.0);
+	result.m_ComponentType = (int)accessor.GetNumber("componentType", 0.0);
+	const JsonValue* normalized = accessor.Find("normalized");
+	result.m_Normalized = normalized != nullptr && normalized->GetBool();
+
+	const JsonValue* type = accessor.Find("type");
+	std::string typeName = type != nullptr ? type->GetString() : "";
+	if (typeName == "SCALAR")
+		result.m_ComponentCount = 1;
+	else if (typeName == "VEC2")
+		result.m_ComponentCount = 2;
+	else if (typeName == "VEC3")
+		result.m_ComponentCount = 3;
+	else if (typeName == "VEC4")
+		result.m_ComponentCount = 4;
+	else
+		throw std::runtime_error("Failed to import glTF, an accessor type isn't supported!");
+
+	switch (result.m_ComponentType)
+	{
+	case GLTF_BYTE:
+	case GLTF_UNSIGNED_BYTE:
+		result.m_ComponentSize = 1;
+		break;
+	case GLTF_SHORT:
+	case GLTF_UNSIGNED_SHORT:
+		result.m_ComponentSize = 2;
+		break;
+	case GLTF_UNSIGNED_INT:
+	case GLTF_FLOAT:
+		result.m_ComponentSize = 4;
+		break;
+	default:
+		throw std::runtime_error("Failed to import glTF, an accessor component type isn't supported!");
+	}
+
+	const JsonValue* viewIndex = accessor.Find("bufferView");
+	if (viewIndex == nullptr)
+		return result;
+
+	const JsonValue& view = GetElement(file.m_Json, "bufferViews", ToIndex(*viewIndex));
+	const JsonValue* bufferIndex = view.Find("buffer");
+	if (bufferIndex == nullptr || ToIndex(*bufferIndex) >= file.m_Buffers.size())
+		throw std::runtime_error("Failed to import glTF, a buffer view's buffer doesn't exist!");
+
+	const std::vector<uint8_t>& buffer = file.m_Buffers[ToIndex(*bufferIndex)];
+	size_t viewOffset = (size_t)view.GetNumber("byteOffset", 0.0);
+	size_t viewLength = (size_t)view.GetNumber("byteLength", 0.0);
+	size_t offset = (size_t)accessor.GetNumber("byteOffset", 0.0);
+	size_t elementSize = result.m_ComponentCount * result.m_ComponentSize;
+	result.m_Stride = (size_t)view.GetNumber("byteStride", 0.0);
+	if (result.m_Stride == 0)
+		result.m_Stride = elementSize;
+
+	if (viewOffset + viewLength > buffer.size() ||
+		(result.m_Count > 0 && offset + result.m_Stride * (result.m_Count - 1) + elementSize > viewLength))
+		throw std::runtime_error("Failed to import glTF, an accessor runs past the end of its buffer!");
+
+	result.m_Data = buffer.data() + viewOffset + offset;
+	return result;
+}
+
+static float ReadComponent(const uint8_t* data, int componentType, bool normalized)
+{
+	switch (componentType)
+	{
+	case GLTF_BYTE:
+	{
+		int8_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? std::max(value / 127.0f, -1.0f) : (float)value;
+	}
+	case GLTF_UNSIGNED_BYTE:
+		return normalized ? data[0] / 255.0f : (float)data[0];
+	case GLTF_SHORT:
+	{
+		int16_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+	}
+	case GLTF_UNSIGNED_SHORT:
+	{
+		uint16_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? value / 65535.0f : (float)value;
+	}
+	case GLTF_UNSIGNED_INT:
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return (float)value;
+	}
+	default:
+	{
+		float value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+	}
+}
+
+// Read an accessor's elements as floats.
+// Params: the file, the accessor index, components to read per element, with missing ones left at 0, vector to fill.
+// Returns: the element count.
+static size_t ReadFloats(const GltfFile& file, size_t accessorIndex, size_t componentCount, std::vector<float>& values)
+{
+	GltfAccessor accessor = GetAccessor(file, accessorIndex);
+	values.assign(accessor.m_Count * componentCount, 0.0f);
+	if (accessor.m_Data == nullptr)
+		return accessor.m_Count;
+
+	size_t readCount = std::min(componentCount, accessor.m_ComponentCount);
+	for (size_t i = 0; i < accessor.m_Count; ++i)
+	{
+		const uint8_t* element = accessor.m_Data + i * accessor.m_Stride;
+		for (size_t c = 0; c < readCount; ++c)
+			values[i * componentCount + c] = ReadComponent(element + c * accessor.m_ComponentSize, accessor.m_ComponentType, accessor.m_Normalized);
+	}
+
+	return accessor.m_Count;
+}
+
+static void ReadIndices(const GltfFile& file, size_t accessorIndex, std::vector<uint>& indices)
+{
+	GltfAccessor accessor = GetAccessor(file, accessorIndex);
+	if (accessor.m_ComponentCount != 1 || accessor.m_Data == nullptr ||
+		(accessor.m_ComponentType != GLTF_UNSIGNED_BYTE && accessor.m_ComponentType != GLTF_UNSIGNED_SHORT && accessor.m_ComponentType != GLTF_UNSIGNED_INT))
+		throw std::runtime_error("Failed to import glTF, an index accessor isn't valid!");
+
+	indices.resize(accessor.m_Count);
+	for (size_t i = 0; i < accessor.m_Count; ++i)
+	{
+		const uint8_t* element = accessor.m_Data + i * accessor.m_Stride;
+		if (accessor.m_ComponentType == GLTF_UNSIGNED_BYTE)
+		{
+			indices[i] = element[0];
+		}
+		else if (accessor.m_ComponentType == GLTF_UNSIGNED_SHORT)
+		{
+			uint16_t index;
+			memcpy(&index, element, sizeof(index));
+			indices[i] = index;
+		}
+		else
+		{
+			memcpy(&indices[i], element, sizeof(uint));
+		}
+	}
+}
+
+// Normalise a vector, leaving zero length ones at zero.
+static glm::vec3 SafeNormalize(const glm::vec3& vector)
+{
+	float length = glm::length(vector);
+	return length > 0.0f ? vector / length : glm::vec3(0.0f);
+}
+
+// Resolve an OBJ index, which counts from 1, or back from the last element read if it's negative.
+static size_t ResolveObjIndex(long index, size_t count)
+{
+	long long resolved = index > 0 ? (long long)index - 1 : (long long)count + index;
+	if (index == 0 || resolved < 0 || resolved >= (long long)count)
+		throw std::runtime_error("Failed to import OBJ, a face uses an element that doesn't exist!");
+	return (size_t)resolved;
+}
+
+static bool IsObjKeyword(const char* line, const char* keyword)
+{
+	size_t length = strlen(keyword);
+	return strncmp(line, keyword, length) == 0 && (line[length] == ' ' || line[length] == '\t');
+}
+
+void MeshImporter::Import(const std::string& path, Mesh& mesh)
+{
+	mesh = Mesh();
+
+	std::string extension = GetExtension(path);
+	if (extension == "obj")
+		ImportObj(path, mesh);
+	else if (extension == "gltf" || extension == "glb")
+		ImportGltf(path, mesh);
+	else
+		throw std::runtime_error("Failed to import mesh, the file type isn't supported!");
+
+	if (mesh.m_Indices.empty())
+		throw std::runtime_error("Failed to import mesh, it has no triangles!");
+
+	m_ImportedVertexCount = mesh.m_Vertices.size();
+	MeshOptimizer::DeduplicateVertices(mesh);
+	GenerateNormals(mesh);
+	GenerateTangents(mesh);
+	mesh.ComputeBounds();
+}
+
+void MeshImporter::ImportObj(const std::string& path, Mesh& mesh)
+{
+	std::vector<char> text = ReadWholeFile(path);
+	text.push_back('\0');
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+
+	// Faces are gathered per material, in the order materials are first used, after the faces before any usemtl.
+	// Materials are numbered in that order, skipping the faces before usemtl if there aren't any.
+	std::vector<std::string> materialNames(1);
+	std::vector<std::vector<uint>> materialIndices(1);
+	size_t material = 0;
+
+	std::vector<uint> faceVertices;
+	char* line = text.data();
+	while (*line != '\0')
+	{
+		char* lineEnd = line + strcspn(line, "\r\n");
+		char* nextLine = *lineEnd != '\0' ? lineEnd + 1 : lineEnd;
+		*lineEnd = '\0';
+
+		while (*line == ' ' || *line == '\t')
+			++line;
+
+		if (IsObjKeyword(line, "v"))
+		{
+			glm::vec3 position;
+			char* cursor = line + 1;
+			for (int i = 0; i < 3; ++i)
+				position[i] = strtof(cursor, &cursor);
+			positions.push_back(position);
+		}
+		else if (IsObjKeyword(line, "vn"))
+		{
+			glm::vec3 normal;
+			char* cursor = line + 2;
+			for (int i = 0; i < 3; ++i)
+				normal[i] = strtof(cursor, &cursor);
+			normals.push_back(SafeNormalize(normal));
+		}
+		else if (IsObjKeyword(line, "vt"))
+		{
+			// OBJ puts v = 0 at the bottom of the texture, Vulkan at the top.
+			char* cursor = line + 2;
+			float u = strtof(cursor, &cursor);
+			float v = strtof(cursor, &cursor);
+			uvs.push_back(glm::vec2(u, 1.0f - v));
+		}
+		else if (IsObjKeyword(line, "usemtl"))
+		{
+			char* name = line + 6;
+			name += strspn(name, " \t");
+			std::string materialName(name);
+			materialName.erase(materialName.find_last_not_of(" \t") + 1);
+
+			material = std::find(materialNames.begin(), materialNames.end(), materialName) - materialNames.begin();
+			if (material == materialNames.size())
+			{
+				materialNames.push_back(materialName);
+				materialIndices.emplace_back();
+			}
+		}
+		else if (IsObjKeyword(line, "f"))
+		{
+			// Each corner is its own vertex for now, deduplicating afterwards merges the ones that match.
+			faceVertices.clear();
+			char* cursor = line + 1;
+			while (true)
+			{
+				cursor += strspn(cursor, " \t");
+				if (*cursor == '\0')
+					break;
+
+				MeshVertex vertex{};
+				vertex.m_Position = positions[ResolveObjIndex(strtol(cursor, &cursor, 10), positions.size())];
+				if (*cursor == '/')
+				{
+					++cursor;
+					if (*cursor != '/')
+						vertex.m_UV = uvs[ResolveObjIndex(strtol(cursor, &cursor, 10), uvs.size())];
+					if (*cursor == '/')
+					{
+						++cursor;
+						vertex.m_Normal = normals[ResolveObjIndex(strtol(cursor, &cursor, 10), normals.size())];
+					}
+				}
+
+				if (*cursor != '\0' && *cursor != ' ' && *cursor != '\t')
+					throw std::runtime_error("Failed to import OBJ, a face isn't valid!");
+
+				faceVertices.push_back((uint)mesh.m_Vertices.size());
+				mesh.m_Vertices.push_back(vertex);
+			}
+
+			for (size_t i = 2; i < faceVertices.size(); ++i)
+			{
+				materialIndices[material].push_back(faceVertices[0]);
+				materialIndices[material].push_back(faceVertices[i - 1]);
+				materialIndices[material].push_back(faceVertices[i]);
+			}
+		}
+
+		line = nextLine;
+	}
+
+	for (size_t i = 0; i < materialIndices.size(); ++i)
+	{
+		if (materialIndices[i].empty())
+			continue;
+
+		SubMesh subMesh;
+		subMesh.m_FirstIndex = (uint)mesh.m_Indices.size();
+		subMesh.m_IndexCount = (uint)materialIndices[i].size();
+		subMesh.m_MaterialIndex = (uint)mesh.m_SubMeshes.size();
+		mesh.m_SubMeshes.push_back(subMesh);
+		mesh.m_Indices.insert(mesh.m_Indices.end(), materialIndices[i].begin(), materialIndices[i].end());
+	}
+}
+
+void MeshImporter::ImportGltf(const std::string& path, Mesh& mesh)
+{
+	std::vector<char> data = ReadWholeFile(path);
+	const char* json = data.data();
+	size_t jsonLength = data.size();
+	std::vector<uint8_t> binaryChunk;
+	bool hasBinaryChunk = false;
+
+	uint magic = 0;
+	if (data.size() >= 12)
+		memcpy(&magic, data.data(), sizeof(magic));
+
+	if (magic == GLB_MAGIC)
+	{
+		// A 12 byte header, then chunks of JSON and binary data, each with its length and type first.
+		json = nullptr;
+		size_t offset = 12;
+		while (offset + 8 <= data.size())
+		{
+			uint chunkLength;
+			uint chunkType;
+			memcpy(&chunkLength, data.data() + offset, sizeof(chunkLength));
+			memcpy(&chunkType, data.data() + offset + 4, sizeof(chunkType));
+			offset += 8;
+
+			if (chunkLength > data.size() - offset)
+				throw std::runtime_error("Failed to import glTF, a chunk runs past the end of the file!");
+
+			if (chunkType == GLB_CHUNK_JSON && json == nullptr)
+			{
+				json = data.data() + offset;
+				jsonLength = chunkLength;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !hasBinaryChunk)
+			{
+				binaryChunk.assign(data.begin() + offset, data.begin() + offset + chunkLength);
+				hasBinaryChunk = true;
+			}
+
+			offset += chunkLength;
+		}
+
+		if (json == nullptr)
+			throw std::runtime_error("Failed to import glTF, the file has no JSON chunk!");
+	}
+
+	GltfFile file;
+	file.m_Json = JsonValue::Parse(json, jsonLength);
+
+	const JsonValue* asset = file.m_Json.Find("asset");
+	const JsonValue* version = asset != nullptr ? asset->Find("version") : nullptr;
+	if (version == nullptr || version->GetString().empty() || version->GetString()[0] != '2')
+		throw std::runtime_error("Failed to import glTF, only version 2 is supported!");
+
+	// Buffers are embedded as base64, in separate files next to this one, or in a .glb's binary chunk.
+	const JsonValue* buffers = file.m_Json.Find("buffers");
+	size_t bufferCount = buffers != nullptr ? buffers->GetSize() : 0;
+	file.m_Buffers.resize(bufferCount);
+	for (size_t i = 0; i < bufferCount; ++i)
+	{
+		const JsonValue& buffer = (*buffers)[i];
+		const JsonValue* uri = buffer.Find("uri");
+		std::vector<uint8_t>& bufferData = file.m_Buffers[i];
+
+		if (uri == nullptr)
+		{
+			if (i != 0 || !hasBinaryChunk)
+				throw std::runtime_error("Failed to import glTF, a buffer has no data!");
+			bufferData.swap(binaryChunk);
+		}
+		else if (uri->GetString().compare(0, 5, "data:") == 0)
+		{
+			const std::string& dataUri = uri->GetString();
+			size_t base64 = dataUri.find(";base64,");
+			if (base64 == std::string::npos)
+				throw std::runtime_error("Failed to import glTF, only base64 data URIs are supported!");
+			DecodeBase64(dataUri.data() + base64 + 8, dataUri.size() - base64 - 8, bufferData);
+		}
+		else
+		{
+			std::vector<char> bufferFile = ReadWholeFile(GetDirectory(path) + uri->GetString());
+			bufferData.assign(bufferFile.begin(), bufferFile.end());
+		}
+
+		if (bufferData.size() < (size_t)buffer.GetNumber("byteLength", 0.0))
+			throw std::runtime_error("Failed to import glTF, a buffer is shorter than it says!");
+	}
+
+	// Without a scene there's nothing to place the meshes with, so they're all imported where they are.
+	const JsonValue* scenes = file.m_Json.Find("scenes");
+	if (scenes != nullptr && scenes->GetSize() > 0)
+	{
+		const JsonValue& scene = GetElement(file.m_Json, "scenes", (size_t)file.m_Json.GetNumber("scene", 0.0));
+		const JsonValue* nodes = scene.Find("nodes");
+		for (size_t i = 0; nodes != nullptr && i < nodes->GetSize(); ++i)
+			ImportGltfNode(file, ToIndex((*nodes)[i]), glm::mat4(1.0f), mesh, 0);
+	}
+	else
+	{
+		const JsonValue* meshes = file.m_Json.Find("meshes");
+		for (size_t i = 0; meshes != nullptr && i < meshes->GetSize(); ++i)
+			ImportGltfMesh(file, i, glm::mat4(1.0f), mesh);
+	}
+}
+
+void MeshImporter::ImportGltfNode(const GltfFile& file, size_t nodeIndex, const glm::mat4& parentTransform, Mesh& mesh, size_t depth)
+{
+	// Nodes can't be deeper than there are nodes unless the hierarchy loops.
+	const JsonValue* nodes = file.m_Json.Find("nodes");
+	if (nodes == nullptr || depth >= nodes->GetSize())
+		throw std::runtime_error("Failed to import glTF, the node hierarchy isn't valid!");
+
+	const JsonValue& node = GetElement(file.m_Json, "nodes", nodeIndex);
+
+	glm::mat4 transform(1.0f);
+	const JsonValue* matrix = node.Find("matrix");
+	if (matrix != nullptr && matrix->GetSize() == 16)
+	{
+		// Column major, the same as glm.
+		float values[16];
+		for (size_t i = 0; i < 16; ++i)
+			values[i] = (float)(*matrix)[i].GetNumber();
+		transform = glm::make_mat4(values);
+	}
+	else
+	{
+		const JsonValue* translation = node.Find("translation");
+		const JsonValue* rotation = node.Find("rotation");
+		const JsonValue* scale = node.Find("scale");
+
+		if (translation != nullptr && translation->GetSize() == 3)
+			transform = glm::translate(transform, glm::vec3((*translation)[0].GetNumber(), (*translation)[1].GetNumber(), (*translation)[2].GetNumber()));
+		if (rotation != nullptr && rotation->GetSize() == 4)
+			transform *= glm::mat4_cast(glm::quat((float)(*rotation)[3].GetNumber(), (float)(*rotation)[0].GetNumber(), (float)(*rotation)[1].GetNumber(), (float)(*rotation)[2].GetNumber()));
+		if (scale != nullptr && scale->GetSize() == 3)
+			transform = glm::scale(transform, glm::vec3((*scale)[0].GetNumber(), (*scale)[1].GetNumber(), (*scale)[2].GetNumber()));
+	}
+
+	transform = parentTransform * transform;
+
+	const JsonValue* meshIndex = node.Find("mesh");
+	if (meshIndex != nullptr)
+		ImportGltfMesh(file, ToIndex(*meshIndex), transform, mesh);
+
+	const JsonValue* children = node.Find("children");
+	for (size_t i = 0; children != nullptr && i < children->GetSize(); ++i)
+		ImportGltfNode(file, ToIndex((*children)[i]), transform, mesh, depth + 1);
+}
+
+void MeshImporter::ImportGltfMesh(const GltfFile& file, size_t meshIndex, const glm::mat4& transform, Mesh& mesh)
+{
+	const JsonValue& gltfMesh = GetElement(file.m_Json, "meshes", meshIndex);
+	const JsonValue* primitives = gltfMesh.Find("primitives");
+	if (primitives == nullptr)
+		return;
+
+	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(transform));
+	glm::mat3 tangentMatrix(transform);
+
+	// A mirroring transform turns the triangles inside out and swaps the handedness of the tangents.
+	bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<float> tangents;
+	std::vector<float> uvs;
+	std::vector<uint> indices;
+
+	for (size_t p = 0; p < primitives->GetSize(); ++p)
+	{
+		const JsonValue& primitive = (*primitives)[p];
+		if ((int)primitive.GetNumber("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES)
+			throw std::runtime_error("Failed to import glTF, only triangle lists are supported!");
+
+		const JsonValue* attributes = primitive.Find("attributes");
+		const JsonValue* position = attributes != nullptr ? attributes->Find("POSITION") : nullptr;
+		if (position == nullptr)
+			throw std::runtime_error("Failed to import glTF, a primitive has no positions!");
+
+		size_t vertexCount = ReadFloats(file, ToIndex(*position), 3, positions);
+
+		// Missing attributes are left at zero, which has normals and tangents generated for them after deduplicating.
+		const char* attributeNames[] = { "NORMAL", "TANGENT", "TEXCOORD_0" };
+		std::vector<float>* attributeValues[] = { &normals, &tangents, &uvs };
+		const size_t attributeComponents[] = { 3, 4, 2 };
+		for (size_t a = 0; a < 3; ++a)
+		{
+			const JsonValue* accessor = attributes->Find(attributeNames[a]);
+			if (accessor == nullptr)
+				attributeValues[a]->assign(vertexCount * attributeComponents[a], 0.0f);
+			else if (ReadFloats(file, ToIndex(*accessor), attributeComponents[a], *attributeValues[a]) != vertexCount)
+				throw std::runtime_error("Failed to import glTF, a primitive's attributes have different counts!");
+		}
+
+		const JsonValue* indicesAccessor = primitive.Find("indices");
+		if (indicesAccessor != nullptr)
+		{
+			ReadIndices(file, ToIndex(*indicesAccessor), indices);
+		}
+		else
+		{
+			indices.resize(vertexCount);
+			std::iota(indices.begin(), indices.end(), 0);
+		}
+
+		if (indices.size() % 3 != 0)
+			throw std::runtime_error("Failed to import glTF, a triangle list has a partial triangle!");
+
+		uint firstVertex = (uint)mesh.m_Vertices.size();
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			MeshVertex vertex;
+			vertex.m_Position = glm::vec3(transform * glm::vec4(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f));
+			vertex.m_Normal = SafeNormalize(normalMatrix * glm::vec3(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]));
+			glm::vec3 tangent = SafeNormalize(tangentMatrix * glm::vec3(tangents[v * 4], tangents[v * 4 + 1], tangents[v * 4 + 2]));
+			vertex.m_Tangent = glm::vec4(tangent, mirrored ? -tangents[v * 4 + 3] : tangents[v * 4 + 3]);
+			vertex.m_UV = glm::vec2(uvs[v * 2], uvs[v * 2 + 1]);
+			mesh.m_Vertices.push_back(vertex);
+		}
+
+		SubMesh subMesh;
+		subMesh.m_FirstIndex = (uint)mesh.m_Indices.size();
+		subMesh.m_IndexCount = (uint)indices.size();
+		subMesh.m_MaterialIndex = (uint)primitive.GetNumber("material", 0.0);
+		mesh.m_SubMeshes.push_back(subMesh);
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+				throw std::runtime_error("Failed to import glTF, an index is past the end of the vertices!");
+
+			mesh.m_Indices.push_back(firstVertex + indices[i]);
+			mesh.m_Indices.push_back(firstVertex + indices[mirrored ? i + 2 : i + 1]);
+			mesh.m_Indices.push_back(firstVertex + indices[mirrored ? i + 1 : i + 2]);
+		}
+	}
+}
+
+void MeshImporter::GenerateNormals(Mesh& mesh)
+{
+	size_t vertexCount = mesh.m_Vertices.size();
+	bool missing = false;
+	for (const MeshVertex& vertex : mesh.m_Vertices)
+		missing = missing || vertex.m_Normal == glm::vec3(0.0f);
+	if (!missing)
+		return;
+
+	// Vertices at the same position share a normal, so UV seams don't show up as creases.
+	std::vector<uint> sortedVertices(vertexCount);
+	std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+	std::sort(sortedVertices.begin(), sortedVertices.end(), [&mesh](uint a, uint b)
+	{
+		const glm::vec3& positionA = mesh.m_Vertices[a].m_Position;
+		const glm::vec3& positionB = mesh.m_Vertices[b].m_Position;
+		if (positionA.x != positionB.x)
+			return positionA.x < positionB.x;
+		if (positionA.y != positionB.y)
+			return positionA.y < positionB.y;
+		return positionA.z < positionB.z;
+	});
+
+	std::vector<uint> positionIndices(vertexCount);
+	uint positionCount = 0;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		if (i > 0 && mesh.m_Vertices[sortedVertices[i]].m_Position != mesh.m_Vertices[sortedVertices[i - 1]].m_Position)
+			++positionCount;
+		positionIndices[sortedVertices[i]] = positionCount;
+	}
+
+	// Cross products are twice the area of the triangle, so bigger faces count for more.
+	std::vector<glm::vec3> positionNormals(positionCount + 1, glm::vec3(0.0f));
+	for (size_t i = 0; i + 2 < mesh.m_Indices.size(); i += 3)
+	{
+		const glm::vec3& a = mesh.m_Vertices[mesh.m_Indices[i]].m_Position;
+		const glm::vec3& b = mesh.m_Vertices[mesh.m_Indices[i + 1]].m_Position;
+		const glm::vec3& c = mesh.m_Vertices[mesh.m_Indices[i + 2]].m_Position;
+		glm::vec3 normal = glm::cross(b - a, c - a);
+
+		for (size_t corner = 0; corner < 3; ++corner)
+			positionNormals[positionIndices[mesh.m_Indices[i + corner]]] += normal;
+	}
+
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		MeshVertex& vertex = mesh.m_Vertices[v];
+		if (vertex.m_Normal != glm::vec3(0.0f))
+			continue;
+
+		vertex.m_Normal = SafeNormalize(positionNormals[positionIndices[v]]);
+		if (vertex.m_Normal == glm::vec3(0.0f))
+			vertex.m_Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+}
+
+void MeshImporter::GenerateTangents(Mesh& mesh)
+{
+	size_t vertexCount = mesh.m_Vertices.size();
+	bool missing = false;
+	for (const MeshVertex& vertex : mesh.m_Vertices)
+		missing = missing || vertex.m_Tangent.w == 0.0f;
+	if (!missing)
+		return;
+
+	// The directions u and v increase in across each triangle, added up per vertex.
+	std::vector<glm::vec3> tangents(vertexCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> bitangents(vertexCount, glm::vec3(0.0f));
+	for (size_t i = 0; i + 2 < mesh.m_Indices.size(); i += 3)
+	{
+		const MeshVertex& a = mesh.m_Vertices[mesh.m_Indices[i]];
+		const MeshVertex& b = mesh.m_Vertices[mesh.m_Indices[i + 1]];
+		const MeshVertex& c = mesh.m_Vertices[mesh.m_Indices[i + 2]];
+
+		glm::vec3 edge1 = b.m_Position - a.m_Position;
+		glm::vec3 edge2 = c.m_Position - a.m_Position;
+		glm::vec2 deltaUV1 = b.m_UV - a.m_UV;
+		glm::vec2 deltaUV2 = c.m_UV - a.m_UV;
+
+		float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+		if (fabsf(determinant) < 1e-12f)
+			continue;
+
+		glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) / determinant;
+		glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) / determinant;
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			tangents[mesh.m_Indices[i + corner]] += tangent;
+			bitangents[mesh.m_Indices[i + corner]] += bitangent;
+		}
+	}
+
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		MeshVertex& vertex = mesh.m_Vertices[v];
+		if (vertex.m_Tangent.w != 0.0f)
+			continue;
+
+		// Made perpendicular to the normal. Without UVs to follow, any perpendicular direction will do.
+		const glm::vec3& normal = vertex.m_Normal;
+		glm::vec3 tangent = SafeNormalize(tangents[v] - normal * glm::dot(normal, tangents[v]));
+		if (tangent == glm::vec3(0.0f))
+			tangent = glm::normalize(glm::cross(normal, fabsf(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		float handedness = glm::dot(glm::cross(normal, tangent), bitangents[v]) < 0.0f ? -1.0f : 1.0f;
+		vertex.m_Tangent = glm::vec4(tangent, handedness);
+	}
+}
\ No newline at end of file
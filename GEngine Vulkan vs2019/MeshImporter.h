@@ -0,0 +1,51 @@
+#pragma once
+#include "Mesh.h"
+#include <string>
+
+class JsonValue;
+struct GltfFile;
+
+// Reads Wavefront OBJ and glTF 2.0 (.gltf and .glb) files into a Mesh, for the MeshCooker.
+// OBJ faces are triangulated as fans and grouped into a sub mesh per material. glTF meshes are placed by the nodes of
+// the default scene and flattened into one mesh with a sub mesh per primitive, so the result is what the file shows.
+// Vertices are deduplicated, then any normals the file doesn't have are generated from the faces around each position
+// and any tangents from the UVs. Anything the importer doesn't support throws, rather than importing something wrong.
+class MeshImporter
+{
+public:
+	// Import a mesh file, picked by its extension.
+	// Params: the file path, the mesh to replace with the file's.
+	void Import(const std::string& path, Mesh& mesh);
+
+	// Get how many vertices the last mesh imported had before they were deduplicated.
+	// Returns: the vertex count.
+	size_t GetImportedVertexCount() const { return m_ImportedVertexCount; }
+
+private:
+	// Read an OBJ file's faces.
+	// Params: the file path, the mesh to add them to.
+	void ImportObj(const std::string& path, Mesh& mesh);
+
+	// Read the meshes of a .gltf or .glb file's default scene.
+	// Params: the file path, the mesh to add them to.
+	void ImportGltf(const std::string& path, Mesh& mesh);
+
+	// Add a glTF node's mesh and its children's to the mesh.
+	// Params: the file, the node index, the parent's transform, the mesh to add to, how deep the node is.
+	void ImportGltfNode(const GltfFile& file, size_t nodeIndex, const glm::mat4& parentTransform, Mesh& mesh, size_t depth);
+
+	// Add a glTF mesh's primitives to the mesh, each as a sub mesh.
+	// Params: the file, the mesh index, the transform to place it with, the mesh to add to.
+	void ImportGltfMesh(const GltfFile& file, size_t meshIndex, const glm::mat4& transform, Mesh& mesh);
+
+	// Fill in normals left at zero, from the area weighted normals of the faces around each position.
+	// Params: the mesh.
+	void GenerateNormals(Mesh& mesh);
+
+	// Fill in tangents left with 0 in w, from the direction the UVs run across the faces around each vertex.
+	// Params: the mesh.
+	void GenerateTangents(Mesh& mesh);
+
+	// Vertices the last mesh had before deduplication.
+	size_t m_ImportedVertexCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,390 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+
+// Vertex index used for "no vertex".
+static const uint INVALID_VERTEX = UINT32_MAX;
+// How much worse than the mesh's ACMR a cluster can be when splitting clusters for overdraw.
+static const float OVERDRAW_THRESHOLD = 1.05f;
+
+// A cluster of triangles and how likely it is to hide the rest of the mesh.
+struct ClusterSort
+{
+	float m_Score;
+	uint m_Cluster;
+};
+
+// Hash all of a vertex's bytes, so only exactly equal vertices are merged.
+static uint HashVertex(const MeshVertex& vertex)
+{
+	uint words[sizeof(MeshVertex) / sizeof(uint)];
+	memcpy(words, &vertex, sizeof(words));
+
+	uint hash = 2166136261u;
+	for (uint word : words)
+		hash = (hash ^ word) * 16777619u;
+	return hash ^ (hash >> 15);
+}
+
+void MeshOptimizer::Optimise(Mesh& mesh)
+{
+	std::vector<uint> clusters;
+	for (const SubMesh& subMesh : mesh.m_SubMeshes)
+	{
+		uint* indices = mesh.m_Indices.data() + subMesh.m_FirstIndex;
+		OptimiseVertexCache(indices, subMesh.m_IndexCount, mesh.m_Vertices.size(), &clusters);
+		OptimiseOverdraw(indices, subMesh.m_IndexCount, mesh.m_Vertices.data(), mesh.m_Vertices.size(), clusters, OVERDRAW_THRESHOLD);
+	}
+
+	OptimiseVertexFetch(mesh);
+}
+
+void MeshOptimizer::OptimiseMeshlets(Mesh& mesh)
+{
+	// Each meshlet's vertices are numbered from 0 while its triangles are ordered, so Tipsify's per vertex arrays are
+	// only as big as the meshlet instead of the whole mesh.
+	std::vector<uint> localVertices(mesh.m_Vertices.size(), INVALID_VERTEX);
+	std::vector<uint> meshVertices;
+	std::vector<uint> localIndices;
+
+	for (const Meshlet& meshlet : mesh.m_Meshlets)
+	{
+		uint* indices = mesh.m_Indices.data() + meshlet.m_FirstIndex;
+		size_t indexCount = meshlet.m_TriangleCount * 3;
+
+		meshVertices.clear();
+		localIndices.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint& local = localVertices[indices[i]];
+			if (local == INVALID_VERTEX)
+			{
+				local = (uint)meshVertices.size();
+				meshVertices.push_back(indices[i]);
+			}
+			localIndices[i] = local;
+		}
+
+		OptimiseVertexCache(localIndices.data(), indexCount, meshVertices.size(), nullptr);
+
+		for (size_t i = 0; i < indexCount; ++i)
+			indices[i] = meshVertices[localIndices[i]];
+		for (uint vertex : meshVertices)
+			localVertices[vertex] = INVALID_VERTEX;
+	}
+}
+
+void MeshOptimizer::DeduplicateVertices(Mesh& mesh)
+{
+	size_t vertexCount = mesh.m_Vertices.size();
+
+	// Open addressing table of unique vertex indices, at most half full.
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<uint> table(tableSize, INVALID_VERTEX);
+
+	std::vector<MeshVertex> uniqueVertices;
+	uniqueVertices.reserve(vertexCount);
+	std::vector<uint> remap(vertexCount);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const MeshVertex& vertex = mesh.m_Vertices[i];
+		size_t slot = HashVertex(vertex) & (tableSize - 1);
+		while (table[slot] != INVALID_VERTEX && memcmp(&uniqueVertices[table[slot]], &vertex, sizeof(MeshVertex)) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == INVALID_VERTEX)
+		{
+			table[slot] = (uint)uniqueVertices.size();
+			uniqueVertices.push_back(vertex);
+		}
+
+		remap[i] = table[slot];
+	}
+
+	for (uint& index : mesh.m_Indices)
+		index = remap[index];
+
+	mesh.m_Vertices.swap(uniqueVertices);
+}
+
+void MeshOptimizer::OptimiseVertexCache(uint* indices, size_t indexCount, size_t vertexCount, std::vector<uint>* clusters)
+{
+	const uint cacheSize = MESH_VERTEX_CACHE_SIZE;
+	size_t triangleCount = indexCount / 3;
+
+	if (clusters != nullptr)
+		clusters->clear();
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex, vertex v's are from triangleOffsets[v] to triangleOffsets[v + 1].
+	std::vector<uint> triangleOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++triangleOffsets[indices[i] + 1];
+	for (size_t v = 0; v < vertexCount; ++v)
+		triangleOffsets[v + 1] += triangleOffsets[v];
+
+	std::vector<uint> vertexTriangles(triangleCount * 3);
+	std::vector<uint> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		liveTriangles[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+
+	std::vector<uint> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+			vertexTriangles[fill[indices[t * 3 + corner]]++] = (uint)t;
+	}
+
+	// A vertex is in the cache while fewer than cacheSize vertices have been transformed since it was.
+	std::vector<uint> cacheTime(vertexCount, 0);
+	uint time = cacheSize + 1;
+
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<uint> deadEnds;
+	deadEnds.reserve(triangleCount * 3);
+	std::vector<uint> candidates;
+	std::vector<uint> output(triangleCount * 3);
+	size_t outputCount = 0;
+
+	// Vertices are started from in input order once the dead end stack runs out.
+	size_t nextInputVertex = 0;
+	uint fanning = indices[0];
+	if (clusters != nullptr)
+		clusters->push_back(0);
+
+	while (fanning != INVALID_VERTEX)
+	{
+		// Draw every triangle left around the fanning vertex.
+		candidates.clear();
+		for (uint i = triangleOffsets[fanning]; i < triangleOffsets[fanning + 1]; ++i)
+		{
+			uint triangle = vertexTriangles[i];
+			if (emitted[triangle])
+				continue;
+
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				uint vertex = indices[triangle * 3 + corner];
+				output[outputCount++] = vertex;
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+
+				if (time - cacheTime[vertex] > cacheSize)
+					cacheTime[vertex] = time++;
+			}
+
+			emitted[triangle] = 1;
+		}
+
+		// Fan next around the vertex touched that's been in the cache longest, as long as its triangles' new vertices
+		// won't push it out before they're drawn. Otherwise take any touched vertex with triangles left.
+		fanning = INVALID_VERTEX;
+		int bestPriority = -1;
+		for (uint vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+				priority = (int)(time - cacheTime[vertex]);
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanning = vertex;
+			}
+		}
+
+		if (fanning != INVALID_VERTEX)
+			continue;
+
+		// Dead end. Go back to the most recently used vertex with triangles left, or the next one in input order.
+		while (!deadEnds.empty() && fanning == INVALID_VERTEX)
+		{
+			uint vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+				fanning = vertex;
+		}
+
+		while (nextInputVertex < triangleCount * 3 && fanning == INVALID_VERTEX)
+		{
+			uint vertex = indices[nextInputVertex++];
+			if (liveTriangles[vertex] > 0)
+				fanning = vertex;
+		}
+
+		if (fanning != INVALID_VERTEX && clusters != nullptr)
+			clusters->push_back((uint)(outputCount / 3));
+	}
+
+	memcpy(indices, output.data(), triangleCount * 3 * sizeof(uint));
+}
+
+void MeshOptimizer::OptimiseOverdraw(uint* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount,
+	const std::vector<uint>& clusters, float threshold)
+{
+	const uint cacheSize = MESH_VERTEX_CACHE_SIZE;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || clusters.empty())
+		return;
+
+	// Split the clusters wherever the triangles so far have reused vertices about as well as the whole order, so
+	// there are more to sort without losing much. Clusters can end up anywhere, so each starts with an empty cache.
+	float meshACMR = AnalyseVertexCache(indices, indexCount, vertexCount, cacheSize).m_ACMR;
+
+	std::vector<uint> splitClusters;
+	std::vector<uint> cacheTime(vertexCount, 0);
+	uint time = cacheSize + 1;
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		size_t start = clusters[c];
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		splitClusters.push_back((uint)start);
+		time += cacheSize + 1;
+		uint misses = 0;
+
+		for (size_t t = start; t < end; ++t)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				uint vertex = indices[t * 3 + corner];
+				if (time - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = time++;
+					++misses;
+				}
+			}
+
+			if (t + 1 < end && (float)misses <= threshold * meshACMR * (float)(t + 1 - start))
+			{
+				start = t + 1;
+				splitClusters.push_back((uint)start);
+				time += cacheSize + 1;
+				misses = 0;
+			}
+		}
+	}
+
+	// Score each cluster by how far it sits out from the mesh's centre along the way it faces. Clusters on the outside
+	// facing out are the likeliest to be in front of the rest from any view, so they're drawn first.
+	std::vector<glm::vec3> triangleCentres(triangleCount);
+	std::vector<glm::vec3> triangleNormals(triangleCount);
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const glm::vec3& a = vertices[indices[t * 3 + 0]].m_Position;
+		const glm::vec3& b = vertices[indices[t * 3 + 1]].m_Position;
+		const glm::vec3& c = vertices[indices[t * 3 + 2]].m_Position;
+
+		// Twice the area, which weights everything the same way.
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float area = glm::length(normal);
+
+		triangleCentres[t] = (a + b + c) / 3.0f;
+		triangleNormals[t] = normal;
+		meshCentre += triangleCentres[t] * area;
+		meshArea += area;
+	}
+
+	if (meshArea > 0.0f)
+		meshCentre /= meshArea;
+
+	std::vector<ClusterSort> sortedClusters(splitClusters.size());
+	for (size_t c = 0; c < splitClusters.size(); ++c)
+	{
+		size_t start = splitClusters[c];
+		size_t end = c + 1 < splitClusters.size() ? splitClusters[c + 1] : triangleCount;
+
+		glm::vec3 centre(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = start; t < end; ++t)
+		{
+			float triangleArea = glm::length(triangleNormals[t]);
+			centre += triangleCentres[t] * triangleArea;
+			normal += triangleNormals[t];
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		float score = 0.0f;
+		if (area > 0.0f && normalLength > 0.0f)
+			score = glm::dot(centre / area - meshCentre, normal / normalLength);
+
+		sortedClusters[c].m_Score = score;
+		sortedClusters[c].m_Cluster = (uint)c;
+	}
+
+	std::stable_sort(sortedClusters.begin(), sortedClusters.end(),
+		[](const ClusterSort& a, const ClusterSort& b) { return a.m_Score > b.m_Score; });
+
+	std::vector<uint> output;
+	output.reserve(triangleCount * 3);
+	for (const ClusterSort& cluster : sortedClusters)
+	{
+		size_t start = splitClusters[cluster.m_Cluster];
+		size_t end = cluster.m_Cluster + 1 < splitClusters.size() ? splitClusters[cluster.m_Cluster + 1] : triangleCount;
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	memcpy(indices, output.data(), triangleCount * 3 * sizeof(uint));
+}
+
+void MeshOptimizer::OptimiseVertexFetch(Mesh& mesh)
+{
+	std::vector<uint> remap(mesh.m_Vertices.size(), INVALID_VERTEX);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.m_Vertices.size());
+
+	for (uint& index : mesh.m_Indices)
+	{
+		if (remap[index] == INVALID_VERTEX)
+		{
+			remap[index] = (uint)vertices.size();
+			vertices.push_back(mesh.m_Vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.m_Vertices.swap(vertices);
+}
+
+VertexCacheStats MeshOptimizer::AnalyseVertexCache(const uint* indices, size_t indexCount, size_t vertexCount, uint cacheSize)
+{
+	VertexCacheStats stats{};
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return stats;
+
+	std::vector<uint> cacheTime(vertexCount, 0);
+	uint time = cacheSize + 1;
+	size_t misses = 0;
+	size_t usedVertices = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		uint vertex = indices[i];
+		if (time - cacheTime[vertex] > cacheSize)
+		{
+			usedVertices += cacheTime[vertex] == 0 ? 1 : 0;
+			cacheTime[vertex] = time++;
+			++misses;
+		}
+	}
+
+	stats.m_ACMR = (float)misses / (float)triangleCount;
+	stats.m_ATVR = (float)misses / (float)usedVertices;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Mesh.h"
+#include <vector>
+
+// Entries in the post-transform vertex cache meshes are optimised for and measured against. Real GPUs don't have a
+// FIFO cache any more, but index orders that do well on a small one also batch well on the shader cores.
+#define MESH_VERTEX_CACHE_SIZE 16
+
+// How well an index order reuses transformed vertices, from simulating a FIFO post-transform cache.
+struct VertexCacheStats
+{
+	// Average cache miss ratio, vertices transformed per triangle. 3 is no reuse at all, around 0.5 is the best possible.
+	float m_ACMR;
+	// Average transform to vertex ratio, vertices transformed per vertex used. 1 is each vertex transformed once.
+	float m_ATVR;
+};
+
+// Offline optimisations of a mesh's index and vertex order, run by the MeshCooker.
+// Triangles are ordered with Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and
+// Reduced Overdraw"), which fans around vertices still in the cache and breaks the mesh into clusters where it has to
+// jump. The clusters are split further while their cache efficiency stays close to the whole mesh's, then sorted so
+// the ones facing out from the middle of the mesh draw first and hide what's behind them. Vertices are then put in the
+// order the indices first use them, so vertex fetches walk through memory.
+class MeshOptimizer
+{
+public:
+	// Optimise the triangle order of each sub mesh for the vertex cache and overdraw, then the vertex order for fetching.
+	// Params: the mesh.
+	static void Optimise(Mesh& mesh);
+
+	// Merge vertices that are exactly the same and point the indices at the one left.
+	// Params: the mesh.
+	static void DeduplicateVertices(Mesh& mesh);
+
+	// Reorder triangles so vertices are reused while they're still in the cache, with Tipsify.
+	// Params: the indices to reorder in place, amount of indices, amount of vertices, vector to fill with the first
+	//         triangle of each cluster the order jumps between, or nullptr.
+	static void OptimiseVertexCache(uint* indices, size_t indexCount, size_t vertexCount, std::vector<uint>* clusters);
+
+	// Reorder clusters of triangles so the ones most likely to hide others draw first, keeping most of the cache reuse.
+	// Params: the indices to reorder in place, ordered by OptimiseVertexCache, amount of indices, the vertices, amount of
+	//         vertices, the clusters from OptimiseVertexCache, how much worse than the whole order's ACMR each cluster's
+	//         is allowed to be, with 1 keeping the clusters as they are.
+	static void OptimiseOverdraw(uint* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount,
+		const std::vector<uint>& clusters, float threshold);
+
+	// Reorder the triangles inside each meshlet for the vertex cache again, once building meshlets has regrouped them.
+	// Meshlets stay in the order they were built in, which takes the place of OptimiseOverdraw's order across the sub mesh.
+	// Params: the mesh, with its meshlets built.
+	static void OptimiseMeshlets(Mesh& mesh);
+
+	// Reorder vertices in the order the indices first use them, dropping unused ones.
+	// Params: the mesh.
+	static void OptimiseVertexFetch(Mesh& mesh);
+
+	// Measure how well an index order uses a FIFO vertex cache.
+	// Params: the indices, amount of indices, amount of vertices, entries in the cache.
+	// Returns: the stats.
+	static VertexCacheStats AnalyseVertexCache(const uint* indices, size_t indexCount, size_t vertexCount, uint cacheSize = MESH_VERTEX_CACHE_SIZE);
+};
\ No newline at end of file
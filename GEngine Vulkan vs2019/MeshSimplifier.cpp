@@ -0,0 +1,451 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Vertex index used for "no vertex".
+static const uint INVALID_VERTEX = UINT32_MAX;
+// Fewest triangles a level is made with. Below this the draw costs more than the triangles.
+static const size_t MIN_LOD_TRIANGLES = 64;
+// Most of the last level's indices a new level can keep. Meshes held in place by their seams stop here.
+static const float MAX_LOD_RATIO = 0.85f;
+// Most error a collapse can have, as a fraction of the mesh's size. Past this the mesh loses its shape.
+static const float MAX_LOD_ERROR = 0.02f;
+// Smallest cosine of the angle a triangle's normal can turn through in a collapse, so triangles don't fold over.
+static const float MIN_NORMAL_COSINE = 0.25f;
+
+// Sum of squared distances to a set of planes, weighted by their area, as the upper triangle of a symmetric 4x4 matrix.
+struct Quadric
+{
+	double m_XX, m_XY, m_XZ, m_XW;
+	double m_YY, m_YZ, m_YW;
+	double m_ZZ, m_ZW;
+	double m_WW;
+	// Total area of the planes.
+	double m_Area;
+};
+
+// A vertex moving onto a neighbour, and the error it would leave.
+struct Collapse
+{
+	uint m_From;
+	uint m_To;
+	float m_Error;
+};
+
+// Make the quadric of a triangle's plane.
+static Quadric MakePlaneQuadric(const glm::vec3& normal, float distance, float area)
+{
+	double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+	Quadric quadric;
+	quadric.m_XX = a * a * area;
+	quadric.m_XY = a * b * area;
+	quadric.m_XZ = a * c * area;
+	quadric.m_XW = a * d * area;
+	quadric.m_YY = b * b * area;
+	quadric.m_YZ = b * c * area;
+	quadric.m_YW = b * d * area;
+	quadric.m_ZZ = c * c * area;
+	quadric.m_ZW = c * d * area;
+	quadric.m_WW = d * d * area;
+	quadric.m_Area = area;
+	return quadric;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.m_XX += other.m_XX;
+	quadric.m_XY += other.m_XY;
+	quadric.m_XZ += other.m_XZ;
+	quadric.m_XW += other.m_XW;
+	quadric.m_YY += other.m_YY;
+	quadric.m_YZ += other.m_YZ;
+	quadric.m_YW += other.m_YW;
+	quadric.m_ZZ += other.m_ZZ;
+	quadric.m_ZW += other.m_ZW;
+	quadric.m_WW += other.m_WW;
+	quadric.m_Area += other.m_Area;
+}
+
+// Get the distance of a point from a quadric's planes, averaged over their area.
+static float GetQuadricError(const Quadric& quadric, const glm::vec3& point)
+{
+	double x = point.x, y = point.y, z = point.z;
+	double squared = quadric.m_XX * x * x + quadric.m_YY * y * y + quadric.m_ZZ * z * z + quadric.m_WW +
+		2.0 * (quadric.m_XY * x * y + quadric.m_XZ * x * z + quadric.m_YZ * y * z + quadric.m_XW * x + quadric.m_YW * y + quadric.m_ZW * z);
+
+	return quadric.m_Area > 0.0 ? (float)sqrt(std::max(squared, 0.0) / quadric.m_Area) : 0.0f;
+}
+
+// Key of an edge between two positions, the same whichever way round they're given.
+static uint64_t GetEdgeKey(uint a, uint b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+void MeshSimplifier::BuildLods(Mesh& mesh)
+{
+	mesh.m_Lods.clear();
+
+	uint fullSubMeshCount = (uint)mesh.m_SubMeshes.size();
+	size_t fullIndexCount = mesh.m_Indices.size();
+
+	MeshLod fullLod = {};
+	fullLod.m_SubMeshCount = fullSubMeshCount;
+	fullLod.m_IndexCount = (uint)fullIndexCount;
+	mesh.m_Lods.push_back(fullLod);
+
+	std::vector<uint> positionRemap;
+	RemapPositions(mesh, positionRemap);
+
+	std::vector<uint> simplified;
+	float maxError = glm::length(mesh.m_Bounds.m_Max - mesh.m_Bounds.m_Min) * MAX_LOD_ERROR;
+	size_t previousIndexCount = fullIndexCount;
+	float previousError = 0.0f;
+
+	// Every level is simplified from the full detail mesh, so its error is measured against that and not the last level.
+	for (uint level = 1; level < MESH_MAX_LODS; ++level)
+	{
+		float ratio = 1.0f / (float)(1 << level);
+		if (fullIndexCount / 3 * ratio < MIN_LOD_TRIANGLES)
+			break;
+
+		MeshLod lod = {};
+		lod.m_FirstSubMesh = (uint)mesh.m_SubMeshes.size();
+		lod.m_FirstIndex = (uint)mesh.m_Indices.size();
+		lod.m_Error = previousError;
+
+		for (uint i = 0; i < fullSubMeshCount; ++i)
+		{
+			SubMesh subMesh = mesh.m_SubMeshes[i];
+			size_t targetIndexCount = (size_t)(subMesh.m_IndexCount / 3 * ratio) * 3;
+			float error = Simplify(mesh.m_Indices.data() + subMesh.m_FirstIndex, subMesh.m_IndexCount, mesh.m_Vertices.data(),
+				mesh.m_Vertices.size(), positionRemap.data(), targetIndexCount, maxError, simplified);
+			lod.m_Error = std::max(lod.m_Error, error);
+
+			subMesh.m_FirstIndex = (uint)mesh.m_Indices.size();
+			subMesh.m_IndexCount = (uint)simplified.size();
+			mesh.m_SubMeshes.push_back(subMesh);
+			mesh.m_Indices.insert(mesh.m_Indices.end(), simplified.begin(), simplified.end());
+		}
+
+		lod.m_SubMeshCount = (uint)mesh.m_SubMeshes.size() - lod.m_FirstSubMesh;
+		lod.m_IndexCount = (uint)mesh.m_Indices.size() - lod.m_FirstIndex;
+
+		if (lod.m_IndexCount > previousIndexCount * MAX_LOD_RATIO)
+		{
+			mesh.m_SubMeshes.resize(lod.m_FirstSubMesh);
+			mesh.m_Indices.resize(lod.m_FirstIndex);
+			break;
+		}
+
+		mesh.m_Lods.push_back(lod);
+		previousIndexCount = lod.m_IndexCount;
+		previousError = lod.m_Error;
+	}
+}
+
+float MeshSimplifier::Simplify(const uint* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount, const uint* positionRemap,
+	size_t targetIndexCount, float maxError, std::vector<uint>& result)
+{
+	result.assign(indices, indices + indexCount);
+	size_t triangleCount = indexCount / 3;
+	size_t targetTriangleCount = targetIndexCount / 3;
+
+	// Everything below is kept for the first vertex with each position, which stands in for all of them.
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	// The vertex used at each position, to find seams where more than one is.
+	std::vector<uint> wedges(vertexCount, INVALID_VERTEX);
+	std::vector<bool> locked(vertexCount, false);
+	std::vector<bool> dead(triangleCount, false);
+	std::unordered_map<uint64_t, uint> edgeCounts;
+	size_t liveTriangleCount = triangleCount;
+
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		uint corners[3];
+		for (uint c = 0; c < 3; ++c)
+		{
+			uint vertex = result[t * 3 + c];
+			corners[c] = positionRemap[vertex];
+			if (wedges[corners[c]] == INVALID_VERTEX)
+				wedges[corners[c]] = vertex;
+			else if (wedges[corners[c]] != vertex)
+				locked[corners[c]] = true;
+		}
+
+		// Triangles with two corners in the same place can't be seen, so they go straight away.
+		if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0])
+		{
+			dead[t] = true;
+			--liveTriangleCount;
+			continue;
+		}
+
+		for (uint c = 0; c < 3; ++c)
+			++edgeCounts[GetEdgeKey(corners[c], corners[(c + 1) % 3])];
+
+		const glm::vec3& a = vertices[corners[0]].m_Position;
+		glm::vec3 normal = glm::cross(vertices[corners[1]].m_Position - a, vertices[corners[2]].m_Position - a);
+		float length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normal /= length;
+			Quadric quadric = MakePlaneQuadric(normal, -glm::dot(normal, a), length * 0.5f);
+			for (uint c = 0; c < 3; ++c)
+				AddQuadric(quadrics[corners[c]], quadric);
+		}
+	}
+
+	// Edges on a border have one triangle, and edges with more than two can't be collapsed without tearing the mesh.
+	for (const auto& edge : edgeCounts)
+	{
+		if (edge.second != 2)
+		{
+			locked[(uint)(edge.first >> 32)] = true;
+			locked[(uint)edge.first] = true;
+		}
+	}
+
+	std::vector<uint> adjacencyOffsets;
+	std::vector<uint> adjacency;
+	std::vector<uint> fill;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched;
+	// Stamp of the last collapse each position was found next to, for counting shared neighbours.
+	std::vector<uint> neighbourStamps(vertexCount, 0);
+	uint stamp = 0;
+	float error = 0.0f;
+
+	auto getPosition = [&](size_t corner) -> const glm::vec3& { return vertices[positionRemap[result[corner]]].m_Position; };
+	auto containsPosition = [&](size_t triangle, uint position)
+	{
+		return positionRemap[result[triangle * 3]] == position || positionRemap[result[triangle * 3 + 1]] == position ||
+			positionRemap[result[triangle * 3 + 2]] == position;
+	};
+
+	while (liveTriangleCount > targetTriangleCount)
+	{
+		// The triangles around each position, for checking and making collapses.
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (!dead[t])
+			{
+				for (uint c = 0; c < 3; ++c)
+					++adjacencyOffsets[positionRemap[result[t * 3 + c]] + 1];
+			}
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(adjacencyOffsets[vertexCount]);
+		fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (!dead[t])
+			{
+				for (uint c = 0; c < 3; ++c)
+					adjacency[fill[positionRemap[result[t * 3 + c]]]++] = (uint)t;
+			}
+		}
+
+		// Edges inside the mesh are in two triangles, one going each way, so each is only looked at once. Border edges
+		// are locked at both ends anyway.
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (dead[t])
+				continue;
+
+			for (uint c = 0; c < 3; ++c)
+			{
+				uint a = positionRemap[result[t * 3 + c]];
+				uint b = positionRemap[result[t * 3 + (c + 1) % 3]];
+				if (a > b || (locked[a] && locked[b]))
+					continue;
+
+				Quadric quadric = quadrics[a];
+				AddQuadric(quadric, quadrics[b]);
+				float errorToB = locked[a] ? FLT_MAX : GetQuadricError(quadric, vertices[b].m_Position);
+				float errorToA = locked[b] ? FLT_MAX : GetQuadricError(quadric, vertices[a].m_Position);
+				collapses.push_back(errorToB <= errorToA ? Collapse{ a, b, errorToB } : Collapse{ b, a, errorToA });
+			}
+		}
+
+		if (collapses.empty() || collapses[0].m_Error > maxError)
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.m_Error < b.m_Error; });
+
+		// Errors go stale as the mesh changes, so a pass only goes as far as the collapses that would reach the target
+		// if they all went through. The rest wait for the next pass to work out their errors again. Collapses inside the
+		// mesh take two triangles with them.
+		size_t neededCount = std::min((liveTriangleCount - targetTriangleCount + 1) / 2, collapses.size());
+		float errorLimit = collapses[std::max<size_t>(neededCount, 1) - 1].m_Error;
+
+		touched.assign(vertexCount, false);
+		size_t collapseCount = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if ((collapse.m_Error > errorLimit && collapseCount > 0) || collapse.m_Error > maxError || liveTriangleCount <= targetTriangleCount)
+				break;
+
+			// Anything around a collapse this pass has out of date adjacency and errors.
+			uint from = collapse.m_From;
+			uint to = collapse.m_To;
+			if (touched[from] || touched[to])
+				continue;
+
+			// The triangles on the edge say which of the target's vertices the rest of the triangles join up with, and
+			// the corners across from it are the only neighbours the ends can share without pinching the mesh.
+			uint toVertex = INVALID_VERTEX;
+			uint edgeTriangleCount = 0;
+			++stamp;
+			for (uint i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+			{
+				uint t = adjacency[i];
+				if (dead[t])
+					continue;
+
+				for (uint c = 0; c < 3; ++c)
+				{
+					uint position = positionRemap[result[t * 3 + c]];
+					neighbourStamps[position] = stamp;
+					if (position == to)
+					{
+						toVertex = result[t * 3 + c];
+						++edgeTriangleCount;
+					}
+				}
+			}
+
+			if (toVertex == INVALID_VERTEX)
+				continue;
+
+			uint sharedCount = 0;
+			++stamp;
+			for (uint i = adjacencyOffsets[to]; i < adjacencyOffsets[to + 1]; ++i)
+			{
+				uint t = adjacency[i];
+				if (dead[t])
+					continue;
+
+				for (uint c = 0; c < 3; ++c)
+				{
+					uint position = positionRemap[result[t * 3 + c]];
+					if (position != from && position != to && neighbourStamps[position] == stamp - 1)
+					{
+						++sharedCount;
+						neighbourStamps[position] = stamp;
+					}
+				}
+			}
+
+			if (sharedCount > edgeTriangleCount)
+				continue;
+
+			// The triangles that stay mustn't turn too far.
+			bool folds = false;
+			const glm::vec3& target = vertices[to].m_Position;
+			for (uint i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && !folds; ++i)
+			{
+				uint t = adjacency[i];
+				if (dead[t] || containsPosition(t, to))
+					continue;
+
+				glm::vec3 corners[3] = { getPosition(t * 3), getPosition(t * 3 + 1), getPosition(t * 3 + 2) };
+				glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				for (uint c = 0; c < 3; ++c)
+				{
+					if (positionRemap[result[t * 3 + c]] == from)
+						corners[c] = target;
+				}
+				glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+				folds = glm::dot(before, after) < MIN_NORMAL_COSINE * glm::length(before) * glm::length(after);
+			}
+
+			if (folds)
+				continue;
+
+			for (uint i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+			{
+				uint t = adjacency[i];
+				if (dead[t])
+					continue;
+
+				if (containsPosition(t, to))
+				{
+					dead[t] = true;
+					--liveTriangleCount;
+					continue;
+				}
+
+				for (uint c = 0; c < 3; ++c)
+				{
+					if (positionRemap[result[t * 3 + c]] == from)
+						result[t * 3 + c] = toVertex;
+				}
+			}
+
+			AddQuadric(quadrics[to], quadrics[from]);
+			error = std::max(error, collapse.m_Error);
+			touched[from] = true;
+			touched[to] = true;
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+			break;
+	}
+
+	size_t liveIndexCount = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (!dead[t])
+		{
+			memmove(result.data() + liveIndexCount, result.data() + t * 3, 3 * sizeof(uint));
+			liveIndexCount += 3;
+		}
+	}
+	result.resize(liveIndexCount);
+
+	return error;
+}
+
+void MeshSimplifier::RemapPositions(const Mesh& mesh, std::vector<uint>& remap)
+{
+	size_t vertexCount = mesh.m_Vertices.size();
+	remap.resize(vertexCount);
+
+	// Open addressing table of the first vertex with each position, at most half full.
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<uint> table(tableSize, INVALID_VERTEX);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const glm::vec3& position = mesh.m_Vertices[i].m_Position;
+		uint words[3];
+		memcpy(words, &position, sizeof(words));
+
+		uint hash = 2166136261u;
+		for (uint word : words)
+			hash = (hash ^ word) * 16777619u;
+		hash ^= hash >> 15;
+
+		size_t slot = hash & (tableSize - 1);
+		while (table[slot] != INVALID_VERTEX && mesh.m_Vertices[table[slot]].m_Position != position)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == INVALID_VERTEX)
+			table[slot] = (uint)i;
+
+		remap[i] = table[slot];
+	}
+}
\ No newline at end of file
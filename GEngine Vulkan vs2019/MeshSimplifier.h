@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Mesh.h"
+#include <vector>
+
+// Offline generation of a mesh's levels of detail, run by the MeshCooker before it builds meshlets.
+// Levels are simplified from the full detail mesh with quadric error metrics (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"). Every vertex sums the planes of the triangles around it, weighted by
+// their area, and edges are collapsed cheapest first onto whichever end moves the surface least. Collapses only ever
+// move a vertex onto a neighbour, so every level shares the full detail vertices and only adds indices.
+// Vertices on borders, on seams where normals or UVs are split, and where sub meshes meet never move, and collapses that
+// would fold a triangle over are skipped. A level's error is how far its worst collapse moved the surface from the
+// planes it replaced, averaged over their area, in the mesh's space. The LodSelector projects it onto the screen.
+class MeshSimplifier
+{
+public:
+	// Add levels of detail after the full detail mesh, each with about half the triangles of the one before, until
+	// there are MESH_MAX_LODS or the mesh can't get simpler without losing its shape.
+	// Params: the mesh, whose sub meshes so far become the full detail level.
+	static void BuildLods(Mesh& mesh);
+
+	// Simplify a list of triangles down towards an amount of indices, without going over an error.
+	// Params: the triangles' indices, amount of indices, the vertices, amount of vertices, the first vertex with each
+	//         vertex's position, the amount of indices to aim for, the most error a collapse can have, vector to fill
+	//         with the simplified indices.
+	// Returns: the error of the simplified triangles, in the mesh's space.
+	static float Simplify(const uint* indices, size_t indexCount, const MeshVertex* vertices, size_t vertexCount, const uint* positionRemap,
+		size_t targetIndexCount, float maxError, std::vector<uint>& result);
+
+private:
+	// Find the first vertex with each vertex's position, so vertices split for their normals or UVs move together.
+	// Params: the mesh, vector to fill with a vertex index for each vertex.
+	static void RemapPositions(const Mesh& mesh, std::vector<uint>& remap);
+};
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Vertex slot used for "not in the meshlet".
+static const uint INVALID_SLOT = UINT32_MAX;
+// Triangle used for "no triangle".
+static const uint INVALID_TRIANGLE = UINT32_MAX;
+// Triangles looked at ahead of the first unused one when none share a vertex with the meshlet.
+static const uint MESHLET_LOOKAHEAD = 256;
+// Cones whose triangles face further than this from the axis (the cosine of the angle) are too wide to ever cull.
+static const float MIN_CONE_COSINE = 0.1f;
+
+// Which way a triangle faces and where its middle is, for picking the next triangle of a meshlet.
+struct MeshletTriangle
+{
+	glm::vec3 m_Normal;
+	glm::vec3 m_Centre;
+};
+
+// Get a triangle's normal, counter-clockwise being the front, or 0 if it has no area.
+static glm::vec3 GetTriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 normal = glm::cross(b - a, c - a);
+	float length = glm::length(normal);
+	return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+void MeshletBuilder::Build(Mesh& mesh)
+{
+	mesh.m_Meshlets.clear();
+
+	size_t vertexCount = mesh.m_Vertices.size();
+	// Each vertex's slot in the meshlet being grown, put back to INVALID_SLOT once the meshlet's done.
+	std::vector<uint> vertexSlots(vertexCount, INVALID_SLOT);
+	std::vector<uint> adjacencyOffsets;
+	std::vector<uint> adjacency;
+	std::vector<MeshletTriangle> triangles;
+	std::vector<bool> used;
+	std::vector<uint> reordered;
+
+	for (uint subMeshIndex = 0; subMeshIndex < (uint)mesh.m_SubMeshes.size(); ++subMeshIndex)
+	{
+		const SubMesh& subMesh = mesh.m_SubMeshes[subMeshIndex];
+		uint* indices = mesh.m_Indices.data() + subMesh.m_FirstIndex;
+		uint triangleCount = subMesh.m_IndexCount / 3;
+		if (triangleCount == 0)
+			continue;
+
+		triangles.resize(triangleCount);
+		for (uint i = 0; i < triangleCount; ++i)
+		{
+			const glm::vec3& a = mesh.m_Vertices[indices[i * 3]].m_Position;
+			const glm::vec3& b = mesh.m_Vertices[indices[i * 3 + 1]].m_Position;
+			const glm::vec3& c = mesh.m_Vertices[indices[i * 3 + 2]].m_Position;
+			triangles[i].m_Normal = GetTriangleNormal(a, b, c);
+			triangles[i].m_Centre = (a + b + c) / 3.0f;
+		}
+
+		// The triangles using each vertex, packed one vertex after another.
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (uint i = 0; i < triangleCount * 3; ++i)
+			++adjacencyOffsets[indices[i] + 1];
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(triangleCount * 3);
+		std::vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+
+		used.assign(triangleCount, false);
+		reordered.clear();
+		size_t firstMeshlet = mesh.m_Meshlets.size();
+		uint seed = 0;
+
+		for (;;)
+		{
+			while (seed < triangleCount && used[seed])
+				++seed;
+			if (seed == triangleCount)
+				break;
+
+			Meshlet meshlet = {};
+			meshlet.m_FirstIndex = subMesh.m_FirstIndex + (uint)reordered.size();
+			meshlet.m_SubMesh = subMeshIndex;
+
+			uint meshletVertices[MESHLET_MAX_VERTICES];
+			uint meshletVertexCount = 0;
+			glm::vec3 normalSum(0.0f);
+			glm::vec3 centreSum(0.0f);
+			float radius = 0.0f;
+
+			uint next = seed;
+			while (next != INVALID_TRIANGLE)
+			{
+				used[next] = true;
+				++meshlet.m_TriangleCount;
+				for (uint corner = 0; corner < 3; ++corner)
+				{
+					uint vertex = indices[next * 3 + corner];
+					reordered.push_back(vertex);
+					if (vertexSlots[vertex] == INVALID_SLOT)
+					{
+						vertexSlots[vertex] = meshletVertexCount;
+						meshletVertices[meshletVertexCount++] = vertex;
+					}
+				}
+
+				normalSum += triangles[next].m_Normal;
+				centreSum += triangles[next].m_Centre;
+				glm::vec3 centre = centreSum / (float)meshlet.m_TriangleCount;
+				radius = std::max(radius, glm::length(triangles[next].m_Centre - centre));
+
+				if (meshlet.m_TriangleCount == MESHLET_MAX_TRIANGLES)
+					break;
+
+				// New vertices cost the most, then facing away from the rest and being far from the middle.
+				float normalLength = glm::length(normalSum);
+				glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+				float inverseRadius = 1.0f / std::max(radius, 1e-6f);
+				float bestScore = FLT_MAX;
+				next = INVALID_TRIANGLE;
+
+				auto scoreTriangle = [&](uint triangle)
+				{
+					uint newVertices = 0;
+					for (uint corner = 0; corner < 3; ++corner)
+						newVertices += vertexSlots[indices[triangle * 3 + corner]] == INVALID_SLOT ? 1 : 0;
+					if (meshletVertexCount + newVertices > MESHLET_MAX_VERTICES)
+						return;
+
+					float facing = 1.0f - glm::dot(triangles[triangle].m_Normal, axis);
+					float distance = std::min(glm::length(triangles[triangle].m_Centre - centre) * inverseRadius, 1.0f);
+					float score = newVertices + facing * 0.25f + distance * 0.25f;
+					if (score < bestScore)
+					{
+						bestScore = score;
+						next = triangle;
+					}
+				};
+
+				for (uint i = 0; i < meshletVertexCount; ++i)
+				{
+					uint vertex = meshletVertices[i];
+					for (uint j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; ++j)
+					{
+						if (!used[adjacency[j]])
+							scoreTriangle(adjacency[j]);
+					}
+				}
+
+				if (next == INVALID_TRIANGLE)
+				{
+					uint end = std::min(seed + MESHLET_LOOKAHEAD, triangleCount);
+					for (uint triangle = seed; triangle < end; ++triangle)
+					{
+						if (!used[triangle])
+							scoreTriangle(triangle);
+					}
+				}
+			}
+
+			meshlet.m_VertexCount = meshletVertexCount;
+			for (uint i = 0; i < meshletVertexCount; ++i)
+				vertexSlots[meshletVertices[i]] = INVALID_SLOT;
+
+			mesh.m_Meshlets.push_back(meshlet);
+		}
+
+		std::copy(reordered.begin(), reordered.end(), indices);
+		for (size_t i = firstMeshlet; i < mesh.m_Meshlets.size(); ++i)
+			ComputeBounds(mesh, mesh.m_Meshlets[i]);
+	}
+
+	// Meshlets are in sub mesh order, so each level of detail's are a range too.
+	size_t meshlet = 0;
+	for (MeshLod& lod : mesh.m_Lods)
+	{
+		while (meshlet < mesh.m_Meshlets.size() && mesh.m_Meshlets[meshlet].m_SubMesh < lod.m_FirstSubMesh)
+			++meshlet;
+		lod.m_FirstMeshlet = (uint)meshlet;
+
+		while (meshlet < mesh.m_Meshlets.size() && mesh.m_Meshlets[meshlet].m_SubMesh < lod.m_FirstSubMesh + lod.m_SubMeshCount)
+			++meshlet;
+		lod.m_MeshletCount = (uint)meshlet - lod.m_FirstMeshlet;
+	}
+}
+
+void MeshletBuilder::ComputeBounds(const Mesh& mesh, Meshlet& meshlet)
+{
+	const uint* indices = mesh.m_Indices.data() + meshlet.m_FirstIndex;
+	uint indexCount = meshlet.m_TriangleCount * 3;
+
+	AABB box = AABB::Empty();
+	for (uint i = 0; i < indexCount; ++i)
+		box.Grow(mesh.m_Vertices[indices[i]].m_Position);
+
+	glm::vec3 centre = box.GetCentre();
+	float radius = 0.0f;
+	for (uint i = 0; i < indexCount; ++i)
+		radius = std::max(radius, glm::length(mesh.m_Vertices[indices[i]].m_Position - centre));
+	meshlet.m_CentreRadius = glm::vec4(centre, radius);
+
+	glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+	glm::vec3 normalSum(0.0f);
+	for (uint i = 0; i < meshlet.m_TriangleCount; ++i)
+	{
+		normals[i] = GetTriangleNormal(mesh.m_Vertices[indices[i * 3]].m_Position, mesh.m_Vertices[indices[i * 3 + 1]].m_Position,
+			mesh.m_Vertices[indices[i * 3 + 2]].m_Position);
+		normalSum += normals[i];
+	}
+
+	// Triangles without area face nowhere, so they don't narrow or widen the cone.
+	float normalLength = glm::length(normalSum);
+	glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+	float minDot = normalLength > 0.0f ? 1.0f : -1.0f;
+	for (uint i = 0; i < meshlet.m_TriangleCount; ++i)
+	{
+		if (normals[i] != glm::vec3(0.0f))
+			minDot = std::min(minDot, glm::dot(axis, normals[i]));
+	}
+
+	if (minDot <= MIN_CONE_COSINE)
+	{
+		meshlet.m_ConeAxisCutoff = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		meshlet.m_ConeApex = centre;
+		return;
+	}
+
+	// Move the apex back along the axis until it's behind every triangle's plane, so the test holds for the whole
+	// triangle and not just its corners.
+	float apexDistance = 0.0f;
+	for (uint i = 0; i < meshlet.m_TriangleCount; ++i)
+	{
+		if (normals[i] == glm::vec3(0.0f))
+			continue;
+
+		float distance = glm::dot(centre - mesh.m_Vertices[indices[i * 3]].m_Position, normals[i]) / glm::dot(axis, normals[i]);
+		apexDistance = std::max(apexDistance, distance);
+	}
+
+	// Every triangle faces away when the view direction is within 90 degrees less the widest angle of the axis.
+	meshlet.m_ConeAxisCutoff = glm::vec4(axis, sqrtf(1.0f - minDot * minDot));
+	meshlet.m_ConeApex = centre - axis * apexDistance;
+}
\ No newline at end of file
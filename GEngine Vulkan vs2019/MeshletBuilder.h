@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Mesh.h"
+
+// Most vertices a meshlet can touch. 64 vertices and 124 triangles fit the limits mesh shaders are fastest at, and
+// keep clusters small enough that a mesh partly on screen or partly facing away only draws the parts that matter.
+#define MESHLET_MAX_VERTICES 64
+// Most triangles in a meshlet.
+#define MESHLET_MAX_TRIANGLES 124
+
+// Offline splitting of a mesh into meshlets, run by the MeshCooker after the mesh is optimised.
+// Meshlets are grown one triangle at a time from the first triangle not used yet, in the optimised order. The next
+// triangle is the one adding the fewest new vertices, then the one closest to facing the same way and sitting closest
+// to the meshlet's middle, so meshlets come out round and flat, which is what makes their spheres and cones tight.
+// Triangles sharing no vertices with the meshlet are looked for a little way ahead in the optimised order, which is
+// spatially coherent, so meshes with split vertices still fill their meshlets. Each sub mesh's indices are rewritten
+// in meshlet order, so each meshlet is a range of indices that can be drawn on its own.
+class MeshletBuilder
+{
+public:
+	// Split every sub mesh into meshlets, reordering its triangles to match, and work out their bounds and cones.
+	// Params: the mesh, whose m_Meshlets is replaced and whose levels of detail get their ranges of meshlets.
+	static void Build(Mesh& mesh);
+
+private:
+	// Work out a meshlet's bounding sphere and normal cone from its triangles.
+	// Params: the mesh, the meshlet with its index range set.
+	static void ComputeBounds(const Mesh& mesh, Meshlet& meshlet);
+};
\ No newline at end of file
@@ -0,0 +1,416 @@
+#include "OcclusionCuller.h"
+#include "CpuFeatures.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+// Objects tested per job when culling a list.
+static const size_t TEST_CHUNK_SIZE = 1024;
+// Rows drawn per band job.
+static const uint BAND_HEIGHT = 16;
+// Clip space w below which a vertex counts as behind the camera.
+static const float NEAR_W = 1e-5f;
+
+//-------------------------------------------------------------------------------
+// Rasterizers.
+//-------------------------------------------------------------------------------
+// Edge functions and depth plane of a triangle, so each pixel is just multiply adds.
+// Edge i is opposite vertex i, and is positive inside the triangle.
+struct TriangleSetup
+{
+	float m_EdgeA[3];
+	float m_EdgeB[3];
+	float m_EdgeC[3];
+	float m_DepthA;
+	float m_DepthB;
+	float m_DepthC;
+	int m_MinX;
+	int m_MaxX;
+	int m_MinY;
+	int m_MaxY;
+};
+
+// Work out the edge functions and pixel bounds of a triangle inside some rows.
+// Returns: if the triangle covers any of those rows.
+static bool SetupTriangle(const OcclusionCuller::ScreenTriangle& triangle, uint width, uint minY, uint maxY, TriangleSetup& setup)
+{
+	glm::vec3 v0 = triangle.m_Vertices[0];
+	glm::vec3 v1 = triangle.m_Vertices[1];
+	glm::vec3 v2 = triangle.m_Vertices[2];
+
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (std::fabs(area) < 1e-8f)
+		return false;
+
+	// Occluders are drawn double sided, so flip clockwise triangles around.
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	setup.m_MinX = std::max(0, (int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+	setup.m_MaxX = std::min((int)width - 1, (int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+	setup.m_MinY = std::max((int)minY, (int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+	setup.m_MaxY = std::min((int)maxY - 1, (int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+
+	if (setup.m_MinX > setup.m_MaxX || setup.m_MinY > setup.m_MaxY)
+		return false;
+
+	const glm::vec3* from[3] = { &v1, &v2, &v0 };
+	const glm::vec3* to[3] = { &v2, &v0, &v1 };
+	for (int i = 0; i < 3; ++i)
+	{
+		setup.m_EdgeA[i] = -(to[i]->y - from[i]->y);
+		setup.m_EdgeB[i] = to[i]->x - from[i]->x;
+		setup.m_EdgeC[i] = (to[i]->y - from[i]->y) * from[i]->x - (to[i]->x - from[i]->x) * from[i]->y;
+	}
+
+	// Depth is the edge functions used as barycentric weights.
+	float inverseArea = 1.0f / area;
+	setup.m_DepthA = (setup.m_EdgeA[0] * v0.z + setup.m_EdgeA[1] * v1.z + setup.m_EdgeA[2] * v2.z) * inverseArea;
+	setup.m_DepthB = (setup.m_EdgeB[0] * v0.z + setup.m_EdgeB[1] * v1.z + setup.m_EdgeB[2] * v2.z) * inverseArea;
+	setup.m_DepthC = (setup.m_EdgeC[0] * v0.z + setup.m_EdgeC[1] * v1.z + setup.m_EdgeC[2] * v2.z) * inverseArea;
+
+	return true;
+}
+
+static void RasterizeSSE(const OcclusionCuller::ScreenTriangle& triangle, float* depth, uint width, uint minY, uint maxY)
+{
+	TriangleSetup setup;
+	if (!SetupTriangle(triangle, width, minY, maxY, setup))
+		return;
+
+	__m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 zero = _mm_setzero_ps();
+
+	for (int y = setup.m_MinY; y <= setup.m_MaxY; ++y)
+	{
+		float pixelY = y + 0.5f;
+		float* row = depth + (size_t)y * width;
+
+		for (int x = setup.m_MinX & ~3; x <= setup.m_MaxX; x += 4)
+		{
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int e = 0; e < 3; ++e)
+			{
+				__m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.m_EdgeA[e]), pixelX), _mm_set1_ps(setup.m_EdgeB[e] * pixelY + setup.m_EdgeC[e]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+			}
+
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.m_DepthA), pixelX), _mm_set1_ps(setup.m_DepthB * pixelY + setup.m_DepthC));
+			__m128 current = _mm_loadu_ps(row + x);
+			__m128 nearest = _mm_min_ps(current, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+		}
+	}
+}
+
+GENGINE_TARGET_AVX2 static void RasterizeAVX2(const OcclusionCuller::ScreenTriangle& triangle, float* depth, uint width, uint minY, uint maxY)
+{
+	TriangleSetup setup;
+	if (!SetupTriangle(triangle, width, minY, maxY, setup))
+		return;
+
+	__m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	__m256 zero = _mm256_setzero_ps();
+
+	for (int y = setup.m_MinY; y <= setup.m_MaxY; ++y)
+	{
+		float pixelY = y + 0.5f;
+		float* row = depth + (size_t)y * width;
+
+		for (int x = setup.m_MinX & ~7; x <= setup.m_MaxX; x += 8)
+		{
+			__m256 pixelX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int e = 0; e < 3; ++e)
+			{
+				__m256 edge = _mm256_fmadd_ps(_mm256_set1_ps(setup.m_EdgeA[e]), pixelX, _mm256_set1_ps(setup.m_EdgeB[e] * pixelY + setup.m_EdgeC[e]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+			}
+
+			if (_mm256_movemask_ps(inside) == 0)
+				continue;
+
+			__m256 z = _mm256_fmadd_ps(_mm256_set1_ps(setup.m_DepthA), pixelX, _mm256_set1_ps(setup.m_DepthB * pixelY + setup.m_DepthC));
+			__m256 current = _mm256_loadu_ps(row + x);
+			_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------
+// OcclusionCuller.
+//-------------------------------------------------------------------------------
+OcclusionCuller::OcclusionCuller(uint width, uint height)
+{
+	m_Width = (width + 7) & ~7u;
+	m_Height = height;
+	m_BandHeight = BAND_HEIGHT;
+	m_ViewProjection = glm::mat4(1.0f);
+
+	const CpuFeatures& cpu = CpuFeatures::Get();
+	m_Rasterize = cpu.m_AVX2 && cpu.m_FMA ? RasterizeAVX2 : RasterizeSSE;
+
+	// Lay out the max depth pyramid, halving down to a single texel.
+	uint levelWidth = m_Width;
+	uint levelHeight = m_Height;
+	uint offset = 0;
+	while (true)
+	{
+		m_LevelOffsets.push_back(offset);
+		m_LevelWidths.push_back(levelWidth);
+		m_LevelHeights.push_back(levelHeight);
+		offset += levelWidth * levelHeight;
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = std::max(1u, (levelWidth + 1) / 2);
+		levelHeight = std::max(1u, (levelHeight + 1) / 2);
+	}
+
+	m_DepthPyramid.assign(offset, 1.0f);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_ViewProjection = viewProjection;
+	m_Occluders.clear();
+	m_Stats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh& mesh, const glm::mat4& worldMatrix)
+{
+	m_Occluders.push_back({ &mesh, worldMatrix, 0 });
+}
+
+void OcclusionCuller::TransformOccluders(void* data, size_t begin, size_t end)
+{
+	OcclusionCuller* culler = (OcclusionCuller*)data;
+	float width = (float)culler->m_Width;
+	float height = (float)culler->m_Height;
+
+	for (size_t o = begin; o < end; ++o)
+	{
+		const OccluderInstance& occluder = culler->m_Occluders[o];
+		const OccluderMesh& mesh = *occluder.m_Mesh;
+		glm::mat4 worldViewProjection = culler->m_ViewProjection * occluder.m_WorldMatrix;
+
+		size_t triangleCount = mesh.m_Indices.size() / 3;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			ScreenTriangle& triangle = culler->m_Triangles[occluder.m_FirstTriangle + t];
+			triangle.m_Valid = true;
+
+			for (int v = 0; v < 3; ++v)
+			{
+				glm::vec4 clip = worldViewProjection * glm::vec4(mesh.m_Vertices[mesh.m_Indices[t * 3 + v]], 1.0f);
+
+				// Clipping isn't worth it here, dropping the triangle only makes culling less aggressive.
+				if (clip.w < NEAR_W || clip.z < 0.0f)
+				{
+					triangle.m_Valid = false;
+					break;
+				}
+
+				float inverseW = 1.0f / clip.w;
+				triangle.m_Vertices[v] = glm::vec3((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height, clip.z * inverseW);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeBands(void* data, size_t begin, size_t end)
+{
+	OcclusionCuller* culler = (OcclusionCuller*)data;
+
+	for (size_t band = begin; band < end; ++band)
+	{
+		uint minY = (uint)band * culler->m_BandHeight;
+		uint maxY = std::min(culler->m_Height, minY + culler->m_BandHeight);
+
+		float* depth = culler->m_DepthPyramid.data();
+		std::fill(depth + (size_t)minY * culler->m_Width, depth + (size_t)maxY * culler->m_Width, 1.0f);
+
+		for (const ScreenTriangle& triangle : culler->m_Triangles)
+		{
+			if (triangle.m_Valid)
+				culler->m_Rasterize(triangle, depth, culler->m_Width, minY, maxY);
+		}
+	}
+}
+
+void OcclusionCuller::RenderOccluders(JobSystem* jobSystem)
+{
+	size_t triangleCount = 0;
+	for (OccluderInstance& occluder : m_Occluders)
+	{
+		occluder.m_FirstTriangle = triangleCount;
+		triangleCount += occluder.m_Mesh->m_Indices.size() / 3;
+	}
+
+	m_Triangles.resize(triangleCount);
+	m_Stats.m_OccluderCount = m_Occluders.size();
+	m_Stats.m_OccluderTriangles = triangleCount;
+
+	uint bandCount = (m_Height + m_BandHeight - 1) / m_BandHeight;
+	if (jobSystem != nullptr)
+	{
+		jobSystem->ParallelFor(m_Occluders.size(), 16, TransformOccluders, this);
+		jobSystem->ParallelFor(bandCount, 1, RasterizeBands, this);
+	}
+	else
+	{
+		TransformOccluders(this, 0, m_Occluders.size());
+		RasterizeBands(this, 0, bandCount);
+	}
+
+	// Each texel of the next level holds the furthest depth of the 2x2 texels under it.
+	for (size_t level = 1; level < m_LevelOffsets.size(); ++level)
+	{
+		const float* source = m_DepthPyramid.data() + m_LevelOffsets[level - 1];
+		float* destination = m_DepthPyramid.data() + m_LevelOffsets[level];
+		uint sourceWidth = m_LevelWidths[level - 1];
+		uint sourceHeight = m_LevelHeights[level - 1];
+
+		for (uint y = 0; y < m_LevelHeights[level]; ++y)
+		{
+			uint y0 = y * 2;
+			uint y1 = std::min(y0 + 1, sourceHeight - 1);
+			for (uint x = 0; x < m_LevelWidths[level]; ++x)
+			{
+				uint x0 = x * 2;
+				uint x1 = std::min(x0 + 1, sourceWidth - 1);
+				float furthest = std::max(std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]), std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+				destination[y * m_LevelWidths[level] + x] = furthest;
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsOccluded(const AABB& worldBounds) const
+{
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	float nearestDepth = FLT_MAX;
+
+	// Corners are the min corner plus box edges in clip space, so only one full transform is needed.
+	glm::vec3 size = worldBounds.m_Max - worldBounds.m_Min;
+	glm::vec4 minCorner = m_ViewProjection * glm::vec4(worldBounds.m_Min, 1.0f);
+	glm::vec4 edgeX = m_ViewProjection[0] * size.x;
+	glm::vec4 edgeY = m_ViewProjection[1] * size.y;
+	glm::vec4 edgeZ = m_ViewProjection[2] * size.z;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec4 clip = minCorner;
+		if (corner & 1)
+			clip += edgeX;
+		if (corner & 2)
+			clip += edgeY;
+		if (corner & 4)
+			clip += edgeZ;
+
+		// Boxes crossing the near plane could be anywhere on screen.
+		if (clip.w < NEAR_W)
+			return false;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * m_Width;
+		float y = (clip.y * inverseW * 0.5f + 0.5f) * m_Height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearestDepth = std::min(nearestDepth, clip.z * inverseW);
+	}
+
+	if (nearestDepth < 0.0f)
+		return false;
+
+	int x0 = std::max(0, (int)std::floor(minX));
+	int x1 = std::min((int)m_Width - 1, (int)std::floor(maxX));
+	int y0 = std::max(0, (int)std::floor(minY));
+	int y1 = std::min((int)m_Height - 1, (int)std::floor(maxY));
+
+	// Off screen, that's the frustum culler's job.
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Go up the pyramid until the box covers at most 4x4 texels.
+	size_t level = 0;
+	while (level + 1 < m_LevelOffsets.size() && (((x1 >> level) - (x0 >> level)) >= 4 || ((y1 >> level) - (y0 >> level)) >= 4))
+		++level;
+
+	const float* depth = m_DepthPyramid.data() + m_LevelOffsets[level];
+	uint levelWidth = m_LevelWidths[level];
+	for (int y = y0 >> level; y <= (y1 >> level); ++y)
+	{
+		for (int x = x0 >> level; x <= (x1 >> level); ++x)
+		{
+			if (depth[y * levelWidth + x] >= nearestDepth)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void OcclusionCuller::TestObjects(void* data, size_t begin, size_t end)
+{
+	OcclusionCuller* culler = (OcclusionCuller*)data;
+
+	for (size_t i = begin; i < end; ++i)
+		culler->m_Results[i] = culler->IsOccluded(culler->m_TestBounds[culler->m_TestObjects[i]]) ? 0 : 1;
+}
+
+size_t OcclusionCuller::CullObjects(const AABB* worldBounds, uint* objects, size_t objectCount, JobSystem* jobSystem)
+{
+	m_Stats.m_TestedObjects = objectCount;
+
+	// Nothing drawn means nothing can be hidden.
+	if (m_Triangles.empty())
+	{
+		m_Stats.m_CulledObjects = 0;
+		m_Stats.m_VisibleObjects = objectCount;
+		return objectCount;
+	}
+
+	if (m_Results.size() < objectCount)
+		m_Results.resize(objectCount);
+
+	m_TestBounds = worldBounds;
+	m_TestObjects = objects;
+
+	if (jobSystem != nullptr)
+		jobSystem->ParallelFor(objectCount, TEST_CHUNK_SIZE, TestObjects, this);
+	else
+		TestObjects(this, 0, objectCount);
+
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < objectCount; ++i)
+	{
+		objects[visibleCount] = objects[i];
+		visibleCount += m_Results[i];
+	}
+
+	m_Stats.m_CulledObjects = objectCount - visibleCount;
+	m_Stats.m_VisibleObjects = visibleCount;
+	return visibleCount;
+}
\ No newline at end of file
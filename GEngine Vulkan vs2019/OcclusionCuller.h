@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "Bounds.h"
+#include "JobSystem.h"
+#include <vector>
+
+// Simplified mesh used to draw an object into the occlusion buffer.
+// It has to sit inside the object it stands in for, or it will hide things it shouldn't.
+struct OccluderMesh
+{
+	std::vector<glm::vec3> m_Vertices;
+	std::vector<uint> m_Indices;
+};
+
+// Counts from the last frame of occlusion culling.
+struct OcclusionStats
+{
+	size_t m_OccluderCount = 0;
+	size_t m_OccluderTriangles = 0;
+	size_t m_TestedObjects = 0;
+	size_t m_CulledObjects = 0;
+	size_t m_VisibleObjects = 0;
+};
+
+// CPU occlusion culling.
+// Occluder meshes are rasterized with SIMD into a small depth buffer, split into horizontal bands
+// that are drawn on worker threads. A pyramid of max depths is built from it, and object boxes are
+// rejected when their nearest depth is behind the furthest occluder depth over the area they cover.
+class OcclusionCuller
+{
+public:
+	// Constructor.
+	// Params: width and height of the depth buffer. The width is rounded up to a multiple of 8.
+	OcclusionCuller(uint width = 256, uint height = 128);
+	// Destructor.
+	~OcclusionCuller();
+
+	// Start a new frame, forgetting last frame's occluders.
+	// Params: the camera's view projection matrix.
+	void BeginFrame(const glm::mat4& viewProjection);
+
+	// Add an occluder to draw this frame. The mesh has to stay alive until RenderOccluders.
+	// Params: the occluder mesh, its world matrix.
+	void AddOccluder(const OccluderMesh& mesh, const glm::mat4& worldMatrix);
+
+	// Draw the occluders into the depth buffer and build the depth pyramid.
+	// Params: the job system to spread the work over, can be nullptr.
+	void RenderOccluders(JobSystem* jobSystem);
+
+	// Remove the objects hidden behind the occluders from a list, keeping the order of the rest.
+	// Params: world bounds indexed by object, the object list to compact, how many objects are in the list, the job system.
+	// Returns: how many objects are left.
+	size_t CullObjects(const AABB* worldBounds, uint* objects, size_t objectCount, JobSystem* jobSystem);
+
+	// Check if a box is hidden behind the occluders.
+	// Params: the world space box.
+	// Returns: if the box is hidden.
+	bool IsOccluded(const AABB& worldBounds) const;
+
+	// Get the counts from the last frame.
+	// Returns: the stats.
+	const OcclusionStats& GetStats() const { return m_Stats; }
+
+	// Get the depth buffer, for debugging.
+	// Returns: width * height depths, 0 near and 1 far.
+	const float* GetDepthBuffer() const { return m_DepthPyramid.data(); }
+
+	// Get the width of the depth buffer.
+	// Returns: the width in pixels.
+	uint GetWidth() const { return m_Width; }
+
+	// Get the height of the depth buffer.
+	// Returns: the height in pixels.
+	uint GetHeight() const { return m_Height; }
+
+	// Triangle in depth buffer pixel space.
+	struct ScreenTriangle
+	{
+		glm::vec3 m_Vertices[3];
+		bool m_Valid;
+	};
+
+	// Draws a triangle into the rows of the depth buffer between minY and maxY.
+	// Params: the triangle, the depth buffer, its width, the first row, one past the last row.
+	typedef void (*RasterizeFunction)(const ScreenTriangle& triangle, float* depth, uint width, uint minY, uint maxY);
+
+private:
+	// Transform a range of occluders into screen triangles.
+	static void TransformOccluders(void* data, size_t begin, size_t end);
+
+	// Draw every triangle into a range of bands.
+	static void RasterizeBands(void* data, size_t begin, size_t end);
+
+	// Test a range of objects against the depth pyramid.
+	static void TestObjects(void* data, size_t begin, size_t end);
+
+	// An occluder added this frame.
+	struct OccluderInstance
+	{
+		const OccluderMesh* m_Mesh;
+		glm::mat4 m_WorldMatrix;
+		size_t m_FirstTriangle;
+	};
+
+	// Size of the depth buffer.
+	uint m_Width;
+	uint m_Height;
+
+	// Rows per band drawn by one job.
+	uint m_BandHeight;
+
+	// The camera's view projection matrix this frame.
+	glm::mat4 m_ViewProjection;
+
+	// Occluders added this frame.
+	std::vector<OccluderInstance> m_Occluders;
+
+	// Triangles of every occluder in pixel space.
+	std::vector<ScreenTriangle> m_Triangles;
+
+	// Max depth pyramid, level 0 is the full depth buffer.
+	std::vector<float> m_DepthPyramid;
+
+	// Offset, width and height of each pyramid level.
+	std::vector<uint> m_LevelOffsets;
+	std::vector<uint> m_LevelWidths;
+	std::vector<uint> m_LevelHeights;
+
+	// Visibility result per entry of the list being culled.
+	std::vector<uint8_t> m_Results;
+
+	// The AVX2 or SSE rasterizer chosen for this cpu.
+	RasterizeFunction m_Rasterize;
+
+	// Counts from the last frame.
+	OcclusionStats m_Stats;
+
+	// Values passed to the object test jobs.
+	const AABB* m_TestBounds = nullptr;
+	const uint* m_TestObjects = nullptr;
+};
\ No newline at end of file
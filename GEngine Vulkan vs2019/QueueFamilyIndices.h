@@ -12,4 +12,8 @@ struct QueueFamilyIndices
 	std::optional<uint> m_GraphicsFamily;
 	// (feelsbadman)
 	std::optional<uint> m_PresentFamily;
+
+	// A family for compute work alongside the graphics queue, one without graphics if there is one, otherwise the
+	// graphics family when it has a second queue. Not needed to be complete.
+	std::optional<uint> m_ComputeFamily;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "RadixSort.h"
+#include <algorithm>
+#include <cstring>
+
+// Items per chunk when sorting in parallel. Smaller chunks spend more time on the prefix sum than they save.
+static const size_t SORT_CHUNK_SIZE = 16 * 1024;
+// Digits per pass.
+static const uint RADIX_BITS = 8;
+static const uint RADIX_SIZE = 1 << RADIX_BITS;
+
+// State shared by the chunks of a pass.
+struct SortJob
+{
+	const SortItem* m_Source;
+	SortItem* m_Destination;
+	size_t m_Count;
+	uint m_Shift;
+	uint* m_Histograms;
+	uint64_t* m_ChunkBits;
+};
+
+static void FindChangingBits(void* data, size_t begin, size_t end)
+{
+	SortJob* job = (SortJob*)data;
+	uint64_t firstKey = job->m_Source[0].m_Key;
+
+	for (size_t chunk = begin; chunk < end; ++chunk)
+	{
+		size_t first = chunk * SORT_CHUNK_SIZE;
+		size_t last = std::min(first + SORT_CHUNK_SIZE, job->m_Count);
+
+		uint64_t bits = 0;
+		for (size_t i = first; i < last; ++i)
+			bits |= job->m_Source[i].m_Key ^ firstKey;
+
+		job->m_ChunkBits[chunk] = bits;
+	}
+}
+
+static void CountDigits(void* data, size_t begin, size_t end)
+{
+	SortJob* job = (SortJob*)data;
+
+	for (size_t chunk = begin; chunk < end; ++chunk)
+	{
+		size_t first = chunk * SORT_CHUNK_SIZE;
+		size_t last = std::min(first + SORT_CHUNK_SIZE, job->m_Count);
+
+		uint* histogram = job->m_Histograms + chunk * RADIX_SIZE;
+		memset(histogram, 0, RADIX_SIZE * sizeof(uint));
+		for (size_t i = first; i < last; ++i)
+			++histogram[(job->m_Source[i].m_Key >> job->m_Shift) & (RADIX_SIZE - 1)];
+	}
+}
+
+static void ScatterDigits(void* data, size_t begin, size_t end)
+{
+	SortJob* job = (SortJob*)data;
+
+	for (size_t chunk = begin; chunk < end; ++chunk)
+	{
+		size_t first = chunk * SORT_CHUNK_SIZE;
+		size_t last = std::min(first + SORT_CHUNK_SIZE, job->m_Count);
+
+		// Offsets are per chunk, so chunks never write to the same place and stay in order.
+		uint* offsets = job->m_Histograms + chunk * RADIX_SIZE;
+		for (size_t i = first; i < last; ++i)
+		{
+			const SortItem& item = job->m_Source[i];
+			job->m_Destination[offsets[(item.m_Key >> job->m_Shift) & (RADIX_SIZE - 1)]++] = item;
+		}
+	}
+}
+
+void RadixSorter::Sort(SortItem* items, size_t count, JobSystem* jobSystem)
+{
+	if (count < 2)
+		return;
+
+	size_t chunkCount = (count + SORT_CHUNK_SIZE - 1) / SORT_CHUNK_SIZE;
+	if (m_Scratch.size() < count)
+		m_Scratch.resize(count);
+	if (m_Histograms.size() < chunkCount * RADIX_SIZE)
+	{
+		m_Histograms.resize(chunkCount * RADIX_SIZE);
+		m_ChunkBits.resize(chunkCount);
+	}
+
+	// One chunk isn't worth waking the workers for.
+	bool parallel = jobSystem != nullptr && chunkCount > 1 && jobSystem->GetThreadCount() > 1;
+
+	SortJob job;
+	job.m_Source = items;
+	job.m_Destination = m_Scratch.data();
+	job.m_Count = count;
+	job.m_Shift = 0;
+	job.m_Histograms = m_Histograms.data();
+	job.m_ChunkBits = m_ChunkBits.data();
+
+	if (parallel)
+		jobSystem->ParallelFor(chunkCount, 1, FindChangingBits, &job);
+	else
+		FindChangingBits(&job, 0, chunkCount);
+
+	uint64_t changingBits = 0;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+		changingBits |= m_ChunkBits[chunk];
+
+	for (uint shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		// Every key has the same digit here, the pass wouldn't move anything.
+		if (((changingBits >> shift) & (RADIX_SIZE - 1)) == 0)
+			continue;
+
+		job.m_Shift = shift;
+		if (parallel)
+			jobSystem->ParallelFor(chunkCount, 1, CountDigits, &job);
+		else
+			CountDigits(&job, 0, chunkCount);
+
+		// Turn the counts into where each chunk writes its first item of each digit.
+		uint offset = 0;
+		for (uint digit = 0; digit < RADIX_SIZE; ++digit)
+		{
+			for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				uint digitCount = m_Histograms[chunk * RADIX_SIZE + digit];
+				m_Histograms[chunk * RADIX_SIZE + digit] = offset;
+				offset += digitCount;
+			}
+		}
+
+		if (parallel)
+			jobSystem->ParallelFor(chunkCount, 1, ScatterDigits, &job);
+		else
+			ScatterDigits(&job, 0, chunkCount);
+
+		SortItem* written = job.m_Destination;
+		job.m_Destination = (SortItem*)job.m_Source;
+		job.m_Source = written;
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer.
+	if (job.m_Source != items)
+		memcpy(items, job.m_Source, count * sizeof(SortItem));
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include "JobSystem.h"
+#include <vector>
+
+// A 64 bit key and the value sorted along with it.
+struct SortItem
+{
+	uint64_t m_Key;
+	uint m_Value;
+};
+
+// Stable least significant digit radix sort of 64 bit keys, 8 bits per pass.
+// Passes over bytes that are the same in every key are skipped, so keys that only use a few of their
+// fields sort in a few passes. Large arrays are split into chunks over the job system: each chunk counts
+// its digits, the counts are prefix summed in chunk order, and each chunk scatters to its own offsets.
+class RadixSorter
+{
+public:
+	// Sort items by key, keeping items with equal keys in the order they were given.
+	// Params: the items, amount of items, the job system to spread the passes over, or nullptr to sort on the calling thread.
+	void Sort(SortItem* items, size_t count, JobSystem* jobSystem);
+
+private:
+	// Items are written here on odd passes.
+	std::vector<SortItem> m_Scratch;
+
+	// 256 digit counts per chunk, turned into write offsets before scattering.
+	std::vector<uint> m_Histograms;
+
+	// Bits that differ from the first key, per chunk.
+	std::vector<uint64_t> m_ChunkBits;
+};
\ No newline at end of file
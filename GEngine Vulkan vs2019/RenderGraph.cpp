@@ -0,0 +1,801 @@
+#include "RenderGraph.h"
+#include "DeletionQueue.h"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+
+// What each access needs. Layouts are only used for images.
+struct AccessInfo
+{
+	VkPipelineStageFlags m_Stages;
+	VkAccessFlags m_ReadAccess;
+	VkAccessFlags m_WriteAccess;
+	VkImageLayout m_Layout;
+};
+
+static const AccessInfo ACCESS_INFO[RENDER_GRAPH_ACCESS_COUNT] =
+{
+	// Colour attachment.
+	{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+	// Depth attachment.
+	{ VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
+	// Fragment sampled.
+	{ VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	// Compute sampled.
+	{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	// Compute storage.
+	{ VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL },
+	// Indirect, buffers only.
+	{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED },
+	// Transfer source.
+	{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+	// Transfer destination.
+	{ VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+	// Present, only as an output.
+	{ VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR },
+};
+
+// Stages a compute queue can run. Async compute passes can only use accesses in these.
+static const VkPipelineStageFlags COMPUTE_QUEUE_STAGES = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT |
+	VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+static const char* LayoutName(VkImageLayout layout)
+{
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED: return "undefined";
+	case VK_IMAGE_LAYOUT_GENERAL: return "general";
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "colour attachment";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "depth attachment";
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "shader read";
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "transfer source";
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "transfer destination";
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "present";
+	default: return "other";
+	}
+}
+
+RenderGraph::RenderGraph(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReleaseTransientImages();
+}
+
+void RenderGraph::Reset()
+{
+	ReleaseTransientImages();
+	m_Passes.clear();
+	m_Resources.clear();
+	m_Steps.clear();
+	m_Segments.clear();
+	m_Stats = RenderGraphStats();
+}
+
+RenderGraphResource RenderGraph::ImportImage(const char* name, VkImage image, VkImageView imageView, VkImageAspectFlags aspect, uint mipLevels)
+{
+	Resource resource;
+	resource.m_Name = name;
+	resource.m_Image = true;
+	resource.m_Transient = false;
+	resource.m_VkImage = image;
+	resource.m_VkImageView = imageView;
+	resource.m_Aspect = aspect;
+	resource.m_MipLevels = mipLevels;
+	m_Resources.push_back(resource);
+	return (RenderGraphResource)(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::ImportBuffer(const char* name)
+{
+	Resource resource;
+	resource.m_Name = name;
+	resource.m_Image = false;
+	resource.m_Transient = false;
+	m_Resources.push_back(resource);
+	return (RenderGraphResource)(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateImage(const char* name, const RenderGraphImageDesc& desc)
+{
+	Resource resource;
+	resource.m_Name = name;
+	resource.m_Image = true;
+	resource.m_Transient = true;
+	resource.m_Aspect = desc.m_Aspect;
+	resource.m_MipLevels = desc.m_MipLevels;
+	resource.m_Desc = desc;
+	m_Resources.push_back(resource);
+	return (RenderGraphResource)(m_Resources.size() - 1);
+}
+
+void RenderGraph::SetImage(RenderGraphResource resource, VkImage image, VkImageView imageView)
+{
+	m_Resources[resource].m_VkImage = image;
+	m_Resources[resource].m_VkImageView = imageView;
+}
+
+uint RenderGraph::AddPass(const char* name, RenderGraphPassFunction function, void* data)
+{
+	Pass pass;
+	pass.m_Name = name;
+	pass.m_Function = function;
+	pass.m_Data = data;
+	m_Passes.push_back(pass);
+	return (uint)(m_Passes.size() - 1);
+}
+
+void RenderGraph::Read(uint pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+	AddUse(pass, resource, access, true, false);
+}
+
+void RenderGraph::Write(uint pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+	AddUse(pass, resource, access, false, true);
+}
+
+void RenderGraph::SetSideEffects(uint pass)
+{
+	m_Passes[pass].m_SideEffects = true;
+}
+
+void RenderGraph::MarkOutput(RenderGraphResource resource, RenderGraphAccess access)
+{
+	m_Resources[resource].m_Output = true;
+	m_Resources[resource].m_OutputAccess = access;
+}
+
+void RenderGraph::SetAsyncComputeEnabled(bool enabled, bool sharedImages)
+{
+	m_AsyncComputeEnabled = enabled;
+	m_SharedImages = sharedImages;
+}
+
+void RenderGraph::SetAsyncCompute(uint pass)
+{
+	m_Passes[pass].m_AsyncCompute = true;
+}
+
+void RenderGraph::AddUse(uint pass, RenderGraphResource resource, RenderGraphAccess access, bool read, bool write)
+{
+	const AccessInfo& info = ACCESS_INFO[access];
+	const Resource& graphResource = m_Resources[resource];
+
+	if ((read && info.m_ReadAccess == 0) || (write && info.m_WriteAccess == 0))
+		throw std::runtime_error("Render graph resource " + graphResource.m_Name + " can't be " + (read ? "read" : "written") + " that way!");
+
+	if (graphResource.m_Image && info.m_Layout == VK_IMAGE_LAYOUT_UNDEFINED)
+		throw std::runtime_error("Render graph resource " + graphResource.m_Name + " is an image, which can't be used that way!");
+
+	VkImageLayout layout = graphResource.m_Image ? info.m_Layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+	// Every use of a resource in a pass becomes one, as the pass can't have a barrier in the middle of it.
+	for (ResourceUse& use : m_Passes[pass].m_Uses)
+	{
+		if (use.m_Resource != resource)
+			continue;
+
+		if (use.m_Layout != layout)
+			throw std::runtime_error("Render graph pass " + m_Passes[pass].m_Name + " needs " + graphResource.m_Name + " in two layouts!");
+
+		use.m_Stages |= info.m_Stages;
+		use.m_ReadAccess |= read ? info.m_ReadAccess : 0;
+		use.m_WriteAccess |= write ? info.m_WriteAccess : 0;
+		use.m_Read |= read;
+		use.m_Write |= write;
+		return;
+	}
+
+	ResourceUse use;
+	use.m_Resource = resource;
+	use.m_Stages = info.m_Stages;
+	use.m_ReadAccess = read ? info.m_ReadAccess : 0;
+	use.m_WriteAccess = write ? info.m_WriteAccess : 0;
+	use.m_Layout = layout;
+	use.m_Read = read;
+	use.m_Write = write;
+	m_Passes[pass].m_Uses.push_back(use);
+}
+
+void RenderGraph::Compile()
+{
+	ReleaseTransientImages();
+	m_Steps.clear();
+	m_Segments.clear();
+	for (uint& count : m_QueueSegmentCounts)
+		count = 0;
+	m_Stats = RenderGraphStats();
+
+	CullPasses();
+	AssignQueues();
+	CreateTransientImages();
+
+	// Run through once from nothing to find where every resource ends up, which is where it starts the next execute.
+	std::vector<ResourceState> finalStates(m_Resources.size());
+	Simulate(finalStates, false);
+
+	// Passes from the last execute are counted back from this one's first, with the output step as the last pass.
+	int passSlots = (int)m_Passes.size() + 1;
+
+	std::vector<ResourceState> states(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+	{
+		const Resource& resource = m_Resources[i];
+		if (resource.m_Transient)
+		{
+			// A different image had the memory last, so only its accesses have to finish, nothing carries over. The first
+			// image in a block follows the last one from the last execute.
+			const ResourceState& previous = finalStates[resource.m_AliasPrevious];
+			states[i].m_WriteStages = previous.m_WriteStages | previous.m_ReadStages;
+			states[i].m_WriteAccess = previous.m_WriteAccess;
+			states[i].m_Used = previous.m_Used;
+			states[i].m_Queue = previous.m_Queue;
+			states[i].m_Pass = previous.m_Pass >= (int)resource.m_FirstPass ? previous.m_Pass - passSlots : previous.m_Pass;
+		}
+		else if (finalStates[i].m_Layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+		{
+			// Presented images come back through the acquire semaphore, which is waited on at colour attachment output.
+			states[i].m_Layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			states[i].m_WriteStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+		else
+		{
+			states[i] = finalStates[i];
+			states[i].m_Pass -= passSlots;
+		}
+	}
+
+	Simulate(states, true);
+	BuildSegments();
+
+	size_t maxImageBarriers = 0;
+	for (const Step& step : m_Steps)
+	{
+		if (step.m_Barriers.m_SrcStages != 0)
+			++m_Stats.m_BarrierCount;
+		m_Stats.m_ImageBarrierCount += step.m_Barriers.m_ImageBarriers.size();
+		maxImageBarriers = std::max(maxImageBarriers, step.m_Barriers.m_ImageBarriers.size());
+	}
+
+	// Sized now so executing never allocates.
+	m_VkImageBarriers.resize(maxImageBarriers);
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walk back from the outputs, keeping passes that write something a kept pass or the outputs need.
+	std::vector<bool> needed(m_Resources.size(), false);
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+		needed[i] = m_Resources[i].m_Output;
+
+	m_Stats.m_PassCount = m_Passes.size();
+	for (size_t i = m_Passes.size(); i-- > 0;)
+	{
+		Pass& pass = m_Passes[i];
+		bool used = pass.m_SideEffects;
+		for (const ResourceUse& use : pass.m_Uses)
+		{
+			if (use.m_Write && needed[use.m_Resource])
+				used = true;
+		}
+
+		pass.m_Culled = !used;
+		if (!used)
+		{
+			++m_Stats.m_CulledPassCount;
+			continue;
+		}
+
+		// Whatever it overwrites isn't needed from earlier passes, whatever it reads is.
+		for (const ResourceUse& use : pass.m_Uses)
+		{
+			if (use.m_Write && !use.m_Read)
+				needed[use.m_Resource] = false;
+		}
+
+		for (const ResourceUse& use : pass.m_Uses)
+		{
+			if (use.m_Read)
+				needed[use.m_Resource] = true;
+		}
+	}
+}
+
+void RenderGraph::AssignQueues()
+{
+	for (Pass& pass : m_Passes)
+	{
+		pass.m_Queue = FRAME_QUEUE_GRAPHICS;
+		if (!pass.m_AsyncCompute)
+			continue;
+
+		bool images = false;
+		for (const ResourceUse& use : pass.m_Uses)
+		{
+			if (use.m_Stages & ~COMPUTE_QUEUE_STAGES)
+				throw std::runtime_error("Render graph pass " + pass.m_Name + " is marked for async compute, but uses " + m_Resources[use.m_Resource].m_Name +
+					" in a way only the graphics queue can!");
+
+			images |= m_Resources[use.m_Resource].m_Image;
+		}
+
+		// Images belong to the graphics queue's family, so with the compute queue in another, passes using them stay on the graphics queue.
+		if (!m_AsyncComputeEnabled || pass.m_Culled || (images && !m_SharedImages))
+			continue;
+
+		pass.m_Queue = FRAME_QUEUE_COMPUTE;
+		++m_Stats.m_AsyncPassCount;
+	}
+}
+
+void RenderGraph::CreateTransientImages()
+{
+	std::vector<RenderGraphResource> transients;
+	std::vector<bool> used(m_Resources.size(), false);
+
+	for (size_t i = 0; i < m_Passes.size(); ++i)
+	{
+		if (m_Passes[i].m_Culled)
+			continue;
+
+		for (const ResourceUse& use : m_Passes[i].m_Uses)
+		{
+			Resource& resource = m_Resources[use.m_Resource];
+			if (!resource.m_Transient)
+				continue;
+
+			if (!used[use.m_Resource])
+			{
+				// Memory is shared with whatever was there before, so the first use can't expect anything in it.
+				if (use.m_Read)
+					throw std::runtime_error("Render graph transient image " + resource.m_Name + " is read before it's written!");
+
+				used[use.m_Resource] = true;
+				resource.m_FirstPass = i;
+				transients.push_back(use.m_Resource);
+			}
+
+			resource.m_LastPass = i;
+		}
+	}
+
+	for (RenderGraphResource index : transients)
+	{
+		Resource& resource = m_Resources[index];
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = resource.m_Desc.m_Extent.width;
+		imageInfo.extent.height = resource.m_Desc.m_Extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = resource.m_Desc.m_MipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.m_Desc.m_Format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.m_Desc.m_Usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &resource.m_VkImage) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create render graph image!");
+
+		vkGetImageMemoryRequirements(m_VkDevice, resource.m_VkImage, &resource.m_MemoryRequirements);
+		m_Stats.m_TransientBytes += resource.m_MemoryRequirements.size;
+	}
+
+	// Biggest first, each into the first block it fits in without overlapping another image's lifetime.
+	std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+	{
+		return m_Resources[a].m_MemoryRequirements.size > m_Resources[b].m_MemoryRequirements.size;
+	});
+
+	for (RenderGraphResource index : transients)
+	{
+		Resource& resource = m_Resources[index];
+		const VkMemoryRequirements& requirements = resource.m_MemoryRequirements;
+
+		size_t blockIndex = 0;
+		for (; blockIndex < m_MemoryBlocks.size(); ++blockIndex)
+		{
+			const MemoryBlock& block = m_MemoryBlocks[blockIndex];
+			if ((block.m_MemoryTypeBits & requirements.memoryTypeBits) == 0)
+				continue;
+
+			bool overlaps = false;
+			for (RenderGraphResource other : block.m_Resources)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (resource.m_FirstPass <= otherResource.m_LastPass && otherResource.m_FirstPass <= resource.m_LastPass)
+					overlaps = true;
+			}
+
+			if (!overlaps)
+				break;
+		}
+
+		if (blockIndex == m_MemoryBlocks.size())
+			m_MemoryBlocks.push_back(MemoryBlock());
+
+		MemoryBlock& block = m_MemoryBlocks[blockIndex];
+		block.m_Size = std::max(block.m_Size, requirements.size);
+		block.m_Alignment = std::max(block.m_Alignment, requirements.alignment);
+		block.m_MemoryTypeBits &= requirements.memoryTypeBits;
+		block.m_Resources.push_back(index);
+		resource.m_MemoryBlock = (uint)blockIndex;
+	}
+
+	for (MemoryBlock& block : m_MemoryBlocks)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.m_Size;
+		allocInfo.memoryTypeIndex = m_Renderer->FindMemoryType(block.m_MemoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (vkAllocateMemory(m_VkDevice, &allocInfo, nullptr, &block.m_VkMemory) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate render graph memory!");
+
+		m_Stats.m_AliasedBytes += block.m_Size;
+
+		// In the order they're used, each image waits for the one before it to finish with the memory, the first for last frame's last.
+		std::sort(block.m_Resources.begin(), block.m_Resources.end(), [this](RenderGraphResource a, RenderGraphResource b)
+		{
+			return m_Resources[a].m_FirstPass < m_Resources[b].m_FirstPass;
+		});
+
+		for (size_t i = 0; i < block.m_Resources.size(); ++i)
+		{
+			Resource& resource = m_Resources[block.m_Resources[i]];
+			resource.m_AliasPrevious = block.m_Resources[(i + block.m_Resources.size() - 1) % block.m_Resources.size()];
+
+			vkBindImageMemory(m_VkDevice, resource.m_VkImage, block.m_VkMemory, 0);
+			resource.m_VkImageView = m_Renderer->CreateImageView(resource.m_VkImage, resource.m_Desc.m_Format, resource.m_Aspect, 0, resource.m_MipLevels);
+		}
+	}
+}
+
+void RenderGraph::ReleaseTransientImages()
+{
+	// Frames in flight could have been recorded with them, so the graph can be built again without waiting for the GPU.
+	DeletionQueue* deletionQueue = m_Renderer->GetDeletionQueue();
+	for (Resource& resource : m_Resources)
+	{
+		if (!resource.m_Transient || resource.m_VkImage == VK_NULL_HANDLE)
+			continue;
+
+		deletionQueue->Destroy(UniqueImageView(m_VkDevice, resource.m_VkImageView));
+		deletionQueue->Destroy(UniqueImage(m_VkDevice, resource.m_VkImage));
+
+		resource.m_VkImage = VK_NULL_HANDLE;
+		resource.m_VkImageView = VK_NULL_HANDLE;
+	}
+
+	for (MemoryBlock& block : m_MemoryBlocks)
+		deletionQueue->Destroy(UniqueDeviceMemory(m_VkDevice, block.m_VkMemory));
+	m_MemoryBlocks.clear();
+}
+
+void RenderGraph::Simulate(std::vector<ResourceState>& states, bool recordSteps)
+{
+	// The latest pass on the other queue each queue has waited for, which covers everything before it there too.
+	int waitedPasses[FRAME_QUEUE_COUNT] = { INT_MIN, INT_MIN };
+
+	for (size_t i = 0; i < m_Passes.size(); ++i)
+	{
+		if (m_Passes[i].m_Culled)
+			continue;
+
+		Step step;
+		step.m_Pass = i;
+		step.m_Queue = m_Passes[i].m_Queue;
+		for (const ResourceUse& use : m_Passes[i].m_Uses)
+		{
+			ResourceState& state = states[use.m_Resource];
+			WaitForQueue(step, m_Resources[use.m_Resource], state, waitedPasses[step.m_Queue]);
+			AddBarrier(step.m_Barriers, m_Resources[use.m_Resource], state, use);
+			state.m_Used = true;
+			state.m_Queue = step.m_Queue;
+			state.m_Pass = (int)i;
+		}
+
+		if (step.m_Wait)
+			waitedPasses[step.m_Queue] = step.m_WaitPass;
+
+		if (recordSteps)
+			m_Steps.push_back(step);
+	}
+
+	// Outputs are left how they're used next, with a last step on the graphics queue that only has barriers.
+	Step outputStep;
+	outputStep.m_Pass = m_Passes.size();
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+	{
+		if (!m_Resources[i].m_Output)
+			continue;
+
+		const AccessInfo& info = ACCESS_INFO[m_Resources[i].m_OutputAccess];
+
+		ResourceUse use;
+		use.m_Resource = (RenderGraphResource)i;
+		use.m_Stages = info.m_Stages;
+		use.m_ReadAccess = info.m_ReadAccess;
+		use.m_WriteAccess = 0;
+		use.m_Layout = m_Resources[i].m_Image ? info.m_Layout : VK_IMAGE_LAYOUT_UNDEFINED;
+		use.m_Read = true;
+		use.m_Write = false;
+		WaitForQueue(outputStep, m_Resources[i], states[i], waitedPasses[FRAME_QUEUE_GRAPHICS]);
+		AddBarrier(outputStep.m_Barriers, m_Resources[i], states[i], use);
+		states[i].m_Used = true;
+		states[i].m_Queue = FRAME_QUEUE_GRAPHICS;
+		states[i].m_Pass = (int)m_Passes.size();
+	}
+
+	// It's kept without barriers too, as the frame always ends on the graphics queue and the other queue can wait for it.
+	if (recordSteps)
+		m_Steps.push_back(outputStep);
+}
+
+void RenderGraph::WaitForQueue(Step& step, const Resource& resource, ResourceState& state, int waitedPass)
+{
+	if (!state.m_Used || state.m_Queue == step.m_Queue)
+		return;
+
+	// Waiting for the latest pass covers the earlier ones, which its queue ran first, and an earlier wait on this queue might already.
+	if (state.m_Pass > waitedPass)
+	{
+		step.m_WaitPass = step.m_Wait ? std::max(step.m_WaitPass, state.m_Pass) : state.m_Pass;
+		step.m_Wait = true;
+	}
+
+	// The semaphore wait is on every stage, so a transition after it only has to wait on every stage too, without access.
+	// Buffers need nothing more, and images only ever need the transition.
+	state.m_WriteStages = resource.m_Image ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : 0;
+	state.m_WriteAccess = 0;
+	state.m_ReadStages = state.m_WriteStages;
+	state.m_VisibleAccess = resource.m_Image ? ~0u : 0;
+}
+
+void RenderGraph::BuildSegments()
+{
+	// The last execute's passes are counted back from this one's first.
+	int passSlots = (int)m_Passes.size() + 1;
+	std::vector<int> passSteps(passSlots, -1);
+	for (size_t i = 0; i < m_Steps.size(); ++i)
+		passSteps[m_Steps[i].m_Pass] = (int)i;
+
+	for (const Step& step : m_Steps)
+	{
+		if (step.m_Wait)
+			m_Steps[passSteps[step.m_WaitPass < 0 ? step.m_WaitPass + passSlots : step.m_WaitPass]].m_Signals = true;
+	}
+
+	// A segment goes on until the queue changes, a step waits for the other queue, or the other queue waits for the step before.
+	for (size_t i = 0; i < m_Steps.size(); ++i)
+	{
+		Step& step = m_Steps[i];
+		if (i == 0 || step.m_Queue != m_Steps[i - 1].m_Queue || step.m_Wait || m_Steps[i - 1].m_Signals)
+		{
+			RenderGraphSegment segment;
+			segment.m_Queue = step.m_Queue;
+			segment.m_QueueIndex = m_QueueSegmentCounts[step.m_Queue]++;
+			segment.m_FirstStep = i;
+			m_Segments.push_back(segment);
+		}
+
+		++m_Segments.back().m_StepCount;
+		step.m_Segment = (uint)(m_Segments.size() - 1);
+	}
+
+	// Only a segment's first step can wait, it waits for the segment the pass ends on the other queue.
+	for (RenderGraphSegment& segment : m_Segments)
+	{
+		const Step& step = m_Steps[segment.m_FirstStep];
+		if (!step.m_Wait)
+			continue;
+
+		bool lastExecute = step.m_WaitPass < 0;
+		const RenderGraphSegment& waited = m_Segments[m_Steps[passSteps[lastExecute ? step.m_WaitPass + passSlots : step.m_WaitPass]].m_Segment];
+		segment.m_Wait = true;
+		segment.m_WaitQueueIndex = (int)waited.m_QueueIndex - (lastExecute ? (int)m_QueueSegmentCounts[waited.m_Queue] : 0);
+		++m_Stats.m_QueueWaitCount;
+	}
+
+	m_Stats.m_SegmentCount = m_Segments.size();
+}
+
+void RenderGraph::AddBarrier(BarrierBatch& batch, const Resource& resource, ResourceState& state, const ResourceUse& use)
+{
+	// Images that are written without being read start from undefined, so nothing is kept from before.
+	bool discard = resource.m_Image && !use.m_Read;
+	bool transition = resource.m_Image && (discard || state.m_Layout != use.m_Layout);
+
+	VkPipelineStageFlags srcStages = 0;
+	VkAccessFlags srcAccess = 0;
+	bool needed = false;
+
+	if (transition || use.m_Write)
+	{
+		// Changing or overwriting it waits for everything since the last write, reads included.
+		srcStages = state.m_WriteStages | state.m_ReadStages;
+		srcAccess = state.m_WriteAccess;
+		needed = transition || srcStages != 0;
+	}
+	else if (state.m_WriteStages != 0 && ((use.m_Stages & ~state.m_ReadStages) != 0 || (use.m_ReadAccess & ~state.m_VisibleAccess) != 0))
+	{
+		// Reads only wait for the last write, and only once per stage and access.
+		srcStages = state.m_WriteStages;
+		srcAccess = state.m_WriteAccess;
+		needed = true;
+	}
+
+	if (needed)
+	{
+		VkAccessFlags dstAccess = use.m_ReadAccess | use.m_WriteAccess;
+
+		// Without sync2 a barrier can't wait on no stages, so waiting on nothing is the top of the pipe.
+		batch.m_SrcStages |= srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		batch.m_DstStages |= use.m_Stages;
+
+		if (transition)
+		{
+			ImageBarrier imageBarrier;
+			imageBarrier.m_Resource = use.m_Resource;
+			imageBarrier.m_SrcAccess = srcAccess;
+			imageBarrier.m_DstAccess = dstAccess;
+			imageBarrier.m_OldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.m_Layout;
+			imageBarrier.m_NewLayout = use.m_Layout;
+			batch.m_ImageBarriers.push_back(imageBarrier);
+		}
+		else if (srcAccess != 0)
+		{
+			// Everything else shares a global memory barrier, which is no slower than one per resource.
+			batch.m_MemoryBarrier = true;
+			batch.m_MemorySrcAccess |= srcAccess;
+			batch.m_MemoryDstAccess |= dstAccess;
+		}
+	}
+
+	if (use.m_Write)
+	{
+		state.m_WriteStages = use.m_Stages;
+		state.m_WriteAccess = use.m_WriteAccess;
+		state.m_ReadStages = 0;
+		state.m_VisibleAccess = 0;
+	}
+	else
+	{
+		// A layout transition finishes before the stages it was for, so later reads can wait on them instead.
+		if (transition)
+			state.m_WriteStages = use.m_Stages;
+		if (needed)
+			state.m_VisibleAccess |= use.m_ReadAccess;
+		state.m_ReadStages |= use.m_Stages;
+	}
+
+	if (resource.m_Image)
+		state.m_Layout = use.m_Layout;
+}
+
+void RenderGraph::Execute(uint segment, VkCommandBuffer commandBuffer)
+{
+	const RenderGraphSegment& graphSegment = m_Segments[segment];
+	for (size_t stepIndex = graphSegment.m_FirstStep; stepIndex < graphSegment.m_FirstStep + graphSegment.m_StepCount; ++stepIndex)
+	{
+		const Step& step = m_Steps[stepIndex];
+		const BarrierBatch& batch = step.m_Barriers;
+		if (batch.m_SrcStages != 0)
+		{
+			for (size_t i = 0; i < batch.m_ImageBarriers.size(); ++i)
+			{
+				const ImageBarrier& imageBarrier = batch.m_ImageBarriers[i];
+				const Resource& resource = m_Resources[imageBarrier.m_Resource];
+
+				VkImageMemoryBarrier& barrier = m_VkImageBarriers[i];
+				barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = imageBarrier.m_SrcAccess;
+				barrier.dstAccessMask = imageBarrier.m_DstAccess;
+				barrier.oldLayout = imageBarrier.m_OldLayout;
+				barrier.newLayout = imageBarrier.m_NewLayout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = resource.m_VkImage;
+				barrier.subresourceRange.aspectMask = resource.m_Aspect;
+				barrier.subresourceRange.levelCount = resource.m_MipLevels;
+				barrier.subresourceRange.layerCount = 1;
+			}
+
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = batch.m_MemorySrcAccess;
+			memoryBarrier.dstAccessMask = batch.m_MemoryDstAccess;
+
+			vkCmdPipelineBarrier(commandBuffer, batch.m_SrcStages, batch.m_DstStages, 0, batch.m_MemoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+				(uint)batch.m_ImageBarriers.size(), m_VkImageBarriers.data());
+		}
+
+		if (step.m_Pass < m_Passes.size())
+			m_Passes[step.m_Pass].m_Function(commandBuffer, m_Passes[step.m_Pass].m_Data);
+	}
+}
+
+std::string RenderGraph::Dump() const
+{
+	std::ostringstream out;
+	out << "Render graph: " << m_Stats.m_PassCount - m_Stats.m_CulledPassCount << " passes, " << m_Stats.m_CulledPassCount << " culled, "
+		<< m_Stats.m_BarrierCount << " barriers with " << m_Stats.m_ImageBarrierCount << " image barriers, " << m_Stats.m_SegmentCount << " segments, "
+		<< m_Stats.m_AsyncPassCount << " async compute passes." << std::endl;
+
+	for (size_t stepIndex = 0; stepIndex < m_Steps.size(); ++stepIndex)
+	{
+		const Step& step = m_Steps[stepIndex];
+		const RenderGraphSegment& segment = m_Segments[step.m_Segment];
+		if (segment.m_FirstStep == stepIndex)
+		{
+			out << "  Segment " << step.m_Segment << " on the " << (segment.m_Queue == FRAME_QUEUE_GRAPHICS ? "graphics" : "compute") << " queue";
+			if (segment.m_Wait)
+			{
+				out << ", waits for the " << (segment.m_Queue == FRAME_QUEUE_GRAPHICS ? "compute" : "graphics") << " queue's segment "
+					<< (segment.m_WaitQueueIndex < 0 ? segment.m_WaitQueueIndex + (int)m_QueueSegmentCounts[1 - segment.m_Queue] : segment.m_WaitQueueIndex)
+					<< (segment.m_WaitQueueIndex < 0 ? " of the last execute" : "");
+			}
+			out << std::endl;
+		}
+
+		const BarrierBatch& batch = step.m_Barriers;
+		if (batch.m_SrcStages != 0)
+		{
+			out << std::hex << "  Barrier, stages 0x" << batch.m_SrcStages << " -> 0x" << batch.m_DstStages;
+			if (batch.m_MemoryBarrier)
+				out << ", memory 0x" << batch.m_MemorySrcAccess << " -> 0x" << batch.m_MemoryDstAccess;
+			out << std::dec << std::endl;
+
+			for (const ImageBarrier& imageBarrier : batch.m_ImageBarriers)
+			{
+				out << "    " << m_Resources[imageBarrier.m_Resource].m_Name << ": " << LayoutName(imageBarrier.m_OldLayout) << " -> "
+					<< LayoutName(imageBarrier.m_NewLayout) << std::endl;
+			}
+		}
+
+		if (step.m_Pass >= m_Passes.size())
+			continue;
+
+		const Pass& pass = m_Passes[step.m_Pass];
+		out << "  Pass " << pass.m_Name << std::endl;
+		for (const ResourceUse& use : pass.m_Uses)
+		{
+			out << "    " << (use.m_Read ? (use.m_Write ? "reads and writes " : "reads ") : "writes ") << m_Resources[use.m_Resource].m_Name;
+			if (m_Resources[use.m_Resource].m_Image)
+				out << " as " << LayoutName(use.m_Layout);
+			out << std::endl;
+		}
+	}
+
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.m_Culled)
+			out << "  Culled pass " << pass.m_Name << std::endl;
+	}
+
+	for (size_t i = 0; i < m_MemoryBlocks.size(); ++i)
+	{
+		out << "  Memory block " << i << ", " << m_MemoryBlocks[i].m_Size << " bytes:";
+		for (RenderGraphResource index : m_MemoryBlocks[i].m_Resources)
+			out << " " << m_Resources[index].m_Name << " (passes " << m_Resources[index].m_FirstPass << " to " << m_Resources[index].m_LastPass << ")";
+		out << std::endl;
+	}
+
+	out << "Transient memory: " << m_Stats.m_TransientBytes << " bytes unaliased, " << m_Stats.m_AliasedBytes << " bytes aliased, "
+		<< m_Stats.m_TransientBytes - m_Stats.m_AliasedBytes << " bytes saved." << std::endl;
+
+	return out.str();
+}
\ No newline at end of file
@@ -0,0 +1,343 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include <string>
+#include <vector>
+
+// Handle to a resource in a render graph.
+typedef uint RenderGraphResource;
+
+// Records a pass's commands.
+typedef void (*RenderGraphPassFunction)(VkCommandBuffer commandBuffer, void* data);
+
+// Ways a pass can use a resource. Each one has the pipeline stages, access masks and, for images, the layout it needs.
+enum RenderGraphAccess
+{
+	RENDER_GRAPH_ACCESS_COLOUR_ATTACHMENT,
+	RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT,
+	RENDER_GRAPH_ACCESS_FRAGMENT_SAMPLED,
+	RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED,
+	RENDER_GRAPH_ACCESS_COMPUTE_STORAGE,
+	RENDER_GRAPH_ACCESS_INDIRECT,
+	RENDER_GRAPH_ACCESS_TRANSFER_SOURCE,
+	RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION,
+	RENDER_GRAPH_ACCESS_PRESENT,
+	RENDER_GRAPH_ACCESS_COUNT
+};
+
+// An image the graph creates, which only lives for part of the frame.
+struct RenderGraphImageDesc
+{
+	VkFormat m_Format;
+	VkExtent2D m_Extent;
+	uint m_MipLevels = 1;
+	VkImageUsageFlags m_Usage;
+	VkImageAspectFlags m_Aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+// Counts from the last compile.
+struct RenderGraphStats
+{
+	size_t m_PassCount = 0;
+	size_t m_CulledPassCount = 0;
+	// Calls to vkCmdPipelineBarrier per execute, and the image barriers in them.
+	size_t m_BarrierCount = 0;
+	size_t m_ImageBarrierCount = 0;
+	// Memory the transient images would need each on their own, and what they need sharing it.
+	VkDeviceSize m_TransientBytes = 0;
+	VkDeviceSize m_AliasedBytes = 0;
+	// Passes put on the compute queue, submissions per execute, and how many of them wait for the other queue.
+	size_t m_AsyncPassCount = 0;
+	size_t m_SegmentCount = 0;
+	size_t m_QueueWaitCount = 0;
+};
+
+// Steps in a row on one queue, recorded into one command buffer and submitted together.
+struct RenderGraphSegment
+{
+	FrameQueue m_Queue = FRAME_QUEUE_GRAPHICS;
+	// Which of its queue's segments it is this execute.
+	uint m_QueueIndex = 0;
+	// If it waits for a segment on the other queue before starting, and which of that queue's segments, counted back
+	// from this execute's first for the last execute's.
+	bool m_Wait = false;
+	int m_WaitQueueIndex = 0;
+	// The steps it records.
+	size_t m_FirstStep = 0;
+	size_t m_StepCount = 0;
+};
+
+// A frame described as passes and the resources they read and write.
+// Passes are added in the order they run. Compiling culls passes nothing needed the results of, works out the
+// fewest pipeline barriers and layout transitions between them, batched into one call before each pass, and gives
+// transient images whose lifetimes don't overlap the same memory. A compiled graph is executed every frame until
+// what's drawn changes; imported resources can be pointed at different images between executes.
+// Imported resources are expected to be in the state the graph left them in last execute, so each execute's first
+// barriers also cover the hazards with the one before.
+// With async compute, passes marked for it go on the compute queue. The passes are split into segments, each
+// submitted on its own, where the queue changes, before a pass that needs the other queue's work, and after a pass
+// the other queue needs. Segments wait on the other queue's timeline semaphore for the one they need, including
+// the last execute's, so everything else on the two queues overlaps.
+class RenderGraph
+{
+public:
+	// Constructor.
+	// Params: the renderer transient images are created with.
+	RenderGraph(VulkanRenderer* renderer);
+	// Destructor.
+	~RenderGraph();
+
+	// Throw away the passes and resources, to describe a new graph. The GPU has to be done with the last execute.
+	void Reset();
+
+	// Add an image the graph doesn't own.
+	// Params: name for the dump, the image, its view, the aspects barriers cover, the amount of mips.
+	// Returns: the resource.
+	RenderGraphResource ImportImage(const char* name, VkImage image, VkImageView imageView, VkImageAspectFlags aspect, uint mipLevels);
+
+	// Add a buffer the graph doesn't own. Buffer hazards are covered by global memory barriers, so the handle isn't needed.
+	// Params: name for the dump.
+	// Returns: the resource.
+	RenderGraphResource ImportBuffer(const char* name);
+
+	// Add an image for the graph to create when compiled, sharing memory with others where it can.
+	// Params: name for the dump, what to create.
+	// Returns: the resource.
+	RenderGraphResource CreateImage(const char* name, const RenderGraphImageDesc& desc);
+
+	// Point an imported image at a different image, such as this frame's swap chain image.
+	// Params: the resource, the image, its view.
+	void SetImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+
+	// Get an image, once compiled for transient ones.
+	// Params: the resource.
+	// Returns: the image, or its view.
+	VkImage GetImage(RenderGraphResource resource) const { return m_Resources[resource].m_VkImage; }
+	VkImageView GetImageView(RenderGraphResource resource) const { return m_Resources[resource].m_VkImageView; }
+
+	// Add a pass.
+	// Params: name for the dump, the function that records it, data passed to the function.
+	// Returns: the pass's index.
+	uint AddPass(const char* name, RenderGraphPassFunction function, void* data);
+
+	// Declare that a pass reads a resource.
+	// Params: the pass, the resource, how it's read.
+	void Read(uint pass, RenderGraphResource resource, RenderGraphAccess access);
+
+	// Declare that a pass writes a resource. Writing without reading throws away what was there.
+	// Params: the pass, the resource, how it's written.
+	void Write(uint pass, RenderGraphResource resource, RenderGraphAccess access);
+
+	// Keep a pass even if nothing reads what it writes, for passes the CPU reads results from.
+	// Params: the pass.
+	void SetSideEffects(uint pass);
+
+	// Mark a resource as used after the graph, so the passes that write it are kept.
+	// Params: the resource, how it's used afterwards.
+	void MarkOutput(RenderGraphResource resource, RenderGraphAccess access);
+
+	// Let passes marked for it run on the compute queue. Takes effect from the next compile.
+	// Params: if async compute is used, if images can be used on both queues, which they can when the queues share a family.
+	void SetAsyncComputeEnabled(bool enabled, bool sharedImages);
+
+	// Run a pass on the compute queue when async compute is enabled. It can only use compute and transfer accesses. When the
+	// queues are in different families only buffers are shared between them, so a pass that uses images stays on the graphics queue.
+	// Params: the pass.
+	void SetAsyncCompute(uint pass);
+
+	// Cull passes, work out the barriers and create the transient images.
+	void Compile();
+
+	// Get the amount of segments the compiled graph is submitted in, in the order they're submitted.
+	// Returns: the segment count.
+	uint GetSegmentCount() const { return (uint)m_Segments.size(); }
+
+	// Get a segment of the compiled graph.
+	// Params: the segment index.
+	// Returns: the segment.
+	const RenderGraphSegment& GetSegment(uint segment) const { return m_Segments[segment]; }
+
+	// Get the amount of segments submitted to a queue each execute.
+	// Params: the queue.
+	// Returns: the segment count.
+	uint GetQueueSegmentCount(FrameQueue queue) const { return m_QueueSegmentCounts[queue]; }
+
+	// Record a segment of the compiled graph.
+	// Params: the segment index, a command buffer for its queue.
+	void Execute(uint segment, VkCommandBuffer commandBuffer);
+
+	// Describe the compiled graph: the passes in order with their barriers, the culled passes, and the transient memory.
+	// Returns: the description.
+	std::string Dump() const;
+
+	// Get the counts from the last compile.
+	// Returns: the stats.
+	const RenderGraphStats& GetStats() const { return m_Stats; }
+
+private:
+	// A pass's use of a resource, with every declared access of it merged.
+	struct ResourceUse
+	{
+		RenderGraphResource m_Resource;
+		VkPipelineStageFlags m_Stages;
+		VkAccessFlags m_ReadAccess;
+		VkAccessFlags m_WriteAccess;
+		VkImageLayout m_Layout;
+		bool m_Read;
+		bool m_Write;
+	};
+
+	struct Pass
+	{
+		std::string m_Name;
+		RenderGraphPassFunction m_Function;
+		void* m_Data;
+		std::vector<ResourceUse> m_Uses;
+		bool m_SideEffects = false;
+		bool m_Culled = false;
+		// If it was marked for async compute, and the queue it was put on.
+		bool m_AsyncCompute = false;
+		FrameQueue m_Queue = FRAME_QUEUE_GRAPHICS;
+	};
+
+	struct Resource
+	{
+		std::string m_Name;
+		bool m_Image;
+		bool m_Transient;
+		VkImage m_VkImage = VK_NULL_HANDLE;
+		VkImageView m_VkImageView = VK_NULL_HANDLE;
+		VkImageAspectFlags m_Aspect = 0;
+		uint m_MipLevels = 1;
+		RenderGraphImageDesc m_Desc;
+
+		// How it's used after the graph, if it's an output.
+		bool m_Output = false;
+		RenderGraphAccess m_OutputAccess;
+
+		// Transient images: first and last pass using it, the memory block it's in, what was in the block before it.
+		size_t m_FirstPass = 0;
+		size_t m_LastPass = 0;
+		uint m_MemoryBlock = 0;
+		RenderGraphResource m_AliasPrevious = 0;
+		VkMemoryRequirements m_MemoryRequirements;
+	};
+
+	// Where a resource's last accesses left it.
+	struct ResourceState
+	{
+		VkImageLayout m_Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// Stages and accesses of the last write.
+		VkPipelineStageFlags m_WriteStages = 0;
+		VkAccessFlags m_WriteAccess = 0;
+		// Stages that have read it since, and the accesses the write is visible to.
+		VkPipelineStageFlags m_ReadStages = 0;
+		VkAccessFlags m_VisibleAccess = 0;
+		// If a pass has used it, and the queue and the pass that used it last, counted back from this execute's first for the last execute's.
+		bool m_Used = false;
+		FrameQueue m_Queue = FRAME_QUEUE_GRAPHICS;
+		int m_Pass = 0;
+	};
+
+	struct ImageBarrier
+	{
+		RenderGraphResource m_Resource;
+		VkAccessFlags m_SrcAccess;
+		VkAccessFlags m_DstAccess;
+		VkImageLayout m_OldLayout;
+		VkImageLayout m_NewLayout;
+	};
+
+	// Barriers recorded in one vkCmdPipelineBarrier.
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags m_SrcStages = 0;
+		VkPipelineStageFlags m_DstStages = 0;
+		// Buffers share one global memory barrier.
+		VkAccessFlags m_MemorySrcAccess = 0;
+		VkAccessFlags m_MemoryDstAccess = 0;
+		bool m_MemoryBarrier = false;
+		std::vector<ImageBarrier> m_ImageBarriers;
+	};
+
+	// A pass to run and the barriers before it. The last step only has barriers, for outputs, and is always on the graphics queue.
+	struct Step
+	{
+		size_t m_Pass;
+		BarrierBatch m_Barriers;
+		FrameQueue m_Queue = FRAME_QUEUE_GRAPHICS;
+		// If it needs a pass on the other queue to finish first, and which, counted back from this execute's first for the last execute's.
+		bool m_Wait = false;
+		int m_WaitPass = 0;
+		// If a pass on the other queue waits for it, and the segment it's in.
+		bool m_Signals = false;
+		uint m_Segment = 0;
+	};
+
+	// A block of memory transient images share.
+	struct MemoryBlock
+	{
+		VkDeviceSize m_Size = 0;
+		VkDeviceSize m_Alignment = 1;
+		uint m_MemoryTypeBits = 0xFFFFFFFF;
+		std::vector<RenderGraphResource> m_Resources;
+		VkDeviceMemory m_VkMemory = VK_NULL_HANDLE;
+	};
+
+	// Add an access to a pass's use of a resource.
+	// Params: the pass, the resource, the access, if it reads, if it writes.
+	void AddUse(uint pass, RenderGraphResource resource, RenderGraphAccess access, bool read, bool write);
+
+	// Mark passes culled that nothing needs.
+	void CullPasses();
+
+	// Put the passes marked for async compute on the compute queue, if they can go on it.
+	void AssignQueues();
+
+	// Split the steps into segments and work out which segment each one that needs the other queue waits for.
+	void BuildSegments();
+
+	// Create the transient images and share memory between the ones whose lifetimes don't overlap.
+	void CreateTransientImages();
+
+	// Give the transient images and their memory to the renderer's deletion queue.
+	void ReleaseTransientImages();
+
+	// Work out the barriers for running the passes in order.
+	// Params: the states resources start in, filled with the states they end in, if steps should be recorded.
+	void Simulate(std::vector<ResourceState>& states, bool recordSteps);
+
+	// Make a step wait for the other queue if it was the last to use a resource. The semaphore covers everything it did
+	// to the resource, so only a layout transition is left for the barrier.
+	// Params: the step, the resource, its state, the latest pass on the other queue the step's queue has already waited for.
+	static void WaitForQueue(Step& step, const Resource& resource, ResourceState& state, int waitedPass);
+
+	// Add the barrier an access needs to a batch, and move the resource's state on.
+	// Params: the batch, the resource, its state, the use.
+	static void AddBarrier(BarrierBatch& batch, const Resource& resource, ResourceState& state, const ResourceUse& use);
+
+	// The renderer the graph was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	std::vector<Pass> m_Passes;
+	std::vector<Resource> m_Resources;
+
+	// If passes marked for async compute go on the compute queue, and if images can be used on both queues.
+	bool m_AsyncComputeEnabled = false;
+	bool m_SharedImages = true;
+
+	// The compiled graph.
+	std::vector<Step> m_Steps;
+	std::vector<MemoryBlock> m_MemoryBlocks;
+	std::vector<RenderGraphSegment> m_Segments;
+	uint m_QueueSegmentCounts[FRAME_QUEUE_COUNT] = {};
+
+	// Space for resolving a batch's image barriers when executing.
+	std::vector<VkImageMemoryBarrier> m_VkImageBarriers;
+
+	// Counts from the last compile.
+	RenderGraphStats m_Stats;
+};
\ No newline at end of file
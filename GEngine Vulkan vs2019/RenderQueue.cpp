@@ -0,0 +1,190 @@
+#include "RenderQueue.h"
+#include "GameObject.h"
+#include "FrameRingBuffer.h"
+#include "GpuMesh.h"
+#include "LodSelector.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// Objects per chunk when making keys and filling instances in parallel.
+static const size_t QUEUE_CHUNK_SIZE = 8 * 1024;
+
+// State shared by the chunks of a build.
+struct QueueJob
+{
+	GameObject* const* m_GameObjects;
+	const uint* m_VisibleObjects;
+	// Every object's level of detail by scene index, or nullptr for full detail.
+	const LodState* m_LodStates;
+	glm::vec4 m_DepthRow;
+	SortItem* m_Items;
+	RenderInstance* m_Instances;
+};
+
+// Make the key of an object's item.
+// Params: the build, the scene index with RENDER_ITEM_FADE_OUT_BIT set for the level it's fading out from, the item.
+static void MakeKey(const QueueJob* job, uint value, SortItem& item)
+{
+	uint objectIndex = value & ~RENDER_ITEM_FADE_OUT_BIT;
+	const GameObject* gameObject = job->m_GameObjects[objectIndex];
+
+	// Clip space w of the object's origin, its distance along the camera's view direction.
+	float depth = glm::dot(job->m_DepthRow, gameObject->GetWorldMatrix()[3]);
+
+	uint lod = 0;
+	if (job->m_LodStates != nullptr)
+	{
+		const LodState& lodState = job->m_LodStates[objectIndex];
+		lod = (value & RENDER_ITEM_FADE_OUT_BIT) != 0 ? lodState.m_FadeLod : lodState.m_Lod;
+	}
+
+	item.m_Key = RenderQueue::MakeSortKey(gameObject->GetRenderState(), lod, depth);
+	item.m_Value = value;
+}
+
+static void MakeKeys(void* data, size_t begin, size_t end)
+{
+	QueueJob* job = (QueueJob*)data;
+
+	for (size_t i = begin; i < end; ++i)
+		MakeKey(job, job->m_VisibleObjects[i], job->m_Items[i]);
+}
+
+static void FillInstances(void* data, size_t begin, size_t end)
+{
+	QueueJob* job = (QueueJob*)data;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		uint value = job->m_Items[i].m_Value;
+		uint objectIndex = value & ~RENDER_ITEM_FADE_OUT_BIT;
+		job->m_Instances[i].m_WorldMatrix = job->m_GameObjects[objectIndex]->GetWorldMatrix();
+		job->m_Instances[i].m_PreviousWorldMatrix = job->m_GameObjects[objectIndex]->GetPreviousWorldMatrix();
+		job->m_Instances[i].m_ObjectIndex = objectIndex;
+		job->m_Instances[i].m_MaterialIndex = job->m_GameObjects[objectIndex]->GetRenderState().m_Material;
+		job->m_Instances[i].m_Lod = 0;
+		job->m_Instances[i].m_LodFade = 0.0f;
+
+		if (job->m_LodStates != nullptr)
+		{
+			const LodState& lodState = job->m_LodStates[objectIndex];
+			bool fading = lodState.m_FadeLod != LOD_NONE;
+			if ((value & RENDER_ITEM_FADE_OUT_BIT) != 0)
+			{
+				job->m_Instances[i].m_Lod = lodState.m_FadeLod;
+				job->m_Instances[i].m_LodFade = -lodState.m_Fade;
+			}
+			else
+			{
+				job->m_Instances[i].m_Lod = lodState.m_Lod;
+				job->m_Instances[i].m_LodFade = fading ? lodState.m_Fade : 0.0f;
+			}
+		}
+	}
+}
+
+RenderQueue::RenderQueue(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+}
+
+uint64_t RenderQueue::MakeSortKey(const RenderState& state, uint lod, float depth)
+{
+	// Positive floats sort the same as their bits, so the exponent and top of the mantissa make a cheap fixed point depth.
+	uint depthBits;
+	depth = std::max(depth, 0.0f);
+	memcpy(&depthBits, &depth, sizeof(float));
+	depthBits >>= 31 - RENDER_KEY_DEPTH_BITS;
+
+	uint64_t key = state.m_Layer & ((1 << RENDER_KEY_LAYER_BITS) - 1);
+	key = (key << RENDER_KEY_PIPELINE_BITS) | (state.m_Pipeline & ((1 << RENDER_KEY_PIPELINE_BITS) - 1));
+	key = (key << RENDER_KEY_MATERIAL_BITS) | (state.m_Material & ((1 << RENDER_KEY_MATERIAL_BITS) - 1));
+	key = (key << RENDER_KEY_MESH_BITS) | (state.m_Mesh & ((1 << RENDER_KEY_MESH_BITS) - 1));
+	key = (key << RENDER_KEY_LOD_BITS) | (lod & ((1 << RENDER_KEY_LOD_BITS) - 1));
+	key = (key << RENDER_KEY_DEPTH_BITS) | (depthBits & ((1 << RENDER_KEY_DEPTH_BITS) - 1));
+
+	return key;
+}
+
+void RenderQueue::Build(GameObject* const* gameObjects, const uint* visibleObjects, size_t visibleCount, const glm::mat4& viewProjection,
+	const LodSelector* lodSelector, JobSystem* jobSystem)
+{
+	// Objects cross-fading between levels of detail are drawn a second time at the level they're fading out from.
+	size_t fadingCount = lodSelector != nullptr ? lodSelector->GetFadingCount() : 0;
+	size_t itemCount = visibleCount + fadingCount;
+
+	FrameRingBuffer* ringBuffer = m_Renderer->GetObjectRingBuffer();
+	// One extra instance of space covers lining the data up to a whole instance.
+	ringBuffer->Reserve((itemCount + 1) * sizeof(RenderInstance));
+	FrameAllocation allocation = ringBuffer->Allocate(itemCount * sizeof(RenderInstance), sizeof(RenderInstance));
+	m_FirstObject = allocation.m_Offset / sizeof(RenderInstance);
+
+	if (m_Items.size() < itemCount)
+	{
+		m_Items.resize(itemCount);
+		m_Batches.reserve(itemCount);
+	}
+
+	QueueJob job;
+	job.m_GameObjects = gameObjects;
+	job.m_VisibleObjects = visibleObjects;
+	job.m_LodStates = lodSelector != nullptr ? lodSelector->GetStates() : nullptr;
+	job.m_DepthRow = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	job.m_Items = m_Items.data();
+	job.m_Instances = (RenderInstance*)allocation.m_Data;
+
+	bool parallel = jobSystem != nullptr && visibleCount > QUEUE_CHUNK_SIZE;
+	if (parallel)
+		jobSystem->ParallelFor(visibleCount, QUEUE_CHUNK_SIZE, MakeKeys, &job);
+	else
+		MakeKeys(&job, 0, visibleCount);
+
+	// Only a few objects fade at once, so their second keys aren't worth spreading over the job system.
+	const uint* fadingObjects = lodSelector != nullptr ? lodSelector->GetFadingObjects() : nullptr;
+	for (size_t i = 0; i < fadingCount; ++i)
+		MakeKey(&job, fadingObjects[i] | RENDER_ITEM_FADE_OUT_BIT, m_Items[visibleCount + i]);
+
+	m_Sorter.Sort(m_Items.data(), itemCount, jobSystem);
+
+	parallel = jobSystem != nullptr && itemCount > QUEUE_CHUNK_SIZE;
+	if (parallel)
+		jobSystem->ParallelFor(itemCount, QUEUE_CHUNK_SIZE, FillInstances, &job);
+	else
+		FillInstances(&job, 0, itemCount);
+
+	// Everything above the depth bits is the state, so a change there starts a new draw.
+	m_Batches.clear();
+	uint64_t previousState = 0;
+	for (size_t i = 0; i < itemCount; ++i)
+	{
+		uint64_t state = m_Items[i].m_Key >> RENDER_KEY_DEPTH_BITS;
+		if (i == 0 || state != previousState)
+		{
+			RenderBatch batch;
+			batch.m_State = gameObjects[m_Items[i].m_Value & ~RENDER_ITEM_FADE_OUT_BIT]->GetRenderState();
+			batch.m_Lod = (uint)(state & ((1 << RENDER_KEY_LOD_BITS) - 1));
+			batch.m_FirstInstance = (uint)i;
+			batch.m_InstanceCount = 0;
+			m_Batches.push_back(batch);
+			previousState = state;
+		}
+
+		++m_Batches.back().m_InstanceCount;
+	}
+
+	m_Stats.m_ObjectCount = itemCount;
+	m_Stats.m_DrawCount = m_Batches.size();
+}
+
+void RenderQueue::RecordDraws(VkCommandBuffer commandBuffer) const
+{
+	// There's only the one pipeline and mesh, and no materials yet, so batches only differ in what they'd bind and in
+	// which level of detail's indices they draw.
+	const GpuMesh* mesh = m_Renderer->GetDemoMesh();
+	for (const RenderBatch& batch : m_Batches)
+	{
+		const MeshLod& lod = mesh->GetLod(std::min(batch.m_Lod, mesh->GetLodCount() - 1));
+		vkCmdDrawIndexed(commandBuffer, lod.m_IndexCount, batch.m_InstanceCount, lod.m_FirstIndex, 0, batch.m_FirstInstance);
+	}
+}
\ No newline at end of file
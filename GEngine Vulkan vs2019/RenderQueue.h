@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include "RadixSort.h"
+#include "JobSystem.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+class GameObject;
+class LodSelector;
+
+// Bits given to each part of a render sort key, from the most significant down.
+// Layer sorts first so layers draw in order, then the state that's most expensive to change.
+#define RENDER_KEY_LAYER_BITS 4
+#define RENDER_KEY_PIPELINE_BITS 10
+#define RENDER_KEY_MATERIAL_BITS 16
+#define RENDER_KEY_MESH_BITS 13
+#define RENDER_KEY_LOD_BITS 3
+#define RENDER_KEY_DEPTH_BITS 18
+
+// Set on a sort item's value for the copy of a fading object drawn at the level it's fading out from.
+#define RENDER_ITEM_FADE_OUT_BIT (1u << 31)
+
+// What an object is drawn with. Objects with the same state are drawn together as one instanced draw.
+struct RenderState
+{
+	// Order the object is drawn in relative to other layers, lowest first.
+	uint m_Layer = 0;
+	uint m_Pipeline = 0;
+	// Material ID from the renderer's bindless table.
+	uint m_Material = 0;
+	uint m_Mesh = 0;
+};
+
+// Per instance data as laid out in the object ring buffer.
+struct RenderInstance
+{
+	glm::mat4 m_WorldMatrix;
+	// Last frame's world matrix, for motion vectors.
+	glm::mat4 m_PreviousWorldMatrix;
+	// Scene index of the object.
+	uint m_ObjectIndex;
+	// Index of the object's material in the bindless table.
+	uint m_MaterialIndex;
+	// Level of detail of the mesh the instance is drawn at.
+	uint m_Lod;
+	// How far the level is through a cross-fade: positive while fading in, negative while fading out, 0 for neither.
+	float m_LodFade;
+};
+
+// Instances of one mesh drawn with the same pipeline and material.
+struct RenderBatch
+{
+	RenderState m_State;
+	// Level of detail of the mesh the batch draws.
+	uint m_Lod;
+	// First instance in the queue's data, passed as the draw's first instance.
+	uint m_FirstInstance;
+	uint m_InstanceCount;
+};
+
+// Draw counts from the last build.
+struct RenderQueueStats
+{
+	// Objects in the queue, one draw each without merging. Objects cross-fading count twice.
+	size_t m_ObjectCount = 0;
+	// Draws after merging objects with the same state.
+	size_t m_DrawCount = 0;
+};
+
+// Turns a list of visible objects into as few draws as possible.
+// Each object gets a 64 bit key of its layer, pipeline, material, mesh, level of detail and depth, and the keys are radix
+// sorted. Objects cross-fading between two levels of detail get a second key, so they're drawn at both.
+// Runs of objects with the same state are merged into instanced draws, front to back within a run,
+// and each object's data goes in the renderer's object ring buffer in the sorted order so gl_InstanceIndex finds it.
+class RenderQueue
+{
+public:
+	// Constructor.
+	// Params: the renderer whose object ring buffer the instance data is written to.
+	RenderQueue(VulkanRenderer* renderer);
+
+	// Build the sorted, merged draws for this frame and write the instance data for them.
+	// Has to be the first thing allocated from the object ring buffer in the frame.
+	// Params: every game object by scene index, scene indices of the objects to draw, how many objects,
+	// the camera's view projection matrix, the levels of detail picked for the objects or nullptr to draw everything at
+	// full detail, the job system to spread the work over.
+	void Build(GameObject* const* gameObjects, const uint* visibleObjects, size_t visibleCount, const glm::mat4& viewProjection,
+		const LodSelector* lodSelector, JobSystem* jobSystem);
+
+	// Get where the instance data starts in this frame's part of the object ring buffer.
+	// Returns: the index of the first instance's data.
+	uint GetFirstObject() const { return m_FirstObject; }
+
+	// Record the draws. Has to be inside a render pass with the pipeline bound.
+	// Params: the command buffer.
+	void RecordDraws(VkCommandBuffer commandBuffer) const;
+
+	// Make a sort key.
+	// Params: what the object is drawn with, the level of detail it's drawn at, its distance from the camera.
+	// Returns: the key.
+	static uint64_t MakeSortKey(const RenderState& state, uint lod, float depth);
+
+	// Get the merged draws from the last build.
+	// Returns: the batches.
+	const std::vector<RenderBatch>& GetBatches() const { return m_Batches; }
+
+	// Get the draw counts from the last build.
+	// Returns: the stats.
+	const RenderQueueStats& GetStats() const { return m_Stats; }
+
+private:
+	// The renderer the queue was created with.
+	VulkanRenderer* m_Renderer;
+
+	// Keys of the visible objects, with the scene index as the value.
+	std::vector<SortItem> m_Items;
+
+	// Sorts the keys.
+	RadixSorter m_Sorter;
+
+	// The merged draws.
+	std::vector<RenderBatch> m_Batches;
+
+	// Where this frame's instance data starts in the object ring buffer.
+	uint m_FirstObject = 0;
+
+	// Draw counts from the last build.
+	RenderQueueStats m_Stats;
+};
\ No newline at end of file
@@ -1,9 +1,43 @@
 #include "Scene.h"
+#include "FrameRingBuffer.h"
+#include "GpuMesh.h"
+#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
-Scene::Scene()
+// Objects per chunk when writing object data in parallel.
+static const size_t OBJECT_DATA_CHUNK_SIZE = 8 * 1024;
+
+// State shared by the chunks writing object data.
+struct ObjectDataJob
+{
+	GameObject* const* m_GameObjects;
+	// Every object's level of detail, or nullptr for full detail.
+	const LodState* m_LodStates;
+	RenderInstance* m_Objects;
+};
+
+static void WriteObjectData(void* data, size_t begin, size_t end)
+{
+	ObjectDataJob* job = (ObjectDataJob*)data;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		job->m_Objects[i].m_WorldMatrix = job->m_GameObjects[i]->GetWorldMatrix();
+		job->m_Objects[i].m_PreviousWorldMatrix = job->m_GameObjects[i]->GetPreviousWorldMatrix();
+		job->m_Objects[i].m_ObjectIndex = (uint)i;
+		job->m_Objects[i].m_MaterialIndex = job->m_GameObjects[i]->GetRenderState().m_Material;
+		// One draw per object can only draw one level, so nothing fades.
+		job->m_Objects[i].m_Lod = job->m_LodStates != nullptr ? job->m_LodStates[i].m_Lod : 0;
+		job->m_Objects[i].m_LodFade = 0.0f;
+	}
+}
+
+Scene::Scene(JobSystem* jobSystem)
 {
 	m_GameObjects = std::vector<GameObject*>();
+	m_JobSystem = jobSystem;
 }
 
 Scene::~Scene()
@@ -13,69 +47,372 @@ Scene::~Scene()
 		delete gameObject;
 		gameObject = nullptr;
 	}
+
+	delete m_GpuCuller;
+	m_GpuCuller = nullptr;
+
+	delete m_RenderQueue;
+	m_RenderQueue = nullptr;
+
+	delete m_LightCuller;
+	m_LightCuller = nullptr;
+}
+
+GameObject* Scene::CreateGameObject(GameObject* parent)
+{
+	GameObject* gameObject = new GameObject(&m_TransformSystem, parent);
+
+	// Children are updated and deleted by their parents.
+	if (parent == nullptr)
+		m_GameObjects.push_back(gameObject);
+
+	m_AllGameObjects.push_back(gameObject);
+	m_SpatialIndexDirty = true;
+
+	return gameObject;
+}
+
+void Scene::SetCamera(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane)
+{
+	// Vulkan's clip space y points down the screen.
+	glm::mat4 projection = glm::perspective(fovY, aspect, nearPlane, farPlane);
+	projection[1][1] *= -1.0f;
+
+	m_ViewProjection = projection * view;
+	m_View = view;
+	m_FovY = fovY;
+	m_Aspect = aspect;
+	m_NearPlane = nearPlane;
+	m_FarPlane = farPlane;
+	m_CameraSet = true;
 }
 
-void Scene::DeleteSamophores(VulkanRenderer* renderer)
+uint Scene::AddLight(const PointLight& light)
 {
-	VkDevice device = renderer->GetLogicalDevice();
-	vkDestroySemaphore(device, m_VkImageAvaliableSemaphore, nullptr);
-	vkDestroySemaphore(device, m_VkRenderFinishedSemaphore, nullptr);
+	m_Lights.push_back(light);
+	return (uint)m_Lights.size() - 1;
 }
 
 void Scene::Update(float deltaTime)
 {
+	m_DeltaTime = deltaTime;
+
 	for (int i = 0; i < m_GameObjects.size(); ++i)
 	{
 		m_GameObjects[i]->Update(deltaTime);
 	}
+
+	// Objects only set their local matrices, world matrices are worked out here in one go.
+	m_TransformSystem.Update();
+
+	UpdateSpatialIndex();
+}
+
+void Scene::UpdateSpatialIndex()
+{
+	if (m_SpatialIndexDirty)
+	{
+		std::vector<AABB> staticBounds;
+		std::vector<uint> staticObjects;
+		std::vector<AABB> dynamicBounds;
+		m_DynamicObjects.clear();
+
+		m_FrustumCuller.Resize(m_AllGameObjects.size());
+		m_VisibleObjects.resize(m_AllGameObjects.size());
+		m_WorldBounds.resize(m_AllGameObjects.size());
+		m_LodSelector.Resize(m_AllGameObjects.size());
+
+		if (m_GpuCuller != nullptr)
+		{
+			m_GpuCuller->Resize(m_AllGameObjects.size());
+			m_GpuVisibleObjects.reserve(m_AllGameObjects.size());
+		}
+
+		for (uint i = 0; i < (uint)m_AllGameObjects.size(); ++i)
+		{
+			AABB bounds = m_AllGameObjects[i]->GetWorldBounds();
+			m_FrustumCuller.SetBounds(i, bounds);
+			m_WorldBounds[i] = bounds;
+			if (m_GpuCuller != nullptr)
+				m_GpuCuller->SetBounds(i, bounds);
+
+			if (m_AllGameObjects[i]->IsStatic())
+			{
+				staticBounds.push_back(bounds);
+				staticObjects.push_back(i);
+			}
+			else
+			{
+				dynamicBounds.push_back(bounds);
+				m_DynamicObjects.push_back(i);
+			}
+		}
+
+		// Cached shadows of the static objects are out of date.
+		if (m_ShadowAtlas != nullptr)
+			m_ShadowAtlas->InvalidateStaticCasters();
+
+		m_StaticBVH.Build(staticBounds.data(), staticObjects.data(), staticObjects.size());
+		m_DynamicBVH.Build(dynamicBounds.data(), m_DynamicObjects.data(), m_DynamicObjects.size());
+		m_SpatialIndexDirty = false;
+		return;
+	}
+
+	for (uint i = 0; i < (uint)m_DynamicObjects.size(); ++i)
+	{
+		AABB bounds = m_AllGameObjects[m_DynamicObjects[i]]->GetWorldBounds();
+		m_DynamicBVH.UpdateItem(i, bounds);
+		m_FrustumCuller.SetBounds(m_DynamicObjects[i], bounds);
+		m_WorldBounds[m_DynamicObjects[i]] = bounds;
+		if (m_GpuCuller != nullptr)
+			m_GpuCuller->SetBounds(m_DynamicObjects[i], bounds);
+	}
+
+	m_DynamicBVH.Refit();
+}
+
+void Scene::QueryFrustum(const Frustum& frustum, std::vector<uint>& results) const
+{
+	m_StaticBVH.QueryFrustum(frustum, results);
+	m_DynamicBVH.QueryFrustum(frustum, results);
+}
+
+void Scene::QueryAABB(const AABB& box, std::vector<uint>& results) const
+{
+	m_StaticBVH.QueryAABB(box, results);
+	m_DynamicBVH.QueryAABB(box, results);
+}
+
+void Scene::QuerySphere(const Sphere& sphere, std::vector<uint>& results) const
+{
+	m_StaticBVH.QuerySphere(sphere, results);
+	m_DynamicBVH.QuerySphere(sphere, results);
+}
+
+bool Scene::Raycast(const Ray& ray, float maxDistance, uint& hitIndex, float& hitDistance) const
+{
+	bool hit = m_StaticBVH.Raycast(ray, maxDistance, hitIndex, hitDistance);
+
+	// The dynamic tree only needs to beat the static hit.
+	float dynamicMax = hit ? hitDistance : maxDistance;
+	uint dynamicIndex;
+	float dynamicDistance;
+	if (m_DynamicBVH.Raycast(ray, dynamicMax, dynamicIndex, dynamicDistance))
+	{
+		hitIndex = dynamicIndex;
+		hitDistance = dynamicDistance;
+		hit = true;
+	}
+
+	return hit;
 }
 
 void Scene::Draw(VulkanRenderer* renderer)
 {
-	uint imageIndex;
+	// Waits for the GPU to be done with the frame in flight, if it's that far behind.
+	uint imageIndex = renderer->BeginFrame();
+
+	DrawConstants drawConstants;
+	drawConstants.m_ViewProjection = m_ViewProjection;
+
+	// Clustering needs the view and projection on their own, so lights are only drawn with a camera set.
+	if (m_CameraSet && !m_Lights.empty())
+	{
+		if (m_LightCuller == nullptr)
+			m_LightCuller = new LightCuller(renderer);
+
+		m_LightCuller->SetProjection(m_FovY, m_Aspect, m_NearPlane, m_FarPlane);
+		drawConstants.m_LightGrid = m_LightCuller->Build(m_Lights.data(), m_Lights.size(), m_View, renderer->GetFrameIndex());
+	}
+
+	// Shadows are fitted to the camera's view, so they need it set too.
+	if (m_ShadowAtlas != nullptr && m_CameraSet)
+		drawConstants.m_Shadows = UpdateShadows(renderer);
+
+	// Levels of detail are picked from how far out their error is on screen, which needs the camera's field of view.
+	if (m_CameraSet)
+	{
+		const GpuMesh* mesh = renderer->GetDemoMesh();
+		m_LodSelector.SetLods(mesh->GetLods(), mesh->GetLodCount());
+		float pixelScale = renderer->GetRenderExtent().height * 0.5f / std::tan(m_FovY * 0.5f);
+		m_LodSelector.SetCamera(glm::vec3(glm::inverse(m_View)[3]), pixelScale);
+
+		// Only the render queue can draw an object twice, and the depth prepass has already written the depth of the
+		// pixels a fade would discard.
+		bool crossFade = m_LodFadeTime > 0.0f && m_GpuCuller == nullptr && !renderer->IsDepthPrepassEnabled();
+		m_LodSelector.SetFadeTime(crossFade ? m_LodFadeTime : 0.0f);
+		renderer->SetLodCrossFadeEnabled(crossFade);
+	}
+
+	// Cull against the camera so only visible objects get recorded.
+	Frustum frustum = Frustum::FromMatrix(m_ViewProjection);
+	if (m_GpuCuller != nullptr)
+	{
+		// Every object could be drawn, and the draws use scene indices as their first instance, so every object's data goes up.
+		size_t objectCount = m_AllGameObjects.size();
+		FrameRingBuffer* ringBuffer = renderer->GetObjectRingBuffer();
+		ringBuffer->Reserve((objectCount + 1) * sizeof(RenderInstance));
+		FrameAllocation allocation = ringBuffer->Allocate(objectCount * sizeof(RenderInstance), sizeof(RenderInstance));
+		drawConstants.m_FirstObject = allocation.m_Offset / sizeof(RenderInstance);
+
+		// The GPU culls after the levels are picked, so every object gets one.
+		if (m_CameraSet)
+			m_LodSelector.Select(m_AllGameObjects.data(), m_WorldBounds.data(), nullptr, objectCount, m_DeltaTime, m_JobSystem);
+
+		ObjectDataJob job;
+		job.m_GameObjects = m_AllGameObjects.data();
+		job.m_LodStates = m_CameraSet ? m_LodSelector.GetStates() : nullptr;
+		job.m_Objects = (RenderInstance*)allocation.m_Data;
+		if (objectCount > OBJECT_DATA_CHUNK_SIZE)
+			m_JobSystem->ParallelFor(objectCount, OBJECT_DATA_CHUNK_SIZE, WriteObjectData, &job);
+		else
+			WriteObjectData(&job, 0, objectCount);
+
+		// Bounds set during the update only reach the GPU now, once this frame's copy of them is no longer being culled with.
+		m_GpuCuller->UploadBounds(renderer->GetFrameIndex());
+
+		// The GPU's count lags the frames in flight behind, the CPU only culls this frame when checking the GPU.
+		m_GpuCuller->SetViewProjection(m_ViewProjection);
+		m_GpuCuller->SetFirstObject(drawConstants.m_FirstObject);
+		m_GpuCuller->SetMesh(renderer->GetDemoMesh());
+		if (m_CameraSet)
+			m_GpuCuller->SetCameraPosition(glm::vec3(glm::inverse(m_View)[3]));
+		if (m_GpuCullingCheck)
+			m_VisibleObjectCount = m_FrustumCuller.CullParallel(frustum, m_JobSystem, m_VisibleObjects.data());
+		else
+			m_VisibleObjectCount = m_GpuCuller->GetVisibleObjectCount();
+
+		renderer->RecordCommandBuffer(imageIndex, drawConstants, nullptr, m_GpuCuller);
+	}
+	else
+	{
+		m_VisibleObjectCount = m_FrustumCuller.CullParallel(frustum, m_JobSystem, m_VisibleObjects.data());
+		if (m_OcclusionCullingEnabled)
+			CullOccludedObjects();
+
+		if (m_RenderQueue == nullptr)
+			m_RenderQueue = new RenderQueue(renderer);
+
+		if (m_CameraSet)
+			m_LodSelector.Select(m_AllGameObjects.data(), m_WorldBounds.data(), m_VisibleObjects.data(), m_VisibleObjectCount, m_DeltaTime, m_JobSystem);
+
+		m_RenderQueue->Build(m_AllGameObjects.data(), m_VisibleObjects.data(), m_VisibleObjectCount, m_ViewProjection,
+			m_CameraSet ? &m_LodSelector : nullptr, m_JobSystem);
+		drawConstants.m_FirstObject = m_RenderQueue->GetFirstObject();
+		renderer->RecordCommandBuffer(imageIndex, drawConstants, m_RenderQueue);
+	}
+
+	// The render graph's segments go to their queues, the first graphics one waiting for the image.
+	renderer->SubmitFrame(imageIndex);
+	renderer->PresentFrame(imageIndex);
+}
+
+uint Scene::UpdateShadows(VulkanRenderer* renderer)
+{
+	uint shadows = m_ShadowAtlas->Update(m_View, m_FovY, m_Aspect, m_NearPlane, m_FarPlane, m_HasDirectionalLight ? &m_DirectionalLight : nullptr,
+		m_Lights.data(), m_Lights.size(), renderer->GetFrameIndex());
+
+	// Static casters are only found for tiles whose cache is being drawn again, dynamic ones for every tile.
+	m_ShadowCasters.clear();
+	for (size_t i = 0; i < m_ShadowAtlas->GetTileCount(); ++i)
+	{
+		Frustum frustum = Frustum::FromMatrix(m_ShadowAtlas->GetTileViewProjection(i));
 
-	vkAcquireNextImageKHR(renderer->GetLogicalDevice(), renderer->GetSwapChain(), UINT64_MAX, m_VkImageAvaliableSemaphore, VK_NULL_HANDLE, &imageIndex);
+		uint firstStatic = (uint)m_ShadowCasters.size();
+		if (m_ShadowAtlas->IsTileStaticDirty(i))
+			m_StaticBVH.QueryFrustum(frustum, m_ShadowCasters);
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		uint firstDynamic = (uint)m_ShadowCasters.size();
+		m_DynamicBVH.QueryFrustum(frustum, m_ShadowCasters);
 
-	VkSemaphore waitSemaphores[] = { m_VkImageAvaliableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;
-	std::vector<VkCommandBuffer> cbs = renderer->GetCommandBuffers();
-	submitInfo.pCommandBuffers = &cbs[imageIndex];
+		m_ShadowAtlas->SetTileCasters(i, firstStatic, firstDynamic - firstStatic, firstDynamic, (uint)m_ShadowCasters.size() - firstDynamic);
+	}
 
-	VkSemaphore signalSemaphores[] = { m_VkRenderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	// Reserve room for the camera's objects as well, since growing the ring buffer throws away what's been written this frame.
+	// Objects cross-fading between levels of detail take two.
+	size_t casterCount = m_ShadowCasters.size();
+	FrameRingBuffer* ringBuffer = renderer->GetObjectRingBuffer();
+	ringBuffer->Reserve((casterCount + m_AllGameObjects.size() * 2 + 2) * sizeof(RenderInstance));
+	FrameAllocation allocation = ringBuffer->Allocate(casterCount * sizeof(RenderInstance), sizeof(RenderInstance));
+	m_ShadowAtlas->SetFirstCaster((uint)(allocation.m_Offset / sizeof(RenderInstance)));
+
+	RenderInstance* casters = (RenderInstance*)allocation.m_Data;
+	for (size_t i = 0; i < casterCount; ++i)
+	{
+		GameObject* gameObject = m_AllGameObjects[m_ShadowCasters[i]];
+		casters[i].m_WorldMatrix = gameObject->GetWorldMatrix();
+		casters[i].m_PreviousWorldMatrix = gameObject->GetPreviousWorldMatrix();
+		casters[i].m_ObjectIndex = m_ShadowCasters[i];
+		casters[i].m_MaterialIndex = gameObject->GetRenderState().m_Material;
+		casters[i].m_Lod = 0;
+		casters[i].m_LodFade = 0.0f;
+	}
 
-	if (vkQueueSubmit(renderer->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
-		throw std::runtime_error("Failed to submit draw command buffer!");
+	return shadows;
+}
 
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+void Scene::EnableShadows(VulkanRenderer* renderer)
+{
+	renderer->EnableShadows();
+	m_ShadowAtlas = renderer->GetShadowAtlas();
+}
 
-	VkSwapchainKHR swapChains[] = { renderer->GetSwapChain() };
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-	presentInfo.pImageIndices = &imageIndex;
+void Scene::SetOcclusionCullingEnabled(bool enabled)
+{
+	m_OcclusionCullingEnabled = enabled;
 
-	vkQueuePresentKHR(renderer->GetPresentQueue(), &presentInfo);
+	// The CPU check only frustum culls, so the GPU can't occlusion cull while checking.
+	if (m_GpuCuller != nullptr)
+		m_GpuCuller->SetOcclusionCullingEnabled(enabled && !m_GpuCullingCheck);
 }
 
-void Scene::CreateSemaphores(VulkanRenderer* renderer)
+void Scene::SetClusterCullingEnabled(bool enabled)
 {
-	VkSemaphoreCreateInfo semaphoreInfo{};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	m_ClusterCullingEnabled = enabled;
 
-	VkDevice device = renderer->GetLogicalDevice();
+	// Like occlusion culling, clusters could leave out objects the CPU check would draw.
+	if (m_GpuCuller != nullptr)
+		m_GpuCuller->SetClusterCullingEnabled(enabled && !m_GpuCullingCheck);
+}
+
+void Scene::EnableGpuCulling(VulkanRenderer* renderer, bool checkResults)
+{
+	if (m_GpuCuller == nullptr)
+		m_GpuCuller = new GpuCuller(renderer);
+
+	m_GpuCuller->SetReadbackEnabled(checkResults);
+	m_GpuCullingCheck = checkResults;
+	SetOcclusionCullingEnabled(m_OcclusionCullingEnabled);
+	SetClusterCullingEnabled(m_ClusterCullingEnabled);
+
+	// Rebuilding uploads every object's bounds.
+	m_SpatialIndexDirty = true;
+}
+
+bool Scene::CheckGpuCulling()
+{
+	if (m_GpuCuller == nullptr || !m_GpuCullingCheck)
+		return false;
+
+	m_GpuCuller->ReadVisibleObjects(m_GpuVisibleObjects);
+
+	// The CPU cull writes objects in ascending order, the same as the read back list.
+	return m_GpuVisibleObjects.size() == m_VisibleObjectCount &&
+		std::equal(m_GpuVisibleObjects.begin(), m_GpuVisibleObjects.end(), m_VisibleObjects.begin());
+}
+
+void Scene::CullOccludedObjects()
+{
+	m_OcclusionCuller.BeginFrame(m_ViewProjection);
+
+	// Only occluders that survived the frustum cull can hide anything on screen.
+	for (size_t i = 0; i < m_VisibleObjectCount; ++i)
+	{
+		GameObject* gameObject = m_AllGameObjects[m_VisibleObjects[i]];
+		if (gameObject->GetOccluderMesh() != nullptr)
+			m_OcclusionCuller.AddOccluder(*gameObject->GetOccluderMesh(), gameObject->GetWorldMatrix());
+	}
 
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_VkImageAvaliableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_VkRenderFinishedSemaphore) != VK_SUCCESS)
-		throw std::runtime_error("failed to create semaphores!");
+	m_OcclusionCuller.RenderOccluders(m_JobSystem);
+	m_VisibleObjectCount = m_OcclusionCuller.CullObjects(m_WorldBounds.data(), m_VisibleObjects.data(), m_VisibleObjectCount, m_JobSystem);
 }
\ No newline at end of file
@@ -3,19 +3,148 @@
 #include <vector>
 #include "GameObject.h"
 #include "VulkanRenderer.h"
+#include "TransformSystem.h"
+#include "BVH.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "GpuCuller.h"
+#include "RenderQueue.h"
+#include "LightCuller.h"
+#include "ShadowAtlas.h"
+#include "LodSelector.h"
+#include "JobSystem.h"
 
 class Scene
 {
 public:
 	// Constructor.
-	Scene();
+	// Params: the job system to spread per frame work over.
+	Scene(JobSystem* jobSystem);
 	// Destructor.
 	~Scene();
 
-	// Create semaphores for drawing.
-	void CreateSemaphores(VulkanRenderer* renderer);
-	// Destroy the semaphores.
-	void DeleteSamophores(VulkanRenderer* renderer);
+	// Create a game object in the scene.
+	// Params: the parent object, or nullptr for a root object.
+	// Returns: the new game object, owned by the scene (or its parent).
+	GameObject* CreateGameObject(GameObject* parent = nullptr);
+
+	// Get a game object by its scene index.
+	// Params: the index reported by the spatial queries.
+	// Returns: the game object.
+	GameObject* GetGameObject(uint index) { return m_AllGameObjects[index]; }
+
+	// Get the amount of game objects in the scene, including children.
+	// Returns: the object count.
+	size_t GetGameObjectCount() const { return m_AllGameObjects.size(); }
+
+	// Mark the static objects as changed, so their tree gets rebuilt on the next update.
+	void MarkStaticObjectsChanged() { m_SpatialIndexDirty = true; }
+
+	// Find the objects whose world bounds are at least partly inside a frustum.
+	// Params: the frustum, vector to append the scene indices of the objects to.
+	void QueryFrustum(const Frustum& frustum, std::vector<uint>& results) const;
+
+	// Find the objects whose world bounds overlap a box.
+	// Params: the box, vector to append the scene indices of the objects to.
+	void QueryAABB(const AABB& box, std::vector<uint>& results) const;
+
+	// Find the objects whose world bounds overlap a sphere.
+	// Params: the sphere, vector to append the scene indices of the objects to.
+	void QuerySphere(const Sphere& sphere, std::vector<uint>& results) const;
+
+	// Find the closest object whose world bounds are hit by a ray.
+	// Params: the ray, the furthest distance to check, the scene index of the object hit, the distance it was hit at.
+	// Returns: if anything was hit.
+	bool Raycast(const Ray& ray, float maxDistance, uint& hitIndex, float& hitDistance) const;
+
+	// Set the camera's view projection matrix, used to cull objects before drawing.
+	// Params: the view projection matrix.
+	void SetViewProjection(const glm::mat4& viewProjection) { m_ViewProjection = viewProjection; }
+
+	// Set the camera from its view matrix and a perspective projection, for culling objects and binning lights into clusters.
+	// Params: the view matrix, vertical field of view in radians, aspect ratio, near and far plane distances.
+	void SetCamera(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane);
+
+	// Add a point light. Lights are only drawn once the camera's been set with SetCamera.
+	// Params: the light.
+	// Returns: the light's index.
+	uint AddLight(const PointLight& light);
+
+	// Change a point light.
+	// Params: the light's index, the new light.
+	void SetLight(uint index, const PointLight& light) { m_Lights[index] = light; }
+
+	// Get the amount of point lights.
+	// Returns: the light count.
+	size_t GetLightCount() const { return m_Lights.size(); }
+
+	// Set the directional light, drawn once the camera's been set with SetCamera.
+	// Params: the light.
+	void SetDirectionalLight(const DirectionalLight& light) { m_DirectionalLight = light; m_HasDirectionalLight = true; }
+
+	// Draw shadows for the directional light and the point lights covering the most of the screen.
+	// Params: the renderer to draw the shadow atlas with.
+	void EnableShadows(VulkanRenderer* renderer);
+
+	// Get the shadow counts from the last draw.
+	// Returns: the stats.
+	ShadowStats GetShadowStats() const { return m_ShadowAtlas != nullptr ? m_ShadowAtlas->GetStats() : ShadowStats(); }
+
+	// Get the light binning counts from the last draw.
+	// Returns: the stats.
+	LightCullStats GetLightCullStats() const { return m_LightCuller != nullptr ? m_LightCuller->GetStats() : LightCullStats(); }
+
+	// Get the amount of objects that passed culling on the last draw.
+	// Returns: the visible object count.
+	size_t GetVisibleObjectCount() const { return m_VisibleObjectCount; }
+
+	// Turn culling of objects hidden behind occluders on or off.
+	// Params: if occlusion culling is on.
+	void SetOcclusionCullingEnabled(bool enabled);
+
+	// Get the occlusion culling counts from the last draw.
+	// Returns: the stats.
+	const OcclusionStats& GetOcclusionStats() const { return m_OcclusionCuller.GetStats(); }
+
+	// Cull and draw with a compute shader and indirect draws instead of on the CPU.
+	// Occlusion culling moves to the GPU's depth pyramid, except when checking the results against the CPU.
+	// Params: the renderer, if the CPU should also cull so CheckGpuCulling can compare the results.
+	void EnableGpuCulling(VulkanRenderer* renderer, bool checkResults);
+
+	// Get the GPU culling counts from the last finished frame. GPU culling has to be enabled.
+	// Returns: the stats.
+	const GpuCullStats& GetGpuCullStats() const { return m_GpuCuller->GetStats(); }
+
+	// Turn culling the mesh's meshlets one by one on or off, when culling on the GPU with a mesh that has them.
+	// Cluster culling is off while checking the GPU against the CPU, which only culls whole objects.
+	// Params: if cluster culling is on.
+	void SetClusterCullingEnabled(bool enabled);
+
+	// Get if the GPU culled clusters rather than objects on the last draw.
+	// Returns: if clusters were culled.
+	bool IsCullingClusters() const { return m_GpuCuller != nullptr && m_GpuCuller->IsCullingClusters(); }
+
+	// Get the draw counts before and after merging from the last draw on the CPU path.
+	// Returns: the stats.
+	RenderQueueStats GetRenderQueueStats() const { return m_RenderQueue != nullptr ? m_RenderQueue->GetStats() : RenderQueueStats(); }
+
+	// Set the quality bias levels of detail are picked with, for performance tiers. Each step up halves the error
+	// allowed on screen, each step down doubles it. Levels are only picked once the camera's been set with SetCamera.
+	// Params: the bias, 0 for none.
+	void SetLodQualityBias(float bias) { m_LodSelector.SetQualityBias(bias); }
+
+	// Cross-fade objects between levels of detail rather than switching straight away. Only the CPU path without the
+	// depth prepass can fade, elsewhere objects still switch straight away.
+	// Params: the fade time in seconds, 0 to switch straight away.
+	void SetLodCrossFadeTime(float seconds) { m_LodFadeTime = seconds; }
+
+	// Get the level of detail counts from the last draw.
+	// Returns: the stats.
+	const LodStats& GetLodStats() const { return m_LodSelector.GetStats(); }
+
+	// Compare the objects the GPU drew on the last finished frame with the CPU frustum cull of the same frame.
+	// Returns: if they match.
+	bool CheckGpuCulling();
 
 	// Update the game scene.
 	void Update(float deltaTime);
@@ -24,12 +153,107 @@ public:
 	void Draw(VulkanRenderer* renderer);
 
 private:
+	// Rebuild or refit the trees used for the spatial queries.
+	void UpdateSpatialIndex();
+
+	// Remove the visible objects hidden behind occluders.
+	void CullOccludedObjects();
+
+	// Work out the shadow atlas's tiles, find each one's casters and write their data to the object ring buffer.
+	// Params: the renderer.
+	// Returns: the bindless index of this frame's shadow buffer.
+	uint UpdateShadows(VulkanRenderer* renderer);
+
 	// Vector of the game objects in the scene.
 	std::vector<GameObject*> m_GameObjects;
 
-	// Semaphore for if the image is avaliable.
-	VkSemaphore m_VkImageAvaliableSemaphore;
+	// Transforms of every game object in the scene.
+	TransformSystem m_TransformSystem;
+
+	// Every game object in the scene including children, indexed by scene index.
+	std::vector<GameObject*> m_AllGameObjects;
+
+	// Tree of the objects that don't move, built with SAH and then left alone.
+	BVH m_StaticBVH;
+
+	// Tree of the objects that move, refit every update.
+	BVH m_DynamicBVH;
+
+	// Scene indices of the objects in the dynamic tree, in the order they were given to it.
+	std::vector<uint> m_DynamicObjects;
+
+	// If objects were added or changed between static and dynamic since the trees were built.
+	bool m_SpatialIndexDirty = false;
+
+	// Job system for per frame work.
+	JobSystem* m_JobSystem;
+
+	// The camera's view projection matrix.
+	glm::mat4 m_ViewProjection = glm::mat4(1.0f);
+
+	// The camera's view matrix and projection, if it was set with SetCamera.
+	bool m_CameraSet = false;
+	glm::mat4 m_View = glm::mat4(1.0f);
+	float m_FovY = 0.0f;
+	float m_Aspect = 0.0f;
+	float m_NearPlane = 0.0f;
+	float m_FarPlane = 0.0f;
+
+	// The point lights.
+	std::vector<PointLight> m_Lights;
+
+	// Bins the lights into clusters each draw, created on the first draw with lights.
+	LightCuller* m_LightCuller = nullptr;
+
+	// The directional light, if one was set.
+	DirectionalLight m_DirectionalLight;
+	bool m_HasDirectionalLight = false;
+
+	// The renderer's shadow atlas, or nullptr without shadows.
+	ShadowAtlas* m_ShadowAtlas = nullptr;
+
+	// Scene indices of every shadow tile's casters this frame, static then dynamic for each tile.
+	std::vector<uint> m_ShadowCasters;
+
+	// World bounds of every object in SIMD friendly form, indexed by scene index.
+	FrustumCuller m_FrustumCuller;
+
+	// Scene indices of the objects that passed culling, sized to fit every object.
+	std::vector<uint> m_VisibleObjects;
+
+	// Amount of entries in m_VisibleObjects filled by the last cull.
+	size_t m_VisibleObjectCount = 0;
+
+	// World bounds of every object, indexed by scene index.
+	std::vector<AABB> m_WorldBounds;
+
+	// Culls objects hidden behind the occluder meshes of visible objects.
+	OcclusionCuller m_OcclusionCuller;
+
+	// If occlusion culling is on.
+	bool m_OcclusionCullingEnabled = true;
+
+	// Sorts and merges the visible objects into instanced draws, created on the first draw.
+	RenderQueue* m_RenderQueue = nullptr;
+
+	// Compute shader culling, or nullptr when culling on the CPU.
+	GpuCuller* m_GpuCuller = nullptr;
+
+	// If the CPU culls as well as the GPU, to check the GPU results.
+	bool m_GpuCullingCheck = false;
+
+	// If the GPU culls meshlets one by one.
+	bool m_ClusterCullingEnabled = false;
+
+	// Picks the level of detail each object is drawn at.
+	LodSelector m_LodSelector;
+
+	// How long changes of level of detail cross-fade for, 0 for not at all.
+	float m_LodFadeTime = 0.0f;
+
+	// Seconds the last update moved the scene on by, for moving the cross-fades on.
+	float m_DeltaTime = 0.0f;
 
-	// Semaphore for if rendering is finished.
-	VkSemaphore m_VkRenderFinishedSemaphore;
+	// Objects the GPU drew, read back for checking.
+	std::vector<uint> m_GpuVisibleObjects;
 };
\ No newline at end of file
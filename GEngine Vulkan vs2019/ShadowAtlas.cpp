@@ -0,0 +1,519 @@
+#include "ShadowAtlas.h"
+#include "BindlessTable.h"
+#include "Bounds.h"
+#include "GpuMesh.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Width and height of the atlas and the cache.
+static const uint SHADOW_ATLAS_SIZE = 4096;
+
+// The cascades are along the top of the atlas.
+static const uint CASCADE_TILE_SIZE = 1024;
+
+// How far from the camera the cascades reach, and how far towards the light casters are looked for past a cascade.
+static const float SHADOW_DISTANCE = 50.0f;
+static const float CASCADE_CASTER_DISTANCE = 100.0f;
+
+// How much the cascade splits lean towards logarithmic over even spacing.
+static const float CASCADE_SPLIT_BLEND = 0.75f;
+
+// Point light tiles fill the rest of the atlas, in cells of the largest tile size, each packed in Morton order
+// in units of the smallest.
+static const uint POINT_TILE_MAX = 512;
+static const uint POINT_TILE_MIN = 64;
+static const uint POINT_REGION_Y = CASCADE_TILE_SIZE;
+static const uint POINT_CELLS_X = SHADOW_ATLAS_SIZE / POINT_TILE_MAX;
+static const uint POINT_CELLS_Y = (SHADOW_ATLAS_SIZE - POINT_REGION_Y) / POINT_TILE_MAX;
+static const uint POINT_CELL_UNITS = (POINT_TILE_MAX / POINT_TILE_MIN) * (POINT_TILE_MAX / POINT_TILE_MIN);
+static const uint POINT_REGION_UNITS = POINT_CELLS_X * POINT_CELLS_Y * POINT_CELL_UNITS;
+
+// Point light shadows start this fraction of the light's radius away from it.
+static const float POINT_NEAR_SCALE = 0.01f;
+
+// Lights the shadow buffer has a face index for. Matches the light culler's limit.
+static const uint SHADOW_MAX_LIGHTS = 1024;
+
+// Where each part of the buffer starts, in bytes.
+static const VkDeviceSize FACES_OFFSET = sizeof(ShadowHeader);
+static const VkDeviceSize LIGHT_FACES_OFFSET = FACES_OFFSET + SHADOW_MAX_FACES * sizeof(ShadowView);
+static const VkDeviceSize SHADOW_BUFFER_SIZE = LIGHT_FACES_OFFSET + SHADOW_MAX_LIGHTS * sizeof(uint);
+
+// Direction and up of each cube face, in the order the fragment shader picks them by the major axis.
+static const glm::vec3 CUBE_FACE_DIRECTIONS[6] =
+{
+	glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+	glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+	glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+};
+
+static const glm::vec3 CUBE_FACE_UPS[6] =
+{
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+	glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+};
+
+// Units of the point light region a tile takes up.
+static uint GetTileUnits(uint tileSize)
+{
+	uint units = tileSize / POINT_TILE_MIN;
+	return units * units;
+}
+
+// Find the rect of a point light tile from the unit it starts at.
+// Tiles are packed biggest first, so every tile starts on a multiple of its own units and stays in one cell.
+static VkRect2D GetPointTileRect(uint unit, uint tileSize)
+{
+	uint cell = unit / POINT_CELL_UNITS;
+	uint morton = unit % POINT_CELL_UNITS;
+
+	uint x = 0;
+	uint y = 0;
+	for (uint bit = 0; (1u << (bit * 2)) < POINT_CELL_UNITS; ++bit)
+	{
+		x |= ((morton >> (bit * 2)) & 1) << bit;
+		y |= ((morton >> (bit * 2 + 1)) & 1) << bit;
+	}
+
+	VkRect2D rect;
+	rect.offset.x = (int32_t)((cell % POINT_CELLS_X) * POINT_TILE_MAX + x * POINT_TILE_MIN);
+	rect.offset.y = (int32_t)(POINT_REGION_Y + (cell / POINT_CELLS_X) * POINT_TILE_MAX + y * POINT_TILE_MIN);
+	rect.extent = { tileSize, tileSize };
+	return rect;
+}
+
+ShadowAtlas::ShadowAtlas(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+
+	CreateImages();
+
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Renderer->CreateBuffer(SHADOW_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_VkBuffers[i], m_VkMemory[i]);
+		vkMapMemory(m_VkDevice, m_VkMemory[i], 0, SHADOW_BUFFER_SIZE, 0, (void**)&m_MappedData[i]);
+
+		m_BindlessIndices[i] = m_Renderer->GetBindlessTable()->AddStorageBuffer(m_VkBuffers[i], 0, SHADOW_BUFFER_SIZE);
+		if (m_BindlessIndices[i] == BINDLESS_INVALID_INDEX)
+			throw std::runtime_error("Failed to add shadow buffer to the bindless table!");
+	}
+
+	m_Tiles.reserve(SHADOW_CASCADE_COUNT + SHADOW_MAX_FACES);
+	m_PreviousTiles.reserve(SHADOW_CASCADE_COUNT + SHADOW_MAX_FACES);
+	m_PointLights.reserve(SHADOW_MAX_LIGHTS);
+	m_ClearRects.reserve(SHADOW_CASCADE_COUNT + SHADOW_MAX_FACES);
+	m_CopyRegions.reserve(SHADOW_CASCADE_COUNT + SHADOW_MAX_FACES);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	BindlessTable* bindlessTable = m_Renderer->GetBindlessTable();
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		bindlessTable->RemoveStorageBuffer(m_BindlessIndices[i]);
+		vkUnmapMemory(m_VkDevice, m_VkMemory[i]);
+		vkDestroyBuffer(m_VkDevice, m_VkBuffers[i], nullptr);
+		vkFreeMemory(m_VkDevice, m_VkMemory[i], nullptr);
+	}
+
+	bindlessTable->RemoveImage(m_BindlessImage);
+	bindlessTable->RemoveSampler(m_BindlessSampler);
+	vkDestroySampler(m_VkDevice, m_VkSampler, nullptr);
+
+	vkDestroyFramebuffer(m_VkDevice, m_VkFramebuffer, nullptr);
+	vkDestroyFramebuffer(m_VkDevice, m_VkCacheFramebuffer, nullptr);
+
+	vkDestroyImageView(m_VkDevice, m_VkImageView, nullptr);
+	vkDestroyImage(m_VkDevice, m_VkImage, nullptr);
+	vkFreeMemory(m_VkDevice, m_VkImageMemory, nullptr);
+	vkDestroyImageView(m_VkDevice, m_VkCacheImageView, nullptr);
+	vkDestroyImage(m_VkDevice, m_VkCacheImage, nullptr);
+	vkFreeMemory(m_VkDevice, m_VkCacheImageMemory, nullptr);
+}
+
+void ShadowAtlas::CreateImages()
+{
+	// Same format as the depth buffer, so the depth only render passes and the shadow pipeline work with both.
+	VkFormat format = m_Renderer->GetDepthFormat();
+
+	m_Renderer->CreateImage(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 1, format,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, m_VkImage, m_VkImageMemory);
+	m_VkImageView = m_Renderer->CreateImageView(m_VkImage, format, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+
+	m_Renderer->CreateImage(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 1, format,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, m_VkCacheImage, m_VkCacheImageMemory);
+	m_VkCacheImageView = m_Renderer->CreateImageView(m_VkCacheImage, format, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+
+	if (!m_Renderer->IsDynamicRenderingEnabled())
+	{
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_Renderer->GetShadowRenderPass();
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &m_VkImageView;
+		framebufferInfo.width = SHADOW_ATLAS_SIZE;
+		framebufferInfo.height = SHADOW_ATLAS_SIZE;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(m_VkDevice, &framebufferInfo, nullptr, &m_VkFramebuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create shadow atlas framebuffer!");
+
+		framebufferInfo.pAttachments = &m_VkCacheImageView;
+		if (vkCreateFramebuffer(m_VkDevice, &framebufferInfo, nullptr, &m_VkCacheFramebuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create shadow cache framebuffer!");
+	}
+
+	// Filtering the comparisons gives 2x2 percentage closer filtering for free where the format allows it.
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(m_Renderer->GetPhysicalDevice(), format, &properties);
+	VkFilter filter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = filter;
+	samplerInfo.minFilter = filter;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(m_VkDevice, &samplerInfo, nullptr, &m_VkSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create shadow atlas sampler!");
+
+	BindlessTable* bindlessTable = m_Renderer->GetBindlessTable();
+	m_BindlessImage = bindlessTable->AddImage(m_VkImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	m_BindlessSampler = bindlessTable->AddSampler(m_VkSampler);
+	if (m_BindlessImage == BINDLESS_INVALID_INDEX || m_BindlessSampler == BINDLESS_INVALID_INDEX)
+		throw std::runtime_error("Failed to add shadow atlas to the bindless table!");
+}
+
+uint ShadowAtlas::Update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, const DirectionalLight* sun,
+	const PointLight* lights, size_t lightCount, uint frameIndex)
+{
+	std::swap(m_Tiles, m_PreviousTiles);
+	m_Tiles.clear();
+	m_Stats = ShadowStats();
+
+	lightCount = std::min<size_t>(lightCount, SHADOW_MAX_LIGHTS);
+
+	char* data = m_MappedData[frameIndex];
+	ShadowView* faces = (ShadowView*)(data + FACES_OFFSET);
+	uint* lightFaces = (uint*)(data + LIGHT_FACES_OFFSET);
+
+	ShadowHeader header;
+	header.m_AtlasImage = m_BindlessImage;
+	header.m_AtlasSampler = m_BindlessSampler;
+	header.m_CascadeCount = 0;
+	header.m_LightCount = (uint)lightCount;
+	header.m_SunDirection = glm::vec4(0.0f);
+	header.m_SunColour = glm::vec4(0.0f);
+	header.m_ViewDepth = glm::vec4(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+	header.m_CascadeSplits = glm::vec4(0.0f);
+
+	if (sun != nullptr)
+		AddCascades(view, fovY, aspect, nearPlane, farPlane, *sun, header);
+
+	// The same projection as the scene's camera.
+	glm::mat4 projection = glm::perspective(fovY, aspect, nearPlane, farPlane);
+	projection[1][1] *= -1.0f;
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+	PickPointLights(projection * view, cameraPosition, fovY, lights, lightCount);
+
+	memset(lightFaces, 0xFF, lightCount * sizeof(uint));
+	uint unit = 0;
+	for (size_t i = 0; i < m_PointLights.size(); ++i)
+	{
+		const PointLightRequest& request = m_PointLights[i];
+		const PointLight& light = lights[request.m_Light];
+		lightFaces[request.m_Light] = (uint)i * 6;
+
+		glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, light.m_Radius * POINT_NEAR_SCALE, light.m_Radius);
+		for (uint face = 0; face < 6; ++face)
+		{
+			glm::mat4 faceView = glm::lookAt(light.m_Position, light.m_Position + CUBE_FACE_DIRECTIONS[face], CUBE_FACE_UPS[face]);
+			faces[i * 6 + face] = AddTile(GetPointTileRect(unit, request.m_TileSize), faceProjection * faceView);
+			unit += GetTileUnits(request.m_TileSize);
+		}
+	}
+
+	memcpy(data, &header, sizeof(header));
+
+	m_StaticCastersChanged = false;
+	m_Stats.m_TileCount = m_Tiles.size();
+	m_Stats.m_PointLightCount = m_PointLights.size();
+	return m_BindlessIndices[frameIndex];
+}
+
+void ShadowAtlas::AddCascades(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, const DirectionalLight& sun, ShadowHeader& header)
+{
+	float shadowFar = std::min(farPlane, SHADOW_DISTANCE);
+	glm::mat4 inverseView = glm::inverse(view);
+
+	// Distance from the view axis to a corner of the view, per unit of depth.
+	float tanHalfFovY = std::tan(fovY * 0.5f);
+	float cornerSquared = tanHalfFovY * tanHalfFovY * (1.0f + aspect * aspect);
+
+	// Light space has no translation, so snapping a position in it to texels snaps the whole shadow map.
+	glm::vec3 direction = glm::normalize(sun.m_Direction);
+	glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	float splitNear = nearPlane;
+	for (uint i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+	{
+		float fraction = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+		float logarithmic = nearPlane * std::pow(shadowFar / nearPlane, fraction);
+		float even = nearPlane + (shadowFar - nearPlane) * fraction;
+		float splitFar = CASCADE_SPLIT_BLEND * logarithmic + (1.0f - CASCADE_SPLIT_BLEND) * even;
+
+		// The smallest sphere around the slice has its centre on the view axis, so its size doesn't change as the camera turns.
+		float centreDepth = std::min((splitNear + splitFar) * 0.5f * (1.0f + cornerSquared), splitFar);
+		float radius = std::sqrt((splitFar - centreDepth) * (splitFar - centreDepth) + cornerSquared * splitFar * splitFar);
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		float texelSize = 2.0f * radius / CASCADE_TILE_SIZE;
+		glm::vec3 centre = glm::vec3(lightView * inverseView * glm::vec4(0.0f, 0.0f, -centreDepth, 1.0f));
+		centre = glm::floor(centre / texelSize) * texelSize;
+
+		// Light space looks down -z. The near plane is pulled back towards the light to keep casters outside the slice.
+		glm::mat4 projection = glm::ortho(centre.x - radius, centre.x + radius, centre.y - radius, centre.y + radius,
+			-centre.z - radius - CASCADE_CASTER_DISTANCE, -centre.z + radius);
+
+		VkRect2D rect;
+		rect.offset = { (int32_t)(i * CASCADE_TILE_SIZE), 0 };
+		rect.extent = { CASCADE_TILE_SIZE, CASCADE_TILE_SIZE };
+		header.m_Cascades[i] = AddTile(rect, projection * lightView);
+		header.m_CascadeSplits[i] = splitFar;
+		splitNear = splitFar;
+	}
+
+	header.m_CascadeCount = SHADOW_CASCADE_COUNT;
+	header.m_SunDirection = glm::vec4(-direction, sun.m_Intensity);
+	header.m_SunColour = glm::vec4(sun.m_Colour, 1.0f);
+}
+
+void ShadowAtlas::PickPointLights(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float fovY, const PointLight* lights, size_t lightCount)
+{
+	m_PointLights.clear();
+
+	Frustum frustum = Frustum::FromMatrix(viewProjection);
+	float tanHalfFovY = std::tan(fovY * 0.5f);
+
+	for (size_t i = 0; i < lightCount; ++i)
+	{
+		Sphere sphere;
+		sphere.m_Centre = lights[i].m_Position;
+		sphere.m_Radius = lights[i].m_Radius;
+		if (!frustum.TestSphere(sphere))
+			continue;
+
+		// Height of the light's sphere on screen as a fraction of the screen's, 1 when the camera's inside it.
+		float distance = glm::length(lights[i].m_Position - cameraPosition);
+		float coverage = 1.0f;
+		if (distance > sphere.m_Radius)
+			coverage = std::min(sphere.m_Radius / (std::sqrt(distance * distance - sphere.m_Radius * sphere.m_Radius) * tanHalfFovY), 1.0f);
+
+		PointLightRequest request;
+		request.m_Light = (uint)i;
+		request.m_Coverage = coverage;
+		request.m_TileSize = POINT_TILE_MIN;
+		while (request.m_TileSize < POINT_TILE_MAX && request.m_TileSize * 2 <= coverage * POINT_TILE_MAX)
+			request.m_TileSize *= 2;
+
+		m_PointLights.push_back(request);
+	}
+
+	// Keep the lights covering the most, ties going to the lower index so the pick doesn't flicker.
+	size_t count = std::min<size_t>(m_PointLights.size(), SHADOW_MAX_POINT_LIGHTS);
+	std::partial_sort(m_PointLights.begin(), m_PointLights.begin() + count, m_PointLights.end(),
+		[](const PointLightRequest& a, const PointLightRequest& b) { return a.m_Coverage != b.m_Coverage ? a.m_Coverage > b.m_Coverage : a.m_Light < b.m_Light; });
+	m_PointLights.resize(count);
+
+	uint units = 0;
+	for (const PointLightRequest& request : m_PointLights)
+		units += GetTileUnits(request.m_TileSize) * 6;
+
+	// Until they all fit, halve the biggest tiles, starting with the light covering the least. Every light at the
+	// smallest size always fits.
+	while (units > POINT_REGION_UNITS)
+	{
+		uint biggest = POINT_TILE_MIN;
+		for (const PointLightRequest& request : m_PointLights)
+			biggest = std::max(biggest, request.m_TileSize);
+
+		for (size_t i = count; i-- > 0;)
+		{
+			PointLightRequest& request = m_PointLights[i];
+			if (request.m_TileSize == biggest)
+			{
+				units -= (GetTileUnits(request.m_TileSize) - GetTileUnits(request.m_TileSize / 2)) * 6;
+				request.m_TileSize /= 2;
+				break;
+			}
+		}
+	}
+
+	// Biggest tiles first keeps every tile aligned to its size when packing. Within a size the order is by light,
+	// so tiles only move when a light's size changes.
+	std::sort(m_PointLights.begin(), m_PointLights.end(),
+		[](const PointLightRequest& a, const PointLightRequest& b) { return a.m_TileSize != b.m_TileSize ? a.m_TileSize > b.m_TileSize : a.m_Light < b.m_Light; });
+}
+
+ShadowView ShadowAtlas::AddTile(const VkRect2D& rect, const glm::mat4& viewProjection)
+{
+	Tile tile{};
+	tile.m_Rect = rect;
+	tile.m_ViewProjection = viewProjection;
+
+	// The cache still has the tile if last frame drew it the same way in the same place. Tiles in a frame never
+	// overlap, so nothing else can have drawn over it since.
+	tile.m_StaticDirty = true;
+	if (!m_StaticCastersChanged)
+	{
+		for (const Tile& previous : m_PreviousTiles)
+		{
+			if (previous.m_Rect.offset.x == rect.offset.x && previous.m_Rect.offset.y == rect.offset.y &&
+				previous.m_Rect.extent.width == rect.extent.width && previous.m_ViewProjection == viewProjection)
+			{
+				tile.m_StaticDirty = false;
+				break;
+			}
+		}
+	}
+
+	if (tile.m_StaticDirty)
+		++m_Stats.m_StaticTilesDrawn;
+
+	m_Tiles.push_back(tile);
+
+	// Clip space x and y from -1 to 1 go to the tile's texture coordinates, the same way the viewport maps them when drawing.
+	float scale = rect.extent.width * 0.5f / SHADOW_ATLAS_SIZE;
+	glm::mat4 toTile(1.0f);
+	toTile[0][0] = scale;
+	toTile[1][1] = scale;
+	toTile[3][0] = (rect.offset.x + rect.extent.width * 0.5f) / SHADOW_ATLAS_SIZE;
+	toTile[3][1] = (rect.offset.y + rect.extent.height * 0.5f) / SHADOW_ATLAS_SIZE;
+
+	float halfTexel = 0.5f / SHADOW_ATLAS_SIZE;
+	ShadowView shadowView;
+	shadowView.m_Matrix = toTile * viewProjection;
+	shadowView.m_Bounds = glm::vec4((float)rect.offset.x / SHADOW_ATLAS_SIZE + halfTexel, (float)rect.offset.y / SHADOW_ATLAS_SIZE + halfTexel,
+		(float)(rect.offset.x + rect.extent.width) / SHADOW_ATLAS_SIZE - halfTexel, (float)(rect.offset.y + rect.extent.height) / SHADOW_ATLAS_SIZE - halfTexel);
+	return shadowView;
+}
+
+void ShadowAtlas::SetTileCasters(size_t tile, uint firstStatic, uint staticCount, uint firstDynamic, uint dynamicCount)
+{
+	m_Tiles[tile].m_FirstStatic = firstStatic;
+	m_Tiles[tile].m_StaticCount = staticCount;
+	m_Tiles[tile].m_FirstDynamic = firstDynamic;
+	m_Tiles[tile].m_DynamicCount = dynamicCount;
+
+	m_Stats.m_StaticCasterCount += staticCount;
+	m_Stats.m_DynamicCasterCount += dynamicCount;
+}
+
+void ShadowAtlas::DrawCasters(VkCommandBuffer commandBuffer, const Tile& tile, uint first, uint count)
+{
+	if (count == 0)
+		return;
+
+	VkViewport viewport;
+	viewport.x = (float)tile.m_Rect.offset.x;
+	viewport.y = (float)tile.m_Rect.offset.y;
+	viewport.width = (float)tile.m_Rect.extent.width;
+	viewport.height = (float)tile.m_Rect.extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &tile.m_Rect);
+
+	DrawConstants drawConstants;
+	drawConstants.m_ViewProjection = tile.m_ViewProjection;
+	drawConstants.m_FirstObject = m_FirstCaster;
+	m_Renderer->PushDrawConstants(commandBuffer, drawConstants);
+
+	// Casters are drawn at full detail whatever level the camera sees, so the cached static tiles stay right as it moves.
+	const MeshLod& lod = m_Renderer->GetDemoMesh()->GetLod(0);
+	vkCmdDrawIndexed(commandBuffer, lod.m_IndexCount, count, lod.m_FirstIndex, 0, first);
+}
+
+void ShadowAtlas::RecordStaticCasters(VkCommandBuffer commandBuffer)
+{
+	m_ClearRects.clear();
+	for (const Tile& tile : m_Tiles)
+	{
+		if (tile.m_StaticDirty)
+		{
+			VkClearRect clearRect;
+			clearRect.rect = tile.m_Rect;
+			clearRect.baseArrayLayer = 0;
+			clearRect.layerCount = 1;
+			m_ClearRects.push_back(clearRect);
+		}
+	}
+
+	if (m_ClearRects.empty())
+		return;
+
+	m_Renderer->BeginShadowRendering(commandBuffer, m_VkCacheImageView, m_VkCacheFramebuffer, { SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE });
+
+	// Only the out of date tiles are cleared, the rest of the cache is kept.
+	VkClearAttachment clear{};
+	clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	clear.clearValue.depthStencil = { 1.0f, 0 };
+	vkCmdClearAttachments(commandBuffer, 1, &clear, (uint)m_ClearRects.size(), m_ClearRects.data());
+
+	for (const Tile& tile : m_Tiles)
+	{
+		if (tile.m_StaticDirty)
+			DrawCasters(commandBuffer, tile, tile.m_FirstStatic, tile.m_StaticCount);
+	}
+
+	m_Renderer->EndRendering(commandBuffer);
+}
+
+void ShadowAtlas::RecordCopy(VkCommandBuffer commandBuffer)
+{
+	m_CopyRegions.clear();
+	for (const Tile& tile : m_Tiles)
+	{
+		VkImageCopy region{};
+		region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		region.srcSubresource.layerCount = 1;
+		region.srcOffset = { tile.m_Rect.offset.x, tile.m_Rect.offset.y, 0 };
+		region.dstSubresource = region.srcSubresource;
+		region.dstOffset = region.srcOffset;
+		region.extent = { tile.m_Rect.extent.width, tile.m_Rect.extent.height, 1 };
+		m_CopyRegions.push_back(region);
+	}
+
+	if (m_CopyRegions.empty())
+		return;
+
+	vkCmdCopyImage(commandBuffer, m_VkCacheImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_VkImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		(uint)m_CopyRegions.size(), m_CopyRegions.data());
+}
+
+void ShadowAtlas::RecordDynamicCasters(VkCommandBuffer commandBuffer)
+{
+	if (m_Stats.m_DynamicCasterCount == 0)
+		return;
+
+	m_Renderer->BeginShadowRendering(commandBuffer, m_VkImageView, m_VkFramebuffer, { SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE });
+
+	for (const Tile& tile : m_Tiles)
+		DrawCasters(commandBuffer, tile, tile.m_FirstDynamic, tile.m_DynamicCount);
+
+	m_Renderer->EndRendering(commandBuffer);
+}
\ No newline at end of file
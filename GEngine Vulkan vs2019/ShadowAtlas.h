@@ -0,0 +1,226 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+#include "LightCuller.h"
+#include <vector>
+
+// Cascades the directional light's shadows are split into along the camera's view.
+#define SHADOW_CASCADE_COUNT 4
+
+// Point lights that can have shadows at once, each with a tile per cube face.
+#define SHADOW_MAX_POINT_LIGHTS 16
+#define SHADOW_MAX_FACES (SHADOW_MAX_POINT_LIGHTS * 6)
+
+// A light that's infinitely far away, such as the sun.
+struct DirectionalLight
+{
+	// Direction the light travels in.
+	glm::vec3 m_Direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	float m_Intensity = 1.0f;
+	glm::vec3 m_Colour = glm::vec3(1.0f);
+};
+
+// A tile in the shadow buffer: the matrix taking world space to atlas (u, v, depth), and the texture coordinates
+// lookups are clamped to, half a texel inside the tile so filtering doesn't read its neighbours.
+struct ShadowView
+{
+	glm::mat4 m_Matrix;
+	glm::vec4 m_Bounds;
+};
+
+// Start of the shadow buffer, read by the fragment shader. The faces of the point lights follow it, then for
+// every light in the light grid, the index of its first face or 0xFFFFFFFF if it has no shadow.
+struct ShadowHeader
+{
+	// Bindless indices of the atlas and its comparison sampler.
+	uint m_AtlasImage;
+	uint m_AtlasSampler;
+	uint m_CascadeCount;
+	uint m_LightCount;
+	// Direction towards the directional light, with its intensity in w, and its colour.
+	glm::vec4 m_SunDirection;
+	glm::vec4 m_SunColour;
+	// Dotted with a world position and 1 to get the camera's view depth there.
+	glm::vec4 m_ViewDepth;
+	// View depth each cascade reaches.
+	glm::vec4 m_CascadeSplits;
+	ShadowView m_Cascades[SHADOW_CASCADE_COUNT];
+};
+
+// Counts from the last update.
+struct ShadowStats
+{
+	size_t m_TileCount = 0;
+	size_t m_PointLightCount = 0;
+	// Tiles whose static casters were drawn again, the rest were copied from the cache.
+	size_t m_StaticTilesDrawn = 0;
+	// Objects drawn into the cache and over the atlas.
+	size_t m_StaticCasterCount = 0;
+	size_t m_DynamicCasterCount = 0;
+};
+
+// Shadow maps for a directional light and point lights, packed into one depth atlas.
+// The directional light gets a cascade per split of the camera's view, snapped to whole texels so they only move
+// when the camera moves far enough. The point lights covering the most of the screen get a tile per cube face,
+// sized by how much of the screen they cover and halved until they all fit.
+// Drawing every shadow map every frame costs too much, so static casters are drawn into a cache atlas, and a tile
+// is only drawn again when its light or place in the atlas changes, or the static objects do. Each frame the cached
+// tiles are copied into the atlas and only the dynamic casters are drawn over them.
+class ShadowAtlas
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the atlas with, which has the shadow pipeline and bindless table.
+	ShadowAtlas(VulkanRenderer* renderer);
+	// Destructor.
+	~ShadowAtlas();
+
+	// Throw away every tile's cached static casters, for when static objects were added or changed.
+	void InvalidateStaticCasters() { m_StaticCastersChanged = true; }
+
+	// Work out this frame's tiles and write them to this frame's buffer.
+	// Params: the camera's view matrix, vertical field of view in radians, aspect ratio, near and far plane distances,
+	// the directional light or nullptr, the point lights in the order they're in the light grid, how many, the frame in flight index.
+	// Returns: the bindless storage buffer index of the frame's shadow buffer.
+	uint Update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, const DirectionalLight* sun,
+		const PointLight* lights, size_t lightCount, uint frameIndex);
+
+	// Get the amount of tiles this frame.
+	// Returns: the tile count.
+	size_t GetTileCount() const { return m_Tiles.size(); }
+
+	// Get the matrix a tile's casters are drawn with.
+	// Params: the tile.
+	// Returns: the view projection matrix.
+	const glm::mat4& GetTileViewProjection(size_t tile) const { return m_Tiles[tile].m_ViewProjection; }
+
+	// Check if a tile's static casters have to be drawn into the cache this frame.
+	// Params: the tile.
+	// Returns: if the cached tile is out of date.
+	bool IsTileStaticDirty(size_t tile) const { return m_Tiles[tile].m_StaticDirty; }
+
+	// Set the objects to draw into a tile, as ranges of the casters written to the object ring buffer.
+	// Params: the tile, first static caster and how many, first dynamic caster and how many.
+	void SetTileCasters(size_t tile, uint firstStatic, uint staticCount, uint firstDynamic, uint dynamicCount);
+
+	// Set where this frame's casters start in the object ring buffer.
+	// Params: the index of the first caster's data.
+	void SetFirstCaster(uint firstCaster) { m_FirstCaster = firstCaster; }
+
+	// Record drawing the static casters of the out of date tiles into the cache.
+	// Params: the command buffer.
+	void RecordStaticCasters(VkCommandBuffer commandBuffer);
+
+	// Record copying every tile from the cache into the atlas.
+	// Params: the command buffer.
+	void RecordCopy(VkCommandBuffer commandBuffer);
+
+	// Record drawing the dynamic casters over the atlas.
+	// Params: the command buffer.
+	void RecordDynamicCasters(VkCommandBuffer commandBuffer);
+
+	// Get the atlas sampled when shading.
+	// Returns: the image and its view.
+	VkImage GetImage() const { return m_VkImage; }
+	VkImageView GetImageView() const { return m_VkImageView; }
+
+	// Get the cache of static casters.
+	// Returns: the image and its view.
+	VkImage GetCacheImage() const { return m_VkCacheImage; }
+	VkImageView GetCacheImageView() const { return m_VkCacheImageView; }
+
+	// Get the counts from the last update.
+	// Returns: the stats.
+	const ShadowStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Tile
+	{
+		VkRect2D m_Rect;
+		glm::mat4 m_ViewProjection;
+		bool m_StaticDirty;
+		uint m_FirstStatic;
+		uint m_StaticCount;
+		uint m_FirstDynamic;
+		uint m_DynamicCount;
+	};
+
+	// A point light wanting a shadow, and the size of its tiles.
+	struct PointLightRequest
+	{
+		uint m_Light;
+		float m_Coverage;
+		uint m_TileSize;
+	};
+
+	// Create the atlas, the cache, their framebuffers and the sampler.
+	void CreateImages();
+
+	// Add the cascades of the directional light.
+	// Params: the camera's view matrix, vertical field of view, aspect ratio, near and far plane distances, the light, the buffer header.
+	void AddCascades(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, const DirectionalLight& sun, ShadowHeader& header);
+
+	// Pick the point lights to shadow and size their tiles.
+	// Params: the camera's view projection matrix, position and vertical field of view, the lights, how many.
+	void PickPointLights(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float fovY, const PointLight* lights, size_t lightCount);
+
+	// Add a tile, working out if its cached static casters are still good.
+	// Params: where it is in the atlas, the matrix its casters are drawn with.
+	// Returns: the tile's view for the shadow buffer.
+	ShadowView AddTile(const VkRect2D& rect, const glm::mat4& viewProjection);
+
+	// Draw a range of a tile's casters, after BeginShadowRendering.
+	// Params: the command buffer, the tile, the first caster, how many.
+	void DrawCasters(VkCommandBuffer commandBuffer, const Tile& tile, uint first, uint count);
+
+	// The renderer the atlas was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// The atlas the fragment shader samples and the cache of static casters, in the depth buffer's format.
+	VkImage m_VkImage;
+	VkDeviceMemory m_VkImageMemory;
+	VkImageView m_VkImageView;
+	VkImage m_VkCacheImage;
+	VkDeviceMemory m_VkCacheImageMemory;
+	VkImageView m_VkCacheImageView;
+
+	// Framebuffers for the depth only render passes, when dynamic rendering isn't used.
+	VkFramebuffer m_VkFramebuffer = VK_NULL_HANDLE;
+	VkFramebuffer m_VkCacheFramebuffer = VK_NULL_HANDLE;
+
+	// Comparison sampler, and its and the atlas's indices in the bindless table.
+	VkSampler m_VkSampler;
+	uint m_BindlessImage;
+	uint m_BindlessSampler;
+
+	// One host visible buffer per frame in flight, mapped, and its index in the bindless table.
+	VkBuffer m_VkBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory m_VkMemory[MAX_FRAMES_IN_FLIGHT];
+	char* m_MappedData[MAX_FRAMES_IN_FLIGHT];
+	uint m_BindlessIndices[MAX_FRAMES_IN_FLIGHT];
+
+	// This frame's tiles and last frame's, to check which cached tiles are still good.
+	std::vector<Tile> m_Tiles;
+	std::vector<Tile> m_PreviousTiles;
+
+	// If the static casters changed since the tiles were last drawn.
+	bool m_StaticCastersChanged = true;
+
+	// Where this frame's casters start in the object ring buffer.
+	uint m_FirstCaster = 0;
+
+	// Point lights picked for shadows this frame.
+	std::vector<PointLightRequest> m_PointLights;
+
+	// Rects of the out of date tiles, cleared before their static casters are drawn.
+	std::vector<VkClearRect> m_ClearRects;
+
+	// Regions copied from the cache to the atlas.
+	std::vector<VkImageCopy> m_CopyRegions;
+
+	// Counts from the last update.
+	ShadowStats m_Stats;
+};
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "TemporalUpsampler.h"
+#include "BindlessTable.h"
+#include "DescriptorAllocator.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Format of the history, with room for colours over 1 and the amount gathered in alpha.
+static const VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+// Output pixels covered by the upsample's workgroups along each side.
+static const uint UPSAMPLE_GROUP_SIZE = 8;
+
+// Jitter offsets per output pixel each render pixel covers, so every output pixel gets samples from all over it,
+// and the most the sequence can have before it starts again.
+static const float JITTER_PHASES_PER_PIXEL = 8.0f;
+static const uint MAX_JITTER_PHASES = 64;
+
+// Part of the Halton sequence with a base, from 0 to 1, spread out evenly however many of it are used.
+static float Halton(uint index, uint base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (index > 0)
+	{
+		fraction /= (float)base;
+		result += fraction * (float)(index % base);
+		index /= base;
+	}
+
+	return result;
+}
+
+TemporalUpsampler::TemporalUpsampler(VulkanRenderer* renderer)
+{
+	m_Renderer = renderer;
+	m_VkDevice = renderer->GetLogicalDevice();
+	m_OutputExtent = renderer->GetSwapChainExtent();
+
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Renderer->CreateBuffer(sizeof(MotionConstants), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			m_VkBuffers[i], m_VkMemory[i]);
+		vkMapMemory(m_VkDevice, m_VkMemory[i], 0, sizeof(MotionConstants), 0, (void**)&m_MappedData[i]);
+
+		m_BindlessIndices[i] = m_Renderer->GetBindlessTable()->AddStorageBuffer(m_VkBuffers[i], 0, sizeof(MotionConstants));
+		if (m_BindlessIndices[i] == BINDLESS_INVALID_INDEX)
+			throw std::runtime_error("Failed to add motion buffer to the bindless table!");
+	}
+
+	m_PreviousViewProjection = glm::mat4(1.0f);
+	m_JitteredViewProjection = glm::mat4(1.0f);
+	memset(&m_Constants, 0, sizeof(UpsampleConstants));
+
+	CreateImages();
+	CreatePipeline();
+}
+
+TemporalUpsampler::~TemporalUpsampler()
+{
+	vkDestroyPipeline(m_VkDevice, m_VkPipeline, nullptr);
+	vkDestroyPipelineLayout(m_VkDevice, m_VkPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_VkDevice, m_VkDescriptorSetLayout, nullptr);
+	vkDestroySampler(m_VkDevice, m_VkPointSampler, nullptr);
+	vkDestroySampler(m_VkDevice, m_VkLinearSampler, nullptr);
+
+	for (uint i = 0; i < 2; ++i)
+	{
+		vkDestroyImageView(m_VkDevice, m_VkHistoryImageViews[i], nullptr);
+		vkDestroyImage(m_VkDevice, m_VkHistoryImages[i], nullptr);
+		vkFreeMemory(m_VkDevice, m_VkHistoryMemory[i], nullptr);
+	}
+
+	for (uint i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_Renderer->GetBindlessTable()->RemoveStorageBuffer(m_BindlessIndices[i]);
+		vkUnmapMemory(m_VkDevice, m_VkMemory[i]);
+		vkDestroyBuffer(m_VkDevice, m_VkBuffers[i], nullptr);
+		vkFreeMemory(m_VkDevice, m_VkMemory[i], nullptr);
+	}
+}
+
+void TemporalUpsampler::CreateImages()
+{
+	for (uint i = 0; i < 2; ++i)
+	{
+		m_Renderer->CreateImage(m_OutputExtent.width, m_OutputExtent.height, 1, HISTORY_FORMAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, m_VkHistoryImages[i], m_VkHistoryMemory[i]);
+		m_VkHistoryImageViews[i] = m_Renderer->CreateImageView(m_VkHistoryImages[i], HISTORY_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	}
+
+	// The render graph expects imported images to be how it left them last frame, so the first frame has to find them
+	// readable too. What's in them doesn't matter, the history isn't valid yet.
+	VkImageMemoryBarrier barriers[2]{};
+	for (uint i = 0; i < 2; ++i)
+	{
+		barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[i].srcAccessMask = 0;
+		barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[i].image = m_VkHistoryImages[i];
+		barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barriers[i].subresourceRange.levelCount = 1;
+		barriers[i].subresourceRange.layerCount = 1;
+	}
+
+	VkCommandBuffer commandBuffer = m_Renderer->BeginSingleTimeCommands();
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+	m_Renderer->EndSingleTimeCommands(commandBuffer);
+
+	// The render targets are read texel by texel, the history between texels.
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(m_VkDevice, &samplerInfo, nullptr, &m_VkPointSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create temporal upsampling sampler!");
+
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+
+	if (vkCreateSampler(m_VkDevice, &samplerInfo, nullptr, &m_VkLinearSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create temporal upsampling sampler!");
+}
+
+void TemporalUpsampler::CreatePipeline()
+{
+	// Scene colour, motion, depth and last frame's history, then this frame's history.
+	VkDescriptorSetLayoutBinding bindings[5]{};
+	for (uint i = 0; i < 5; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i < 4 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 5;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_VkDevice, &layoutInfo, nullptr, &m_VkDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create temporal upsampling descriptor set layout!");
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(UpsampleConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_VkDescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_VkDevice, &pipelineLayoutInfo, nullptr, &m_VkPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create temporal upsampling pipeline layout!");
+
+	VkShaderModule shaderModule = m_Renderer->CreateShaderModule(m_Renderer->ReadFile("../Shaders/TemporalUpsample/temporalUpsample.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_VkPipelineLayout;
+
+	if (vkCreateComputePipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create temporal upsampling pipeline!");
+
+	vkDestroyShaderModule(m_VkDevice, shaderModule, nullptr);
+}
+
+VkExtent2D TemporalUpsampler::GetRenderExtent(VkExtent2D outputExtent) const
+{
+	VkExtent2D extent;
+	extent.width = std::min(std::max((uint)(outputExtent.width * m_RenderScale + 0.5f), 1u), outputExtent.width);
+	extent.height = std::min(std::max((uint)(outputExtent.height * m_RenderScale + 0.5f), 1u), outputExtent.height);
+
+	return extent;
+}
+
+void TemporalUpsampler::ResetHistory()
+{
+	m_HistoryValid = false;
+	++m_Stats.m_HistoryResets;
+}
+
+uint TemporalUpsampler::Update(const glm::mat4& viewProjection, VkExtent2D renderExtent, uint frameIndex)
+{
+	// Last frame's history is read and the other image written over.
+	m_HistoryIndex = 1 - m_HistoryIndex;
+
+	// The more output pixels each render pixel covers, the more offsets it takes to sample all of them.
+	float outputPixels = (float)m_OutputExtent.width / renderExtent.width * ((float)m_OutputExtent.height / renderExtent.height);
+	uint phaseCount = std::min((uint)std::ceil(JITTER_PHASES_PER_PIXEL * outputPixels), MAX_JITTER_PHASES);
+	m_JitterIndex = (m_JitterIndex + 1) % phaseCount;
+
+	// Index 0 of the sequence is 0 on both axes, so it starts at 1. Bases 2 and 3 don't line up with each other.
+	glm::vec2 jitter(Halton(m_JitterIndex + 1, 2) - 0.5f, Halton(m_JitterIndex + 1, 3) - 0.5f);
+
+	// A clip space offset of 2 / size moves the image by a whole pixel.
+	glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * jitter.x / renderExtent.width, 2.0f * jitter.y / renderExtent.height, 0.0f));
+	m_JitteredViewProjection = offset * viewProjection;
+
+	// Motion is worked out without the jitter, or still surfaces would look like they were shaking.
+	MotionConstants motion;
+	motion.m_ViewProjection = viewProjection;
+	motion.m_PreviousViewProjection = m_HasPreviousViewProjection ? m_PreviousViewProjection : viewProjection;
+	memcpy(m_MappedData[frameIndex], &motion, sizeof(MotionConstants));
+
+	m_PreviousViewProjection = viewProjection;
+	m_HasPreviousViewProjection = true;
+
+	m_Constants.m_Jitter[0] = jitter.x;
+	m_Constants.m_Jitter[1] = jitter.y;
+	m_Constants.m_RenderSize[0] = (int32_t)renderExtent.width;
+	m_Constants.m_RenderSize[1] = (int32_t)renderExtent.height;
+	m_Constants.m_OutputSize[0] = (int32_t)m_OutputExtent.width;
+	m_Constants.m_OutputSize[1] = (int32_t)m_OutputExtent.height;
+	m_Constants.m_HistoryValid = m_HistoryValid ? 1 : 0;
+	m_HistoryValid = true;
+
+	m_Stats.m_RenderExtent = renderExtent;
+	m_Stats.m_OutputExtent = m_OutputExtent;
+	m_Stats.m_Jitter = jitter;
+	m_Stats.m_JitterPhaseCount = phaseCount;
+
+	return m_BindlessIndices[frameIndex];
+}
+
+void TemporalUpsampler::Record(VkCommandBuffer commandBuffer, VkImageView sceneColour, VkImageView motion)
+{
+	// The targets are transient and the history images swap every frame, so the set is made for each frame.
+	DescriptorWrite descriptorWrites[5];
+	descriptorWrites[0] = DescriptorWrite::Image(0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_VkPointSampler, sceneColour, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	descriptorWrites[1] = DescriptorWrite::Image(1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_VkPointSampler, motion, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	descriptorWrites[2] = DescriptorWrite::Image(2, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_VkPointSampler, m_Renderer->GetDepthImageView(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	descriptorWrites[3] = DescriptorWrite::Image(3, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_VkLinearSampler, GetPreviousHistoryImageView(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	descriptorWrites[4] = DescriptorWrite::Image(4, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE, GetHistoryImageView(), VK_IMAGE_LAYOUT_GENERAL);
+
+	VkDescriptorSet descriptorSet = m_Renderer->GetDescriptorAllocator()->AllocateFrameSet(m_VkDescriptorSetLayout, descriptorWrites, 5);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_VkPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_VkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpsampleConstants), &m_Constants);
+	vkCmdDispatch(commandBuffer, (m_OutputExtent.width + UPSAMPLE_GROUP_SIZE - 1) / UPSAMPLE_GROUP_SIZE,
+		(m_OutputExtent.height + UPSAMPLE_GROUP_SIZE - 1) / UPSAMPLE_GROUP_SIZE, 1);
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstdint>
+#include "VulkanRenderer.h"
+
+// The motion buffer, read by the vertex shader to work out motion vectors.
+struct MotionConstants
+{
+	// This frame's and last frame's view projection, both without the jitter.
+	glm::mat4 m_ViewProjection;
+	glm::mat4 m_PreviousViewProjection;
+};
+
+// Numbers from the last update.
+struct TemporalUpsamplerStats
+{
+	VkExtent2D m_RenderExtent = {};
+	VkExtent2D m_OutputExtent = {};
+	// This frame's sub-pixel offset in render pixels, and how many offsets the sequence goes through.
+	glm::vec2 m_Jitter = glm::vec2(0.0f);
+	uint m_JitterPhaseCount = 0;
+	// Times the history was thrown away.
+	size_t m_HistoryResets = 0;
+};
+
+// Rebuilds a full resolution image from a scene drawn at a lower one, by gathering samples over several frames.
+// The projection is moved by a different sub-pixel offset each frame, from a Halton sequence, so over a few
+// frames every output pixel gets samples from all over its area. The main pass writes per-pixel motion vectors,
+// and the upsample follows them back to where each pixel was in the history and blends in this frame's samples.
+// History that doesn't fit this frame's 3x3 neighbourhood, from things appearing, moving or changing, is clipped
+// to its colour range so it doesn't leave trails, and surfaces with a reactive material lean on this frame more.
+// The history is a pair of images at the output extent, one read and one written each frame.
+class TemporalUpsampler
+{
+public:
+	// Constructor.
+	// Params: the renderer to create the history, buffers and pipeline with.
+	TemporalUpsampler(VulkanRenderer* renderer);
+	// Destructor.
+	~TemporalUpsampler();
+
+	// Set the scale of each side of the output extent the scene is drawn at, when dynamic resolution doesn't pick it.
+	// Params: the render scale.
+	void SetRenderScale(float scale) { m_RenderScale = scale; }
+
+	// Work out the extent to draw at from the output extent and the render scale.
+	// Params: the output extent.
+	// Returns: the render extent.
+	VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const;
+
+	// Move on to the next jitter offset and history image, and write the frame's motion buffer.
+	// Params: the camera's view projection without jitter, the extent the scene is drawn at, the frame in flight index.
+	// Returns: the bindless storage buffer index of the frame's motion buffer.
+	uint Update(const glm::mat4& viewProjection, VkExtent2D renderExtent, uint frameIndex);
+
+	// Get the view projection moved by this frame's jitter, for drawing the scene with.
+	// Returns: the jittered view projection.
+	const glm::mat4& GetJitteredViewProjection() const { return m_JitteredViewProjection; }
+
+	// Throw away the history, for when the camera cuts somewhere else.
+	void ResetHistory();
+
+	// Record the upsample into this frame's history. The scene colour, motion, depth and last frame's history have to be
+	// readable by shaders, and this frame's history in the general layout.
+	// Params: the command buffer, views of the scene colour and motion targets.
+	void Record(VkCommandBuffer commandBuffer, VkImageView sceneColour, VkImageView motion);
+
+	// Get the history written this frame.
+	// Returns: the image and its view.
+	VkImage GetHistoryImage() const { return m_VkHistoryImages[m_HistoryIndex]; }
+	VkImageView GetHistoryImageView() const { return m_VkHistoryImageViews[m_HistoryIndex]; }
+
+	// Get the history written last frame.
+	// Returns: the image and its view.
+	VkImage GetPreviousHistoryImage() const { return m_VkHistoryImages[1 - m_HistoryIndex]; }
+	VkImageView GetPreviousHistoryImageView() const { return m_VkHistoryImageViews[1 - m_HistoryIndex]; }
+
+	// Get the numbers from the last update.
+	// Returns: the stats.
+	const TemporalUpsamplerStats& GetStats() const { return m_Stats; }
+
+private:
+	// Create the history images, left in the layout the render graph leaves them in, and the samplers.
+	void CreateImages();
+
+	// Create the set layout and the compute pipeline.
+	void CreatePipeline();
+
+	// Push constants for the upsample shader.
+	struct UpsampleConstants
+	{
+		float m_Jitter[2];
+		int32_t m_RenderSize[2];
+		int32_t m_OutputSize[2];
+		uint m_HistoryValid;
+		uint m_Padding;
+	};
+
+	// The renderer the upsampler was created with.
+	VulkanRenderer* m_Renderer;
+
+	// The logical device.
+	VkDevice m_VkDevice;
+
+	// Size of the history, the swap chain extent.
+	VkExtent2D m_OutputExtent;
+
+	// Scale of each side the scene is drawn at without dynamic resolution.
+	float m_RenderScale = 0.5f;
+
+	// The history images, and which one is written this frame.
+	VkImage m_VkHistoryImages[2];
+	VkDeviceMemory m_VkHistoryMemory[2];
+	VkImageView m_VkHistoryImageViews[2];
+	uint m_HistoryIndex = 0;
+
+	// If the history has anything in it yet.
+	bool m_HistoryValid = false;
+
+	// Nearest sampler for the render targets, linear for the history.
+	VkSampler m_VkPointSampler;
+	VkSampler m_VkLinearSampler;
+
+	// One host visible motion buffer per frame in flight, mapped, and its index in the bindless table.
+	VkBuffer m_VkBuffers[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory m_VkMemory[MAX_FRAMES_IN_FLIGHT];
+	char* m_MappedData[MAX_FRAMES_IN_FLIGHT];
+	uint m_BindlessIndices[MAX_FRAMES_IN_FLIGHT];
+
+	// Last frame's view projection without jitter, and if there was a last frame.
+	glm::mat4 m_PreviousViewProjection;
+	bool m_HasPreviousViewProjection = false;
+
+	// This frame's view projection with jitter.
+	glm::mat4 m_JitteredViewProjection;
+
+	// Position in the jitter sequence.
+	uint m_JitterIndex = 0;
+
+	// What this frame's upsample is recorded with.
+	UpsampleConstants m_Constants;
+
+	// The upsample pipeline.
+	VkDescriptorSetLayout m_VkDescriptorSetLayout;
+	VkPipelineLayout m_VkPipelineLayout;
+	VkPipeline m_VkPipeline;
+
+	// Numbers from the last update.
+	TemporalUpsamplerStats m_Stats;
+};
\ No newline at end of file
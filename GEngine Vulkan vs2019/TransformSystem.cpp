@@ -0,0 +1,350 @@
+#include "TransformSystem.h"
+#include "CpuFeatures.h"
+#include <glm/simd/matrix.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <stdexcept>
+
+//-------------------------------------------------------------------------------
+// Compose kernels.
+//-------------------------------------------------------------------------------
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+static inline void LoadMatrix(const glm::mat4& matrix, glm_vec4 out[4])
+{
+	out[0] = _mm_loadu_ps(&matrix[0][0]);
+	out[1] = _mm_loadu_ps(&matrix[1][0]);
+	out[2] = _mm_loadu_ps(&matrix[2][0]);
+	out[3] = _mm_loadu_ps(&matrix[3][0]);
+}
+
+static inline void StoreMatrix(const glm_vec4 in[4], glm::mat4& matrix)
+{
+	_mm_storeu_ps(&matrix[0][0], in[0]);
+	_mm_storeu_ps(&matrix[1][0], in[1]);
+	_mm_storeu_ps(&matrix[2][0], in[2]);
+	_mm_storeu_ps(&matrix[3][0], in[3]);
+}
+
+// glm's SSE multiply, four matrices at a time so the loads of one can overlap the math of another.
+static void ComposeSSE(const uint* slots, size_t count, const uint* parentSlots, const glm::mat4* localMatrices, glm::mat4* worldMatrices)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		glm_vec4 parent[4][4];
+		glm_vec4 local[4][4];
+		glm_vec4 world[4][4];
+
+		for (int b = 0; b < 4; ++b)
+		{
+			uint slot = slots[i + b];
+			LoadMatrix(worldMatrices[parentSlots[slot]], parent[b]);
+			LoadMatrix(localMatrices[slot], local[b]);
+		}
+
+		for (int b = 0; b < 4; ++b)
+			glm_mat4_mul(parent[b], local[b], world[b]);
+
+		for (int b = 0; b < 4; ++b)
+			StoreMatrix(world[b], worldMatrices[slots[i + b]]);
+	}
+
+	for (; i < count; ++i)
+	{
+		uint slot = slots[i];
+		glm_vec4 parent[4];
+		glm_vec4 local[4];
+		glm_vec4 world[4];
+		LoadMatrix(worldMatrices[parentSlots[slot]], parent);
+		LoadMatrix(localMatrices[slot], local);
+		glm_mat4_mul(parent, local, world);
+		StoreMatrix(world, worldMatrices[slot]);
+	}
+}
+#else
+// Plain glm multiply, used when glm wasn't built with SSE2.
+static void ComposeScalar(const uint* slots, size_t count, const uint* parentSlots, const glm::mat4* localMatrices, glm::mat4* worldMatrices)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint slot = slots[i];
+		worldMatrices[slot] = worldMatrices[parentSlots[slot]] * localMatrices[slot];
+	}
+}
+#endif
+
+// Same maths as glm_mat4_mul, but computes two output columns per instruction.
+// The parent columns are duplicated into both halves of a ymm register,
+// and each half of the local matrix register broadcasts its own column's elements.
+GENGINE_TARGET_AVX2 static inline void MultiplyMatrixAVX2(const float* parent, const float* local, float* world)
+{
+	__m256 p0 = _mm256_broadcast_ps((const __m128*)(parent + 0));
+	__m256 p1 = _mm256_broadcast_ps((const __m128*)(parent + 4));
+	__m256 p2 = _mm256_broadcast_ps((const __m128*)(parent + 8));
+	__m256 p3 = _mm256_broadcast_ps((const __m128*)(parent + 12));
+
+	for (int half = 0; half < 2; ++half)
+	{
+		__m256 l = _mm256_loadu_ps(local + half * 8);
+		__m256 result = _mm256_mul_ps(p0, _mm256_permute_ps(l, 0x00));
+		result = _mm256_fmadd_ps(p1, _mm256_permute_ps(l, 0x55), result);
+		result = _mm256_fmadd_ps(p2, _mm256_permute_ps(l, 0xAA), result);
+		result = _mm256_fmadd_ps(p3, _mm256_permute_ps(l, 0xFF), result);
+		_mm256_storeu_ps(world + half * 8, result);
+	}
+}
+
+GENGINE_TARGET_AVX2 static void ComposeAVX2(const uint* slots, size_t count, const uint* parentSlots, const glm::mat4* localMatrices, glm::mat4* worldMatrices)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint slot = slots[i];
+		MultiplyMatrixAVX2(&worldMatrices[parentSlots[slot]][0][0], &localMatrices[slot][0][0], &worldMatrices[slot][0][0]);
+	}
+}
+
+//-------------------------------------------------------------------------------
+// TransformSystem.
+//-------------------------------------------------------------------------------
+// Flags in m_Dirty.
+static const uint8_t DIRTY_WORLD = 1;
+static const uint8_t DIRTY_NEW = 2;
+
+TransformSystem::TransformSystem()
+{
+	m_NeedsRebuild = false;
+	m_AnyDirty = false;
+	m_LastUpdateCount = 0;
+	m_LevelOffsets = { 0 };
+
+	const CpuFeatures& cpu = CpuFeatures::Get();
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	m_Compose = ComposeSSE;
+#else
+	m_Compose = ComposeScalar;
+#endif
+	if (cpu.m_AVX2 && cpu.m_FMA)
+		m_Compose = ComposeAVX2;
+}
+
+TransformSystem::~TransformSystem()
+{
+
+}
+
+uint TransformSystem::CreateTransform(uint parent)
+{
+	uint transform;
+	if (!m_FreeTransforms.empty())
+	{
+		transform = m_FreeTransforms.back();
+		m_FreeTransforms.pop_back();
+	}
+	else
+	{
+		transform = (uint)m_TransformToSlot.size();
+		m_TransformToSlot.push_back(INVALID_TRANSFORM);
+		m_TransformParents.push_back(INVALID_TRANSFORM);
+		m_PendingDestroy.push_back(0);
+	}
+
+	// Appending keeps parents before children, the depth levels get fixed up on the next rebuild.
+	uint slot = (uint)m_SlotToTransform.size();
+	m_TransformToSlot[transform] = slot;
+	m_TransformParents[transform] = parent;
+	m_PendingDestroy[transform] = 0;
+
+	m_LocalMatrices.push_back(glm::mat4(1.0f));
+	m_WorldMatrices.push_back(glm::mat4(1.0f));
+	m_PreviousWorldMatrices.push_back(glm::mat4(1.0f));
+	m_ParentSlots.push_back(parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_TransformToSlot[parent]);
+	m_SlotToTransform.push_back(transform);
+	m_Dirty.push_back(DIRTY_WORLD | DIRTY_NEW);
+
+	m_NeedsRebuild = true;
+	m_AnyDirty = true;
+
+	return transform;
+}
+
+void TransformSystem::DestroyTransform(uint transform)
+{
+	m_PendingDestroy[transform] = 1;
+	m_NeedsRebuild = true;
+}
+
+void TransformSystem::SetParent(uint transform, uint parent)
+{
+	for (uint ancestor = parent; ancestor != INVALID_TRANSFORM; ancestor = m_TransformParents[ancestor])
+	{
+		if (ancestor == transform)
+			throw std::runtime_error("Transform can't be parented to itself or its children!");
+	}
+
+	m_TransformParents[transform] = parent;
+	m_Dirty[m_TransformToSlot[transform]] |= DIRTY_WORLD;
+	m_NeedsRebuild = true;
+	m_AnyDirty = true;
+}
+
+void TransformSystem::SetLocalMatrix(uint transform, const glm::mat4& localMatrix)
+{
+	uint slot = m_TransformToSlot[transform];
+	m_LocalMatrices[slot] = localMatrix;
+	m_Dirty[slot] |= DIRTY_WORLD;
+	m_AnyDirty = true;
+}
+
+void TransformSystem::Update()
+{
+	// What moved last Update is a frame old now. Done before a rebuild moves the slots around.
+	for (uint slot : m_MovedSlots)
+		m_PreviousWorldMatrices[slot] = m_WorldMatrices[slot];
+	m_MovedSlots.clear();
+
+	if (m_NeedsRebuild)
+		Rebuild();
+
+	m_LastUpdateCount = 0;
+
+	if (!m_AnyDirty)
+		return;
+
+	size_t levelCount = m_LevelOffsets.size() - 1;
+	for (size_t level = 0; level < levelCount; ++level)
+	{
+		// Parents were finished on the previous level, so dirtiness can be pushed down as we go.
+		m_DirtyBatch.clear();
+		for (uint slot = m_LevelOffsets[level]; slot < m_LevelOffsets[level + 1]; ++slot)
+		{
+			uint parentSlot = m_ParentSlots[slot];
+			if (parentSlot != INVALID_TRANSFORM && m_Dirty[parentSlot])
+				m_Dirty[slot] |= DIRTY_WORLD;
+
+			if (m_Dirty[slot])
+				m_DirtyBatch.push_back(slot);
+		}
+
+		if (level == 0)
+		{
+			for (uint slot : m_DirtyBatch)
+				m_WorldMatrices[slot] = m_LocalMatrices[slot];
+		}
+		else
+		{
+			m_Compose(m_DirtyBatch.data(), m_DirtyBatch.size(), m_ParentSlots.data(), m_LocalMatrices.data(), m_WorldMatrices.data());
+		}
+
+		// New transforms didn't move, they start where they were put.
+		for (uint slot : m_DirtyBatch)
+		{
+			if (m_Dirty[slot] & DIRTY_NEW)
+				m_PreviousWorldMatrices[slot] = m_WorldMatrices[slot];
+			else
+				m_MovedSlots.push_back(slot);
+		}
+
+		m_LastUpdateCount += m_DirtyBatch.size();
+	}
+
+	std::fill(m_Dirty.begin(), m_Dirty.end(), 0);
+	m_AnyDirty = false;
+}
+
+void TransformSystem::Rebuild()
+{
+	size_t transformCount = m_TransformToSlot.size();
+	size_t oldSlotCount = m_SlotToTransform.size();
+
+	// Work out the depth of every transform, and whether it's being destroyed along with an ancestor.
+	// Walks up the parent chain until it hits a transform that's already been resolved.
+	std::vector<int> depths(transformCount, -1);
+	std::vector<uint8_t> destroyed(transformCount, 0);
+	std::vector<uint> chain;
+	int maxDepth = -1;
+
+	for (uint transform : m_SlotToTransform)
+	{
+		chain.clear();
+		uint current = transform;
+		while (current != INVALID_TRANSFORM && depths[current] < 0)
+		{
+			chain.push_back(current);
+			current = m_TransformParents[current];
+		}
+
+		for (size_t i = chain.size(); i-- > 0;)
+		{
+			uint resolving = chain[i];
+			uint parent = m_TransformParents[resolving];
+			depths[resolving] = parent == INVALID_TRANSFORM ? 0 : depths[parent] + 1;
+			destroyed[resolving] = m_PendingDestroy[resolving] || (parent != INVALID_TRANSFORM && destroyed[parent]);
+		}
+
+		if (!destroyed[transform])
+			maxDepth = std::max(maxDepth, depths[transform]);
+	}
+
+	// Counting sort by depth, visiting the old slots in order so siblings keep their relative order.
+	std::vector<uint> levelOffsets(maxDepth + 2, 0);
+	for (uint transform : m_SlotToTransform)
+	{
+		if (!destroyed[transform])
+			++levelOffsets[depths[transform] + 1];
+	}
+
+	size_t largestLevel = 0;
+	for (size_t level = 1; level < levelOffsets.size(); ++level)
+	{
+		largestLevel = std::max(largestLevel, (size_t)levelOffsets[level]);
+		levelOffsets[level] += levelOffsets[level - 1];
+	}
+
+	size_t newSlotCount = levelOffsets.back();
+	std::vector<uint> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+
+	std::vector<glm::mat4> localMatrices(newSlotCount);
+	std::vector<glm::mat4> worldMatrices(newSlotCount);
+	std::vector<glm::mat4> previousWorldMatrices(newSlotCount);
+	std::vector<uint> slotToTransform(newSlotCount);
+	std::vector<uint8_t> dirty(newSlotCount);
+
+	for (size_t oldSlot = 0; oldSlot < oldSlotCount; ++oldSlot)
+	{
+		uint transform = m_SlotToTransform[oldSlot];
+		if (destroyed[transform])
+		{
+			m_TransformToSlot[transform] = INVALID_TRANSFORM;
+			m_PendingDestroy[transform] = 0;
+			m_FreeTransforms.push_back(transform);
+			continue;
+		}
+
+		uint newSlot = cursor[depths[transform]]++;
+		localMatrices[newSlot] = m_LocalMatrices[oldSlot];
+		worldMatrices[newSlot] = m_WorldMatrices[oldSlot];
+		previousWorldMatrices[newSlot] = m_PreviousWorldMatrices[oldSlot];
+		slotToTransform[newSlot] = transform;
+		dirty[newSlot] = m_Dirty[oldSlot];
+		m_TransformToSlot[transform] = newSlot;
+	}
+
+	std::vector<uint> parentSlots(newSlotCount);
+	for (size_t slot = 0; slot < newSlotCount; ++slot)
+	{
+		uint parent = m_TransformParents[slotToTransform[slot]];
+		parentSlots[slot] = parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_TransformToSlot[parent];
+	}
+
+	m_LocalMatrices.swap(localMatrices);
+	m_WorldMatrices.swap(worldMatrices);
+	m_PreviousWorldMatrices.swap(previousWorldMatrices);
+	m_SlotToTransform.swap(slotToTransform);
+	m_Dirty.swap(dirty);
+	m_ParentSlots.swap(parentSlots);
+	m_LevelOffsets.swap(levelOffsets);
+
+	m_DirtyBatch.reserve(largestLevel);
+	m_MovedSlots.reserve(newSlotCount);
+	m_NeedsRebuild = false;
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include "QueueFamilyIndices.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Handle used for a transform with no parent.
+#define INVALID_TRANSFORM UINT32_MAX
+
+// Stores local and world matrices for a transform hierarchy in flat arrays sorted by depth,
+// so every parent comes before its children and each depth level is contiguous.
+// Changing a local matrix marks it dirty, and Update only recomputes the dirty subtrees.
+// The world matrices from before the last Update are kept too, for motion vectors, and only the ones that moved are copied each Update.
+class TransformSystem
+{
+public:
+	// Constructor.
+	TransformSystem();
+	// Destructor.
+	~TransformSystem();
+
+	// Create a new transform.
+	// Params: the parent transform, or INVALID_TRANSFORM for a root.
+	// Returns: handle to the new transform.
+	uint CreateTransform(uint parent = INVALID_TRANSFORM);
+
+	// Destroy a transform and all of its children.
+	// Params: the transform to destroy.
+	void DestroyTransform(uint transform);
+
+	// Move a transform to a new parent.
+	// Params: the transform to move, the new parent or INVALID_TRANSFORM to make it a root.
+	void SetParent(uint transform, uint parent);
+
+	// Set the local matrix of a transform and mark it dirty.
+	// Params: the transform, the matrix relative to its parent.
+	void SetLocalMatrix(uint transform, const glm::mat4& localMatrix);
+
+	// Get the local matrix of a transform.
+	// Params: the transform.
+	// Returns: the matrix relative to its parent.
+	const glm::mat4& GetLocalMatrix(uint transform) const { return m_LocalMatrices[m_TransformToSlot[transform]]; }
+
+	// Get the world matrix of a transform, as of the last Update.
+	// Params: the transform.
+	// Returns: the matrix relative to the world.
+	const glm::mat4& GetWorldMatrix(uint transform) const { return m_WorldMatrices[m_TransformToSlot[transform]]; }
+
+	// Get the world matrix of a transform from before the last Update. New transforms start where they were first put.
+	// Params: the transform.
+	// Returns: the previous matrix relative to the world.
+	const glm::mat4& GetPreviousWorldMatrix(uint transform) const { return m_PreviousWorldMatrices[m_TransformToSlot[transform]]; }
+
+	// Recompute the world matrices of all dirty transforms and their children.
+	void Update();
+
+	// Get the amount of live transforms.
+	// Returns: the transform count.
+	size_t GetTransformCount() const { return m_SlotToTransform.size(); }
+
+	// Get the amount of world matrices recomputed by the last Update.
+	// Returns: the recomputed count.
+	size_t GetLastUpdateCount() const { return m_LastUpdateCount; }
+
+	// Multiplies parent world matrices by local matrices for a batch of slots.
+	// Params: the slots to compute, how many slots, parent slot per slot, local matrices, world matrices.
+	typedef void (*ComposeFunction)(const uint* slots, size_t count, const uint* parentSlots, const glm::mat4* localMatrices, glm::mat4* worldMatrices);
+
+private:
+	// Re-sort the arrays by depth after transforms were added, moved or destroyed.
+	void Rebuild();
+
+	//-------------------------------------------------------------------------------
+	// Per transform, indexed by handle.
+	//-------------------------------------------------------------------------------
+	// Where the transform lives in the sorted arrays.
+	std::vector<uint> m_TransformToSlot;
+
+	// Parent handle of the transform.
+	std::vector<uint> m_TransformParents;
+
+	// If the transform is waiting to be destroyed on the next rebuild.
+	std::vector<uint8_t> m_PendingDestroy;
+
+	// Handles that can be reused.
+	std::vector<uint> m_FreeTransforms;
+
+	//-------------------------------------------------------------------------------
+	// Per slot, sorted by depth.
+	//-------------------------------------------------------------------------------
+	// Matrices relative to the parent.
+	std::vector<glm::mat4> m_LocalMatrices;
+
+	// Matrices relative to the world.
+	std::vector<glm::mat4> m_WorldMatrices;
+
+	// Matrices relative to the world before the last Update.
+	std::vector<glm::mat4> m_PreviousWorldMatrices;
+
+	// Slot of the parent, or INVALID_TRANSFORM for roots.
+	std::vector<uint> m_ParentSlots;
+
+	// Handle of the transform in each slot.
+	std::vector<uint> m_SlotToTransform;
+
+	// DIRTY_* flags: if the world matrix needs recomputing, and if it's never been worked out.
+	std::vector<uint8_t> m_Dirty;
+
+	// First slot of each depth level, with one extra entry for the end.
+	std::vector<uint> m_LevelOffsets;
+
+	//-------------------------------------------------------------------------------
+	// Update state.
+	//-------------------------------------------------------------------------------
+	// Dirty slots of the level being computed, kept around so Update doesn't allocate.
+	std::vector<uint> m_DirtyBatch;
+
+	// Slots whose world matrix changed in the last Update, so their previous matrix is out of date by the next.
+	std::vector<uint> m_MovedSlots;
+
+	// The SSE or AVX compose kernel chosen for this cpu.
+	ComposeFunction m_Compose;
+
+	// If the sorted arrays need rebuilding.
+	bool m_NeedsRebuild;
+
+	// If anything has been marked dirty since the last Update.
+	bool m_AnyDirty;
+
+	// Amount of world matrices recomputed by the last Update.
+	size_t m_LastUpdateCount;
+};
\ No newline at end of file
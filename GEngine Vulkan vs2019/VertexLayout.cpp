@@ -0,0 +1,212 @@
+#include "VertexLayout.h"
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+// A vertex in VERTEX_FORMAT_OCTAHEDRAL_16.
+struct OctahedralVertex16
+{
+	uint16_t m_Position[4];
+	uint m_Normal;
+	uint m_Tangent;
+	uint m_UV;
+};
+
+// A vertex in VERTEX_FORMAT_OCTAHEDRAL_8.
+struct OctahedralVertex8
+{
+	uint16_t m_Position[4];
+	uint16_t m_Normal;
+	uint16_t m_Tangent;
+	uint m_UV;
+};
+
+static_assert(sizeof(MeshVertex) == 48, "The float vertex format is MeshVertex as it is.");
+static_assert(sizeof(OctahedralVertex16) == 20, "Octahedral 16 vertices should be packed tightly.");
+static_assert(sizeof(OctahedralVertex8) == 16, "Octahedral 8 vertices should be packed tightly.");
+
+// Map a unit vector onto the octahedron, with the lower half folded out over the corners of the square.
+static glm::vec2 EncodeOctahedral(const glm::vec3& vector)
+{
+	float length = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+	if (length == 0.0f)
+		return glm::vec2(0.0f);
+
+	glm::vec3 octahedral = vector / length;
+	if (octahedral.z >= 0.0f)
+		return glm::vec2(octahedral.x, octahedral.y);
+
+	return glm::vec2((1.0f - fabsf(octahedral.y)) * (octahedral.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - fabsf(octahedral.x)) * (octahedral.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+// Unfold a point on the square back into a unit vector, the same way the vertex shaders do.
+static glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+{
+	glm::vec3 vector(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+	float fold = std::max(-vector.z, 0.0f);
+	vector.x += vector.x >= 0.0f ? -fold : fold;
+	vector.y += vector.y >= 0.0f ? -fold : fold;
+	return glm::normalize(vector);
+}
+
+static VertexLayout MakeLayout(VertexFormat format, VkBool32 octahedral, uint stride, const VkFormat attributeFormats[VERTEX_ATTRIBUTE_COUNT],
+	const uint attributeOffsets[VERTEX_ATTRIBUTE_COUNT])
+{
+	VertexLayout layout;
+	layout.m_Format = format;
+	layout.m_Octahedral = octahedral;
+	layout.m_Stride = stride;
+
+	layout.m_Binding.binding = 0;
+	layout.m_Binding.stride = stride;
+	layout.m_Binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	for (uint i = 0; i < VERTEX_ATTRIBUTE_COUNT; ++i)
+	{
+		layout.m_Attributes[i].location = i;
+		layout.m_Attributes[i].binding = 0;
+		layout.m_Attributes[i].format = attributeFormats[i];
+		layout.m_Attributes[i].offset = attributeOffsets[i];
+	}
+
+	return layout;
+}
+
+const VertexLayout& VertexLayout::Get(VertexFormat format)
+{
+	static const VkFormat floatFormats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32_SFLOAT };
+	static const uint floatOffsets[] = { offsetof(MeshVertex, m_Position), offsetof(MeshVertex, m_Normal), offsetof(MeshVertex, m_Tangent), offsetof(MeshVertex, m_UV) };
+
+	static const VkFormat octahedral16Formats[] = { VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SFLOAT };
+	static const uint octahedral16Offsets[] = { offsetof(OctahedralVertex16, m_Position), offsetof(OctahedralVertex16, m_Normal),
+		offsetof(OctahedralVertex16, m_Tangent), offsetof(OctahedralVertex16, m_UV) };
+
+	static const VkFormat octahedral8Formats[] = { VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R16G16_SFLOAT };
+	static const uint octahedral8Offsets[] = { offsetof(OctahedralVertex8, m_Position), offsetof(OctahedralVertex8, m_Normal),
+		offsetof(OctahedralVertex8, m_Tangent), offsetof(OctahedralVertex8, m_UV) };
+
+	static const VertexLayout layouts[VERTEX_FORMAT_COUNT] =
+	{
+		MakeLayout(VERTEX_FORMAT_FLOAT, VK_FALSE, sizeof(MeshVertex), floatFormats, floatOffsets),
+		MakeLayout(VERTEX_FORMAT_OCTAHEDRAL_16, VK_TRUE, sizeof(OctahedralVertex16), octahedral16Formats, octahedral16Offsets),
+		MakeLayout(VERTEX_FORMAT_OCTAHEDRAL_8, VK_TRUE, sizeof(OctahedralVertex8), octahedral8Formats, octahedral8Offsets),
+	};
+
+	return layouts[format];
+}
+
+VkPipelineVertexInputStateCreateInfo VertexLayout::GetInputState() const
+{
+	VkPipelineVertexInputStateCreateInfo inputState{};
+	inputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	inputState.vertexBindingDescriptionCount = 1;
+	inputState.pVertexBindingDescriptions = &m_Binding;
+	inputState.vertexAttributeDescriptionCount = VERTEX_ATTRIBUTE_COUNT;
+	inputState.pVertexAttributeDescriptions = m_Attributes;
+	return inputState;
+}
+
+void VertexLayout::Pack(const MeshVertex* vertices, size_t count, const AABB& bounds, void* destination) const
+{
+	if (m_Format == VERTEX_FORMAT_FLOAT)
+	{
+		memcpy(destination, vertices, count * sizeof(MeshVertex));
+		return;
+	}
+
+	// Flat meshes have no size on an axis, everything on it quantises to 0 and is scaled back by 0.
+	glm::vec3 size = bounds.m_Max - bounds.m_Min;
+	glm::vec3 inverseSize(size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f);
+
+	uint8_t* output = (uint8_t*)destination;
+	for (size_t i = 0; i < count; ++i, output += m_Stride)
+	{
+		const MeshVertex& vertex = vertices[i];
+		glm::vec3 position = (vertex.m_Position - bounds.m_Min) * inverseSize;
+		glm::uint64 packedPosition = glm::packUnorm4x16(glm::vec4(position, vertex.m_Tangent.w < 0.0f ? 0.0f : 1.0f));
+		glm::vec2 normal = EncodeOctahedral(vertex.m_Normal);
+		glm::vec2 tangent = EncodeOctahedral(glm::vec3(vertex.m_Tangent));
+		uint uv = glm::packHalf2x16(vertex.m_UV);
+
+		if (m_Format == VERTEX_FORMAT_OCTAHEDRAL_16)
+		{
+			OctahedralVertex16 packed;
+			memcpy(packed.m_Position, &packedPosition, sizeof(packed.m_Position));
+			packed.m_Normal = glm::packSnorm2x16(normal);
+			packed.m_Tangent = glm::packSnorm2x16(tangent);
+			packed.m_UV = uv;
+			memcpy(output, &packed, sizeof(packed));
+		}
+		else
+		{
+			OctahedralVertex8 packed;
+			memcpy(packed.m_Position, &packedPosition, sizeof(packed.m_Position));
+			packed.m_Normal = glm::packSnorm2x8(normal);
+			packed.m_Tangent = glm::packSnorm2x8(tangent);
+			packed.m_UV = uv;
+			memcpy(output, &packed, sizeof(packed));
+		}
+	}
+}
+
+MeshVertex VertexLayout::Unpack(const void* source, const AABB& bounds) const
+{
+	MeshVertex vertex;
+	if (m_Format == VERTEX_FORMAT_FLOAT)
+	{
+		memcpy(&vertex, source, sizeof(vertex));
+		return vertex;
+	}
+
+	glm::uint64 packedPosition;
+	glm::vec2 normal;
+	glm::vec2 tangent;
+	uint uv;
+
+	if (m_Format == VERTEX_FORMAT_OCTAHEDRAL_16)
+	{
+		OctahedralVertex16 packed;
+		memcpy(&packed, source, sizeof(packed));
+		memcpy(&packedPosition, packed.m_Position, sizeof(packedPosition));
+		normal = glm::unpackSnorm2x16(packed.m_Normal);
+		tangent = glm::unpackSnorm2x16(packed.m_Tangent);
+		uv = packed.m_UV;
+	}
+	else
+	{
+		OctahedralVertex8 packed;
+		memcpy(&packed, source, sizeof(packed));
+		memcpy(&packedPosition, packed.m_Position, sizeof(packedPosition));
+		normal = glm::unpackSnorm2x8(packed.m_Normal);
+		tangent = glm::unpackSnorm2x8(packed.m_Tangent);
+		uv = packed.m_UV;
+	}
+
+	glm::vec4 offset;
+	glm::vec4 scale;
+	GetPositionTransform(bounds, offset, scale);
+
+	glm::vec4 position = glm::unpackUnorm4x16(packedPosition);
+	vertex.m_Position = glm::vec3(offset) + glm::vec3(position) * glm::vec3(scale);
+	vertex.m_Normal = DecodeOctahedral(normal);
+	vertex.m_Tangent = glm::vec4(DecodeOctahedral(tangent), position.w * 2.0f - 1.0f);
+	vertex.m_UV = glm::unpackHalf2x16(uv);
+	return vertex;
+}
+
+void VertexLayout::GetPositionTransform(const AABB& bounds, glm::vec4& offset, glm::vec4& scale) const
+{
+	if (m_Format == VERTEX_FORMAT_FLOAT)
+	{
+		offset = glm::vec4(0.0f);
+		scale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+		return;
+	}
+
+	offset = glm::vec4(bounds.m_Min, 0.0f);
+	scale = glm::vec4(bounds.m_Max - bounds.m_Min, 0.0f);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "Mesh.h"
+
+// How mesh vertices are stored in vertex buffers.
+enum VertexFormat
+{
+	// Everything as floats, 48 bytes a vertex. Only there to compare the others against.
+	VERTEX_FORMAT_FLOAT,
+	// Positions as 16 bit fractions of the mesh's bounds, normals and tangents octahedral in 2x16 bits, UVs as half floats.
+	// 20 bytes a vertex.
+	VERTEX_FORMAT_OCTAHEDRAL_16,
+	// The same with normals and tangents in 2x8 bits, about a degree off at worst. 16 bytes a vertex.
+	VERTEX_FORMAT_OCTAHEDRAL_8,
+
+	VERTEX_FORMAT_COUNT
+};
+
+// Vertex attributes, numbered by the locations the vertex shaders read them from.
+enum VertexAttribute
+{
+	VERTEX_ATTRIBUTE_POSITION,
+	VERTEX_ATTRIBUTE_NORMAL,
+	VERTEX_ATTRIBUTE_TANGENT,
+	VERTEX_ATTRIBUTE_UV,
+
+	VERTEX_ATTRIBUTE_COUNT
+};
+
+// How a vertex format is laid out in a vertex buffer, with the vertex input state for pipelines that draw it, and the
+// packing to get mesh vertices into it. Quantised positions are fractions of the mesh's bounds, which the vertex
+// shader scales back with the MeshConstants. The bitangent sign goes in the position's spare 16 bits. Normals and
+// tangents are mapped onto an octahedron and unfolded into a square, which spreads the precision evenly over the
+// sphere, so 2 components do better than 3 would with the same bits. The vertex shaders unfold them again when
+// the OCTAHEDRAL_VERTICES specialisation constant is set.
+struct VertexLayout
+{
+	// Get the layout of a format.
+	// Params: the format.
+	// Returns: the layout, which lives for the whole program.
+	static const VertexLayout& Get(VertexFormat format);
+
+	// Get the vertex input state for a pipeline drawing this format.
+	// Returns: the state, pointing into the layout.
+	VkPipelineVertexInputStateCreateInfo GetInputState() const;
+
+	// Pack vertices into this format.
+	// Params: the vertices, amount of vertices, the bounds positions are quantised to, where to write count * m_Stride bytes.
+	void Pack(const MeshVertex* vertices, size_t count, const AABB& bounds, void* destination) const;
+
+	// Unpack a vertex the way the vertex shader does, for checking what packing loses.
+	// Params: the packed vertex, the bounds positions were quantised to.
+	// Returns: the vertex.
+	MeshVertex Unpack(const void* source, const AABB& bounds) const;
+
+	// Get what the vertex shader scales and offsets positions by to undo the quantisation.
+	// Params: the bounds positions were quantised to, the offset and scale, with 0 in w.
+	void GetPositionTransform(const AABB& bounds, glm::vec4& offset, glm::vec4& scale) const;
+
+	VertexFormat m_Format;
+	// If normals and tangents are octahedral and positions quantised, the OCTAHEDRAL_VERTICES specialisation constant.
+	VkBool32 m_Octahedral;
+	uint m_Stride;
+	VkVertexInputBindingDescription m_Binding;
+	VkVertexInputAttributeDescription m_Attributes[VERTEX_ATTRIBUTE_COUNT];
+};
\ No newline at end of file
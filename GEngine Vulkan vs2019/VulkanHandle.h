@@ -0,0 +1,93 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// Owns a Vulkan object made from a device, and destroys it when it goes out of scope or is given another one.
+// It can only be moved, so there's only ever one owner. The destroy function is part of the type, so on 32-bit
+// builds, where every non-dispatchable handle is the same integer type, a buffer still can't be put in an image's.
+// Anything the GPU might still be using should be given to the renderer's DeletionQueue instead of destroyed here.
+template<typename T, void (VKAPI_PTR* Destroy)(VkDevice, T, const VkAllocationCallbacks*)>
+class VulkanHandle
+{
+public:
+	// Constructor, for an empty handle.
+	VulkanHandle() {}
+
+	// Constructor, taking ownership of an object.
+	// Params: the device it was made with, the object.
+	VulkanHandle(VkDevice device, T handle) : m_VkDevice(device), m_Handle(handle) {}
+
+	// Destructor.
+	~VulkanHandle() { Reset(); }
+
+	VulkanHandle(const VulkanHandle&) = delete;
+	VulkanHandle& operator=(const VulkanHandle&) = delete;
+
+	// Move constructor, leaving the other handle empty.
+	VulkanHandle(VulkanHandle&& other) noexcept : m_VkDevice(other.m_VkDevice), m_Handle(other.Release()) {}
+
+	// Move assignment, destroying this handle's object first.
+	VulkanHandle& operator=(VulkanHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_VkDevice = other.m_VkDevice;
+			m_Handle = other.Release();
+		}
+
+		return *this;
+	}
+
+	// Get the object, still owned by the handle.
+	// Returns: the object, or VK_NULL_HANDLE if empty.
+	T Get() const { return m_Handle; }
+
+	// Get the device the object was made with.
+	// Returns: the device.
+	VkDevice GetDevice() const { return m_VkDevice; }
+
+	// Check if the handle owns an object.
+	// Returns: if it isn't empty.
+	explicit operator bool() const { return m_Handle != VK_NULL_HANDLE; }
+
+	// Give up ownership of the object without destroying it.
+	// Returns: the object, or VK_NULL_HANDLE if empty.
+	T Release()
+	{
+		T handle = m_Handle;
+		m_Handle = VK_NULL_HANDLE;
+		return handle;
+	}
+
+	// Destroy the object now, if there is one.
+	void Reset()
+	{
+		if (m_Handle != VK_NULL_HANDLE)
+			Destroy(m_VkDevice, m_Handle, nullptr);
+		m_Handle = VK_NULL_HANDLE;
+	}
+
+private:
+	// The device the object was made with.
+	VkDevice m_VkDevice = VK_NULL_HANDLE;
+
+	// The object.
+	T m_Handle = VK_NULL_HANDLE;
+};
+
+using UniqueBuffer = VulkanHandle<VkBuffer, vkDestroyBuffer>;
+using UniqueDeviceMemory = VulkanHandle<VkDeviceMemory, vkFreeMemory>;
+using UniqueImage = VulkanHandle<VkImage, vkDestroyImage>;
+using UniqueImageView = VulkanHandle<VkImageView, vkDestroyImageView>;
+using UniqueSampler = VulkanHandle<VkSampler, vkDestroySampler>;
+using UniqueFramebuffer = VulkanHandle<VkFramebuffer, vkDestroyFramebuffer>;
+using UniqueRenderPass = VulkanHandle<VkRenderPass, vkDestroyRenderPass>;
+using UniquePipeline = VulkanHandle<VkPipeline, vkDestroyPipeline>;
+using UniquePipelineLayout = VulkanHandle<VkPipelineLayout, vkDestroyPipelineLayout>;
+using UniqueShaderModule = VulkanHandle<VkShaderModule, vkDestroyShaderModule>;
+using UniqueDescriptorSetLayout = VulkanHandle<VkDescriptorSetLayout, vkDestroyDescriptorSetLayout>;
+using UniqueDescriptorPool = VulkanHandle<VkDescriptorPool, vkDestroyDescriptorPool>;
+using UniqueSemaphore = VulkanHandle<VkSemaphore, vkDestroySemaphore>;
+using UniqueCommandPool = VulkanHandle<VkCommandPool, vkDestroyCommandPool>;
+using UniqueQueryPool = VulkanHandle<VkQueryPool, vkDestroyQueryPool>;
\ No newline at end of file
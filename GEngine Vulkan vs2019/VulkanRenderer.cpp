@@ -1,10 +1,49 @@
 #include "VulkanRenderer.h"
+#include "GpuCuller.h"
+#include "DepthPyramid.h"
+#include "RenderQueue.h"
+#include "FrameRingBuffer.h"
+#include "BindlessTable.h"
+#include "DescriptorAllocator.h"
+#include "RenderGraph.h"
+#include "ShadowAtlas.h"
+#include "DynamicResolution.h"
+#include "TemporalUpsampler.h"
+#include "FrameTimeline.h"
+#include "DeletionQueue.h"
+#include "GpuMesh.h"
 #include <iostream>
 #include <cstring>
 #include <set>
 #include <algorithm>
 #include <fstream>
 
+// Size of each frame's part of the object ring buffer before it first grows.
+static const VkDeviceSize INITIAL_OBJECT_RING_SIZE = 64 * 1024;
+
+// Format of the motion target: the motion vector, then the material's reactive value.
+static const VkFormat MOTION_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+// Most render graph segments a queue can have each frame, which command buffers are made for.
+static const uint MAX_QUEUE_SEGMENTS = 8;
+
+// What each AttachmentSetup does with the attachments. Depth only setups have no colour attachment.
+struct AttachmentLoadOps
+{
+	bool m_Colour;
+	VkAttachmentLoadOp m_ColourLoadOp;
+	VkAttachmentLoadOp m_DepthLoadOp;
+};
+
+static const AttachmentLoadOps ATTACHMENT_LOAD_OPS[] =
+{
+	{ true, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_LOAD_OP_CLEAR },
+	{ true, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_LOAD_OP_LOAD },
+	{ true, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_LOAD_OP_LOAD },
+	{ false, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_LOAD_OP_CLEAR },
+	{ false, VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_LOAD_OP_LOAD },
+};
+
 #ifdef NDBUG
 const bool enableValidationLayers = false;
 #else
@@ -27,36 +66,112 @@ VulkanRenderer::VulkanRenderer(float width, float height)
 	CreateLogicalDevice();
 	CreateSwapChain();
 	CreateImageViews();
-	CreateRenderPass();
+	CreateDepthResources();
+
+	// Dynamic rendering begins straight on image views, so render passes and framebuffers are only made without it.
+	if (!IsDynamicRenderingEnabled())
+		CreateRenderPasses();
+
+	m_DescriptorAllocator = new DescriptorAllocator(this);
+	m_ObjectRingBuffer = new FrameRingBuffer(this, INITIAL_OBJECT_RING_SIZE);
+	m_BindlessTable = new BindlessTable(this);
+	CreatePipelineLayout();
 	CreateGraphicsPipeline();
-	CreateFramebuffers();
+	if (!IsDynamicRenderingEnabled())
+		CreateFramebuffers();
 	CreateCommandPool();
 	CreateCommandBuffers();
+	CreateSyncObjects();
+	CreateDemoMesh();
+
+	m_RenderGraph = new RenderGraph(this);
+
+	for (uint i = 0; i < sizeof(m_GraphPassData) / sizeof(m_GraphPassData[0]); ++i)
+	{
+		m_GraphPassData[i].m_Renderer = this;
+		m_GraphPassData[i].m_Phase = i;
+	}
 }
 
 VulkanRenderer::~VulkanRenderer()
 {
-	// Delete all the vulkan stuff.
+	// Nothing can be destroyed while the GPU might still be using it.
+	WaitIdle();
+
+	// Delete all the vulkan stuff. The subsystems give what they own to the deletion queue.
+	delete m_RenderGraph;
+	m_RenderGraph = nullptr;
+
+	delete m_DepthPyramid;
+	m_DepthPyramid = nullptr;
+
+	delete m_ShadowAtlas;
+	m_ShadowAtlas = nullptr;
+
+	delete m_DynamicResolution;
+	m_DynamicResolution = nullptr;
+
+	delete m_TemporalUpsampler;
+	m_TemporalUpsampler = nullptr;
+
+	delete m_ObjectRingBuffer;
+	m_ObjectRingBuffer = nullptr;
+
+	delete m_BindlessTable;
+	m_BindlessTable = nullptr;
+
+	delete m_DemoMesh;
+	m_DemoMesh = nullptr;
+
+	// Freed descriptor sets in the queue need their pools to still be there.
+	delete m_DeletionQueue;
+	m_DeletionQueue = nullptr;
+
+	delete m_DescriptorAllocator;
+	m_DescriptorAllocator = nullptr;
+
 	vkDestroyPipeline(m_VkLogicalDevice, m_VkGraphicsPipeline, nullptr);
+	vkDestroyPipeline(m_VkLogicalDevice, m_VkDepthEqualPipeline, nullptr);
+	vkDestroyPipeline(m_VkLogicalDevice, m_VkMotionPipeline, nullptr);
+	vkDestroyPipeline(m_VkLogicalDevice, m_VkMotionDepthEqualPipeline, nullptr);
+	vkDestroyPipeline(m_VkLogicalDevice, m_VkDepthPrepassPipeline, nullptr);
+	vkDestroyPipeline(m_VkLogicalDevice, m_VkShadowPipeline, nullptr);
 	vkDestroyPipelineLayout(m_VkLogicalDevice, m_VkPipelineLayout, nullptr);
-	vkDestroySurfaceKHR(m_VkInstance, m_VkSurface, nullptr);
-	vkDestroyInstance(m_VkInstance, nullptr);
-	vkDestroySwapchainKHR(m_VkLogicalDevice, m_VkSwapChain, nullptr);
-	vkDestroyPipelineLayout(m_VkLogicalDevice, m_VkPipelineLayout, nullptr);
-	vkDestroyRenderPass(m_VkLogicalDevice, m_VkRenderPass, nullptr);
-	vkDestroyCommandPool(m_VkLogicalDevice, m_VkCommandPool, nullptr);
-
-	for (auto imageView : m_VkSwapChainImageViews)
-	{
-		vkDestroyImageView(m_VkLogicalDevice, imageView, nullptr);
-	}
 
 	for (auto framebuffer : m_VkSwapChainFramebuffers)
 	{
 		vkDestroyFramebuffer(m_VkLogicalDevice, framebuffer, nullptr);
 	}
+	vkDestroyFramebuffer(m_VkLogicalDevice, m_VkDepthFramebuffer, nullptr);
+	vkDestroyFramebuffer(m_VkLogicalDevice, m_VkSceneFramebuffer, nullptr);
+
+	for (VkRenderPass renderPass : m_VkRenderPasses)
+		vkDestroyRenderPass(m_VkLogicalDevice, renderPass, nullptr);
+	for (VkRenderPass renderPass : m_VkMotionRenderPasses)
+		vkDestroyRenderPass(m_VkLogicalDevice, renderPass, nullptr);
+	vkDestroyImageView(m_VkLogicalDevice, m_VkDepthImageView, nullptr);
+	vkDestroyImage(m_VkLogicalDevice, m_VkDepthImage, nullptr);
+	vkFreeMemory(m_VkLogicalDevice, m_VkDepthImageMemory, nullptr);
+	vkDestroyCommandPool(m_VkLogicalDevice, m_VkCommandPool, nullptr);
+	vkDestroyCommandPool(m_VkLogicalDevice, m_VkComputeCommandPool, nullptr);
+	delete m_FrameTimeline;
+	m_FrameTimeline = nullptr;
+	for (VkSemaphore semaphore : m_VkImageAvailableSemaphores)
+		vkDestroySemaphore(m_VkLogicalDevice, semaphore, nullptr);
+	for (VkSemaphore semaphore : m_VkRenderFinishedSemaphores)
+		vkDestroySemaphore(m_VkLogicalDevice, semaphore, nullptr);
+
+	// The swap chain's images go with it, their views have to go first.
+	for (auto imageView : m_VkSwapChainImageViews)
+	{
+		vkDestroyImageView(m_VkLogicalDevice, imageView, nullptr);
+	}
+	vkDestroySwapchainKHR(m_VkLogicalDevice, m_VkSwapChain, nullptr);
 
+	// Everything made from the device has to be gone before it, and the device and surface before the instance.
 	vkDestroyDevice(m_VkLogicalDevice, nullptr);
+	vkDestroySurfaceKHR(m_VkInstance, m_VkSurface, nullptr);
+	vkDestroyInstance(m_VkInstance, nullptr);
 
 	// Destry glfw and terminate it.
 	glfwDestroyWindow(m_Window);
@@ -87,7 +202,18 @@ void VulkanRenderer::CreateInstance()
 	appInfo.pApplicationName = "GEngine Vulkan";
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	// Descriptor indexing is core in 1.2. Anything older than 1.1 can't even query for it, and a 1.0 loader
+	// fails instance creation if a newer version is asked for, so check what the loader supports first.
+	PFN_vkEnumerateInstanceVersion enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+	uint instanceVersion = VK_API_VERSION_1_0;
+	if (enumerateInstanceVersion != nullptr)
+		enumerateInstanceVersion(&instanceVersion);
+
+	if (instanceVersion < VK_API_VERSION_1_1)
+		throw std::runtime_error("Vulkan 1.1 or newer is needed!");
+
+	appInfo.apiVersion = VK_API_VERSION_1_2;
+	m_VkApiVersion = std::min(instanceVersion, (uint)VK_API_VERSION_1_2);
 
 	VkInstanceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -178,7 +304,80 @@ bool VulkanRenderer::IsDeviceSuitable(VkPhysicalDevice device)
 		swapChainAdequate = !swapChainSupport.m_Formats.empty() && !swapChainSupport.m_PresentModes.empty();
 	}
 
-	return indices.IsComplete() && extensionsSupport && swapChainAdequate;
+	return indices.IsComplete() && extensionsSupport && swapChainAdequate && CheckDescriptorIndexingSupport(device) && CheckTimelineSemaphoreSupport(device);
+}
+
+bool VulkanRenderer::CheckDescriptorIndexingSupport(VkPhysicalDevice device)
+{
+	// Before 1.2 descriptor indexing is an extension.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (std::min(properties.apiVersion, m_VkApiVersion) < VK_API_VERSION_1_2 && !CheckDeviceExtension(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		return false;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexingFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+
+	return indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+		indexingFeatures.descriptorBindingUpdateUnusedWhilePending && indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+}
+
+bool VulkanRenderer::CheckDynamicRenderingSupport(VkPhysicalDevice device)
+{
+	if (!CheckDeviceExtension(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		return false;
+
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &dynamicRenderingFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+
+	return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+}
+
+bool VulkanRenderer::CheckTimelineSemaphoreSupport(VkPhysicalDevice device)
+{
+	// Before 1.2 timeline semaphores are an extension.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (std::min(properties.apiVersion, m_VkApiVersion) < VK_API_VERSION_1_2 && !CheckDeviceExtension(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		return false;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &timelineFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+
+	return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+bool VulkanRenderer::CheckDeviceExtension(VkPhysicalDevice device, const char* extensionName)
+{
+	uint extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> avaliableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, avaliableExtensions.data());
+
+	for (const auto& extension : avaliableExtensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+			return true;
+	}
+
+	return false;
 }
 
 bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
@@ -295,6 +494,21 @@ QueueFamilyIndices VulkanRenderer::FindQueueFamilies(VkPhysicalDevice device)
 		i++;
 	}
 
+	// A family with compute but not graphics is a separate engine that runs alongside the graphics queue. Without one, a
+	// second queue in the graphics family can still be scheduled alongside it.
+	for (uint family = 0; family < queueFamilyCount; ++family)
+	{
+		VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.m_ComputeFamily = family;
+			break;
+		}
+	}
+
+	if (!indices.m_ComputeFamily.has_value() && indices.m_GraphicsFamily.has_value() && queueFamilies[indices.m_GraphicsFamily.value()].queueCount > 1)
+		indices.m_ComputeFamily = indices.m_GraphicsFamily;
+
 	return indices;
 }
 
@@ -303,30 +517,94 @@ void VulkanRenderer::CreateLogicalDevice()
 	// Get the queue families from the graphics card.
 	QueueFamilyIndices indicies = FindQueueFamilies(m_VkPhysicalDevice);
 
+	// Async compute needs a queue for compute passes, it's synced with the graphics queue by their timelines.
+	bool asyncCompute = indicies.m_ComputeFamily.has_value();
+	m_GraphicsQueueFamily = indicies.m_GraphicsFamily.value();
+	m_ComputeQueueFamily = asyncCompute ? indicies.m_ComputeFamily.value() : m_GraphicsQueueFamily;
+
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint> uniqueQueueFamilies = { indicies.m_GraphicsFamily.value(), indicies.m_PresentFamily.value() };
+	std::set<uint> uniqueQueueFamilies = { indicies.m_GraphicsFamily.value(), indicies.m_PresentFamily.value(), m_ComputeQueueFamily };
 
-	float queuePriority = 1.0f;
+	// Without a family of its own, the compute queue is the graphics family's second.
+	float queuePriorities[] = { 1.0f, 1.0f };
 	for (uint queueFamily : uniqueQueueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo{};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfo.queueCount = asyncCompute && queueFamily == m_GraphicsQueueFamily && m_ComputeQueueFamily == m_GraphicsQueueFamily ? 2 : 1;
+		queueCreateInfo.pQueuePriorities = queuePriorities;
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
-	VkPhysicalDeviceFeatures deviceFeatures{};
+	// Indirect draws that start at the object's index and draw many objects per call are used by GPU culling.
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_VkPhysicalDevice, &supportedFeatures);
+
+	m_VkEnabledFeatures = {};
+	m_VkEnabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	m_VkEnabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	m_VkEnabledFeatures.shaderStorageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats;
+
+	// Draw indirect count is optional, without it culled draws are left in the buffer with no instances.
+	bool drawIndirectCountSupported = CheckDeviceExtension(m_VkPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+	std::vector<const char*> deviceExtensions = m_VkDeviceExtenstions;
+	if (drawIndirectCountSupported)
+		deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+	// The device was picked for supporting these, they're what the bindless table needs.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_VkPhysicalDevice, &properties);
+	m_VkApiVersion = std::min(properties.apiVersion, m_VkApiVersion);
+	if (m_VkApiVersion < VK_API_VERSION_1_2)
+		deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+	m_VkDescriptorIndexingFeatures = {};
+	m_VkDescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	m_VkDescriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	m_VkDescriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	m_VkDescriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	m_VkDescriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	m_VkDescriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	m_VkDescriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+	// Dynamic rendering is optional, render passes are used without it. It needs 1.2 for depth stencil resolve.
+	bool dynamicRenderingSupported = m_VkApiVersion >= VK_API_VERSION_1_2 && CheckDynamicRenderingSupport(m_VkPhysicalDevice);
+
+	m_VkDynamicRenderingFeatures = {};
+	m_VkDynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	m_VkDynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	if (dynamicRenderingSupported)
+	{
+		deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		m_VkDescriptorIndexingFeatures.pNext = &m_VkDynamicRenderingFeatures;
+	}
+
+	// Features have to go through the pNext chain to reach the descriptor indexing ones.
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &m_VkDescriptorIndexingFeatures;
+	features.features = m_VkEnabledFeatures;
+
+	// Every queue's submits signal a timeline, which is how the CPU knows when frames are done.
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+	timelineFeatures.pNext = features.pNext;
+	features.pNext = &timelineFeatures;
+	if (m_VkApiVersion < VK_API_VERSION_1_2)
+		deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
 
 	// Creation information.
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &features;
 	createInfo.queueCreateInfoCount = static_cast<uint>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
-	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint>(m_VkDeviceExtenstions.size());
-	createInfo.ppEnabledExtensionNames = m_VkDeviceExtenstions.data();
+	createInfo.pEnabledFeatures = nullptr;
+	createInfo.enabledExtensionCount = static_cast<uint>(deviceExtensions.size());
+	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (enableValidationLayers)
 	{
@@ -346,6 +624,17 @@ void VulkanRenderer::CreateLogicalDevice()
 	// Get the graphics and present family queues.
 	vkGetDeviceQueue(m_VkLogicalDevice, indicies.m_GraphicsFamily.value(), 0, &m_VkGraphicsQueue);
 	vkGetDeviceQueue(m_VkLogicalDevice, indicies.m_PresentFamily.value(), 0, &m_VkPresentQueue);
+	if (asyncCompute)
+		vkGetDeviceQueue(m_VkLogicalDevice, m_ComputeQueueFamily, m_ComputeQueueFamily == m_GraphicsQueueFamily ? 1 : 0, &m_VkComputeQueue);
+
+	if (drawIndirectCountSupported)
+		m_VkCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_VkLogicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+
+	if (dynamicRenderingSupported)
+	{
+		m_VkCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_VkLogicalDevice, "vkCmdBeginRenderingKHR");
+		m_VkCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_VkLogicalDevice, "vkCmdEndRenderingKHR");
+	}
 }
 
 SwapChainSupportDetails VulkanRenderer::QuerySwapChainSupport(VkPhysicalDevice device)
@@ -448,6 +737,17 @@ void VulkanRenderer::CreateSwapChain()
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+	// Dynamic resolution blits the scene up to the swap chain image, linearly filtered where the format allows it.
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_VkPhysicalDevice, surfaceFormat.format, &formatProperties);
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	m_UpscaleSupported = (swapChainSupport.m_Capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+		(formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+	if (m_UpscaleSupported)
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+		m_VkUpscaleFilter = VK_FILTER_LINEAR;
+
 	// Queue families indices.
 	QueueFamilyIndices indices = FindQueueFamilies(m_VkPhysicalDevice);
 	uint queueFamilyIndices[] = { indices.m_GraphicsFamily.value(), indices.m_PresentFamily.value() };
@@ -480,6 +780,7 @@ void VulkanRenderer::CreateSwapChain()
 	vkGetSwapchainImagesKHR(m_VkLogicalDevice, m_VkSwapChain, &imageCount, m_VkSwapChainImages.data());
 	m_VkSwapChainImageFormat = surfaceFormat.format;
 	m_VkSwapChainExtent = extent;
+	m_RenderExtent = extent;
 }
 
 void VulkanRenderer::CreateImageViews()
@@ -511,6 +812,34 @@ void VulkanRenderer::CreateImageViews()
 	}
 }
 
+void VulkanRenderer::CreatePipelineLayout()
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	// Object data in set 0, found with the instance index and the first object in the push constants.
+	// Bindless resources and materials in set 1, found with the object's material ID.
+	VkDescriptorSetLayout setLayouts[] = { m_ObjectRingBuffer->GetDescriptorSetLayout(), m_BindlessTable->GetDescriptorSetLayout() };
+
+	VkPushConstantRange pushConstantRanges[2] = {};
+	// The fragment shader finds its lights with the light grid index.
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(DrawConstants);
+	// Pushed when a mesh is bound, for unpacking its positions.
+	pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRanges[1].offset = sizeof(DrawConstants);
+	pushConstantRanges[1].size = sizeof(MeshConstants);
+
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+	pipelineLayoutInfo.pushConstantRangeCount = 2;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
+
+	// Create the pipeline layout object.
+	if (vkCreatePipelineLayout(m_VkLogicalDevice, &pipelineLayoutInfo, nullptr, &m_VkPipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create pipeline layout!");
+}
+
 void VulkanRenderer::CreateGraphicsPipeline()
 {
 	std::vector<char> vertShaderCode = ReadFile("../Shaders/Simple/vert.spv");
@@ -526,6 +855,20 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main";
 
+	// The vertex shaders unpack octahedral normals and quantised positions if the format has them.
+	const VertexLayout& vertexLayout = VertexLayout::Get(m_VertexFormat);
+	VkSpecializationMapEntry octahedralEntry{};
+	octahedralEntry.constantID = 0;
+	octahedralEntry.offset = 0;
+	octahedralEntry.size = sizeof(VkBool32);
+
+	VkSpecializationInfo vertexSpecialization{};
+	vertexSpecialization.mapEntryCount = 1;
+	vertexSpecialization.pMapEntries = &octahedralEntry;
+	vertexSpecialization.dataSize = sizeof(VkBool32);
+	vertexSpecialization.pData = &vertexLayout.m_Octahedral;
+	vertShaderStageInfo.pSpecializationInfo = &vertexSpecialization;
+
 	// Information on the frag shader.
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -533,40 +876,40 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
 
+	// The fragment shader only discards pixels for cross-fades between levels of detail when they're on.
+	VkSpecializationMapEntry crossFadeEntry{};
+	crossFadeEntry.constantID = 1;
+	crossFadeEntry.offset = 0;
+	crossFadeEntry.size = sizeof(VkBool32);
+
+	VkSpecializationInfo fragmentSpecialization{};
+	fragmentSpecialization.mapEntryCount = 1;
+	fragmentSpecialization.pMapEntries = &crossFadeEntry;
+	fragmentSpecialization.dataSize = sizeof(VkBool32);
+	fragmentSpecialization.pData = &m_LodCrossFade;
+	fragShaderStageInfo.pSpecializationInfo = &fragmentSpecialization;
+
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = vertexLayout.GetInputState();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	// Viewport for where the camera is in scene.
-	// Just here for the demo.
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)m_VkSwapChainExtent.width;
-	viewport.height = (float) m_VkSwapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_VkSwapChainExtent;
-
+	// The viewport and scissor are set when drawing begins, since dynamic resolution changes them every frame
+	// and shadow tiles are each a different part of the atlas.
 	VkPipelineViewportStateCreateInfo viewportState{};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
 
 	// Rasterizer.
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -576,7 +919,8 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizer.lineWidth = 1.0f;
 	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	// Counter-clockwise as glTF and OBJ have it, which the y flip in the projection keeps on screen. Meshlet cones rely on it.
+	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 	rasterizer.depthBiasEnable = VK_FALSE;
 
 	VkPipelineMultisampleStateCreateInfo multisampling{};
@@ -584,6 +928,14 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	multisampling.sampleShadingEnable = VK_FALSE;
 	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
@@ -599,15 +951,6 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-	// Create the pipeline layout object.
-	if (vkCreatePipelineLayout(m_VkLogicalDevice, &pipelineLayoutInfo, nullptr, &m_VkPipelineLayout) != VK_SUCCESS)
-		throw std::runtime_error("Failed to create pipeline layout!");
-
 	// The graphics pipeline.
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -618,16 +961,81 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = m_VkPipelineLayout;
-	pipelineInfo.renderPass = m_VkRenderPass;
+	pipelineInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_CLEAR];
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+	// With dynamic rendering the pipeline only needs the attachment formats, so it works with any attachments in them.
+	VkPipelineRenderingCreateInfoKHR renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &m_VkSwapChainImageFormat;
+	renderingInfo.depthAttachmentFormat = m_VkDepthFormat;
+	if (IsDynamicRenderingEnabled())
+		pipelineInfo.pNext = &renderingInfo;
+
 	// Create the graphics pipeline object.
 	if (vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkGraphicsPipeline) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create graphics pipeline!");
 
+	// After the pre-pass only what's at the depth it drew gets shaded, and the depth's already there.
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+	if (vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkDepthEqualPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth equal pipeline!");
+
+	// The same two for temporal upsampling, which draw motion vectors as well.
+	VkPipelineColorBlendAttachmentState motionBlendAttachments[] = { colorBlendAttachment, colorBlendAttachment };
+	VkFormat motionFormats[] = { m_VkSwapChainImageFormat, MOTION_FORMAT };
+	colorBlending.attachmentCount = 2;
+	colorBlending.pAttachments = motionBlendAttachments;
+	renderingInfo.colorAttachmentCount = 2;
+	renderingInfo.pColorAttachmentFormats = motionFormats;
+	pipelineInfo.renderPass = m_VkMotionRenderPasses[ATTACHMENTS_CLEAR];
+
+	if (vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkMotionDepthEqualPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create motion depth equal pipeline!");
+
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	if (vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkMotionPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create motion pipeline!");
+
+	// The pre-pass only has a vertex shader and only draws to the depth buffer. Shadow casters draw with it too, but
+	// the pre-pass pipeline is only made once the pre-pass is enabled.
+	VkShaderModule prepassShaderModule = CreateShaderModule(ReadFile("../Shaders/DepthPrepass/depthPrepass.spv"));
+
+	VkPipelineShaderStageCreateInfo prepassShaderStageInfo = vertShaderStageInfo;
+	prepassShaderStageInfo.module = prepassShaderModule;
+
+	colorBlending.attachmentCount = 0;
+	renderingInfo.colorAttachmentCount = 0;
+	pipelineInfo.stageCount = 1;
+	pipelineInfo.pStages = &prepassShaderStageInfo;
+	pipelineInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_DEPTH_CLEAR];
+
+	m_VkDepthPrepassPipeline = VK_NULL_HANDLE;
+	if (m_DepthPrepass && vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkDepthPrepassPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create depth pre-pass pipeline!");
+
+	// Shadow casters use the same vertex shader, and the triangle is drawn from both sides since lights can be on either.
+	// Bias the depth drawn so surfaces don't shadow themselves, more where they're at a steep angle to the light.
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.depthBiasEnable = VK_TRUE;
+	rasterizer.depthBiasConstantFactor = 1.25f;
+	rasterizer.depthBiasSlopeFactor = 1.75f;
+	pipelineInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_DEPTH_LOAD];
+
+	if (vkCreateGraphicsPipelines(m_VkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkShadowPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create shadow pipeline!");
+
+	vkDestroyShaderModule(m_VkLogicalDevice, prepassShaderModule, nullptr);
 	vkDestroyShaderModule(m_VkLogicalDevice, fragShaderModule, nullptr);
 	vkDestroyShaderModule(m_VkLogicalDevice, vertShaderModule, nullptr);
 }
@@ -666,46 +1074,167 @@ VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char>& code)
 	return shaderModule;
 }
 
-void VulkanRenderer::CreateRenderPass()
+void VulkanRenderer::CreateRenderPasses()
+{
+	for (uint i = 0; i < ATTACHMENTS_COUNT; ++i)
+	{
+		m_VkRenderPasses[i] = CreateRenderPass((AttachmentSetup)i, false);
+		if (ATTACHMENT_LOAD_OPS[i].m_Colour)
+			m_VkMotionRenderPasses[i] = CreateRenderPass((AttachmentSetup)i, true);
+	}
+}
+
+VkRenderPass VulkanRenderer::CreateRenderPass(AttachmentSetup setup, bool motion)
 {
+	const AttachmentLoadOps& loadOps = ATTACHMENT_LOAD_OPS[setup];
+
 	VkAttachmentDescription colourAttachment{};
 	colourAttachment.format = m_VkSwapChainImageFormat;
 	colourAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colourAttachment.loadOp = loadOps.m_ColourLoadOp;
 	colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colourAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colourAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colourAttachmentRef{};
-	colourAttachmentRef.attachment = 0;
-	colourAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colourAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colourAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// Motion is cleared and kept along with the colour.
+	VkAttachmentDescription motionAttachment = colourAttachment;
+	motionAttachment.format = MOTION_FORMAT;
+
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = m_VkDepthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = loadOps.m_DepthLoadOp;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Attachments go colour, motion, then depth, leaving out the ones the pass doesn't have.
+	uint colourCount = loadOps.m_Colour ? (motion ? 2 : 1) : 0;
+
+	VkAttachmentReference colourAttachmentRefs[2]{};
+	colourAttachmentRefs[0].attachment = 0;
+	colourAttachmentRefs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colourAttachmentRefs[1].attachment = 1;
+	colourAttachmentRefs[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = colourCount;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colourAttachmentRef;
-
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	subpass.colorAttachmentCount = colourCount;
+	subpass.pColorAttachments = colourCount > 0 ? colourAttachmentRefs : nullptr;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkAttachmentDescription attachments[3];
+	uint attachmentCount = 0;
+	if (loadOps.m_Colour)
+		attachments[attachmentCount++] = colourAttachment;
+	if (colourCount > 1)
+		attachments[attachmentCount++] = motionAttachment;
+	attachments[attachmentCount++] = depthAttachment;
 
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colourAttachment;
+	renderPassInfo.attachmentCount = attachmentCount;
+	renderPassInfo.pAttachments = attachments;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
 
-	if (vkCreateRenderPass(m_VkLogicalDevice, &renderPassInfo, nullptr, &m_VkRenderPass) != VK_SUCCESS)
+	VkRenderPass renderPass;
+	if (vkCreateRenderPass(m_VkLogicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
 		throw std::runtime_error("failed to create render pass!");
+
+	return renderPass;
+}
+
+VkFormat VulkanRenderer::FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+{
+	for (VkFormat format : candidates)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_VkPhysicalDevice, format, &properties);
+
+		VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+		if ((supported & features) == features)
+			return format;
+	}
+
+	throw std::runtime_error("Failed to find supported format!");
+}
+
+VkFormat VulkanRenderer::FindDepthFormat()
+{
+	return FindSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+}
+
+void VulkanRenderer::CreateDepthResources()
+{
+	m_VkDepthFormat = FindDepthFormat();
+
+	CreateImage(m_VkSwapChainExtent.width, m_VkSwapChainExtent.height, 1, m_VkDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		m_VkDepthImage, m_VkDepthImageMemory);
+	m_VkDepthImageView = CreateImageView(m_VkDepthImage, m_VkDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+}
+
+void VulkanRenderer::CreateImage(uint width, uint height, uint mipLevels, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory)
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = width;
+	imageInfo.extent.height = height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = usage;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(m_VkLogicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create image!");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(m_VkLogicalDevice, image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(m_VkLogicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate image memory!");
+
+	vkBindImageMemory(m_VkLogicalDevice, image, imageMemory, 0);
+}
+
+VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, uint baseMipLevel, uint mipLevels)
+{
+	VkImageViewCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	createInfo.image = image;
+	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	createInfo.format = format;
+	createInfo.subresourceRange.aspectMask = aspectMask;
+	createInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	createInfo.subresourceRange.levelCount = mipLevels;
+	createInfo.subresourceRange.baseArrayLayer = 0;
+	createInfo.subresourceRange.layerCount = 1;
+
+	VkImageView imageView;
+	if (vkCreateImageView(m_VkLogicalDevice, &createInfo, nullptr, &imageView) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create image view!");
+
+	return imageView;
 }
 
 void VulkanRenderer::CreateFramebuffers()
@@ -714,12 +1243,13 @@ void VulkanRenderer::CreateFramebuffers()
 
 	for (size_t i = 0; i < m_VkSwapChainImageViews.size(); ++i)
 	{
-		VkImageView attachments[] = { m_VkSwapChainImageViews[i] };
+		// Every image shares the one depth buffer, only one frame is drawn at a time.
+		VkImageView attachments[] = { m_VkSwapChainImageViews[i], m_VkDepthImageView };
 
 		VkFramebufferCreateInfo framebufferInfo{};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_VkRenderPass;
-		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_CLEAR];
+		framebufferInfo.attachmentCount = 2;
 		framebufferInfo.pAttachments = attachments;
 		framebufferInfo.width = m_VkSwapChainExtent.width;
 		framebufferInfo.height = m_VkSwapChainExtent.height;
@@ -728,6 +1258,19 @@ void VulkanRenderer::CreateFramebuffers()
 		if (vkCreateFramebuffer(m_VkLogicalDevice, &framebufferInfo, nullptr, &m_VkSwapChainFramebuffers[i]) != VK_SUCCESS)
 			throw std::runtime_error("Failed to create framebuffer!");
 	}
+
+	// The pre-pass only draws depth, which every swap chain image shares.
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_DEPTH_CLEAR];
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &m_VkDepthImageView;
+	framebufferInfo.width = m_VkSwapChainExtent.width;
+	framebufferInfo.height = m_VkSwapChainExtent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(m_VkLogicalDevice, &framebufferInfo, nullptr, &m_VkDepthFramebuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create framebuffer!");
 }
 
 void VulkanRenderer::CreateCommandPool()
@@ -737,49 +1280,934 @@ void VulkanRenderer::CreateCommandPool()
 	VkCommandPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.queueFamilyIndex = queueFamilyIndices.m_GraphicsFamily.value();
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	if (vkCreateCommandPool(m_VkLogicalDevice, &poolInfo, nullptr, &m_VkCommandPool) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create command pool!");
+
+	if (!IsAsyncComputeSupported())
+		return;
+
+	poolInfo.queueFamilyIndex = m_ComputeQueueFamily;
+
+	if (vkCreateCommandPool(m_VkLogicalDevice, &poolInfo, nullptr, &m_VkComputeCommandPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create compute command pool!");
 }
 
 void VulkanRenderer::CreateCommandBuffers()
 {
-	m_VkCommandBuffers.resize(m_VkSwapChainFramebuffers.size());
+	// Enough per frame in flight for each queue's segments.
+	VkCommandPool pools[FRAME_QUEUE_COUNT] = { m_VkCommandPool, m_VkComputeCommandPool };
+	for (uint queue = 0; queue < FRAME_QUEUE_COUNT; ++queue)
+	{
+		if (pools[queue] == VK_NULL_HANDLE)
+			continue;
+
+		m_VkCommandBuffers[queue].resize(MAX_FRAMES_IN_FLIGHT * MAX_QUEUE_SEGMENTS);
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pools[queue];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = (uint)m_VkCommandBuffers[queue].size();
+
+		if (vkAllocateCommandBuffers(m_VkLogicalDevice, &allocInfo, m_VkCommandBuffers[queue].data()) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate command buffers!");
+	}
+}
+
+void VulkanRenderer::CreateSyncObjects()
+{
+	m_FrameTimeline = new FrameTimeline(this);
+	m_DeletionQueue = new DeletionQueue(m_VkLogicalDevice, m_FrameTimeline);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (VkSemaphore& semaphore : m_VkImageAvailableSemaphores)
+	{
+		if (vkCreateSemaphore(m_VkLogicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create semaphores!");
+	}
+
+	m_VkRenderFinishedSemaphores.resize(m_VkSwapChainImages.size());
+	for (VkSemaphore& semaphore : m_VkRenderFinishedSemaphores)
+	{
+		if (vkCreateSemaphore(m_VkLogicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create semaphores!");
+	}
+}
+
+void VulkanRenderer::CreateDemoMesh()
+{
+	// The triangle the shaders used to have built in, with UVs across its bounds. Wound the other way to the shaders'
+	// version since the front face became counter-clockwise, so it's culled exactly as before.
+	Mesh mesh;
+	const glm::vec3 positions[] = { glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f), glm::vec3(-0.5f, 0.5f, 0.0f) };
+	for (const glm::vec3& position : positions)
+	{
+		MeshVertex vertex;
+		vertex.m_Position = position;
+		vertex.m_Normal = glm::vec3(0.0f, 0.0f, -1.0f);
+		vertex.m_Tangent = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+		vertex.m_UV = glm::vec2(position) + 0.5f;
+		mesh.m_Vertices.push_back(vertex);
+	}
+
+	mesh.m_Indices = { 0, 2, 1 };
+	mesh.m_SubMeshes.push_back({ 0, 3, 0 });
+	mesh.ComputeBounds();
+
+	SetDemoMesh(mesh);
+}
+
+void VulkanRenderer::SetDemoMesh(const Mesh& mesh)
+{
+	m_DemoMeshSource = mesh;
+	delete m_DemoMesh;
+	m_DemoMesh = new GpuMesh(this, m_DemoMeshSource, m_VertexFormat);
+}
+
+void VulkanRenderer::SetVertexFormat(VertexFormat format)
+{
+	if (format == m_VertexFormat)
+		return;
+
+	m_VertexFormat = format;
+	RecreateGraphicsPipelines();
+
+	delete m_DemoMesh;
+	m_DemoMesh = new GpuMesh(this, m_DemoMeshSource, m_VertexFormat);
+}
+
+void VulkanRenderer::SetLodCrossFadeEnabled(bool enabled)
+{
+	VkBool32 crossFade = enabled ? VK_TRUE : VK_FALSE;
+	if (crossFade == m_LodCrossFade)
+		return;
+
+	m_LodCrossFade = crossFade;
+	RecreateGraphicsPipelines();
+}
+
+void VulkanRenderer::SetDepthPrepassEnabled(bool enabled)
+{
+	m_DepthPrepass = enabled;
+
+	// Once made the pre-pass pipeline stays around, so turning it off and on again doesn't make them all again.
+	if (enabled && m_VkDepthPrepassPipeline == VK_NULL_HANDLE)
+		RecreateGraphicsPipelines();
+}
+
+void VulkanRenderer::RecreateGraphicsPipelines()
+{
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkGraphicsPipeline));
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkDepthEqualPipeline));
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkMotionPipeline));
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkMotionDepthEqualPipeline));
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkDepthPrepassPipeline));
+	m_DeletionQueue->Destroy(UniquePipeline(m_VkLogicalDevice, m_VkShadowPipeline));
+	CreateGraphicsPipeline();
+}
+
+uint VulkanRenderer::FindMemoryType(uint typeFilter, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(m_VkPhysicalDevice, &memoryProperties);
+
+	for (uint i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+void VulkanRenderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Any buffer could be used by an async compute pass, so with the compute queue in another family they're shared with it.
+	uint queueFamilies[] = { m_GraphicsQueueFamily, m_ComputeQueueFamily };
+	if (m_ComputeQueueFamily != m_GraphicsQueueFamily)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
+
+	if (vkCreateBuffer(m_VkLogicalDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create buffer!");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_VkLogicalDevice, buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, properties);
+
+	if (vkAllocateMemory(m_VkLogicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate buffer memory!");
+
+	vkBindBufferMemory(m_VkLogicalDevice, buffer, bufferMemory, 0);
+}
+
+void VulkanRenderer::EnableShadows()
+{
+	if (m_ShadowAtlas == nullptr)
+		m_ShadowAtlas = new ShadowAtlas(this);
+}
+
+void VulkanRenderer::EnableDepthPyramid()
+{
+	if (m_DepthPyramid == nullptr)
+		m_DepthPyramid = new DepthPyramid(this);
+}
+
+void VulkanRenderer::EnableDynamicResolution(float targetFrameTime, float minScale, float maxScale)
+{
+	if (!m_UpscaleSupported)
+		throw std::runtime_error("Failed to enable dynamic resolution, the swap chain images can't be blitted to!");
+
+	if (m_DynamicResolution == nullptr)
+		m_DynamicResolution = new DynamicResolution(this);
+
+	m_DynamicResolution->SetTarget(targetFrameTime, minScale, maxScale);
+}
+
+void VulkanRenderer::EnableTemporalUpsampling(float renderScale)
+{
+	if (!m_UpscaleSupported)
+		throw std::runtime_error("Failed to enable temporal upsampling, the swap chain images can't be blitted to!");
 
+	if (m_TemporalUpsampler == nullptr)
+		m_TemporalUpsampler = new TemporalUpsampler(this);
+
+	m_TemporalUpsampler->SetRenderScale(renderScale);
+}
+
+VkCommandBuffer VulkanRenderer::BeginSingleTimeCommands()
+{
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = m_VkCommandPool;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint)m_VkCommandBuffers.size();
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(m_VkLogicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate command buffer!");
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin recording command buffer!");
+
+	return commandBuffer;
+}
+
+void VulkanRenderer::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
+{
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to record command buffer!");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if (vkQueueSubmit(m_VkGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit command buffer!");
 
-	if (vkAllocateCommandBuffers(m_VkLogicalDevice, &allocInfo, m_VkCommandBuffers.data()) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate command buffers!");
+	vkQueueWaitIdle(m_VkGraphicsQueue);
+	vkFreeCommandBuffers(m_VkLogicalDevice, m_VkCommandPool, 1, &commandBuffer);
+}
 
-	for (size_t i = 0; i < m_VkCommandBuffers.size(); i++)
+uint VulkanRenderer::BeginFrame()
+{
+	// The frame in flight's command buffers, per frame buffers and acquire semaphore are reused once the frame that last
+	// used them is done. The CPU only waits here if it's more than MAX_FRAMES_IN_FLIGHT frames ahead of the GPU.
+	m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	uint64_t frame = m_FrameTimeline->GetFrameNumber();
+	if (frame > MAX_FRAMES_IN_FLIGHT)
+		m_FrameTimeline->WaitForFrame(frame - MAX_FRAMES_IN_FLIGHT);
+	m_DeletionQueue->Collect();
+
+	uint imageIndex;
+	vkAcquireNextImageKHR(m_VkLogicalDevice, m_VkSwapChain, UINT64_MAX, m_VkImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+
+	m_ObjectRingBuffer->BeginFrame(m_CurrentFrame);
+	m_BindlessTable->BeginFrame(m_CurrentFrame);
+	m_DescriptorAllocator->BeginFrame(m_CurrentFrame);
+
+	// The render extent is picked before anything's drawn, so the light grid is built for it too.
+	if (m_DynamicResolution != nullptr)
 	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		m_DynamicResolution->Update(m_CurrentFrame);
+		m_RenderExtent = m_DynamicResolution->GetRenderExtent(m_VkSwapChainExtent);
+	}
+	else if (m_TemporalUpsampler != nullptr)
+		m_RenderExtent = m_TemporalUpsampler->GetRenderExtent(m_VkSwapChainExtent);
+
+	return imageIndex;
+}
+
+void VulkanRenderer::WaitIdle()
+{
+	m_FrameTimeline->WaitIdle();
+}
+
+void VulkanRenderer::RecordCommandBuffer(uint imageIndex, const DrawConstants& drawConstants, const RenderQueue* renderQueue, GpuCuller* gpuCuller)
+{
+	FramePath framePath = FRAME_PATH_RENDER_QUEUE;
+	if (gpuCuller != nullptr)
+		framePath = gpuCuller->IsOcclusionCullingEnabled() ? FRAME_PATH_OCCLUSION_CULL : FRAME_PATH_GPU_CULL;
+
+	// Frames are drawn the same way until culling, the pre-pass, shadows, dynamic resolution, temporal upsampling or async compute
+	// are switched, so the graph is only built again then. The render extent changing doesn't need it, the viewport is set each frame.
+	bool shadows = m_ShadowAtlas != nullptr;
+	bool dynamicResolution = m_DynamicResolution != nullptr;
+	bool temporal = m_TemporalUpsampler != nullptr;
+	if (framePath != m_FramePath || m_DepthPrepass != m_GraphDepthPrepass || shadows != m_GraphShadows || dynamicResolution != m_GraphDynamicResolution ||
+		temporal != m_GraphTemporal || m_AsyncCompute != m_GraphAsyncCompute)
+	{
+		// Frames still in flight keep the old graph's transient images, they go through the deletion queue.
+		m_GraphRebuilt = true;
+		m_FramePath = framePath;
+		m_GraphDepthPrepass = m_DepthPrepass;
+		m_GraphShadows = shadows;
+		m_GraphDynamicResolution = dynamicResolution;
+		m_GraphTemporal = temporal;
+		m_GraphAsyncCompute = m_AsyncCompute;
+		BuildRenderGraph(framePath);
+
+		if (m_RenderGraph->GetQueueSegmentCount(FRAME_QUEUE_GRAPHICS) > MAX_QUEUE_SEGMENTS || m_RenderGraph->GetQueueSegmentCount(FRAME_QUEUE_COMPUTE) > MAX_QUEUE_SEGMENTS)
+			throw std::runtime_error("Failed to build render graph, it has too many segments for the command buffers!");
+	}
+
+	m_FrameImageIndex = imageIndex;
+	m_FrameDrawConstants = drawConstants;
+	m_FrameRenderQueue = renderQueue;
+	m_FrameGpuCuller = gpuCuller;
+	m_RenderGraph->SetImage(m_SwapChainResource, m_VkSwapChainImages[imageIndex], m_VkSwapChainImageViews[imageIndex]);
 
-		if (vkBeginCommandBuffer(m_VkCommandBuffers[i], &beginInfo) != VK_SUCCESS)
+	// The scene is drawn with this frame's jitter, and the history images swap which is read and which is written.
+	if (m_GraphTemporal)
+	{
+		m_FrameDrawConstants.m_Motion = m_TemporalUpsampler->Update(drawConstants.m_ViewProjection, m_RenderExtent, m_CurrentFrame);
+		m_FrameDrawConstants.m_ViewProjection = m_TemporalUpsampler->GetJitteredViewProjection();
+		m_RenderGraph->SetImage(m_HistoryResource, m_TemporalUpsampler->GetHistoryImage(), m_TemporalUpsampler->GetHistoryImageView());
+		m_RenderGraph->SetImage(m_PreviousHistoryResource, m_TemporalUpsampler->GetPreviousHistoryImage(), m_TemporalUpsampler->GetPreviousHistoryImageView());
+	}
+
+	// The pool allows resetting individual buffers, so beginning again throws away last frame's commands.
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	uint graphicsSegments = m_RenderGraph->GetQueueSegmentCount(FRAME_QUEUE_GRAPHICS);
+	for (uint i = 0; i < m_RenderGraph->GetSegmentCount(); ++i)
+	{
+		const RenderGraphSegment& segment = m_RenderGraph->GetSegment(i);
+		VkCommandBuffer commandBuffer = m_VkCommandBuffers[segment.m_Queue][m_CurrentFrame * MAX_QUEUE_SEGMENTS + segment.m_QueueIndex];
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
 			throw std::runtime_error("Failed to begin recording command buffer!");
 
+		// The whole frame is timed on the graphics queue, it's what has to fit in the target. Async compute before the
+		// first graphics segment overlaps the last frame, so it isn't counted.
+		bool graphics = segment.m_Queue == FRAME_QUEUE_GRAPHICS;
+		if (m_DynamicResolution != nullptr && graphics && segment.m_QueueIndex == 0)
+			m_DynamicResolution->RecordBegin(commandBuffer, m_CurrentFrame);
+
+		m_RenderGraph->Execute(i, commandBuffer);
+
+		if (m_DynamicResolution != nullptr && graphics && segment.m_QueueIndex == graphicsSegments - 1)
+			m_DynamicResolution->RecordEnd(commandBuffer, m_CurrentFrame);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Failed to record command buffer!");
+	}
+}
+
+void VulkanRenderer::SubmitFrame(uint imageIndex)
+{
+	VkQueue queues[FRAME_QUEUE_COUNT] = { m_VkGraphicsQueue, m_VkComputeQueue };
+	uint graphicsSegments = m_RenderGraph->GetQueueSegmentCount(FRAME_QUEUE_GRAPHICS);
+
+	// The value the first segment of each queue this frame will signal, before any are taken.
+	uint64_t firstValues[FRAME_QUEUE_COUNT];
+	for (uint queue = 0; queue < FRAME_QUEUE_COUNT; ++queue)
+		firstValues[queue] = m_FrameTimeline->GetSubmittedValue((FrameQueue)queue) + 1;
+
+	for (uint i = 0; i < m_RenderGraph->GetSegmentCount(); ++i)
+	{
+		const RenderGraphSegment& segment = m_RenderGraph->GetSegment(i);
+		FrameQueue otherQueue = segment.m_Queue == FRAME_QUEUE_GRAPHICS ? FRAME_QUEUE_COMPUTE : FRAME_QUEUE_GRAPHICS;
+		bool graphics = segment.m_Queue == FRAME_QUEUE_GRAPHICS;
+
+		// Binary semaphores are given a value too, which is ignored.
+		VkSemaphore waitSemaphores[2];
+		uint64_t waitValues[2] = {};
+		VkPipelineStageFlags waitStages[2];
+		uint waitCount = 0;
+
+		// The swap chain image is only used on the graphics queue, so its first segment waits for the acquire.
+		if (graphics && segment.m_QueueIndex == 0)
+		{
+			waitSemaphores[waitCount] = m_VkImageAvailableSemaphores[m_CurrentFrame];
+			waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+
+		// Each queue's segments signal one after another, so the value is the waited segment's. One counted back from
+		// before the first execute has nothing to wait for.
+		// The last execute's segments are only known from this graph if it drew the last frame too. Just after it's built
+		// again, everything submitted to the other queue is waited for instead.
+		int64_t waitValue = (int64_t)firstValues[otherQueue] + segment.m_WaitQueueIndex;
+		if (segment.m_WaitQueueIndex < 0 && m_GraphRebuilt)
+			waitValue = (int64_t)firstValues[otherQueue] - 1;
+		if (segment.m_Wait && waitValue > 0)
+		{
+			waitSemaphores[waitCount] = m_FrameTimeline->GetSemaphore(otherQueue);
+			waitValues[waitCount] = (uint64_t)waitValue;
+			waitStages[waitCount++] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+
+		// Every segment moves its queue's timeline on, which is what the frame being done is checked against.
+		VkSemaphore signalSemaphores[2];
+		uint64_t signalValues[2] = {};
+		uint signalCount = 0;
+		signalSemaphores[signalCount] = m_FrameTimeline->GetSemaphore(segment.m_Queue);
+		signalValues[signalCount++] = m_FrameTimeline->Signal(segment.m_Queue);
+
+		if (graphics && segment.m_QueueIndex == graphicsSegments - 1)
+			signalSemaphores[signalCount++] = m_VkRenderFinishedSemaphores[imageIndex];
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = waitCount;
+		timelineInfo.pWaitSemaphoreValues = waitValues;
+		timelineInfo.signalSemaphoreValueCount = signalCount;
+		timelineInfo.pSignalSemaphoreValues = signalValues;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = waitCount;
+		submitInfo.pWaitSemaphores = waitSemaphores;
+		submitInfo.pWaitDstStageMask = waitStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_VkCommandBuffers[segment.m_Queue][m_CurrentFrame * MAX_QUEUE_SEGMENTS + segment.m_QueueIndex];
+		submitInfo.signalSemaphoreCount = signalCount;
+		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		if (vkQueueSubmit(queues[segment.m_Queue], 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit draw command buffer!");
+	}
+
+	m_GraphRebuilt = false;
+	m_FrameTimeline->EndFrame();
+}
+
+void VulkanRenderer::PresentFrame(uint imageIndex)
+{
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &m_VkRenderFinishedSemaphores[imageIndex];
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &m_VkSwapChain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	vkQueuePresentKHR(m_VkPresentQueue, &presentInfo);
+}
+
+void VulkanRenderer::BuildRenderGraph(FramePath framePath)
+{
+	// The scene colour target's framebuffer goes with the transient image it was made for.
+	m_DeletionQueue->Destroy(UniqueFramebuffer(m_VkLogicalDevice, m_VkSceneFramebuffer));
+	m_VkSceneFramebuffer = VK_NULL_HANDLE;
+	m_RenderGraph->Reset();
+
+	// Images can only go on the compute queue when it shares the graphics family, buffers are shared with it either way.
+	m_RenderGraph->SetAsyncComputeEnabled(m_GraphAsyncCompute, m_ComputeQueueFamily == m_GraphicsQueueFamily);
+
+	m_SwapChainResource = m_RenderGraph->ImportImage("Swap chain image", m_VkSwapChainImages[0], m_VkSwapChainImageViews[0], VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	m_ColourResource = m_SwapChainResource;
+	RenderGraphResource depth = m_RenderGraph->ImportImage("Depth", m_VkDepthImage, m_VkDepthImageView, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+	m_RenderGraph->MarkOutput(m_SwapChainResource, RENDER_GRAPH_ACCESS_PRESENT);
+
+	// Shadows don't depend on culling, so every frame path draws them first.
+	if (m_ShadowAtlas != nullptr)
+		AddShadowPasses();
+
+	// With dynamic resolution or temporal upsampling the scene is drawn into a target the size of the swap chain, only ever
+	// as big as it's drawn at, then taken up to the swap chain image at the end.
+	if (IsSceneColourInGraph())
+	{
+		RenderGraphImageDesc desc;
+		desc.m_Format = m_VkSwapChainImageFormat;
+		desc.m_Extent = m_VkSwapChainExtent;
+		desc.m_Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (m_GraphTemporal ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		m_SceneColourResource = m_RenderGraph->CreateImage("Scene colour", desc);
+		m_ColourResource = m_SceneColourResource;
+	}
+
+	// Temporal upsampling draws motion vectors alongside the colour, and keeps a history at the swap chain extent. Both history
+	// images are left readable, since next frame the one written this frame is read.
+	if (m_GraphTemporal)
+	{
+		RenderGraphImageDesc desc;
+		desc.m_Format = MOTION_FORMAT;
+		desc.m_Extent = m_VkSwapChainExtent;
+		desc.m_Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		m_MotionResource = m_RenderGraph->CreateImage("Motion", desc);
+
+		m_HistoryResource = m_RenderGraph->ImportImage("History", m_TemporalUpsampler->GetHistoryImage(), m_TemporalUpsampler->GetHistoryImageView(),
+			VK_IMAGE_ASPECT_COLOR_BIT, 1);
+		m_PreviousHistoryResource = m_RenderGraph->ImportImage("History previous", m_TemporalUpsampler->GetPreviousHistoryImage(),
+			m_TemporalUpsampler->GetPreviousHistoryImageView(), VK_IMAGE_ASPECT_COLOR_BIT, 1);
+		m_RenderGraph->MarkOutput(m_HistoryResource, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+		m_RenderGraph->MarkOutput(m_PreviousHistoryResource, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+	}
+
+	if (framePath == FRAME_PATH_RENDER_QUEUE)
+	{
+		AddDrawPasses("Depth pre-pass render queue", "Draw render queue", GPU_CULL_PHASE_ALL, depth, false, 0, 0);
+		CompileRenderGraph(depth);
+		return;
+	}
+
+	// The cull writes the draws, the count and the visibility, clearing some of them first.
+	RenderGraphResource draws = m_RenderGraph->ImportBuffer("Cull draws");
+	RenderGraphResource counts = m_RenderGraph->ImportBuffer("Cull counts");
+	RenderGraphResource visibility = m_RenderGraph->ImportBuffer("Cull visibility");
+
+	if (framePath == FRAME_PATH_GPU_CULL)
+	{
+		// With async compute the cull runs alongside the shadow passes and the end of last frame.
+		uint cull = m_RenderGraph->AddPass("Cull", RecordCullPass, &m_GraphPassData[GPU_CULL_PHASE_ALL]);
+		m_RenderGraph->SetAsyncCompute(cull);
+		m_RenderGraph->Write(cull, draws, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+		m_RenderGraph->Read(cull, draws, RENDER_GRAPH_ACCESS_TRANSFER_SOURCE);
+		m_RenderGraph->Write(cull, counts, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+		m_RenderGraph->Write(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+		m_RenderGraph->Read(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+		m_RenderGraph->Write(cull, visibility, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+		m_RenderGraph->Write(cull, visibility, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+
+		AddDrawPasses("Depth pre-pass culled", "Draw culled", GPU_CULL_PHASE_ALL, depth, true, draws, counts);
+		CompileRenderGraph(depth);
+		return;
+	}
+
+	// Draw what was visible last frame, build the depth pyramid from that, then draw whatever else it doesn't hide.
+	RenderGraphResource pyramid = m_RenderGraph->ImportImage("Depth pyramid", m_DepthPyramid->GetImage(), m_DepthPyramid->GetImageView(),
+		VK_IMAGE_ASPECT_COLOR_BIT, m_DepthPyramid->GetMipCount());
+
+	// The first phase only needs last frame's visibility, so it can run on the compute queue like the single cull. The pyramid and the
+	// second phase sit between the two draws, with nothing on the graphics queue to overlap, so they stay on it.
+	uint cull = m_RenderGraph->AddPass("Cull first phase", RecordCullPass, &m_GraphPassData[GPU_CULL_PHASE_FIRST]);
+	m_RenderGraph->SetAsyncCompute(cull);
+	m_RenderGraph->Write(cull, draws, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, counts, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+	m_RenderGraph->Write(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Read(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, visibility, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+	m_RenderGraph->Read(cull, visibility, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, visibility, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+
+	AddDrawPasses("Depth pre-pass first phase", "Draw first phase", GPU_CULL_PHASE_FIRST, depth, true, draws, counts);
+
+	uint build = m_RenderGraph->AddPass("Depth pyramid", RecordDepthPyramidPass, this);
+	m_RenderGraph->Read(build, depth, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+	m_RenderGraph->Write(build, pyramid, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+
+	// The cull samples the pyramid in the general layout it was built in.
+	cull = m_RenderGraph->AddPass("Cull second phase", RecordCullPass, &m_GraphPassData[GPU_CULL_PHASE_SECOND]);
+	m_RenderGraph->Read(cull, pyramid, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Read(cull, draws, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, draws, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Read(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, counts, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Read(cull, visibility, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+	m_RenderGraph->Write(cull, visibility, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+
+	AddDrawPasses("Depth pre-pass second phase", "Draw second phase", GPU_CULL_PHASE_SECOND, depth, true, draws, counts);
+
+	CompileRenderGraph(depth);
+}
+
+void VulkanRenderer::CompileRenderGraph(uint depth)
+{
+	if (!IsSceneColourInGraph())
+	{
+		m_RenderGraph->Compile();
+		return;
+	}
+
+	// Every pixel of the history is written, reading what's around it in last frame's.
+	uint upscaleSource = m_SceneColourResource;
+	if (m_GraphTemporal)
+	{
+		uint upsample = m_RenderGraph->AddPass("Temporal upsample", RecordTemporalUpsamplePass, this);
+		m_RenderGraph->Read(upsample, m_SceneColourResource, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+		m_RenderGraph->Read(upsample, m_MotionResource, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+		m_RenderGraph->Read(upsample, depth, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+		m_RenderGraph->Read(upsample, m_PreviousHistoryResource, RENDER_GRAPH_ACCESS_COMPUTE_SAMPLED);
+		m_RenderGraph->Write(upsample, m_HistoryResource, RENDER_GRAPH_ACCESS_COMPUTE_STORAGE);
+		upscaleSource = m_HistoryResource;
+	}
+
+	// Every pixel of the swap chain image is written, so what was there is thrown away.
+	uint upscale = m_RenderGraph->AddPass("Upscale", RecordUpscalePass, this);
+	m_RenderGraph->Read(upscale, upscaleSource, RENDER_GRAPH_ACCESS_TRANSFER_SOURCE);
+	m_RenderGraph->Write(upscale, m_SwapChainResource, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+
+	m_RenderGraph->Compile();
+
+	if (IsDynamicRenderingEnabled())
+		return;
+
+	VkImageView attachments[3];
+	uint attachmentCount = 0;
+	attachments[attachmentCount++] = m_RenderGraph->GetImageView(m_SceneColourResource);
+	if (m_GraphTemporal)
+		attachments[attachmentCount++] = m_RenderGraph->GetImageView(m_MotionResource);
+	attachments[attachmentCount++] = m_VkDepthImageView;
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = m_GraphTemporal ? m_VkMotionRenderPasses[ATTACHMENTS_CLEAR] : m_VkRenderPasses[ATTACHMENTS_CLEAR];
+	framebufferInfo.attachmentCount = attachmentCount;
+	framebufferInfo.pAttachments = attachments;
+	framebufferInfo.width = m_VkSwapChainExtent.width;
+	framebufferInfo.height = m_VkSwapChainExtent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(m_VkLogicalDevice, &framebufferInfo, nullptr, &m_VkSceneFramebuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create scene colour framebuffer!");
+}
+
+void VulkanRenderer::AddDrawPasses(const char* prepassName, const char* drawName, uint phase, uint depth, bool indirect, uint draws, uint counts)
+{
+	// The second phase draws over what the first drew.
+	bool load = phase == GPU_CULL_PHASE_SECOND;
+
+	if (m_DepthPrepass)
+	{
+		uint prepass = m_RenderGraph->AddPass(prepassName, RecordDepthPrepass, &m_GraphPassData[phase]);
+		if (indirect)
+		{
+			m_RenderGraph->Read(prepass, draws, RENDER_GRAPH_ACCESS_INDIRECT);
+			m_RenderGraph->Read(prepass, counts, RENDER_GRAPH_ACCESS_INDIRECT);
+		}
+		if (load)
+			m_RenderGraph->Read(prepass, depth, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+		m_RenderGraph->Write(prepass, depth, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+	}
+
+	uint draw = m_RenderGraph->AddPass(drawName, RecordDrawPass, &m_GraphPassData[phase]);
+	if (indirect)
+	{
+		m_RenderGraph->Read(draw, draws, RENDER_GRAPH_ACCESS_INDIRECT);
+		m_RenderGraph->Read(draw, counts, RENDER_GRAPH_ACCESS_INDIRECT);
+	}
+	if (load)
+		m_RenderGraph->Read(draw, m_ColourResource, RENDER_GRAPH_ACCESS_COLOUR_ATTACHMENT);
+	m_RenderGraph->Write(draw, m_ColourResource, RENDER_GRAPH_ACCESS_COLOUR_ATTACHMENT);
+
+	if (m_GraphTemporal)
+	{
+		if (load)
+			m_RenderGraph->Read(draw, m_MotionResource, RENDER_GRAPH_ACCESS_COLOUR_ATTACHMENT);
+		m_RenderGraph->Write(draw, m_MotionResource, RENDER_GRAPH_ACCESS_COLOUR_ATTACHMENT);
+	}
+
+	// After a pre-pass the depth is only tested against.
+	if (load || m_DepthPrepass)
+		m_RenderGraph->Read(draw, depth, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+	if (!m_DepthPrepass)
+		m_RenderGraph->Write(draw, depth, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+
+	if (m_ShadowAtlas != nullptr)
+		m_RenderGraph->Read(draw, m_ShadowAtlasResource, RENDER_GRAPH_ACCESS_FRAGMENT_SAMPLED);
+}
+
+void VulkanRenderer::AddShadowPasses()
+{
+	RenderGraphResource cache = m_RenderGraph->ImportImage("Shadow cache", m_ShadowAtlas->GetCacheImage(), m_ShadowAtlas->GetCacheImageView(),
+		VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+	m_ShadowAtlasResource = m_RenderGraph->ImportImage("Shadow atlas", m_ShadowAtlas->GetImage(), m_ShadowAtlas->GetImageView(), VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+
+	// The cache keeps the tiles that are still good, so it's read as well as written.
+	uint pass = m_RenderGraph->AddPass("Shadow static casters", RecordShadowStaticPass, this);
+	m_RenderGraph->Read(pass, cache, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+	m_RenderGraph->Write(pass, cache, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+
+	// Every tile in use is copied, so whatever was in the atlas before can be thrown away.
+	pass = m_RenderGraph->AddPass("Shadow cache copy", RecordShadowCopyPass, this);
+	m_RenderGraph->Read(pass, cache, RENDER_GRAPH_ACCESS_TRANSFER_SOURCE);
+	m_RenderGraph->Write(pass, m_ShadowAtlasResource, RENDER_GRAPH_ACCESS_TRANSFER_DESTINATION);
+
+	pass = m_RenderGraph->AddPass("Shadow dynamic casters", RecordShadowDynamicPass, this);
+	m_RenderGraph->Read(pass, m_ShadowAtlasResource, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+	m_RenderGraph->Write(pass, m_ShadowAtlasResource, RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT);
+}
+
+void VulkanRenderer::RecordCullPass(VkCommandBuffer commandBuffer, void* data)
+{
+	GraphPassData* passData = (GraphPassData*)data;
+	passData->m_Renderer->m_FrameGpuCuller->RecordCull(commandBuffer, (GpuCullPhase)passData->m_Phase);
+}
+
+void VulkanRenderer::RecordDrawPass(VkCommandBuffer commandBuffer, void* data)
+{
+	GraphPassData* passData = (GraphPassData*)data;
+	VulkanRenderer* renderer = passData->m_Renderer;
+
+	// The second phase draws over what the first drew. After a pre-pass, only the colour is cleared.
+	AttachmentSetup setup = renderer->m_GraphDepthPrepass ? ATTACHMENTS_CLEAR_COLOUR : ATTACHMENTS_CLEAR;
+	if (passData->m_Phase == GPU_CULL_PHASE_SECOND)
+		setup = ATTACHMENTS_LOAD;
+
+	VkPipeline pipeline = renderer->m_GraphDepthPrepass ? renderer->m_VkDepthEqualPipeline : renderer->m_VkGraphicsPipeline;
+	if (renderer->m_GraphTemporal)
+		pipeline = renderer->m_GraphDepthPrepass ? renderer->m_VkMotionDepthEqualPipeline : renderer->m_VkMotionPipeline;
+	renderer->BeginRendering(commandBuffer, setup, pipeline, renderer->m_FrameImageIndex, renderer->m_FrameDrawConstants);
+	renderer->RecordDraws(commandBuffer, passData->m_Phase);
+	renderer->EndRendering(commandBuffer);
+}
+
+void VulkanRenderer::RecordDepthPrepass(VkCommandBuffer commandBuffer, void* data)
+{
+	GraphPassData* passData = (GraphPassData*)data;
+	VulkanRenderer* renderer = passData->m_Renderer;
+
+	AttachmentSetup setup = passData->m_Phase == GPU_CULL_PHASE_SECOND ? ATTACHMENTS_DEPTH_LOAD : ATTACHMENTS_DEPTH_CLEAR;
+	renderer->BeginRendering(commandBuffer, setup, renderer->m_VkDepthPrepassPipeline, renderer->m_FrameImageIndex, renderer->m_FrameDrawConstants);
+	renderer->RecordDraws(commandBuffer, passData->m_Phase);
+	renderer->EndRendering(commandBuffer);
+}
+
+void VulkanRenderer::RecordDraws(VkCommandBuffer commandBuffer, uint phase)
+{
+	if (m_FrameGpuCuller != nullptr)
+		m_FrameGpuCuller->RecordDraws(commandBuffer, (GpuCullPhase)phase);
+	else
+		m_FrameRenderQueue->RecordDraws(commandBuffer);
+}
+
+void VulkanRenderer::RecordDepthPyramidPass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+	renderer->m_DepthPyramid->Record(commandBuffer);
+}
+
+void VulkanRenderer::RecordShadowStaticPass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+	renderer->m_ShadowAtlas->RecordStaticCasters(commandBuffer);
+}
+
+void VulkanRenderer::RecordShadowCopyPass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+	renderer->m_ShadowAtlas->RecordCopy(commandBuffer);
+}
+
+void VulkanRenderer::RecordShadowDynamicPass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+	renderer->m_ShadowAtlas->RecordDynamicCasters(commandBuffer);
+}
+
+void VulkanRenderer::RecordTemporalUpsamplePass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+	renderer->m_TemporalUpsampler->Record(commandBuffer, renderer->m_RenderGraph->GetImageView(renderer->m_SceneColourResource),
+		renderer->m_RenderGraph->GetImageView(renderer->m_MotionResource));
+}
+
+void VulkanRenderer::RecordUpscalePass(VkCommandBuffer commandBuffer, void* data)
+{
+	VulkanRenderer* renderer = (VulkanRenderer*)data;
+
+	// The history is already the size of the swap chain image, so it's only converted to its format.
+	VkImage source = renderer->m_RenderGraph->GetImage(renderer->m_SceneColourResource);
+	VkExtent2D sourceExtent = renderer->m_RenderExtent;
+	VkFilter filter = renderer->m_VkUpscaleFilter;
+	if (renderer->m_GraphTemporal)
+	{
+		source = renderer->m_TemporalUpsampler->GetHistoryImage();
+		sourceExtent = renderer->m_VkSwapChainExtent;
+		filter = VK_FILTER_NEAREST;
+	}
+
+	VkImageBlit region{};
+	region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.srcSubresource.layerCount = 1;
+	region.srcOffsets[1] = { (int32_t)sourceExtent.width, (int32_t)sourceExtent.height, 1 };
+	region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.dstSubresource.layerCount = 1;
+	region.dstOffsets[1] = { (int32_t)renderer->m_VkSwapChainExtent.width, (int32_t)renderer->m_VkSwapChainExtent.height, 1 };
+
+	vkCmdBlitImage(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renderer->m_VkSwapChainImages[renderer->m_FrameImageIndex],
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, filter);
+}
+
+void VulkanRenderer::BeginRendering(VkCommandBuffer commandBuffer, AttachmentSetup setup, VkPipeline pipeline, uint imageIndex, const DrawConstants& drawConstants)
+{
+	const AttachmentLoadOps& loadOps = ATTACHMENT_LOAD_OPS[setup];
+
+	// Temporal upsampling draws motion vectors too, cleared to not moving.
+	bool motion = loadOps.m_Colour && m_GraphTemporal;
+	uint colourCount = loadOps.m_Colour ? (motion ? 2 : 1) : 0;
+
+	VkClearValue colourClear{};
+	colourClear.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	VkClearValue motionClear{};
+	VkClearValue depthClear{};
+	depthClear.depthStencil = { 1.0f, 0 };
+
+	// Only the render extent is drawn to, the rest of the attachments is left as it was.
+	VkRect2D renderArea;
+	renderArea.offset = { 0, 0 };
+	renderArea.extent = m_RenderExtent;
+
+	if (IsDynamicRenderingEnabled())
+	{
+		// The render graph has the attachments in these layouts already, same as the render pass path expects.
+		VkRenderingAttachmentInfoKHR colourAttachments[2]{};
+		colourAttachments[0].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		colourAttachments[0].imageView = IsSceneColourInGraph() ? m_RenderGraph->GetImageView(m_SceneColourResource) : m_VkSwapChainImageViews[imageIndex];
+		colourAttachments[0].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colourAttachments[0].loadOp = loadOps.m_ColourLoadOp;
+		colourAttachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colourAttachments[0].clearValue = colourClear;
+
+		if (motion)
+		{
+			colourAttachments[1] = colourAttachments[0];
+			colourAttachments[1].imageView = m_RenderGraph->GetImageView(m_MotionResource);
+			colourAttachments[1].clearValue = motionClear;
+		}
+
+		VkRenderingAttachmentInfoKHR depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		depthAttachment.imageView = m_VkDepthImageView;
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = loadOps.m_DepthLoadOp;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.clearValue = depthClear;
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea = renderArea;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = colourCount;
+		renderingInfo.pColorAttachments = colourCount > 0 ? colourAttachments : nullptr;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		m_VkCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+	else
+	{
+		// Clear values go in the same order as the attachments, leaving out the ones the pass doesn't have.
+		VkClearValue clearValues[3];
+		uint clearValueCount = 0;
+		if (loadOps.m_Colour)
+			clearValues[clearValueCount++] = colourClear;
+		if (motion)
+			clearValues[clearValueCount++] = motionClear;
+		clearValues[clearValueCount++] = depthClear;
+
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_VkRenderPass;
-		renderPassInfo.framebuffer = m_VkSwapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = m_VkSwapChainExtent;
+		renderPassInfo.renderPass = motion ? m_VkMotionRenderPasses[setup] : m_VkRenderPasses[setup];
+		renderPassInfo.framebuffer = m_VkDepthFramebuffer;
+		if (loadOps.m_Colour)
+			renderPassInfo.framebuffer = IsSceneColourInGraph() ? m_VkSceneFramebuffer : m_VkSwapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea = renderArea;
+		renderPassInfo.clearValueCount = clearValueCount;
+		renderPassInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
 
-		VkClearValue clearColour = { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColour;
+	VkViewport viewport{};
+	viewport.width = (float)m_RenderExtent.width;
+	viewport.height = (float)m_RenderExtent.height;
+	viewport.maxDepth = 1.0f;
 
-		vkCmdBeginRenderPass(m_VkCommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(m_VkCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkGraphicsPipeline);
-		vkCmdDraw(m_VkCommandBuffers[i], 3, 1, 0, 0);
-		vkCmdEndRenderPass(m_VkCommandBuffers[i]);
+	BindPipeline(commandBuffer, pipeline);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &renderArea);
+	PushDrawConstants(commandBuffer, drawConstants);
+}
 
-		if (vkEndCommandBuffer(m_VkCommandBuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to record command buffer!");
+void VulkanRenderer::BeginShadowRendering(VkCommandBuffer commandBuffer, VkImageView imageView, VkFramebuffer framebuffer, VkExtent2D extent)
+{
+	VkRect2D renderArea;
+	renderArea.offset = { 0, 0 };
+	renderArea.extent = extent;
+
+	if (IsDynamicRenderingEnabled())
+	{
+		VkRenderingAttachmentInfoKHR depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		depthAttachment.imageView = imageView;
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea = renderArea;
+		renderingInfo.layerCount = 1;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		m_VkCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+	else
+	{
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = m_VkRenderPasses[ATTACHMENTS_DEPTH_LOAD];
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea = renderArea;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 	}
+
+	BindPipeline(commandBuffer, m_VkShadowPipeline);
+}
+
+void VulkanRenderer::BindPipeline(VkCommandBuffer commandBuffer, VkPipeline pipeline)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	m_ObjectRingBuffer->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkPipelineLayout, 0);
+	m_BindlessTable->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkPipelineLayout, 1);
+	m_DemoMesh->Bind(commandBuffer, m_VkPipelineLayout);
+}
+
+void VulkanRenderer::PushDrawConstants(VkCommandBuffer commandBuffer, const DrawConstants& drawConstants)
+{
+	vkCmdPushConstants(commandBuffer, m_VkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DrawConstants), &drawConstants);
+}
+
+void VulkanRenderer::EndRendering(VkCommandBuffer commandBuffer)
+{
+	if (IsDynamicRenderingEnabled())
+		m_VkCmdEndRendering(commandBuffer);
+	else
+		vkCmdEndRenderPass(commandBuffer);
 }
\ No newline at end of file
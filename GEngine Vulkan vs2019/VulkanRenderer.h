@@ -1,8 +1,50 @@
 #pragma once
 #include "SwapChainSupportDetails.h"
 #include "QueueFamilyIndices.h"
+#include "DynamicRendering.h"
+#include "VertexLayout.h"
+#include <glm/glm.hpp>
 #include <string>
 
+class GpuCuller;
+class RenderQueue;
+class DepthPyramid;
+class FrameRingBuffer;
+class BindlessTable;
+class DescriptorAllocator;
+class RenderGraph;
+class ShadowAtlas;
+class DynamicResolution;
+class TemporalUpsampler;
+class FrameTimeline;
+class DeletionQueue;
+class GpuMesh;
+
+// Frames the CPU can be writing per frame data for while the GPU works on earlier ones.
+#define MAX_FRAMES_IN_FLIGHT 2
+
+// Queues a frame's work is submitted to. Only passes marked for async compute go on the compute queue.
+enum FrameQueue
+{
+	FRAME_QUEUE_GRAPHICS,
+	FRAME_QUEUE_COMPUTE,
+	FRAME_QUEUE_COUNT
+};
+
+// Push constants for the graphics pipeline.
+struct DrawConstants
+{
+	glm::mat4 m_ViewProjection;
+	// Index of the first object's data in this frame's part of the object ring buffer, added to gl_InstanceIndex.
+	uint m_FirstObject;
+	// Bindless storage buffer index of this frame's light grid, or 0xFFFFFFFF to draw unlit.
+	uint m_LightGrid = 0xFFFFFFFF;
+	// Bindless storage buffer index of this frame's shadow buffer, or 0xFFFFFFFF to draw without shadows.
+	uint m_Shadows = 0xFFFFFFFF;
+	// Bindless storage buffer index of this frame's motion buffer, or 0xFFFFFFFF to not work out motion vectors.
+	uint m_Motion = 0xFFFFFFFF;
+};
+
 class VulkanRenderer
 {
 public:
@@ -20,9 +62,228 @@ public:
 	// Returns: VKSwapchainKHR swap chain object.
 	VkSwapchainKHR GetSwapChain() { return m_VkSwapChain; }
 
-	// Get the command buffers.
-	// Returns: vector of the command buffers.
-	std::vector<VkCommandBuffer> GetCommandBuffers() { return m_VkCommandBuffers; }
+	// Move on to the next frame in flight, waiting for the GPU to finish the frame that last used it, freeing its part of the
+	// object ring buffer and its descriptor sets, and acquire the next swap chain image.
+	// Returns: the swap chain image index.
+	uint BeginFrame();
+
+	// Get the global bindless descriptor set that images, samplers, buffers and materials are added to.
+	// Returns: the bindless table.
+	BindlessTable* GetBindlessTable() { return m_BindlessTable; }
+
+	// Get the allocator for per frame descriptor sets and cached sets that don't change.
+	// Returns: the descriptor allocator.
+	DescriptorAllocator* GetDescriptorAllocator() { return m_DescriptorAllocator; }
+
+	// Get the frame in flight being recorded.
+	// Returns: the frame in flight index.
+	uint GetFrameIndex() { return m_CurrentFrame; }
+
+	// Get the timelines of the queues, for waiting for or checking on frames.
+	// Returns: the frame timeline.
+	FrameTimeline* GetFrameTimeline() { return m_FrameTimeline; }
+
+	// Get the queue to give Vulkan objects to that might still be in use, to destroy once the GPU's done with them.
+	// Returns: the deletion queue.
+	DeletionQueue* GetDeletionQueue() { return m_DeletionQueue; }
+
+	// Wait for the GPU to finish everything submitted so far.
+	void WaitIdle();
+
+	// Get the Vulkan version the device is used with.
+	// Returns: the API version.
+	uint GetApiVersion() { return m_VkApiVersion; }
+
+	// Get the ring buffer per object data is written to each frame, read by the vertex shader.
+	// Returns: the object ring buffer.
+	FrameRingBuffer* GetObjectRingBuffer() { return m_ObjectRingBuffer; }
+
+	// Record the frame in flight's command buffers for a swap chain image by executing the render graph, building it first if the way frames are drawn changed.
+	// Params: the swap chain image index, the camera and where this frame's object data starts,
+	// the render queue built from the visible objects,
+	// the GPU culler to cull and draw every object with instead, or nullptr to draw the render queue.
+	void RecordCommandBuffer(uint imageIndex, const DrawConstants& drawConstants, const RenderQueue* renderQueue, GpuCuller* gpuCuller = nullptr);
+
+	// Submit the command buffers recorded for the frame, each render graph segment to its queue in order, and end the frame on
+	// the frame timeline. The first graphics segment waits for the image to be acquired and the last signals that it can be presented.
+	// Params: the swap chain image index.
+	void SubmitFrame(uint imageIndex);
+
+	// Present a swap chain image once the frame drawing it has finished.
+	// Params: the swap chain image index.
+	void PresentFrame(uint imageIndex);
+
+	// Check if the device has a queue that compute passes can run on alongside the graphics queue.
+	// Returns: if async compute is supported.
+	bool IsAsyncComputeSupported() { return m_VkComputeQueue != VK_NULL_HANDLE; }
+
+	// Run the culling passes on the compute queue, overlapping them with the graphics work they don't depend on. Does nothing
+	// without support for it. Takes effect from the next frame recorded, which builds the render graph again.
+	// Params: if async compute is used.
+	void SetAsyncComputeEnabled(bool enabled) { m_AsyncCompute = enabled && IsAsyncComputeSupported(); }
+
+	// Check if passes are put on the compute queue.
+	// Returns: if async compute is used.
+	bool IsAsyncComputeEnabled() { return m_AsyncCompute; }
+
+	// Get the physical device.
+	// Returns: VkPhysicalDevice used for rendering.
+	VkPhysicalDevice GetPhysicalDevice() { return m_VkPhysicalDevice; }
+
+	// Get the features enabled on the logical device.
+	// Returns: the enabled features.
+	const VkPhysicalDeviceFeatures& GetEnabledFeatures() { return m_VkEnabledFeatures; }
+
+	// Get vkCmdDrawIndexedIndirectCount, if the device supports VK_KHR_draw_indirect_count.
+	// Returns: the function, or nullptr.
+	PFN_vkCmdDrawIndexedIndirectCountKHR GetDrawIndexedIndirectCount() { return m_VkCmdDrawIndexedIndirectCount; }
+
+	// Check if frames are drawn with dynamic rendering instead of render passes and framebuffers.
+	// Returns: if VK_KHR_dynamic_rendering is enabled.
+	bool IsDynamicRenderingEnabled() { return m_VkCmdBeginRendering != nullptr; }
+
+	// Lay down depth in a pass of its own before shading, so the main pass only shades what's visible. The pre-pass
+	// pipeline is made the first time it's enabled. Takes effect from the next frame recorded, which builds the render graph again.
+	// Params: if the depth pre-pass is used.
+	void SetDepthPrepassEnabled(bool enabled);
+
+	// Check if frames have a depth pre-pass.
+	// Returns: if the depth pre-pass is used.
+	bool IsDepthPrepassEnabled() { return m_DepthPrepass; }
+
+	// Pack mesh vertices in another format, making the graphics pipelines again to read it. The old pipelines and
+	// buffers go to the deletion queue, so frames in flight still draw with them.
+	// Params: the vertex format.
+	void SetVertexFormat(VertexFormat format);
+
+	// Get the format mesh vertices are packed in.
+	// Returns: the vertex format.
+	VertexFormat GetVertexFormat() { return m_VertexFormat; }
+
+	// Turn discarding pixels in a dither for objects cross-fading between levels of detail on or off, making the graphics
+	// pipelines again if it changes. Off, the fragment shader never discards, so early depth tests aren't lost.
+	// Params: if the cross-fade dither is on.
+	void SetLodCrossFadeEnabled(bool enabled);
+
+	// Check if objects can cross-fade between levels of detail.
+	// Returns: if the cross-fade dither is on.
+	bool IsLodCrossFadeEnabled() { return m_LodCrossFade != VK_FALSE; }
+
+	// Get the mesh every object is drawn with until objects have meshes of their own.
+	// Returns: the demo mesh.
+	GpuMesh* GetDemoMesh() { return m_DemoMesh; }
+
+	// Draw every object with another mesh instead of the demo triangle. The old mesh's buffers go to the deletion queue.
+	// Params: the mesh, which is copied so it can be packed again if the vertex format changes.
+	void SetDemoMesh(const Mesh& mesh);
+
+	// Draw shadows into an atlas before the main pass, creating it the first time.
+	// Takes effect from the next frame recorded, which builds the render graph again.
+	void EnableShadows();
+
+	// Create the depth pyramid for two phase occlusion culling the first time it's asked for.
+	void EnableDepthPyramid();
+
+	// Get the shadow atlas.
+	// Returns: the shadow atlas, or nullptr if shadows aren't enabled.
+	ShadowAtlas* GetShadowAtlas() { return m_ShadowAtlas; }
+
+	// Begin drawing shadow casters to a depth image the size of an extent, keeping what's there, then bind the
+	// shadow pipeline and the object data. The viewport, scissor and push constants are set for each tile.
+	// Params: the command buffer, the image view in the depth buffer's format, its framebuffer for the shadow render pass, its extent.
+	void BeginShadowRendering(VkCommandBuffer commandBuffer, VkImageView imageView, VkFramebuffer framebuffer, VkExtent2D extent);
+
+	// End drawing started with BeginRendering or BeginShadowRendering.
+	// Params: the command buffer.
+	void EndRendering(VkCommandBuffer commandBuffer);
+
+	// Push the constants for the draws that follow.
+	// Params: the command buffer, the push constants.
+	void PushDrawConstants(VkCommandBuffer commandBuffer, const DrawConstants& drawConstants);
+
+	// Get the render pass shadow framebuffers are made for, which keeps the depth already there.
+	// Returns: the render pass, or VK_NULL_HANDLE with dynamic rendering.
+	VkRenderPass GetShadowRenderPass() { return m_VkRenderPasses[ATTACHMENTS_DEPTH_LOAD]; }
+
+	// Draw the scene into an offscreen colour target at a resolution picked from how long the GPU takes on a frame,
+	// then blit it up to the swap chain image. Creates the controller the first time, and takes effect from the next
+	// frame recorded, which builds the render graph again.
+	// Params: the GPU time to aim for in milliseconds, the smallest and largest scale of each side of the swap chain extent.
+	void EnableDynamicResolution(float targetFrameTime, float minScale, float maxScale);
+
+	// Get the dynamic resolution controller.
+	// Returns: the controller, or nullptr if dynamic resolution isn't enabled.
+	DynamicResolution* GetDynamicResolution() { return m_DynamicResolution; }
+
+	// Draw the scene at a lower resolution with a jittered projection and motion vectors, and rebuild the swap chain
+	// extent from the samples of several frames. Creates the upsampler the first time, and takes effect from the next
+	// frame recorded, which builds the render graph again. With dynamic resolution too, it picks the render extent instead.
+	// Params: the scale of each side of the swap chain extent to draw at.
+	void EnableTemporalUpsampling(float renderScale);
+
+	// Get the temporal upsampler.
+	// Returns: the upsampler, or nullptr if temporal upsampling isn't enabled.
+	TemporalUpsampler* GetTemporalUpsampler() { return m_TemporalUpsampler; }
+
+	// Get the part of the colour target and depth buffer the scene is drawn to this frame, from their top left corner.
+	// Returns: the render extent, the swap chain extent without dynamic resolution or temporal upsampling.
+	VkExtent2D GetRenderExtent() { return m_RenderExtent; }
+
+	// Get the render graph frames are recorded with.
+	// Returns: the render graph.
+	RenderGraph* GetRenderGraph() { return m_RenderGraph; }
+
+	// Get the depth pyramid built from the depth buffer for occlusion culling.
+	// Returns: the depth pyramid, or nullptr if two phase occlusion culling was never turned on.
+	DepthPyramid* GetDepthPyramid() { return m_DepthPyramid; }
+
+	// Get the depth buffer view.
+	// Returns: the depth image view.
+	VkImageView GetDepthImageView() { return m_VkDepthImageView; }
+
+	// Get the format of the depth buffer.
+	// Returns: the depth format.
+	VkFormat GetDepthFormat() { return m_VkDepthFormat; }
+
+	// Get the extents of the swap chain images.
+	// Returns: the extents.
+	VkExtent2D GetSwapChainExtent() { return m_VkSwapChainExtent; }
+
+	// Create a 2D image and bind new memory to it.
+	// Params: width, height, amount of mip levels, format, what it's used for, the image and memory created.
+	void CreateImage(uint width, uint height, uint mipLevels, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory);
+
+	// Create a view of a 2D image.
+	// Params: the image, its format, which aspects to view, first mip level, amount of mip levels.
+	// Returns: the image view.
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, uint baseMipLevel, uint mipLevels);
+
+	// Find a memory type on the physical device.
+	// Params: bit mask of memory types that can be used, properties the memory needs.
+	// Returns: index of the memory type.
+	uint FindMemoryType(uint typeFilter, VkMemoryPropertyFlags properties);
+
+	// Create a buffer and bind new memory to it.
+	// Params: size of the buffer in bytes, what it's used for, properties its memory needs, the buffer and memory created.
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+
+	// Read a file.
+	// Params: the path to the file.
+	// Returns: char vector of the contents of the file.
+	std::vector<char> ReadFile(const std::string& fileName);
+
+	// Create shader modules.
+	// Params: the shader code.
+	// Returns: Vulkan shader module with the shader code.
+	VkShaderModule CreateShaderModule(const std::vector<char>& code);
+
+	// Begin a command buffer for work done once outside of frames, like the first transition of an image.
+	// Returns: the command buffer, recording.
+	VkCommandBuffer BeginSingleTimeCommands();
+
+	// Submit a command buffer from BeginSingleTimeCommands to the graphics queue, wait for it to finish, then free it.
+	// Params: the command buffer.
+	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 
 	// Get the graphics queue.
 	// Returns: VkQueue used as the graphics queue.
@@ -32,6 +293,10 @@ public:
 	// Returns: VkQueue used as the present queue.
 	VkQueue GetPresentQueue() { return m_VkPresentQueue; }
 
+	// Get the async compute queue.
+	// Returns: VkQueue used for async compute, or VK_NULL_HANDLE if it isn't supported.
+	VkQueue GetComputeQueue() { return m_VkComputeQueue; }
+
 private:
 	//-------------------------------------------------------------------------------
 	// Functions.
@@ -58,6 +323,26 @@ private:
 	// Returns: if the device supports the required extensions.
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
 
+	// Check if the device supports the descriptor indexing features bindless resources need.
+	// Params: the device to check.
+	// Returns: if descriptor indexing is supported.
+	bool CheckDescriptorIndexingSupport(VkPhysicalDevice device);
+
+	// Check if the device supports dynamic rendering.
+	// Params: the device to check.
+	// Returns: if VK_KHR_dynamic_rendering and its feature are supported.
+	bool CheckDynamicRenderingSupport(VkPhysicalDevice device);
+
+	// Check if the device supports timeline semaphores, which frames and async compute are synced with.
+	// Params: the device to check.
+	// Returns: if timeline semaphores are core or VK_KHR_timeline_semaphore is supported, and the feature is.
+	bool CheckTimelineSemaphoreSupport(VkPhysicalDevice device);
+
+	// Check if the device supports an extension.
+	// Params: the device to check, the extension name.
+	// Returns: if the extension is supported.
+	bool CheckDeviceExtension(VkPhysicalDevice device, const char* extensionName);
+
 	// Check if validation layers are supported.
 	// Returns: if validation layers are supported.
 	bool CheckValidationLayerSupport();
@@ -109,21 +394,107 @@ private:
 	// Create the view images.
 	void CreateImageViews();
 
-	// Create the graphics pipeline.
-	void CreateGraphicsPipeline();
-
-	// Read a file.
-	// Params: the path to the file.
-	// Returns: char vector of the contents of the file.
-	std::vector<char> ReadFile(const std::string& fileName);
+	// Create the layout the graphics pipelines share: the object data, the bindless table, and the draw and mesh push constants.
+	void CreatePipelineLayout();
 
-	// Create shader modules.
-	// Params: the shader code.
-	// Returns: Vulkan shader module with the shader code.
-	VkShaderModule CreateShaderModule(const std::vector<char>& code);
+	// Create the graphics pipelines, reading vertices in the current vertex format.
+	void CreateGraphicsPipeline();
 
-	// Create a render pass.
-	void CreateRenderPass();
+	// Give the graphics pipelines to the deletion queue and create them again, for frames in flight to finish with the old ones.
+	void RecreateGraphicsPipelines();
+
+	// How a draw pass begins on the attachments.
+	enum AttachmentSetup
+	{
+		// Clear or keep the colour and the depth.
+		ATTACHMENTS_CLEAR,
+		ATTACHMENTS_LOAD,
+		// Clear the colour and keep the depth the pre-pass drew.
+		ATTACHMENTS_CLEAR_COLOUR,
+		// Only the depth, cleared or kept, for the pre-pass.
+		ATTACHMENTS_DEPTH_CLEAR,
+		ATTACHMENTS_DEPTH_LOAD,
+		ATTACHMENTS_COUNT
+	};
+
+	// Create the render passes.
+	void CreateRenderPasses();
+
+	// Create a render pass with a colour, a motion and a depth attachment, or without the motion, or just the depth.
+	// The attachments start and end in their attachment layouts, the render graph does every transition and dependency around it.
+	// Params: what the pass does with the attachments, if it has the motion attachment.
+	// Returns: the render pass.
+	VkRenderPass CreateRenderPass(AttachmentSetup setup, bool motion);
+
+	// Find the first format from a list the device supports.
+	// Params: the formats in order of preference, image tiling, features the format needs.
+	// Returns: the format.
+	VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+
+	// Find a depth format that can be drawn to and sampled.
+	// Returns: the depth format.
+	VkFormat FindDepthFormat();
+
+	// Create the depth buffer.
+	void CreateDepthResources();
+
+	// Begin drawing to the render extent of a swap chain image, or the scene colour target with dynamic resolution or
+	// temporal upsampling, the motion target with temporal upsampling, and the depth buffer, with dynamic rendering or a render pass, then bind a pipeline and the object data, set the
+	// viewport and push the constants.
+	// Params: the command buffer, what to do with the attachments, the pipeline, the swap chain image index, the push constants.
+	void BeginRendering(VkCommandBuffer commandBuffer, AttachmentSetup setup, VkPipeline pipeline, uint imageIndex, const DrawConstants& drawConstants);
+
+	// Bind a pipeline with the object data and bindless table.
+	// Params: the command buffer, the pipeline.
+	void BindPipeline(VkCommandBuffer commandBuffer, VkPipeline pipeline);
+
+	// Ways a frame can be drawn, each with its own render graph.
+	enum FramePath
+	{
+		FRAME_PATH_NONE,
+		FRAME_PATH_RENDER_QUEUE,
+		FRAME_PATH_GPU_CULL,
+		FRAME_PATH_OCCLUSION_CULL
+	};
+
+	// Describe and compile the render graph for a way of drawing frames.
+	// Params: the frame path.
+	void BuildRenderGraph(FramePath framePath);
+
+	// Add the pass drawing a cull phase to the render graph, with a depth pre-pass before it if that's enabled.
+	// Params: names of the pre-pass and the draw pass for the dump, the cull phase, the depth buffer resource,
+	// if the draws come from the cull's draw and count buffers, those buffers' resources.
+	void AddDrawPasses(const char* prepassName, const char* drawName, uint phase, uint depth, bool indirect, uint draws, uint counts);
+
+	// Add the passes drawing the shadow atlas to the render graph: static casters into the cache, the cache copied
+	// into the atlas, then dynamic casters over it.
+	void AddShadowPasses();
+
+	// Render graph passes. They record what's set for the frame in RecordCommandBuffer.
+	// Params: the command buffer, the pass's GraphPassData, or the renderer for the depth pyramid.
+	static void RecordCullPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordDrawPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordDepthPrepass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordDepthPyramidPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordShadowStaticPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordShadowCopyPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordShadowDynamicPass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordTemporalUpsamplePass(VkCommandBuffer commandBuffer, void* data);
+	static void RecordUpscalePass(VkCommandBuffer commandBuffer, void* data);
+
+	// Add the passes taking the scene colour target to the swap chain image, if there is one, then compile the
+	// render graph and make the framebuffer for the scene colour target. With temporal upsampling the target is
+	// upsampled into the history, which is copied to the swap chain image, otherwise the target is blitted up.
+	// Params: the depth buffer resource.
+	void CompileRenderGraph(uint depth);
+
+	// Check if the render graph draws into the scene colour target instead of the swap chain image.
+	// Returns: if the graph was built with dynamic resolution or temporal upsampling.
+	bool IsSceneColourInGraph() { return m_GraphDynamicResolution || m_GraphTemporal; }
+
+	// Record this frame's draws for a cull phase, from the GPU culler or the render queue.
+	// Params: the command buffer, the cull phase.
+	void RecordDraws(VkCommandBuffer commandBuffer, uint phase);
 
 	// Create the framebuffers.
 	void CreateFramebuffers();
@@ -134,6 +505,12 @@ private:
 	// Create command buffers.
 	void CreateCommandBuffers();
 
+	// Create the frame timeline, the deletion queue, and the semaphores for acquiring and presenting swap chain images.
+	void CreateSyncObjects();
+
+	// Create the demo triangle and upload it in the current vertex format.
+	void CreateDemoMesh();
+
 	//-------------------------------------------------------------------------------
 	// Variables.
 	//-------------------------------------------------------------------------------
@@ -173,8 +550,51 @@ private:
 	// The presentation queue.
 	VkQueue m_VkPresentQueue;
 
-	// The vulkan render pass.
-	VkRenderPass m_VkRenderPass;
+	// The queue async compute passes run on, or VK_NULL_HANDLE if the device has none.
+	VkQueue m_VkComputeQueue = VK_NULL_HANDLE;
+
+	// Families of the graphics and compute queues. Buffers are shared between them when they're different.
+	uint m_GraphicsQueueFamily = 0;
+	uint m_ComputeQueueFamily = 0;
+
+	// If culling passes run on the compute queue, and if the render graph was built with them there.
+	bool m_AsyncCompute = false;
+	bool m_GraphAsyncCompute = false;
+
+	// If the render graph was built again since the last frame was submitted, so its waits on the last execute don't apply.
+	bool m_GraphRebuilt = false;
+
+	// A timeline per queue, signalled as each render graph segment finishes, and the frames submitted on them.
+	FrameTimeline* m_FrameTimeline = nullptr;
+
+	// Objects given up while frames that use them are in flight, destroyed as those frames finish.
+	DeletionQueue* m_DeletionQueue = nullptr;
+
+	// The acquire of each frame in flight signals its semaphore. Presenting waits on one per swap chain image, as it's
+	// only known to be done with it once the image is acquired again.
+	VkSemaphore m_VkImageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT] = {};
+	std::vector<VkSemaphore> m_VkRenderFinishedSemaphores;
+
+	// A render pass for each AttachmentSetup. None are made with dynamic rendering.
+	VkRenderPass m_VkRenderPasses[ATTACHMENTS_COUNT] = {};
+
+	// The same with the motion attachment too, for temporal upsampling. Only made for setups with colour.
+	VkRenderPass m_VkMotionRenderPasses[ATTACHMENTS_COUNT] = {};
+
+	// The depth buffer.
+	VkImage m_VkDepthImage;
+	VkDeviceMemory m_VkDepthImageMemory;
+	VkImageView m_VkDepthImageView;
+	VkFormat m_VkDepthFormat;
+
+	// Min and max depth pyramid built from the depth buffer.
+	DepthPyramid* m_DepthPyramid = nullptr;
+
+	// Per object data written each frame, one part per frame in flight.
+	FrameRingBuffer* m_ObjectRingBuffer = nullptr;
+
+	// The frame in flight being recorded.
+	uint m_CurrentFrame = 0;
 
 	// The graphics pipeline layout.
 	VkPipelineLayout m_VkPipelineLayout;
@@ -182,17 +602,78 @@ private:
 	// The graphics pipeline.
 	VkPipeline m_VkGraphicsPipeline;
 
+	// The graphics pipeline testing for depth equal to what the pre-pass drew, without writing it.
+	VkPipeline m_VkDepthEqualPipeline;
+
+	// The graphics pipeline and the depth equal one drawing motion vectors too, for temporal upsampling.
+	VkPipeline m_VkMotionPipeline;
+	VkPipeline m_VkMotionDepthEqualPipeline;
+
+	// Depth only pipeline for the pre-pass, with a vertex shader that only works out positions, or null until the pre-pass is enabled.
+	VkPipeline m_VkDepthPrepassPipeline = VK_NULL_HANDLE;
+
+	// Depth only pipeline for shadow casters, with depth bias, no culling, and the viewport set per tile.
+	VkPipeline m_VkShadowPipeline;
+
+	// Shadow maps drawn before the main pass, or nullptr if shadows aren't enabled.
+	ShadowAtlas* m_ShadowAtlas = nullptr;
+
+	// If the render graph was built with the shadow passes, and the atlas in it.
+	bool m_GraphShadows = false;
+	uint m_ShadowAtlasResource = 0;
+
+	// Picks the render extent each frame, or nullptr if dynamic resolution isn't enabled.
+	DynamicResolution* m_DynamicResolution = nullptr;
+
+	// If the render graph was built with dynamic resolution, and the scene colour target in it.
+	bool m_GraphDynamicResolution = false;
+	uint m_SceneColourResource = 0;
+
+	// Rebuilds the swap chain extent from jittered frames, or nullptr if temporal upsampling isn't enabled.
+	TemporalUpsampler* m_TemporalUpsampler = nullptr;
+
+	// If the render graph was built with temporal upsampling, and the motion target and both history images in it.
+	bool m_GraphTemporal = false;
+	uint m_MotionResource = 0;
+	uint m_HistoryResource = 0;
+	uint m_PreviousHistoryResource = 0;
+
+	// Framebuffer with the scene colour target, the motion target with temporal upsampling, and the depth buffer,
+	// when dynamic rendering isn't used.
+	VkFramebuffer m_VkSceneFramebuffer = VK_NULL_HANDLE;
+
+	// Part of the colour target and depth buffer drawn to this frame.
+	VkExtent2D m_RenderExtent;
+
+	// If the swap chain images can be blitted to in their format, which upscaling needs, and the filter it can use.
+	bool m_UpscaleSupported = false;
+	VkFilter m_VkUpscaleFilter = VK_FILTER_NEAREST;
+
+	// If frames have a depth pre-pass, and if the render graph was built with one.
+	bool m_DepthPrepass = false;
+	bool m_GraphDepthPrepass = false;
+
+	// If the fragment shader dithers objects cross-fading between levels of detail, the specialisation constant for it.
+	VkBool32 m_LodCrossFade = VK_FALSE;
+
 	// View of the swap chain images.
 	std::vector<VkImageView> m_VkSwapChainImageViews;
 
 	// The framebuffers.
 	std::vector<VkFramebuffer> m_VkSwapChainFramebuffers;
 
+	// Framebuffer with just the depth buffer, for the pre-pass.
+	VkFramebuffer m_VkDepthFramebuffer = VK_NULL_HANDLE;
+
 	// Manager of memory for buffers and command buffers.
 	VkCommandPool m_VkCommandPool;
 
-	// The command buffers.
-	std::vector<VkCommandBuffer> m_VkCommandBuffers;
+	// Command pool for the compute queue's family, or VK_NULL_HANDLE without async compute.
+	VkCommandPool m_VkComputeCommandPool = VK_NULL_HANDLE;
+
+	// The command buffers for each queue, a render graph segment's for a frame in flight at the frame index times
+	// the most segments a queue can have plus the segment's index on its queue.
+	std::vector<VkCommandBuffer> m_VkCommandBuffers[FRAME_QUEUE_COUNT];
 
 	// Validation layers
 	std::vector<const char*> m_VkValidationLayers;
@@ -200,6 +681,60 @@ private:
 	// Device extensions.
 	std::vector<const char*> m_VkDeviceExtenstions;
 
+	// Features enabled on the logical device.
+	VkPhysicalDeviceFeatures m_VkEnabledFeatures;
+
+	// Descriptor indexing features enabled on the logical device.
+	VkPhysicalDeviceDescriptorIndexingFeatures m_VkDescriptorIndexingFeatures;
+
+	// The Vulkan version the device is used with, the lower of what the instance and device support, up to 1.2.
+	uint m_VkApiVersion = VK_API_VERSION_1_0;
+
+	// Global descriptor set of bindless resources.
+	BindlessTable* m_BindlessTable = nullptr;
+
+	// Pools for every other descriptor set.
+	DescriptorAllocator* m_DescriptorAllocator = nullptr;
+
+	// Passes of the frame and the barriers between them, built for the current frame path.
+	RenderGraph* m_RenderGraph = nullptr;
+	FramePath m_FramePath = FRAME_PATH_NONE;
+
+	// The swap chain image in the render graph, pointed at this frame's image before executing.
+	uint m_SwapChainResource = 0;
+
+	// What the draw passes draw colour to, the swap chain image or the scene colour target.
+	uint m_ColourResource = 0;
+
+	// What a render graph pass is given, the cull phase it's for. One per GpuCullPhase.
+	struct GraphPassData
+	{
+		VulkanRenderer* m_Renderer;
+		uint m_Phase;
+	};
+	GraphPassData m_GraphPassData[3];
+
+	// What the render graph's passes record this frame.
+	uint m_FrameImageIndex = 0;
+	DrawConstants m_FrameDrawConstants;
+	const RenderQueue* m_FrameRenderQueue = nullptr;
+	GpuCuller* m_FrameGpuCuller = nullptr;
+
+	// Dynamic rendering feature enabled on the logical device, chained after the descriptor indexing features.
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR m_VkDynamicRenderingFeatures;
+
+	// vkCmdBeginRenderingKHR and vkCmdEndRenderingKHR from VK_KHR_dynamic_rendering, or nullptr if it isn't supported.
+	PFN_vkCmdBeginRenderingKHR m_VkCmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR m_VkCmdEndRendering = nullptr;
+
+	// vkCmdDrawIndexedIndirectCount from VK_KHR_draw_indirect_count, or nullptr if it isn't supported.
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_VkCmdDrawIndexedIndirectCount = nullptr;
+
+	// The format mesh vertices are packed in, and the mesh every object is drawn with, as it was given and packed in it.
+	VertexFormat m_VertexFormat = VERTEX_FORMAT_OCTAHEDRAL_16;
+	Mesh m_DemoMeshSource;
+	GpuMesh* m_DemoMesh = nullptr;
+
 	// Width of the window.
 	float m_WindowWidth;
 
@@ -1,12 +1,87 @@
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
 #include "Application.h"
+#include "JobSystem.h"
+#include "MeshCooker.h"
+#include "Benchmark.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 	try
 	{
-		Application* app = new Application();
+		// -cook <files> imports .obj, .gltf and .glb meshes and saves them optimised as .gmesh files, without starting the renderer.
+		if (argc > 1 && strcmp(argv[1], "-cook") == 0)
+		{
+			JobSystem jobSystem;
+			MeshCooker cooker(&jobSystem);
+			return cooker.Cook(std::vector<std::string>(argv + 2, argv + argc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		// -bench [names] times the CPU side systems at the sizes they're meant to handle, without starting the renderer either.
+		if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+		{
+			JobSystem jobSystem;
+			Benchmark benchmark(&jobSystem);
+			return benchmark.Run(std::vector<std::string>(argv + 2, argv + argc)) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		// Owned here so it's destroyed on the way out of an exception too.
+		std::unique_ptr<Application> app = std::make_unique<Application>();
+
+		// -alloctest runs a fixed number of frames and fails if the frame loop allocates.
+		// -gpucull culls with a compute shader, -gpucullcheck does too and fails if it disagrees with the CPU.
+		// -drawstats prints how many draws the visible objects were merged into.
+		// -rendergraph prints the compiled render graph with its barriers and transient memory.
+		// -depthprepass draws depth first and shades with an equal depth test.
+		// -lights scatters 256 point lights around the triangle, shaded with clustered lighting.
+		// -shadows adds a directional light and a wall for the triangle to cast a shadow on, and shadows the lights.
+		// -dynamicres scales the resolution the scene's drawn at to keep the GPU inside 60 fps.
+		// -temporal draws the scene at half resolution and upsamples it over several frames, with -dynamicres picking the resolution instead.
+		// -asynccompute culls on the compute queue, overlapping it with graphics work, with -gpucull.
+		// -floatvertices stores vertices as plain floats, -compactvertices packs normals and tangents into 8 bits a component.
+		// -mesh <file> draws a cooked .gmesh instead of the triangle, -clustercull culls its meshlets one by one with -gpucull.
+		// -lodbias <n> picks the mesh's levels of detail for a performance tier, -1 allowing twice the error on screen and 1 half.
+		// -lodfade cross-fades between levels of detail instead of switching straight away, on the CPU path without -depthprepass.
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "-alloctest") == 0)
+				app->EnableAllocationTest(60, 600);
+			else if (strcmp(argv[i], "-gpucull") == 0)
+				app->EnableGpuCulling(false, 0);
+			else if (strcmp(argv[i], "-gpucullcheck") == 0)
+				app->EnableGpuCulling(true, 600);
+			else if (strcmp(argv[i], "-drawstats") == 0)
+				app->EnableDrawStats(60);
+			else if (strcmp(argv[i], "-rendergraph") == 0)
+				app->EnableRenderGraphDump();
+			else if (strcmp(argv[i], "-depthprepass") == 0)
+				app->EnableDepthPrepass();
+			else if (strcmp(argv[i], "-lights") == 0)
+				app->EnableLights(256);
+			else if (strcmp(argv[i], "-shadows") == 0)
+				app->EnableShadows();
+			else if (strcmp(argv[i], "-dynamicres") == 0)
+				app->EnableDynamicResolution();
+			else if (strcmp(argv[i], "-temporal") == 0)
+				app->EnableTemporalUpsampling();
+			else if (strcmp(argv[i], "-asynccompute") == 0)
+				app->EnableAsyncCompute();
+			else if (strcmp(argv[i], "-floatvertices") == 0)
+				app->EnableVertexFormat(VERTEX_FORMAT_FLOAT);
+			else if (strcmp(argv[i], "-compactvertices") == 0)
+				app->EnableVertexFormat(VERTEX_FORMAT_OCTAHEDRAL_8);
+			else if (strcmp(argv[i], "-mesh") == 0 && i + 1 < argc)
+				app->EnableMesh(argv[++i]);
+			else if (strcmp(argv[i], "-clustercull") == 0)
+				app->EnableClusterCulling();
+			else if (strcmp(argv[i], "-lodbias") == 0 && i + 1 < argc)
+				app->EnableLodQualityBias((float)atof(argv[++i]));
+			else if (strcmp(argv[i], "-lodfade") == 0)
+				app->EnableLodCrossFade();
+		}
 
 		if (app->Startup())
 		{
@@ -15,9 +90,6 @@ int main()
 			app->Run();
 		}	
 
-			delete app;
-			app = nullptr;
-
 		return 0;
 	}
 	catch (const std::exception& e)
@@ -0,0 +1,2 @@
+D:\Vulkan\1.2.148.1\Bin32\glslc.exe cull.comp -o cull.spv
+pause
\ No newline at end of file
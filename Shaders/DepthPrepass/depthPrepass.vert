@@ -0,0 +1,45 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The main pass tests for equal depth, so both have to work out positions exactly the same way.
+invariant gl_Position;
+
+// Only the position, nothing the fragment shader would need.
+layout(location = 0) in vec4 inPosition;
+
+// Per object data, laid out like RenderInstance.
+struct ObjectData
+{
+	mat4 worldMatrix;
+	mat4 previousWorldMatrix;
+	uint objectIndex;
+	uint materialIndex;
+	uint lod;
+	float lodFade;
+};
+
+// This frame's part of the object ring buffer.
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout(push_constant) uniform DrawConstants
+{
+	mat4 viewProjection;
+	uint firstObject;
+	uint lightGrid;
+	uint shadows;
+	uint motion;
+	// MeshConstants, pushed when the mesh is bound.
+	layout(offset = 80) vec4 positionOffset;
+	vec4 positionScale;
+} draw;
+
+void main()
+{
+	ObjectData object = objects[draw.firstObject + gl_InstanceIndex];
+	vec4 position = vec4(draw.positionOffset.xyz + inPosition.xyz * draw.positionScale.xyz, 1.0);
+	vec4 worldPosition = object.worldMatrix * position;
+	gl_Position = draw.viewProjection * worldPosition;
+}
\ No newline at end of file
@@ -1,11 +1,257 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColour;
+layout(location = 1) in vec2 fragUV;
+layout(location = 2) flat in uint fragMaterial;
+layout(location = 3) in vec3 fragWorldPosition;
+layout(location = 4) in vec4 fragCurrentPosition;
+layout(location = 5) in vec4 fragPreviousPosition;
+layout(location = 6) in vec3 fragNormal;
+layout(location = 7) flat in float fragLodFade;
+
+// If objects cross-fading between levels of detail are dithered, set by the pipeline. Off, nothing is discarded and
+// early depth tests stay on.
+layout(constant_id = 1) const bool LOD_CROSS_FADE = false;
 
 layout(location = 0) out vec4 outColour;
+// How far the surface moved in texture coordinates since last frame, and the material's reactive value.
+// Only there when drawing for temporal upsampling, otherwise it's thrown away.
+layout(location = 1) out vec4 outMotion;
+
+#define INVALID_INDEX 0xFFFFFFFF
+
+// Laid out like MaterialData.
+struct Material
+{
+	vec4 colour;
+	uint albedoImage;
+	uint albedoSampler;
+	float reactive;
+};
+
+// The bindless table, indexed by the IDs in the materials.
+layout(set = 1, binding = 0) uniform texture2D images[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+// The same samplers, for the ones that compare depth.
+layout(set = 1, binding = 1) uniform samplerShadow shadowSamplers[];
+
+layout(std430, set = 1, binding = 3) readonly buffer MaterialBuffer
+{
+	Material materials[];
+};
+
+// Laid out like LightGridHeader.
+struct LightGridHeader
+{
+	uvec3 gridSize;
+	uint lightCount;
+	vec2 tileSize;
+	float sliceScale;
+	float sliceBias;
+	float nearPlane;
+	float farPlane;
+	uint clusterOffset;
+	uint indexOffset;
+};
+
+// Laid out like PointLight.
+struct PointLight
+{
+	vec3 position;
+	float radius;
+	vec3 colour;
+	float intensity;
+};
+
+// The light grid is a bindless storage buffer, read as the header and lights, and as words for the clusters and index list.
+layout(std430, set = 1, binding = 2) readonly buffer LightGrid
+{
+	LightGridHeader header;
+	PointLight lights[];
+} lightGrids[];
+
+layout(std430, set = 1, binding = 2) readonly buffer LightGridWords
+{
+	uint words[];
+} lightGridWords[];
+
+// Matches ShadowAtlas.h.
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_MAX_FACES (16 * 6)
+
+// Laid out like ShadowView.
+struct ShadowView
+{
+	mat4 matrix;
+	vec4 bounds;
+};
+
+// Laid out like ShadowHeader.
+struct ShadowHeader
+{
+	uint atlasImage;
+	uint atlasSampler;
+	uint cascadeCount;
+	uint lightCount;
+	vec4 sunDirection;
+	vec4 sunColour;
+	vec4 viewDepth;
+	vec4 cascadeSplits;
+	ShadowView cascades[SHADOW_CASCADE_COUNT];
+};
+
+// The shadow buffer is a bindless storage buffer too, with the point light faces and each light's first face after the header.
+layout(std430, set = 1, binding = 2) readonly buffer Shadows
+{
+	ShadowHeader header;
+	ShadowView faces[SHADOW_MAX_FACES];
+	uint lightFaces[];
+} shadows[];
+
+layout(push_constant) uniform DrawConstants
+{
+	mat4 viewProjection;
+	uint firstObject;
+	uint lightGrid;
+	uint shadows;
+	uint motion;
+} draw;
+
+// Light that isn't from the point lights or the directional light.
+#define AMBIENT_LIGHT 0.1
+
+// Look up how lit a world position is in a shadow atlas tile, 0 for fully in shadow.
+float SampleShadow(ShadowView view, vec3 position)
+{
+	vec4 atlasPosition = view.matrix * vec4(position, 1.0);
+	atlasPosition.xyz /= atlasPosition.w;
+	vec2 uv = clamp(atlasPosition.xy, view.bounds.xy, view.bounds.zw);
+
+	uint atlasImage = shadows[draw.shadows].header.atlasImage;
+	uint atlasSampler = shadows[draw.shadows].header.atlasSampler;
+	return texture(sampler2DShadow(images[atlasImage], shadowSamplers[atlasSampler]), vec3(uv, atlasPosition.z));
+}
+
+// Find how lit a position is by a point light, from the cube face it's in.
+float PointShadow(uint lightIndex, vec3 fromLight)
+{
+	if (draw.shadows == INVALID_INDEX || lightIndex >= shadows[draw.shadows].header.lightCount)
+		return 1.0;
+
+	uint firstFace = shadows[draw.shadows].lightFaces[lightIndex];
+	if (firstFace == INVALID_INDEX)
+		return 1.0;
+
+	// Faces are +x, -x, +y, -y, +z, -z.
+	vec3 axis = abs(fromLight);
+	uint face;
+	if (axis.x >= axis.y && axis.x >= axis.z)
+		face = fromLight.x > 0.0 ? 0 : 1;
+	else if (axis.y >= axis.z)
+		face = fromLight.y > 0.0 ? 2 : 3;
+	else
+		face = fromLight.z > 0.0 ? 4 : 5;
+
+	return SampleShadow(shadows[draw.shadows].faces[firstFace + face], fragWorldPosition);
+}
+
+// Light from the directional light, shadowed by the cascade this pixel's view depth is in.
+vec3 SunLighting(vec3 normal)
+{
+	ShadowHeader header = shadows[draw.shadows].header;
+
+	float depth = dot(header.viewDepth, vec4(fragWorldPosition, 1.0));
+	float shadow = 1.0;
+	for (uint i = 0; i < header.cascadeCount; ++i)
+	{
+		if (depth < header.cascadeSplits[i])
+		{
+			shadow = SampleShadow(header.cascades[i], fragWorldPosition);
+			break;
+		}
+	}
+
+	return header.sunColour.rgb * header.sunDirection.w * shadow * abs(dot(normal, header.sunDirection.xyz));
+}
+
+// Add up the point lights in this pixel's cluster.
+vec3 ClusteredLighting(vec3 normal)
+{
+	LightGridHeader header = lightGrids[draw.lightGrid].header;
+
+	// View depth from the depth buffer value, for a projection with depth from 0 to 1.
+	float depth = header.nearPlane * header.farPlane / (header.farPlane - gl_FragCoord.z * (header.farPlane - header.nearPlane));
+	uint slice = uint(clamp(log(depth) * header.sliceScale + header.sliceBias, 0.0, float(header.gridSize.z - 1)));
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / header.tileSize), header.gridSize.xy - 1);
+	uint cluster = tile.x + tile.y * header.gridSize.x + slice * header.gridSize.x * header.gridSize.y;
+
+	uint first = lightGridWords[draw.lightGrid].words[header.clusterOffset + cluster * 2];
+	uint count = lightGridWords[draw.lightGrid].words[header.clusterOffset + cluster * 2 + 1];
+
+	vec3 lighting = vec3(0.0);
+	for (uint i = 0; i < count; ++i)
+	{
+		uint lightIndex = lightGridWords[draw.lightGrid].words[header.indexOffset + first + i];
+		PointLight light = lightGrids[draw.lightGrid].lights[lightIndex];
+
+		vec3 toLight = light.position - fragWorldPosition;
+		float distance = length(toLight);
+		float falloff = clamp(1.0 - (distance * distance) / (light.radius * light.radius), 0.0, 1.0);
+		float shadow = PointShadow(lightIndex, -toLight);
+		lighting += light.colour * light.intensity * falloff * falloff * shadow * abs(dot(normal, toLight / max(distance, 0.0001)));
+	}
+
+	return lighting;
+}
+
+// Threshold of a 4x4 ordered dither, spread evenly between 0 and 1.
+float BayerThreshold(uvec2 pixel)
+{
+	const uint bayer[16] = uint[](0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5);
+	return (float(bayer[(pixel.y & 3) * 4 + (pixel.x & 3)]) + 0.5) / 16.0;
+}
 
 void main()
 {
-	outColour = vec4(fragColour, 1.0);
+	// The level fading in keeps the pixels under the fade's threshold and the level fading out keeps the rest, so
+	// between them every pixel is drawn once.
+	if (LOD_CROSS_FADE && fragLodFade != 0.0)
+	{
+		bool fadingIn = fragLodFade > 0.0;
+		if ((BayerThreshold(uvec2(gl_FragCoord.xy)) < abs(fragLodFade)) != fadingIn)
+			discard;
+	}
+
+	Material material = materials[fragMaterial];
+
+	vec4 colour = vec4(fragColour, 1.0) * material.colour;
+
+	// Neighbouring pixels can have different materials, so the indices aren't uniform.
+	if (material.albedoImage != INVALID_INDEX)
+		colour *= texture(sampler2D(images[nonuniformEXT(material.albedoImage)], samplers[nonuniformEXT(material.albedoSampler)]), fragUV);
+
+	if (draw.lightGrid != INVALID_INDEX || draw.shadows != INVALID_INDEX)
+	{
+		// Lit from either side, since the demo triangle is seen from both.
+		vec3 normal = normalize(fragNormal);
+
+		vec3 lighting = vec3(AMBIENT_LIGHT);
+		if (draw.lightGrid != INVALID_INDEX)
+			lighting += ClusteredLighting(normal);
+		if (draw.shadows != INVALID_INDEX)
+			lighting += SunLighting(normal);
+
+		colour.rgb *= lighting;
+	}
+
+	outColour = colour;
+
+	// Clip space y goes down the screen like texture coordinates, so the motion only needs halving.
+	vec2 motion = vec2(0.0);
+	if (draw.motion != INVALID_INDEX)
+		motion = (fragCurrentPosition.xy / fragCurrentPosition.w - fragPreviousPosition.xy / fragPreviousPosition.w) * 0.5;
+	outMotion = vec4(motion, material.reactive, 0.0);
 }
\ No newline at end of file
@@ -1,14 +1,66 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Matches the depth pre-pass exactly, for the equal depth test after it.
+invariant gl_Position;
+
+// Laid out by VertexLayout. Quantised positions have the bitangent sign in w, and the tangent isn't read until there are normal maps.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec4 inNormal;
+layout(location = 3) in vec2 inUV;
+
+// If positions are fractions of the mesh's bounds and normals are folded onto an octahedron, set by the pipeline.
+layout(constant_id = 0) const bool OCTAHEDRAL_VERTICES = true;
 
 layout(location = 0) out vec3 fragColour;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragMaterial;
+layout(location = 3) out vec3 fragWorldPosition;
+// Where the vertex is this frame and was last frame, without the jitter, for the motion vector.
+layout(location = 4) out vec4 fragCurrentPosition;
+layout(location = 5) out vec4 fragPreviousPosition;
+layout(location = 6) out vec3 fragNormal;
+// How far through a cross-fade between levels of detail the object is, see RenderInstance.
+layout(location = 7) flat out float fragLodFade;
 
-vec2 positions[3] = vec2[]
-(
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+#define INVALID_INDEX 0xFFFFFFFF
+
+// Per object data, laid out like RenderInstance.
+struct ObjectData
+{
+	mat4 worldMatrix;
+	mat4 previousWorldMatrix;
+	uint objectIndex;
+	uint materialIndex;
+	uint lod;
+	float lodFade;
+};
+
+// This frame's part of the object ring buffer.
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+// Laid out like MotionConstants, a bindless storage buffer.
+layout(std430, set = 1, binding = 2) readonly buffer Motion
+{
+	mat4 viewProjection;
+	mat4 previousViewProjection;
+} motions[];
+
+layout(push_constant) uniform DrawConstants
+{
+	mat4 viewProjection;
+	uint firstObject;
+	uint lightGrid;
+	uint shadows;
+	uint motion;
+	// MeshConstants, pushed when the mesh is bound.
+	layout(offset = 80) vec4 positionOffset;
+	vec4 positionScale;
+} draw;
 
 vec3 colours[3] = vec3[]
 (
@@ -17,8 +69,40 @@ vec3 colours[3] = vec3[]
 	vec3(0.0, 0.0, 1.0)
 );
 
+// Unfold a point on the square back onto the octahedron, the same as VertexLayout's DecodeOctahedral.
+vec3 DecodeOctahedral(vec2 encoded)
+{
+	vec3 vector = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-vector.z, 0.0);
+	vector.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(vector.xy, vec2(0.0)));
+	return normalize(vector);
+}
+
 void main()
 {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColour = colours[gl_VertexIndex];
+	// The first instance of each draw points at its object's data.
+	ObjectData object = objects[draw.firstObject + gl_InstanceIndex];
+	// Float vertices have an offset of 0 and a scale of 1, so this is the same for every format.
+	vec4 position = vec4(draw.positionOffset.xyz + inPosition.xyz * draw.positionScale.xyz, 1.0);
+	vec3 normal = OCTAHEDRAL_VERTICES ? DecodeOctahedral(inNormal.xy) : inNormal.xyz;
+
+	vec4 worldPosition = object.worldMatrix * position;
+	gl_Position = draw.viewProjection * worldPosition;
+	fragWorldPosition = worldPosition.xyz;
+	fragNormal = mat3(object.worldMatrix) * normal;
+	fragColour = colours[gl_VertexIndex % 3];
+	fragUV = inUV;
+	fragMaterial = object.materialIndex;
+	fragLodFade = object.lodFade;
+
+	if (draw.motion != INVALID_INDEX)
+	{
+		fragCurrentPosition = motions[draw.motion].viewProjection * worldPosition;
+		fragPreviousPosition = motions[draw.motion].previousViewProjection * object.previousWorldMatrix * position;
+	}
+	else
+	{
+		fragCurrentPosition = vec4(0.0, 0.0, 0.0, 1.0);
+		fragPreviousPosition = vec4(0.0, 0.0, 0.0, 1.0);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,2 @@
+D:\Vulkan\1.2.148.1\Bin32\glslc.exe temporalUpsample.comp -o temporalUpsample.spv
+pause
\ No newline at end of file